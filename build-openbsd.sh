@@ -19,8 +19,6 @@ CC=`which clang` \
 CXX=`which clang++` \
 cmake .. \
     -DPROFILE=1 \
-    -DXDIFF_INCLUDE_DIR=~/local/usr/local/include \
-    -DXDIFF_LIBRARIES=~/local/usr/local/lib/libxdiff.a \
     -DCMAKE_BUILD_TYPE=$BUILD_TYPE \
     || exit 1
 
@@ -1,7 +1,7 @@
 #!/bin/sh
 
 ###
-# You will also need deutex-git and libxdiff from AUR
+# You will also need deutex-git from AUR
 ###
 
 pacman -S --noconfirm \
@@ -149,6 +149,52 @@ Shortcut {
     func = d2k.Client.set_bobbing
 }
 
+Shortcut {
+    name = 'lump_cache_stats',
+    help = 'lump_cache_stats\n  Show lump cache hits, misses and evictions',
+    func = function()
+        local stats = d2k.Wad.get_lump_cache_stats()
+
+        d2k.Messaging.echo(string.format(
+            'Hits:      %d (%0.2f%%)\n' ..
+            'Misses:    %d\n' ..
+            'Read:      %d KB\n' ..
+            'Evictions: %d\n' ..
+            'Cached:    %d lumps, %d / %d KB',
+            stats.hits,
+            stats.hit_rate * 100,
+            stats.misses,
+            stats.bytes_read / 1024,
+            stats.evictions,
+            stats.lumps_cached,
+            stats.bytes_cached / 1024,
+            stats.budget / 1024
+        ))
+    end
+}
+
+Shortcut {
+    name = 'reset_lump_cache_stats',
+    help = 'reset_lump_cache_stats\n  Reset lump cache hit, miss and ' ..
+           'eviction counts',
+    func = d2k.Wad.reset_lump_cache_stats
+}
+
+Shortcut {
+    name = 'lump_cache_budget',
+    help = 'lump_cache_budget [MiB]\n' ..
+           '  Show or set the lump cache budget, 0 is unlimited',
+    func = function(budget)
+        if budget ~= nil then
+            d2k.Wad.set_lump_cache_budget(budget * 1024 * 1024)
+        end
+
+        d2k.Messaging.echo(string.format('Lump cache budget: %d MiB',
+            d2k.Wad.get_lump_cache_budget() / (1024 * 1024)
+        ))
+    end
+}
+
 func, err = loadfile(d2k.script_folder .. '/local_console_shortcuts.lua', 't')
 
 if not func then
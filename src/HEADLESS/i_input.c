@@ -0,0 +1,94 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "d_event.h"
+#include "i_input.h"
+#include "i_joy.h"
+#include "i_mouse.h"
+
+/* Input backend for the dedicated server, which has no local players */
+
+key_states_t key_states;
+
+int joyleft;
+int joyright;
+int joyup;
+int joydown;
+
+int usejoystick;
+
+void I_InputInit(void) {
+}
+
+void I_InputUpdateKeyStates(void) {
+  key_states.shiftdown = false;
+  key_states.ctrldown  = false;
+  key_states.altdown   = false;
+  key_states.metadown  = false;
+}
+
+void I_InputHandle(void) {
+}
+
+bool I_Responder(event_t *ev) {
+  return false;
+}
+
+const char* I_GetKeyString(int keycode) {
+  return "unknown key";
+}
+
+void I_InitJoystick(void) {
+}
+
+bool I_JoystickEnabled(void) {
+  return false;
+}
+
+void I_MouseInit(void) {
+}
+
+bool I_MouseEnabled(void) {
+  return false;
+}
+
+void I_MouseShutdown(void) {
+}
+
+void I_MouseActivate(void) {
+}
+
+void I_MouseDeactivate(void) {
+}
+
+void I_MouseReset(void) {
+}
+
+void I_MouseUpdateGrab(void) {
+}
+
+/* vi: set et ts=2 sw=2: */
+
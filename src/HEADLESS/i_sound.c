@@ -0,0 +1,139 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "sounds.h"
+#include "i_sound.h"
+#include "w_wad.h"
+
+/* Sound backend for the dedicated server; only lump lookups are real */
+
+bool sound_inited_once = false;
+
+int snd_pcspeaker;
+int snd_card = 1;
+int mus_card = 1;
+int detect_voices = 0;
+int snd_samplerate = 11025;
+int use_experimental_music = 0;
+
+const char *snd_soundfont;
+const char *snd_mididev;
+const char *snd_midiplayer;
+const char *midiplayers[midi_player_last + 1] = {
+  "sdl", "fluidsynth", "opl2", "portmidi", NULL
+};
+const char *music_player_order[] = { NULL };
+
+int mus_fluidsynth_gain;
+int mus_opl_gain;
+
+void I_InitSound(void) {
+  sound_inited_once = true;
+}
+
+void I_ShutdownSound(void) {
+}
+
+void I_SetChannels(void) {
+}
+
+int I_GetSfxLumpNum(sfxinfo_t *sfx) {
+  char namebuf[9];
+  const char *prefix = (snd_pcspeaker ? "dp" : "ds");
+
+  snprintf(namebuf, 9, "%s%s", prefix, sfx->name);
+
+  return W_SafeGetNumForName(namebuf);
+}
+
+int I_StartSound(int id, int channel, int vol, int sep, int pitch,
+                                                        int priority) {
+  return -1;
+}
+
+void I_StopSound(int handle) {
+}
+
+bool I_SoundIsPlaying(int handle) {
+  return false;
+}
+
+bool I_AnySoundStillPlaying(void) {
+  return false;
+}
+
+void I_UpdateSoundParams(int handle, int vol, int sep, int pitch) {
+}
+
+void I_SetSoundCap(void) {
+}
+
+unsigned char* I_GrabSound(int len) {
+  return NULL;
+}
+
+void I_ResampleStream(void *dest, unsigned nsamp,
+                      void (*proc) (void *dest, unsigned nsamp),
+                      unsigned sratein, unsigned srateout) {
+}
+
+void I_InitMusic(void) {
+}
+
+void I_ShutdownMusic(void) {
+}
+
+void I_SetMusicVolume(int volume) {
+}
+
+void I_PauseSong(int handle) {
+}
+
+void I_ResumeSong(int handle) {
+}
+
+int I_RegisterSong(const void *data, size_t len) {
+  return 0;
+}
+
+int I_RegisterMusic(const char *filename, musicinfo_t *music) {
+  return 0;
+}
+
+void I_PlaySong(int handle, bool looping) {
+}
+
+void I_StopSong(int handle) {
+}
+
+void I_UnRegisterSong(int handle) {
+}
+
+void M_ChangeMIDIPlayer(void) {
+}
+
+/* vi: set et ts=2 sw=2: */
+
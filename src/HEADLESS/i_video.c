@@ -0,0 +1,142 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include <SDL.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "r_defs.h"
+#include "v_video.h"
+#include "i_font.h"
+#include "i_video.h"
+
+/* Video backend for the dedicated server; nothing is ever drawn */
+
+#define HEADLESS_SCREENWIDTH  320
+#define HEADLESS_SCREENHEIGHT 200
+
+void R_InitSpritesRes(void);
+void R_InitBuffersRes(void);
+void R_InitMeltRes(void);
+void R_InitPlanesRes(void);
+void R_InitVisplanesRes(void);
+
+const char *screen_resolutions_list[] = {"320x200", NULL};
+const char *screen_resolution = NULL;
+
+int use_gl_surface;
+int process_affinity_mask;
+int process_priority;
+int try_to_reduce_cpu_cache_misses;
+
+bool window_focused = false;
+
+const char *sdl_videodriver;
+const char *sdl_video_window_pos;
+
+int use_doublebuffer = 0;
+int use_fullscreen;
+int desired_fullscreen;
+SDL_Surface *screen = NULL;
+
+void I_PreInitGraphics(void) {
+  if (SDL_Init(0) < 0) {
+    I_Error("Could not initialize SDL [%s]", SDL_GetError());
+  }
+
+  atexit(SDL_Quit);
+}
+
+void I_InitScreenResolution(void) {
+  V_InitMode(VID_MODE32);
+
+  SCREENWIDTH  = HEADLESS_SCREENWIDTH;
+  SCREENHEIGHT = HEADLESS_SCREENHEIGHT;
+  SCREENPITCH  = SCREENWIDTH * V_GetPixelDepth();
+
+  REAL_SCREENWIDTH  = SCREENWIDTH;
+  REAL_SCREENHEIGHT = SCREENHEIGHT;
+  REAL_SCREENPITCH  = SCREENPITCH;
+
+  V_DestroyUnusedTrueColorPalettes();
+  V_FreeScreens();
+
+  for (int i = 0; i < 5; i++) {
+    screens[i].width = REAL_SCREENWIDTH;
+    screens[i].height = REAL_SCREENHEIGHT;
+    screens[i].byte_pitch = REAL_SCREENPITCH;
+    screens[i].int_pitch = REAL_SCREENPITCH / V_GetModePixelDepth(VID_MODE32);
+  }
+
+  R_InitMeltRes();
+  R_InitSpritesRes();
+  R_InitBuffersRes();
+  R_InitPlanesRes();
+  R_InitVisplanesRes();
+
+  D_Msg(MSG_INFO, "I_InitScreenResolution: Headless (%dx%d)\n",
+    REAL_SCREENWIDTH, REAL_SCREENHEIGHT
+  );
+}
+
+void I_InitGraphics(void) {
+}
+
+void I_UpdateVideoMode(void) {
+}
+
+void I_ShutdownGraphics(void) {
+}
+
+void I_SetPalette(int pal) {
+}
+
+unsigned char* I_GrabScreen(void) {
+  return NULL;
+}
+
+void I_UpdateNoBlit(void) {
+}
+
+void I_FinishUpdate(void) {
+}
+
+int I_ScreenShot(const char *fname) {
+  return -1;
+}
+
+int I_GetScreenStride(void) {
+  return REAL_SCREENPITCH;
+}
+
+void I_VideoUpdateFocus(void) {
+  window_focused = false;
+}
+
+void I_LoadCustomFonts(void) {
+}
+
+/* vi: set et ts=2 sw=2: */
+
@@ -28,7 +28,9 @@
 typedef BOOL (WINAPI *SetAffinityFunc)(HANDLE hProcess, DWORD mask);
 #endif
 
+#ifndef DEDICATED_SERVER
 #include "TEXTSCREEN/txt_main.h"
+#endif
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -71,6 +73,7 @@ typedef BOOL (WINAPI *SetAffinityFunc)(HANDLE hProcess, DWORD mask);
 #include "xs_main.h"
 #include "xst_main.h"
 #include "xv_main.h"
+#include "xw_main.h"
 
 #include "icon.c"
 
@@ -165,6 +168,7 @@ static void print_version(void) {
   D_Msg(MSG_INFO, "%s\n", I_GetVersionString(vbuf, 200));
 }
 
+#ifndef DEDICATED_SERVER
 //
 // ENDOOM support using text mode emulation
 //
@@ -237,6 +241,7 @@ static void end_doom(void) {
     TXT_Shutdown();
   }
 }
+#endif
 
 /* I_EndDoom
  * Prints out ENDOOM or ENDBOOM, using some common sense to decide which.
@@ -373,8 +378,10 @@ static void quit(void)
     has_exited=1;   /* Prevent infinitely recursive exits -- killough */
 
   if (has_exited == 1) {
+#ifndef DEDICATED_SERVER
     if (!demorecording)
       end_doom();
+#endif
 
     if (demorecording)
       G_CheckDemoStatus();
@@ -853,6 +860,7 @@ int main(int argc, char **argv) {
   XST_RegisterInterface();
   XS_RegisterInterface();
   XV_RegisterInterface();
+  XW_RegisterInterface();
 
   X_ExposeInterfaces(NULL);
 
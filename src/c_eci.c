@@ -35,7 +35,7 @@
 
 #include "n_uds.h"
 
-/* CG [TODO]: Make this configurable */
+/* Used unless the caller names one, e.g. for hosted instances */
 #define D2K_SERVER_SOCKET_NAME "d2k.sock"
 
 static uds_t uds;
@@ -52,12 +52,16 @@ static void eci_cleanup(void) {
   N_UDSFree(&uds);
 }
 
-void C_ECIInitUNIX(void) {
+void C_ECIInitUNIX(const char *socket_name) {
   memset(&uds, 0, sizeof(uds_t));
 
+  if (!socket_name) {
+    socket_name = D2K_SERVER_SOCKET_NAME;
+  }
+
   N_UDSInit(
     &uds,
-    D2K_SERVER_SOCKET_NAME,
+    socket_name,
     handle_data,
     handle_oob,
     true
@@ -81,7 +85,7 @@ void C_ECIServiceUNIX(void) {
 
 #endif
 
-void C_ECIInitNonUNIX(void) {}
+void C_ECIInitNonUNIX(const char *socket_name) {}
 
 void C_ECIServiceNonUNIX(void) {}
 
@@ -32,10 +32,10 @@
 #define C_ECIService C_ECIServiceNonUNIX
 #endif
 
-void C_ECIInitUNIX(void);
+void C_ECIInitUNIX(const char *socket_name);
 void C_ECIServiceUNIX(void);
 
-void C_ECIInitNonUNIX(void);
+void C_ECIInitNonUNIX(const char *socket_name);
 void C_ECIServiceNonUNIX(void);
 
 #endif
@@ -130,8 +130,9 @@ void C_Init(void) {
     I_Error("C_Init: Error compiling shorthand regex: %s", error->message);
 
 #ifdef G_OS_UNIX
-  if (SERVER)
-    C_ECIInit();
+  /* Hosted instances open their own ECI socket after they're forked */
+  if (SERVER && !N_HostEnabled())
+    C_ECIInit(NULL);
 #endif
 }
 
@@ -85,6 +85,32 @@ static gamestate_t cl_new_gamestate = GS_BAD;
  */
 static bool cl_needs_init_new = false;
 
+/* Hashes of predicted states by TIC, kept while the server sends hashes */
+#define CL_PREDICTED_HASH_COUNT (TICRATE * 4)
+
+typedef struct cl_predicted_hash_s {
+  int          tic;
+  state_hash_t hash;
+} cl_predicted_hash_t;
+
+static cl_predicted_hash_t cl_predicted_hashes[CL_PREDICTED_HASH_COUNT];
+static bool cl_server_sends_hashes = false;
+
+/*
+ * Only TICs on the server's report spacing are hashed, or every TIC if the
+ * spacing isn't steady.
+ */
+#define CL_REPORT_GAP_COUNT 8
+
+static int cl_reported_tic = -1;
+static int cl_report_gaps[CL_REPORT_GAP_COUNT];
+static unsigned int cl_report_gap_index = 0;
+static unsigned int cl_prediction_hits = 0;
+static unsigned int cl_prediction_misses = 0;
+
+/* Set when the last state received matched the client's prediction */
+static bool cl_prediction_confirmed = false;
+
 static void cl_set_repredicting(int start_tic, int end_tic) {
   cl_repredicting_start_tic = start_tic;
   cl_repredicting_end_tic = end_tic;
@@ -97,13 +123,110 @@ static void cl_clear_repredicting(void) {
   cl_repredicting = false;
 }
 
+/* Reports the sections where the client has diverged from the server */
+static void cl_check_state_hash(game_state_delta_t *delta) {
+  static GString *mismatches = NULL;
+  int saved_gametic = gametic;
+  state_hash_t hash;
+
+  if (!delta->hash.valid) {
+    return;
+  }
+
+  if (!mismatches) {
+    mismatches = g_string_new("");
+  }
+
+  /* Synchronization leaves gametic one past the state's TIC */
+  gametic = delta->to_tic;
+  G_HashCurrentState(&hash);
+  gametic = saved_gametic;
+
+  g_string_truncate(mismatches, 0);
+
+  if (!G_CompareStateHashes(&hash, &delta->hash, mismatches)) {
+    D_Msg(MSG_WARN, "(%d) Desynced from server at %d: %s\n",
+      gametic, delta->to_tic, mismatches->str
+    );
+  }
+}
+
+static void cl_note_reported_tic(int tic) {
+  if (cl_reported_tic != -1 && tic > cl_reported_tic) {
+    cl_report_gaps[cl_report_gap_index] = tic - cl_reported_tic;
+    cl_report_gap_index = (cl_report_gap_index + 1) % CL_REPORT_GAP_COUNT;
+  }
+
+  cl_reported_tic = tic;
+}
+
+static bool cl_server_will_report(int tic) {
+  int gap = cl_report_gaps[0];
+
+  if (cl_reported_tic == -1 || gap <= 1) {
+    return true;
+  }
+
+  for (size_t i = 1; i < CL_REPORT_GAP_COUNT; i++) {
+    if (cl_report_gaps[i] != gap) {
+      return true;
+    }
+  }
+
+  return ((tic - cl_reported_tic) % gap) == 0;
+}
+
+static bool cl_prediction_matches(game_state_delta_t *delta) {
+  cl_predicted_hash_t *predicted =
+    &cl_predicted_hashes[delta->to_tic % CL_PREDICTED_HASH_COUNT];
+
+  if (cl_needs_init_new) {
+    return false;
+  }
+
+  if (predicted->tic != delta->to_tic || gametic <= delta->to_tic) {
+    return false;
+  }
+
+  return G_CompareStateHashes(&predicted->hash, &delta->hash, NULL);
+}
+
+static void cl_update_gamestate(void) {
+  if (cl_new_gamestate != GS_BAD) {
+    if ((cl_new_gamestate != GS_LEVEL) && (G_GetGameState() == GS_LEVEL)) {
+      G_ExitLevel();
+    }
+    G_SetGameState(cl_new_gamestate);
+    cl_new_gamestate = GS_BAD;
+  }
+}
+
 static bool cl_load_new_state(netpeer_t *server) {
   game_state_delta_t *delta = N_PeerGetSyncStateDelta(server);
   bool state_loaded;
 
-  if (!G_ApplyStateDelta(delta)) {
-    P_Echo(consoleplayer, "Error applying state delta");
-    return false;
+  cl_prediction_confirmed = false;
+  cl_server_sends_hashes = delta->hash.valid;
+
+  /*
+   * Already applied on arrival (see N_SyncUpdateStateDelta), so the state
+   * only has to be loaded if the prediction was wrong.
+   */
+  if (delta->hash.valid) {
+    cl_note_reported_tic(delta->to_tic);
+
+    if (cl_prediction_matches(delta)) {
+      D_Msg(MSG_SYNC, "(%d) Prediction for %d confirmed\n",
+        gametic, delta->to_tic
+      );
+      cl_prediction_hits++;
+      cl_prediction_confirmed = true;
+      G_RemoveOldStates(N_RelayGetOldestStateTIC(delta->from_tic));
+      cl_update_gamestate();
+      return true;
+    }
+
+    cl_prediction_misses++;
   }
 
   cl_loading_state = true;
@@ -126,20 +249,18 @@ static bool cl_load_new_state(netpeer_t *server) {
     return false;
   }
 
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    player_t *player;
-    
-    if (!playeringame[i]) {
-      continue;
-    }
-
-    player = &players[i];
+  PLAYERS_FOR_EACH(i) {
+    player_t *player = &players[i];
 
-    if (player->cmdq.commands->len) {
+    if (player->cmdq.count) {
       D_Msg(MSG_SYNC, "(%d) (%d) [ ", gametic, i);
 
-      for (unsigned int i = 0; i < player->cmdq.commands->len; i++) {
-        netticcmd_t *ncmd = g_ptr_array_index(player->cmdq.commands, i);
+      for (unsigned int j = 0; j < player->cmdq.span; j++) {
+        netticcmd_t *ncmd = P_GetCommand(i, j);
+
+        if (!ncmd) {
+          continue;
+        }
 
         D_Msg(MSG_SYNC, "%d/%d/%d ", ncmd->index, ncmd->tic, ncmd->server_tic);
       }
@@ -172,6 +293,9 @@ static bool cl_load_new_state(netpeer_t *server) {
       gametic, N_PeerGetSyncTIC(server)
     );
   }
+  else if (delta->to_tic == N_PeerGetSyncTIC(server)) {
+    cl_check_state_hash(delta);
+  }
 
   D_Msg(MSG_CMD, "Ran sync'd commands, loading latest state\n");
 
@@ -186,15 +310,9 @@ static bool cl_load_new_state(netpeer_t *server) {
 
   R_UpdateInterpolations();
 
-  G_RemoveOldStates(delta->from_tic);
+  G_RemoveOldStates(N_RelayGetOldestStateTIC(delta->from_tic));
 
-  if (cl_new_gamestate != GS_BAD) {
-    if ((cl_new_gamestate != GS_LEVEL) && (G_GetGameState() == GS_LEVEL)) {
-      G_ExitLevel();
-    }
-    G_SetGameState(cl_new_gamestate);
-    cl_new_gamestate = GS_BAD;
-  }
+  cl_update_gamestate();
 
   return true;
 }
@@ -250,7 +368,9 @@ void CL_CheckForStateUpdates(void) {
     return;
   }
 
-  gametic++;
+  if (!cl_prediction_confirmed) {
+    gametic++;
+  }
 
   CL_TrimSynchronizedCommands();
 
@@ -288,7 +408,7 @@ void CL_CheckForStateUpdates(void) {
   }
 #endif
 
-  if (G_GetGameState() == GS_LEVEL) {
+  if ((G_GetGameState() == GS_LEVEL) && (!cl_prediction_confirmed)) {
     CL_RePredict(saved_gametic);
   }
 
@@ -301,6 +421,8 @@ void CL_CheckForStateUpdates(void) {
     N_PeerGetSyncStateDelta(server)->from_tic,
     N_PeerGetSyncCommandIndex(server)
   );
+
+  N_RelayUpdateSync();
 }
 
 void CL_MarkServerOutdated(void) {
@@ -420,6 +542,35 @@ void CL_RePredict(int saved_gametic) {
   cl_clear_repredicting();
 }
 
+/* Called after each TIC, so the hash matches the server's saved state */
+void CL_RecordPredictedStateHash(void) {
+  cl_predicted_hash_t *predicted;
+
+  if (!CLIENT || !cl_server_sends_hashes || cl_synchronizing) {
+    return;
+  }
+
+  if (G_GetGameState() != GS_LEVEL) {
+    return;
+  }
+
+  if (!cl_server_will_report(gametic)) {
+    return;
+  }
+
+  predicted = &cl_predicted_hashes[gametic % CL_PREDICTED_HASH_COUNT];
+  predicted->tic = gametic;
+  G_HashCurrentState(&predicted->hash);
+}
+
+unsigned int CL_GetPredictionHits(void) {
+  return cl_prediction_hits;
+}
+
+unsigned int CL_GetPredictionMisses(void) {
+  return cl_prediction_misses;
+}
+
 bool CL_LoadingState(void) {
   return cl_loading_state;
 }
@@ -442,11 +593,17 @@ void CL_ResetSync(void) {
   cl_state_tic = -1;
   cl_repredicting_start_tic = 0;
   cl_repredicting_end_tic = 0;
+  cl_prediction_confirmed = false;
 
-  for (size_t i = 0; i < MAXPLAYERS; i++) {
-    if (playeringame[i]) {
-      P_ResetPlayerCommands(i);
-    }
+  for (size_t i = 0; i < CL_PREDICTED_HASH_COUNT; i++) {
+    cl_predicted_hashes[i].tic = -1;
+  }
+
+  cl_reported_tic = -1;
+  memset(cl_report_gaps, 0, sizeof(cl_report_gaps));
+
+  PLAYERS_FOR_EACH(i) {
+    P_ResetPlayerCommands(i);
   }
 
   G_ClearStates();
@@ -34,6 +34,9 @@ void       CL_SetAuthorizationLevel(auth_level_e level);
 void       CL_SetNewGameState(gamestate_t new_gamestate);
 void       CL_RePredict(int saved_gametic);
 bool       CL_OccurredDuringRePrediction(int tic);
+void       CL_RecordPredictedStateHash(void);
+unsigned int CL_GetPredictionHits(void);
+unsigned int CL_GetPredictionMisses(void);
 bool       CL_LoadingState(void);
 bool       CL_Synchronizing(void);
 bool       CL_RePredicting(void);
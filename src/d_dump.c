@@ -910,7 +910,7 @@ void D_DumpUpdate(void) {
     }
   }
   else {
-    M_BuildDelta(dump_buf1, dump_buf2, delta_buf);
+    M_BuildDelta(dump_buf1, NULL, dump_buf2, NULL, delta_buf);
 
     M_PBufClear(size_buf);
     M_PBufWriteUInt(size_buf, M_BufferGetSize(delta_buf));
@@ -1402,6 +1402,8 @@ static void DoLooseFiles(void)
     int *count;
   } looses[] = {
     {".wad", &wads, &wadcount},
+    {".pk3", &wads, &wadcount},
+    {".zip", &wads, &wadcount},
     {".lmp", &lmps, &lmpcount},
     {".deh", &dehs, &dehcount},
     {".bex", &dehs, &dehcount},
@@ -1798,6 +1800,14 @@ static void D_DoomMainSetup(void) {
     noblit = M_CheckParm ("-noblit");
   }
 
+#ifdef DEDICATED_SERVER
+  /* d2k-server has nothing to draw to or play sound through */
+  nodrawers   = true;
+  noblit      = true;
+  nosfxparm   = true;
+  nomusicparm = true;
+#endif
+
   //proff 11/22/98: Added setting of viewangleoffset
   p = M_CheckParm("-viewangle");
   if (p) {
@@ -2084,7 +2094,8 @@ static void D_DoomMainSetup(void) {
   D_Msg(MSG_INFO, "S_Init: Setting up sound.\n");
   S_Init(snd_SfxVolume /* *8 */, snd_MusicVolume /* *8*/ );
 
-  if ((!SERVER) && !(M_CheckParm("-nodraw") && M_CheckParm("-nosound")))
+  /* Servers and -nodraw clients can't open a window */
+  if (!nodrawers)
     I_InitGraphics();
 
   graphics_initialized = true;
@@ -2119,6 +2130,9 @@ static void D_DoomMainSetup(void) {
   X_ExposeInterfaces(NULL);
   */
 
+  /* N_HostRun only returns in a freshly forked instance */
+  N_HostRun();
+
   // CPhipps - auto screenshots
   if ((p = M_CheckParm("-autoshot")) && (p < myargc - 2))
     if ((auto_shot_count = auto_shot_time = atoi(myargv[p + 1])))
@@ -190,6 +190,8 @@ bool            noblit;        // for comparative timing purposes
 int             starttime;     // for comparative timing purposes
 int             deathmatch;    // only if started as net death
 bool            playeringame[MAXPLAYERS];
+int             ingame_players[MAXPLAYERS];
+int             ingame_player_count;
 player_t        players[MAXPLAYERS];
 int             upmove;
 int             consoleplayer; // player taking events and displaying
@@ -1095,6 +1097,17 @@ void G_DoLoadLevel(void) {
   if (SERVER) {
     SV_ResyncPeers();
   }
+
+  /* -benchsave [iterations] benchmarks saving the first level, then exits */
+  if ((!MULTINET) && (i = M_CheckParm("-benchsave"))) {
+    int iterations = 0;
+
+    if (i < myargc - 1)
+      iterations = atoi(myargv[i + 1]);
+
+    G_BenchSaveData(iterations);
+    I_SafeExit(0);
+  }
 }
 
 //
@@ -1465,7 +1478,7 @@ void G_Ticker(void) {
         S_StartSound(actor, sfx_telept);
       }
 
-      playeringame[i] = false;
+      G_SetPlayerInGame(i, false);
       players[i].playerstate = PST_LIVE;
     }
   }
@@ -1550,11 +1563,7 @@ void G_Ticker(void) {
     }
 
     // check for special buttons
-    for (i = 0; i < MAXPLAYERS; i++) {
-      if (!playeringame[i]) {
-        continue;
-      }
-
+    PLAYERS_FOR_EACH(i) {
       if (players[i].cmd.buttons & BT_SPECIAL) {
         switch (players[i].cmd.buttons & BT_SPECIALMASK) {
           case BTS_PAUSE:
@@ -1624,10 +1633,8 @@ void G_Ticker(void) {
   }
 
   if (SERVER && gamestate != GS_LEVEL) {
-    for (int i = 0; i < MAXPLAYERS; i++) {
-      if (playeringame[i]) {
-        P_IgnorePlayerCommands(i);
-      }
+    PLAYERS_FOR_EACH(i) {
+      P_IgnorePlayerCommands(i);
     }
   }
 
@@ -1798,8 +1805,8 @@ void G_ChangedPlayerColour(int pn, int cl) {
   R_InitTranslationTables();
 
   // Change translations on existing player mobj's
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if ((gamestate == GS_LEVEL) && playeringame[i] && (players[i].mo != NULL)) {
+  PLAYERS_FOR_EACH(i) {
+    if ((gamestate == GS_LEVEL) && (players[i].mo != NULL)) {
       players[i].mo->flags &= ~MF_TRANSLATION;
       players[i].mo->flags |= ((uint64_t)playernumtotrans[i]) << MF_TRANSSHIFT;
     }
@@ -2179,10 +2186,8 @@ void G_DoCompleted(void) {
 
   G_SetGameAction(ga_nothing);
 
-  for (i = 0; i < MAXPLAYERS; i++) {
-    if (playeringame[i]) {
-      G_PlayerFinishLevel(i);        // take away cards and stuff
-    }
+  PLAYERS_FOR_EACH(i) {
+    G_PlayerFinishLevel(i);        // take away cards and stuff
   }
 
   if (automapmode & am_active) {
@@ -2610,6 +2615,7 @@ void G_ReloadDefaults(void) {
   // killough 2/21/98:
   memset(&playeringame[1], 0, sizeof(playeringame) - sizeof(playeringame[0]));
   // memset(playeringame + 1, 0, sizeof(*playeringame) * (MAXPLAYERS - 1));
+  G_UpdatePlayersInGame();
 
   consoleplayer = 0;
 
@@ -3384,6 +3390,10 @@ void G_SaveRestoreGameOptions(int save) {
     }
   }
 
+  if (!save) {
+    G_UpdatePlayersInGame();
+  }
+
   for (i = 0; i < COMP_TOTAL; i++) {
     if (save) {
       comp_o[i] = comp[i];
@@ -3663,6 +3673,8 @@ const unsigned char* G_ReadDemoHeaderEx(const unsigned char *demo_p, size_t size
     demo_p += MIN_MAXPLAYERS - MAXPLAYERS;
   }
 
+  G_UpdatePlayersInGame();
+
   if (playeringame[1]) {
     netgame = true;
     netdemo = true;
@@ -4086,5 +4098,50 @@ void G_SetGameAction(gameaction_t new_gameaction) {
   }
 }
 
-/* vi: set et ts=2 sw=2: */
+void G_SetPlayerInGame(int playernum, bool in_game) {
+  int index = 0;
+
+  if (playernum < 0 || playernum >= MAXPLAYERS) {
+    I_Error("G_SetPlayerInGame: Invalid player number %d", playernum);
+  }
 
+  if (playeringame[playernum] == in_game) {
+    return;
+  }
+
+  playeringame[playernum] = in_game;
+
+  while (index < ingame_player_count && ingame_players[index] < playernum) {
+    index++;
+  }
+
+  if (in_game) {
+    memmove(
+      &ingame_players[index + 1],
+      &ingame_players[index],
+      (ingame_player_count - index) * sizeof(ingame_players[0])
+    );
+    ingame_players[index] = playernum;
+    ingame_player_count++;
+  }
+  else {
+    ingame_player_count--;
+    memmove(
+      &ingame_players[index],
+      &ingame_players[index + 1],
+      (ingame_player_count - index) * sizeof(ingame_players[0])
+    );
+  }
+}
+
+void G_UpdatePlayersInGame(void) {
+  ingame_player_count = 0;
+
+  for (int i = 0; i < MAXPLAYERS; i++) {
+    if (playeringame[i]) {
+      ingame_players[ingame_player_count++] = i;
+    }
+  }
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -286,6 +286,20 @@ extern  int       upmove;
 extern  bool playeringame[MAXPLAYERS];
 extern  bool realplayeringame[MAXPLAYERS];
 
+/*
+ * In-game player numbers in ascending order.  Use G_SetPlayerInGame, or call
+ * G_UpdatePlayersInGame after rewriting playeringame.
+ */
+extern  int ingame_players[MAXPLAYERS];
+extern  int ingame_player_count;
+
+/* Don't add or remove players inside the loop */
+#define PLAYERS_FOR_EACH(pn)                                                  \
+  for (int pn##_index = 0, pn = 0;                                            \
+       pn##_index < ingame_player_count &&                                    \
+       ((pn = ingame_players[pn##_index]), true);                             \
+       pn##_index++)
+
 //-----------------------------------------
 // Internal parameters, used for engine.
 //
@@ -492,6 +506,9 @@ const unsigned char* G_ReadDemoHeader(const unsigned char *demo_p,
                                       size_t size);
 void G_CalculateDemoParams(const unsigned char *demo_p);
 
+void G_SetPlayerInGame(int playernum, bool in_game);
+void G_UpdatePlayersInGame(void);
+
 #endif
 
 /* vi: set et ts=2 sw=2: */
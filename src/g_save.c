@@ -27,10 +27,12 @@
 #include "doomstat.h"
 #include "d_event.h"
 #include "m_avg.h"
+#include "m_hash.h"
 #include "d_main.h"
 #include "p_user.h"
 #include "g_game.h"
 #include "g_save.h"
+#include "g_state.h"
 #include "m_menu.h"
 #include "n_main.h"
 #include "p_ident.h"
@@ -55,6 +57,10 @@
 // CPhipps - size of version header
 #define VERSIONSIZE 16
 #define SAVESTRINGSIZE  24
+#define BENCH_SAVE_DEFAULT_ITERATIONS 1000
+
+/* Where each section of the last G_WriteSaveData output starts, and its end */
+static size_t save_section_offsets[STATE_SECTION_MAX + 1];
 
 static avg_t average_savebuffer_size;
 static bool average_savebuffer_size_initialized = false;
@@ -237,6 +243,9 @@ void G_WriteSaveData(pbuf_t *savebuffer) {
 
   M_PBufWriteBytes(savebuffer, description, SAVESTRINGSIZE);
 
+  /* The description is local, so the header section starts after it */
+  save_section_offsets[STATE_SECTION_HEADER] = M_PBufGetSize(savebuffer);
+
   memset(name2, 0, sizeof(name2));
 
   // CPhipps - scan for the version header
@@ -299,17 +308,42 @@ void G_WriteSaveData(pbuf_t *savebuffer) {
   // killough 11/98: save revenant tracer state
   M_PBufWriteInt(savebuffer, basetic);
 
+  save_section_offsets[STATE_SECTION_WORLD] = M_PBufGetSize(savebuffer);
   P_ArchiveWorld(savebuffer);
+  save_section_offsets[STATE_SECTION_PLAYERS] = M_PBufGetSize(savebuffer);
   P_ArchivePlayers(savebuffer);
+  save_section_offsets[STATE_SECTION_THINKERS] = M_PBufGetSize(savebuffer);
   P_ArchiveThinkers(savebuffer);
+  save_section_offsets[STATE_SECTION_SPECIALS] = M_PBufGetSize(savebuffer);
   P_ArchiveSpecials(savebuffer);
+  save_section_offsets[STATE_SECTION_RNG] = M_PBufGetSize(savebuffer);
   P_ArchiveRNG(savebuffer);    // killough 1/18/98: save RNG information
+  save_section_offsets[STATE_SECTION_MAP] = M_PBufGetSize(savebuffer);
   P_ArchiveMap(savebuffer);    // killough 1/22/98: save automap information
   M_PBufWriteUChar(savebuffer, 0xe6); // consistency marker
+  save_section_offsets[STATE_SECTION_MAX] = M_PBufGetSize(savebuffer);
 
   G_UpdateAverageSaveSize(M_PBufGetCapacity(savebuffer));
 }
 
+/*
+ * Hashes each section of the save data G_WriteSaveData last wrote into
+ * savebuffer.  The automap is local, so it isn't hashed.
+ */
+void G_HashSaveData(pbuf_t *savebuffer, uint64_t *section_hashes) {
+  const char *data = M_PBufGetData(savebuffer);
+
+  for (int i = 0; i < STATE_SECTION_MAP; i++) {
+    section_hashes[i] = M_HashBytes(
+      data + save_section_offsets[i],
+      save_section_offsets[i + 1] - save_section_offsets[i],
+      0
+    );
+  }
+
+  section_hashes[STATE_SECTION_MAP] = 0;
+}
+
 bool G_ReadSaveData(pbuf_t *savebuffer, bool bail_on_errors,
                                         bool init_new) {
   int i;
@@ -473,6 +507,8 @@ bool G_ReadSaveData(pbuf_t *savebuffer, bool bail_on_errors,
     M_PBufReadBool(savebuffer, &playeringame[i]);
   }
 
+  G_UpdatePlayersInGame();
+
   if (MAXPLAYERS < MIN_MAXPLAYERS) {
     // killough 2/28/98
     bool b = false;
@@ -549,5 +585,55 @@ bool G_ReadSaveData(pbuf_t *savebuffer, bool bail_on_errors,
   return true;
 }
 
-/* vi: set et ts=2 sw=2: */
+/* -benchsave [iterations]: times saving and loading the current level */
+void G_BenchSaveData(int iterations) {
+  pbuf_t savebuffer;
+  size_t save_size;
+  gint64 start;
+  double write_time;
+  double read_time;
+
+  if (iterations <= 0)
+    iterations = BENCH_SAVE_DEFAULT_ITERATIONS;
+
+  M_PBufInit(&savebuffer);
+
+  G_WriteSaveData(&savebuffer);
+  save_size = M_PBufGetSize(&savebuffer);
 
+  start = g_get_monotonic_time();
+
+  for (int i = 0; i < iterations; i++) {
+    M_PBufClear(&savebuffer);
+    G_WriteSaveData(&savebuffer);
+  }
+
+  write_time = (g_get_monotonic_time() - start) / (double)iterations;
+
+  start = g_get_monotonic_time();
+
+  for (int i = 0; i < iterations; i++) {
+    M_PBufSeek(&savebuffer, 0);
+
+    if (!G_ReadSaveData(&savebuffer, true, false))
+      I_Error("G_BenchSaveData: Error reading save data");
+  }
+
+  read_time = (g_get_monotonic_time() - start) / (double)iterations;
+
+  D_Msg(MSG_INFO,
+    "\nSave benchmark: %d iterations, %zu bytes, %d sectors, %d lines\n",
+    iterations, save_size, numsectors, numlines
+  );
+  D_Msg(MSG_INFO, "  %-6s %12s %10s\n", "", "us/save", "MB/s");
+  D_Msg(MSG_INFO, "  %-6s %12.1f %10.1f\n",
+    "write", write_time, save_size / write_time
+  );
+  D_Msg(MSG_INFO, "  %-6s %12.1f %10.1f\n",
+    "read", read_time, save_size / read_time
+  );
+
+  M_PBufFree(&savebuffer);
+}
+
+/* vi: set et ts=2 sw=2: */
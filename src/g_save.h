@@ -29,6 +29,8 @@ int  G_GetAverageSaveSize(void);
 bool G_ReadSaveData(pbuf_t *savebuffer, bool bail_on_errors,
                                         bool init_new);
 void G_WriteSaveData(pbuf_t *savebuffer);
+void G_HashSaveData(pbuf_t *savebuffer, uint64_t *section_hashes);
+void G_BenchSaveData(int iterations);
 
 #endif
 
@@ -28,87 +28,378 @@
 #include "doomdef.h"
 #include "doomstat.h"
 #include "d_event.h"
+#include "m_argv.h"
 #include "m_avg.h"
 #include "m_delta.h"
+#include "m_hash.h"
 #include "p_user.h"
 #include "g_game.h"
 #include "g_save.h"
+#include "p_saveg.h"
 #include "n_main.h"
 #include "g_state.h"
 
+/*
+ * Saved states live in a ring indexed by TIC, within a memory budget
+ * (-statebudget, in MB).  Peers whose sync TIC was evicted get a full state.
+ * Only every Nth state (-statekeyframes) and the latest are kept whole, the
+ * rest as deltas from the state before them.
+ */
+#define STATE_RING_CAPACITY (TICRATE * 8)
+#define STATE_MEMORY_BUDGET (256 * 1024 * 1024)
+#define STATE_KEYFRAME_INTERVAL 16
+#define STATE_MIN_CAPACITY 16384
+
+/* data and records are NULL once the state is reduced to its delta */
+typedef struct state_slot_s {
+  game_state_t state;
+  bool         stored;
+  bool         keyframe;
+  buf_t        delta;
+} state_slot_t;
+
+static state_slot_t  state_slots[STATE_RING_CAPACITY];
 static game_state_t *latest_game_state = NULL;
-static GHashTable *saved_game_states = NULL;
 static GQueue *state_data_buffer_queue = NULL;
+static GQueue *state_records_queue = NULL;
 static avg_t average_state_size;
 static int last_delta_loaded_from_tic = 0;
+static size_t state_memory_budget = STATE_MEMORY_BUDGET;
+static size_t state_resident_bytes = 0;
+static unsigned int state_evictions = 0;
+static int state_keyframe_interval = STATE_KEYFRAME_INTERVAL;
+static int last_keyframe_tic = 0;
+
+/* -nostatehashes turns off per-section state hashes */
+static bool state_hashing = true;
+
+static const char *state_section_names[STATE_SECTION_MAX] = {
+  "header", "world", "players", "thinkers", "specials", "RNG", "map"
+};
+
+/* Rebuilt states alternate between these two */
+static game_state_t  rebuilt_states[2];
+static game_state_t *rebuilt_state = NULL;
+
+/* Unchanged records are copied forward from the last state saved */
+static game_state_t *baseline_state = NULL;
+static unsigned int baseline_generation = 0;
+
+/* Cached by "from" TIC, valid while "to" is the latest state */
+static GHashTable *state_delta_cache = NULL;
+static unsigned int state_delta_cache_hits = 0;
+static unsigned int state_delta_cache_misses = 0;
 
 static void clear_state_buffer(gpointer gp) {
   pbuf_t *pbuf = gp;
 
-  M_PBufClear(pbuf);
+  M_PBufFree(pbuf);
   free(pbuf);
 }
 
-static void clear_game_state_data(gpointer gp) {
-  game_state_t *gs = (game_state_t *)gp;
+static void clear_state_records(gpointer gp) {
+  g_array_free((GArray *)gp, true);
+}
+
+static state_slot_t* get_slot(int tic) {
+  return &state_slots[tic % STATE_RING_CAPACITY];
+}
+
+static state_slot_t* get_stored_slot(int tic) {
+  state_slot_t *slot = get_slot(tic);
+
+  if (!slot->stored || slot->state.tic != tic) {
+    return NULL;
+  }
+
+  return slot;
+}
+
+static void get_state_buffers(game_state_t *gs) {
+  if (g_queue_is_empty(state_data_buffer_queue)) {
+    gs->data = M_PBufNewWithCapacity(
+      MAX(average_state_size.value, STATE_MIN_CAPACITY)
+    );
+  }
+  else {
+    gs->data = g_queue_pop_head(state_data_buffer_queue);
+  }
+
+  if (g_queue_is_empty(state_records_queue)) {
+    gs->records = g_array_new(false, false, sizeof(delta_record_t));
+  }
+  else {
+    gs->records = g_queue_pop_head(state_records_queue);
+  }
+}
+
+static void release_state_buffers(game_state_t *gs) {
+  if (!gs->data) {
+    return;
+  }
 
   M_PBufClear(gs->data);
   g_queue_push_tail(state_data_buffer_queue, gs->data);
   gs->data = NULL;
 
-  free(gs);
+  g_array_set_size(gs->records, 0);
+  g_queue_push_tail(state_records_queue, gs->records);
+  gs->records = NULL;
 }
 
-static gboolean state_is_old(gpointer key, gpointer value, gpointer user_data) {
-  int tic = GPOINTER_TO_INT(user_data);
-  game_state_t *gs = (game_state_t *)value;
+static void free_state_buffers(game_state_t *gs) {
+  if (!gs->data) {
+    return;
+  }
 
-  if (gs->tic < tic) {
-    D_Msg(MSG_STATE, "Removing state %d (< %d)\n", gs->tic, tic);
-    return true;
+  clear_state_buffer(gs->data);
+  gs->data = NULL;
+
+  clear_state_records(gs->records);
+  gs->records = NULL;
+}
+
+static void clear_slot(state_slot_t *slot, bool free_buffers) {
+  if (&slot->state == baseline_state) {
+    baseline_state = NULL;
+  }
+
+  if (free_buffers) {
+    free_state_buffers(&slot->state);
+    M_BufferFree(&slot->delta);
+  }
+  else {
+    release_state_buffers(&slot->state);
+    M_BufferClear(&slot->delta);
+  }
+
+  slot->stored = false;
+  slot->keyframe = false;
+}
+
+/* Also removes later states that can't be rebuilt without it */
+static unsigned int remove_state(state_slot_t *slot, bool free_buffers) {
+  int tic = slot->state.tic;
+  unsigned int removed = 1;
+
+  clear_slot(slot, free_buffers);
+
+  for (int t = tic + 1; t < tic + STATE_RING_CAPACITY; t++) {
+    state_slot_t *next = get_stored_slot(t);
+
+    if (!next || next->state.data) {
+      break;
+    }
+
+    clear_slot(next, free_buffers);
+    removed++;
   }
 
-  return false;
+  return removed;
 }
 
-game_state_t* get_new_state(int tic) {
-  game_state_t *new_gs = malloc(sizeof(game_state_t));
+/* A rebuilt state is only valid until the next one is rebuilt */
+static game_state_t* get_full_state(int tic) {
+  state_slot_t *slot = get_stored_slot(tic);
+  game_state_t *source;
+  int base_tic = tic;
 
-  if (!new_gs) {
-    I_Error("get_new_state: Error allocating new game state");
+  if (!slot) {
+    return NULL;
   }
 
-  if (g_queue_is_empty(state_data_buffer_queue)) {
-    new_gs->data = M_PBufNewWithCapacity(MAX(average_state_size.value, 16384));
+  if (slot->state.data) {
+    return &slot->state;
+  }
+
+  if (rebuilt_state && rebuilt_state->tic == tic) {
+    return rebuilt_state;
+  }
+
+  while (!get_stored_slot(base_tic)->state.data) {
+    base_tic--;
+
+    if (rebuilt_state && rebuilt_state->tic == base_tic) {
+      break;
+    }
+
+    if (!get_stored_slot(base_tic)) {
+      I_Error("get_full_state: No state to rebuild state %d from\n", tic);
+    }
+  }
+
+  if (rebuilt_state && rebuilt_state->tic == base_tic) {
+    source = rebuilt_state;
   }
   else {
-    new_gs->data = g_queue_pop_head(state_data_buffer_queue);
+    source = &get_stored_slot(base_tic)->state;
+  }
+
+  for (int t = base_tic + 1; t <= tic; t++) {
+    state_slot_t *next = get_stored_slot(t);
+    game_state_t *target = &rebuilt_states[0];
+
+    if (source == target) {
+      target = &rebuilt_states[1];
+    }
+
+    if (!target->data) {
+      get_state_buffers(target);
+    }
+
+    M_PBufSeek(source->data, 0);
+    M_BufferSeek(&next->delta, 0);
+
+    if (!M_ApplyDelta(source->data, source->records,
+                      target->data, target->records,
+                      &next->delta)) {
+      I_Error("get_full_state: Error rebuilding state %d\n", t);
+    }
+
+    target->tic = t;
+    rebuilt_state = source = target;
+  }
+
+  return rebuilt_state;
+}
+
+static size_t get_state_size(game_state_t *gs) {
+  if (!gs->data) {
+    return 0;
+  }
+
+  return M_PBufGetCapacity(gs->data) +
+         (gs->records->len * sizeof(delta_record_t));
+}
+
+static void update_resident_bytes(void) {
+  state_resident_bytes = 0;
+
+  for (size_t i = 0; i < STATE_RING_CAPACITY; i++) {
+    state_slot_t *slot = &state_slots[i];
+
+    state_resident_bytes += get_state_size(&slot->state);
+    state_resident_bytes += M_BufferGetCapacity(&slot->delta);
+  }
+
+  for (size_t i = 0; i < 2; i++) {
+    state_resident_bytes += get_state_size(&rebuilt_states[i]);
+  }
+
+  for (GList *node = state_data_buffer_queue->head; node; node = node->next) {
+    state_resident_bytes += M_PBufGetCapacity((pbuf_t *)node->data);
+  }
+}
+
+/* The latest state is never evicted */
+static void enforce_memory_budget(void) {
+  update_resident_bytes();
+
+  while (state_resident_bytes > state_memory_budget &&
+         !g_queue_is_empty(state_data_buffer_queue)) {
+    pbuf_t *pbuf = g_queue_pop_head(state_data_buffer_queue);
+
+    state_resident_bytes -= M_PBufGetCapacity(pbuf);
+    clear_state_buffer(pbuf);
+  }
+
+  while (state_resident_bytes > state_memory_budget) {
+    state_slot_t *oldest = NULL;
+
+    for (size_t i = 0; i < STATE_RING_CAPACITY; i++) {
+      state_slot_t *slot = &state_slots[i];
+
+      if (!slot->stored || &slot->state == latest_game_state) {
+        continue;
+      }
+
+      if (!oldest || slot->state.tic < oldest->state.tic) {
+        oldest = slot;
+      }
+    }
+
+    if (!oldest) {
+      break;
+    }
+
+    D_Msg(MSG_STATE, "Evicting state %d (over budget: %zu > %zu)\n",
+      oldest->state.tic, state_resident_bytes, state_memory_budget
+    );
+
+    state_evictions += remove_state(oldest, true);
+    update_resident_bytes();
   }
+}
+
+static void free_cached_delta(gpointer gp) {
+  game_state_delta_t *delta = (game_state_delta_t *)gp;
 
-  new_gs->tic = tic;
+  G_DeltaFree(delta);
+  free(delta);
+}
+
+static gboolean cached_delta_is_old(gpointer key, gpointer value,
+                                                  gpointer user_data) {
+  int tic = GPOINTER_TO_INT(user_data);
+  game_state_delta_t *delta = (game_state_delta_t *)value;
 
-  return new_gs;
+  return delta->from_tic < tic;
+}
+
+static game_state_t* get_new_state(int tic) {
+  state_slot_t *slot = get_slot(tic);
+
+  if (slot->stored) {
+    if (slot->state.tic != tic) {
+      D_Msg(MSG_STATE, "Evicting state %d (replaced by %d)\n",
+        slot->state.tic, tic
+      );
+      state_evictions += remove_state(slot, false);
+    }
+    else {
+      remove_state(slot, false);
+    }
+  }
+
+  /* Rebuilding went through the state being replaced */
+  if (rebuilt_state && rebuilt_state->tic >= tic) {
+    rebuilt_state = NULL;
+  }
+
+  get_state_buffers(&slot->state);
+
+  slot->state.tic = tic;
+  slot->state.hash.valid = false;
+  slot->stored = true;
+  slot->keyframe = true;
+
+  return &slot->state;
 }
 
 void G_DeltaInit(game_state_delta_t *delta) {
   delta->from_tic = 0;
   delta->to_tic = 0;
+  delta->hash.valid = false;
   M_BufferInit(&delta->data);
 }
 
 void G_DeltaClear(game_state_delta_t *delta) {
   delta->from_tic = 0;
   delta->to_tic = 0;
+  delta->hash.valid = false;
   M_BufferClear(&delta->data);
 }
 
 void G_DeltaFree(game_state_delta_t *delta) {
   delta->from_tic = 0;
   delta->to_tic = 0;
+  delta->hash.valid = false;
   M_BufferFree(&delta->data);
 }
 
 void G_InitStates(void) {
+  int p;
+
 #if DEBUG_STATES
   if (SERVER) {
     D_EnableLogChannel(LOG_STATE, "server-states.log");
@@ -116,36 +407,162 @@ void G_InitStates(void) {
 #endif
   M_AverageInit(&average_state_size);
 
-  if (saved_game_states) {
-    g_hash_table_destroy(saved_game_states);
+  if ((p = M_CheckParm("-statebudget")) && p < myargc - 1) {
+    state_memory_budget = ((size_t)atoi(myargv[p + 1])) * 1024 * 1024;
   }
 
-  saved_game_states = g_hash_table_new_full(
-    g_direct_hash, g_direct_equal, NULL, clear_game_state_data
-  );
+  if (M_CheckParm("-nostatehashes")) {
+    state_hashing = false;
+  }
+
+  if ((p = M_CheckParm("-statekeyframes")) && p < myargc - 1) {
+    state_keyframe_interval = MAX(atoi(myargv[p + 1]), 1);
+  }
+
+  for (size_t i = 0; i < STATE_RING_CAPACITY; i++) {
+    clear_slot(&state_slots[i], true);
+  }
+
+  for (size_t i = 0; i < 2; i++) {
+    free_state_buffers(&rebuilt_states[i]);
+  }
+
+  latest_game_state = NULL;
+  rebuilt_state = NULL;
+  last_keyframe_tic = 0;
 
   if (state_data_buffer_queue) {
     g_queue_free_full(state_data_buffer_queue, clear_state_buffer);
   }
 
   state_data_buffer_queue = g_queue_new();
+
+  if (state_records_queue) {
+    g_queue_free_full(state_records_queue, clear_state_records);
+  }
+
+  state_records_queue = g_queue_new();
+
+  if (state_delta_cache) {
+    g_hash_table_destroy(state_delta_cache);
+  }
+
+  state_delta_cache = g_hash_table_new_full(
+    g_direct_hash, g_direct_equal, NULL, free_cached_delta
+  );
+
+  state_delta_cache_hits = 0;
+  state_delta_cache_misses = 0;
+  state_resident_bytes = 0;
+  state_evictions = 0;
+
+  baseline_state = NULL;
+}
+
+#if DEBUG_STATES
+static void check_incremental_state(game_state_t *gs) {
+  static pbuf_t *full_state = NULL;
+
+  if (!full_state) {
+    full_state = M_PBufNew();
+  }
+
+  M_PBufClear(full_state);
+  G_WriteSaveData(full_state);
+
+  if (M_PBufGetSize(full_state) != M_PBufGetSize(gs->data) ||
+      memcmp(M_PBufGetData(full_state),
+             M_PBufGetData(gs->data),
+             M_PBufGetSize(gs->data))) {
+    D_Msg(MSG_STATE, "Incremental state %d doesn't match full state\n",
+      gs->tic
+    );
+  }
+}
+#endif
+
+/*
+ * The previous state is only reduced to its delta once this one is written,
+ * since it's the source for unchanged records.
+ */
+static void compact_states(game_state_t *previous, game_state_t *gs) {
+  state_slot_t *slot = get_slot(gs->tic);
+  state_slot_t *previous_slot;
+
+  if (state_keyframe_interval > 1 &&
+      previous &&
+      previous->data &&
+      previous->tic == gs->tic - 1 &&
+      gs->tic > last_keyframe_tic &&
+      gs->tic - last_keyframe_tic < state_keyframe_interval) {
+    slot->keyframe = false;
+    M_BufferClear(&slot->delta);
+    M_BuildDelta(
+      previous->data, previous->records, gs->data, gs->records, &slot->delta
+    );
+  }
+  else {
+    last_keyframe_tic = gs->tic;
+  }
+
+  if (!previous) {
+    return;
+  }
+
+  previous_slot = get_stored_slot(previous->tic);
+
+  if (previous_slot &&
+      &previous_slot->state == previous &&
+      previous != gs &&
+      !previous_slot->keyframe) {
+    release_state_buffers(previous);
+  }
 }
 
 void G_SaveState(void) {
-  game_state_t *gs = latest_game_state = get_new_state(gametic);
+  game_state_t *previous = latest_game_state;
+  game_state_t *gs = get_new_state(gametic);
+  bool incremental = baseline_state &&
+                     baseline_generation == archive_generation;
 
   M_PBufClear(gs->data);
+  M_DeltaBeginRecords(gs->data, gs->records);
+
+  if (incremental) {
+    M_DeltaSetRecordSource(baseline_state->data, baseline_state->records);
+  }
+
   G_WriteSaveData(gs->data);
+  M_DeltaEndRecords(gs->data);
+
+  if (state_hashing) {
+    G_HashSaveData(gs->data, gs->hash.sections);
+    gs->hash.valid = true;
+  }
+
+#if DEBUG_STATES
+  if (incremental) {
+    check_incremental_state(gs);
+  }
+#endif
+
+  P_AdvanceArchiveGeneration();
+  baseline_state = latest_game_state = gs;
+  baseline_generation = archive_generation;
 
-  g_hash_table_insert(saved_game_states, GINT_TO_POINTER(gs->tic), gs);
+  compact_states(previous, gs);
 
   M_AverageUpdate(&average_state_size, M_PBufGetCapacity(gs->data));
+
+  enforce_memory_budget();
+}
+
+bool G_HaveState(int tic) {
+  return get_stored_slot(tic) != NULL;
 }
 
 bool G_LoadState(int tic, bool call_init_new) {
-  game_state_t *gs = g_hash_table_lookup(
-    saved_game_states, GINT_TO_POINTER(tic)
-  );
+  game_state_t *gs = get_full_state(tic);
 
   if (!gs) {
     return false;
@@ -158,25 +575,107 @@ bool G_LoadState(int tic, bool call_init_new) {
 }
 
 void G_RemoveOldStates(int tic) {
+  int floor_tic = tic;
+  state_slot_t *floor_slot;
+
+  /* Keep the whole state that tic is rebuilt from */
+  while ((floor_slot = get_stored_slot(floor_tic)) && !floor_slot->state.data) {
+    floor_tic--;
+  }
+
+  for (size_t i = 0; i < STATE_RING_CAPACITY; i++) {
+    state_slot_t *slot = &state_slots[i];
+
+    if (slot->stored && slot->state.tic < floor_tic) {
+      D_Msg(MSG_STATE, "Removing state %d (< %d)\n", slot->state.tic, tic);
+      clear_slot(slot, false);
+    }
+  }
+
   g_hash_table_foreach_remove(
-    saved_game_states, state_is_old, GINT_TO_POINTER(tic)
+    state_delta_cache, cached_delta_is_old, GINT_TO_POINTER(tic)
   );
 }
 
 void G_ClearStates(void) {
-  g_hash_table_remove_all(saved_game_states);
+  baseline_state = NULL;
+  rebuilt_state = NULL;
+  last_keyframe_tic = 0;
+
+  for (size_t i = 0; i < STATE_RING_CAPACITY; i++) {
+    clear_slot(&state_slots[i], false);
+  }
+
+  g_hash_table_remove_all(state_delta_cache);
+}
+
+/* Clients need the record table to apply deltas built against this state */
+void G_WriteStateToPackedBuffer(game_state_t *gs, pbuf_t *pbuf) {
+  M_PBufWriteBytes(pbuf, M_PBufGetData(gs->data), M_PBufGetSize(gs->data));
+  M_PBufWriteArray(pbuf, gs->records->len);
+
+  for (unsigned int i = 0; i < gs->records->len; i++) {
+    delta_record_t *record = &g_array_index(gs->records, delta_record_t, i);
+
+    M_PBufWriteULong(pbuf, record->key);
+    M_PBufWriteUInt(pbuf, record->size);
+  }
 }
 
+/* Validated in place, so a bad state doesn't evict anything */
 game_state_t* G_ReadNewStateFromPackedBuffer(int tic, pbuf_t *pbuf) {
-  game_state_t *gs = get_new_state(tic);
+  game_state_t *gs;
+  const char *data = NULL;
+  size_t size = 0;
+  unsigned int record_count = 0;
+  size_t records_start;
+  uint64_t offset = 0;
+
+  if (!M_PBufReadBytesSlice(pbuf, &data, &size)) {
+    return NULL;
+  }
 
-  if (!M_PBufReadBytes(pbuf, M_PBufGetBuffer(gs->data))) {
-    M_PBufClear(gs->data);
-    free(gs);
+  if (!M_PBufReadArray(pbuf, &record_count)) {
     return NULL;
   }
 
-  g_hash_table_insert(saved_game_states, GINT_TO_POINTER(gs->tic), gs);
+  records_start = M_PBufGetCursor(pbuf);
+
+  for (unsigned int i = 0; i < record_count; i++) {
+    uint64_t key;
+    uint32_t record_size;
+
+    if (!M_PBufReadULong(pbuf, &key)) {
+      return NULL;
+    }
+
+    if (!M_PBufReadUInt(pbuf, &record_size)) {
+      return NULL;
+    }
+
+    offset += record_size;
+  }
+
+  if (offset != size) {
+    return NULL;
+  }
+
+  gs = get_new_state(tic);
+
+  M_BufferWrite(M_PBufGetBuffer(gs->data), data, size);
+  g_array_set_size(gs->records, record_count);
+
+  M_PBufSeek(pbuf, records_start);
+  offset = 0;
+
+  for (unsigned int i = 0; i < record_count; i++) {
+    delta_record_t *record = &g_array_index(gs->records, delta_record_t, i);
+
+    M_PBufReadULong(pbuf, &record->key);
+    M_PBufReadUInt(pbuf, &record->size);
+    record->offset = offset;
+    offset += record->size;
+  }
 
   return gs;
 }
@@ -195,52 +694,231 @@ bool G_LoadLatestState(bool call_init_new) {
   return G_ReadSaveData(latest_game_state->data, true, call_init_new);
 }
 
-bool G_ApplyStateDelta(game_state_delta_t *delta) {
-  game_state_t *gs = g_hash_table_lookup(
-    saved_game_states, GINT_TO_POINTER(delta->from_tic)
-  );
+/* The delta is only read, so it can be borrowed from its message */
+bool G_ApplyStateDelta(int from_tic, int to_tic, const state_hash_t *hash,
+                                                 const char *data,
+                                                 size_t size) {
+  game_state_t *gs = get_full_state(from_tic);
   game_state_t *new_gs = NULL;
+  buf_t delta;
 
   if (!gs) {
     return false;
   }
 
-  new_gs = get_new_state(delta->to_tic);
+  /* The new state would overwrite the one it's built from */
+  if (&get_slot(to_tic)->state == gs) {
+    return false;
+  }
+
+  new_gs = get_new_state(to_tic);
 
   M_PBufSeek(gs->data, 0);
   M_PBufSeek(new_gs->data, 0);
-  M_BufferSeek(&delta->data, 0);
+  M_BufferInitView(&delta, data, size);
 
-  if (!M_ApplyDelta(gs->data, new_gs->data, &delta->data)) {
+  if (!M_ApplyDelta(gs->data, gs->records, new_gs->data, new_gs->records,
+                                             &delta)) {
+    clear_slot(get_slot(to_tic), false);
     return false;
   }
 
-  g_hash_table_insert(saved_game_states, GINT_TO_POINTER(new_gs->tic), new_gs);
+  new_gs->hash = *hash;
+
   G_SetLatestState(new_gs);
 
-  last_delta_loaded_from_tic = delta->from_tic;
+  last_delta_loaded_from_tic = from_tic;
 
   return true;
 }
 
-void G_BuildStateDelta(int tic, game_state_delta_t *delta) {
-  game_state_t *gs = g_hash_table_lookup(
-    saved_game_states, GINT_TO_POINTER(tic)
+game_state_delta_t* G_GetStateDelta(int tic) {
+  game_state_delta_t *cached_delta = g_hash_table_lookup(
+    state_delta_cache, GINT_TO_POINTER(tic)
   );
+  game_state_t *gs;
+
+  if (cached_delta && cached_delta->to_tic == latest_game_state->tic) {
+    state_delta_cache_hits++;
+    return cached_delta;
+  }
+
+  gs = get_full_state(tic);
 
   if (!gs) {
-    I_Error("G_BuildStateDelta: Missing game state %d.\n", tic);
+    I_Error("G_GetStateDelta: Missing game state %d.\n", tic);
   }
 
-  M_BufferClear(&delta->data);
-  M_BuildDelta(gs->data, latest_game_state->data, &delta->data);
+  if (!cached_delta) {
+    cached_delta = malloc(sizeof(game_state_delta_t));
+
+    if (!cached_delta) {
+      I_Error("G_GetStateDelta: Error allocating new state delta");
+    }
+
+    G_DeltaInit(cached_delta);
+    g_hash_table_insert(state_delta_cache, GINT_TO_POINTER(tic), cached_delta);
+  }
+
+  state_delta_cache_misses++;
+
+  M_BufferClear(&cached_delta->data);
+  M_BuildDelta(
+    gs->data,
+    gs->records,
+    latest_game_state->data,
+    latest_game_state->records,
+    &cached_delta->data
+  );
+
+  cached_delta->from_tic = tic;
+  cached_delta->to_tic = latest_game_state->tic;
+  cached_delta->hash = latest_game_state->hash;
+
+  return cached_delta;
+}
+
+/* Safe on sync workers once N_SyncPrepareStateDelta has run */
+void G_BuildStateDelta(int tic, game_state_delta_t *delta) {
+  game_state_delta_t *cached_delta = g_hash_table_lookup(
+    state_delta_cache, GINT_TO_POINTER(tic)
+  );
+
+  if (!cached_delta || cached_delta->to_tic != latest_game_state->tic) {
+    cached_delta = G_GetStateDelta(tic);
+  }
+
+  M_BufferCopy(&delta->data, &cached_delta->data);
 
-  delta->from_tic = tic;
-  delta->to_tic = latest_game_state->tic;
+  delta->from_tic = cached_delta->from_tic;
+  delta->to_tic = cached_delta->to_tic;
+  delta->hash = cached_delta->hash;
+}
+
+/*
+ * Copy of the latest state with only the actors stamped with relevance_mark;
+ * the game must still be at the latest state's TIC.
+ */
+void G_BuildRelevantState(game_state_t *gs, unsigned int relevance_mark) {
+  delta_record_t *records = (delta_record_t *)latest_game_state->records->data;
+  unsigned int record_count = latest_game_state->records->len;
+  unsigned int i = 0;
+  size_t thinkers_start;
+
+  M_PBufClear(gs->data);
+  M_DeltaBeginRecords(gs->data, gs->records);
+  M_DeltaSetRecordSource(latest_game_state->data, latest_game_state->records);
+
+  while (i < record_count &&
+         M_DeltaRecordType(records[i].key) != SAVE_RECORD_THINKERS) {
+    M_DeltaCopyRecord(gs->data,
+      M_DeltaRecordType(records[i].key), M_DeltaRecordID(records[i].key)
+    );
+    i++;
+  }
+
+  thinkers_start = M_PBufGetSize(gs->data);
+
+  P_SetArchiveRelevanceMark(relevance_mark);
+  P_ArchiveThinkers(gs->data);
+  P_SetArchiveRelevanceMark(0);
+
+  gs->hash = latest_game_state->hash;
+
+  if (gs->hash.valid) {
+    gs->hash.sections[STATE_SECTION_THINKERS] = M_HashBytes(
+      M_PBufGetData(gs->data) + thinkers_start,
+      M_PBufGetSize(gs->data) - thinkers_start,
+      0
+    );
+  }
+
+  while (i < record_count &&
+         M_DeltaRecordType(records[i].key) != SAVE_RECORD_SPECIALS) {
+    i++;
+  }
+
+  while (i < record_count) {
+    M_DeltaCopyRecord(gs->data,
+      M_DeltaRecordType(records[i].key), M_DeltaRecordID(records[i].key)
+    );
+    i++;
+  }
+
+  M_DeltaEndRecords(gs->data);
+
+  gs->tic = latest_game_state->tic;
+}
+
+unsigned int G_GetStateDeltaCacheHits(void) {
+  return state_delta_cache_hits;
+}
+
+unsigned int G_GetStateDeltaCacheMisses(void) {
+  return state_delta_cache_misses;
+}
+
+unsigned int G_GetStateEvictions(void) {
+  return state_evictions;
+}
+
+size_t G_GetStateResidentBytes(void) {
+  return state_resident_bytes;
 }
 
 int G_GetStateFromTic(void) {
   return last_delta_loaded_from_tic;
 }
 
+const char* G_GetStateSectionName(state_section_e section) {
+  if (section >= STATE_SECTION_MAX) {
+    return "unknown";
+  }
+
+  return state_section_names[section];
+}
+
+/*
+ * Hashes the game as it is right now, as though it were saved at the current
+ * TIC, so it matches the hashes of saved states.
+ */
+void G_HashCurrentState(state_hash_t *hash) {
+  static pbuf_t *hash_buffer = NULL;
+
+  if (!hash_buffer) {
+    hash_buffer = M_PBufNew();
+  }
+
+  M_PBufClear(hash_buffer);
+  G_WriteSaveData(hash_buffer);
+  G_HashSaveData(hash_buffer, hash->sections);
+  hash->valid = true;
+}
+
+/* Hashes that weren't computed always match */
+bool G_CompareStateHashes(state_hash_t *hash, state_hash_t *other,
+                                              GString *mismatches) {
+  bool match = true;
+
+  if (!hash->valid || !other->valid) {
+    return true;
+  }
+
+  for (int i = 0; i < STATE_SECTION_MAX; i++) {
+    if (hash->sections[i] == other->sections[i]) {
+      continue;
+    }
+
+    if (mismatches) {
+      g_string_append_printf(mismatches, "%s%s",
+        match ? "" : ", ", state_section_names[i]
+      );
+    }
+
+    match = false;
+  }
+
+  return match;
+}
+
 /* vi: set et ts=2 sw=2: */
@@ -24,15 +24,36 @@
 #ifndef G_STATE_H__
 #define G_STATE_H__
 
+/* In the order G_WriteSaveData writes them */
+typedef enum {
+  STATE_SECTION_HEADER,
+  STATE_SECTION_WORLD,
+  STATE_SECTION_PLAYERS,
+  STATE_SECTION_THINKERS,
+  STATE_SECTION_SPECIALS,
+  STATE_SECTION_RNG,
+  STATE_SECTION_MAP,
+  STATE_SECTION_MAX
+} state_section_e;
+
+typedef struct state_hash_s {
+  bool     valid;
+  uint64_t sections[STATE_SECTION_MAX];
+} state_hash_t;
+
 typedef struct game_state_s {
-  int     tic;
-  pbuf_t *data;
+  int          tic;
+  pbuf_t      *data;
+  GArray      *records;
+  state_hash_t hash;
 } game_state_t;
 
+/* hash is the hash of the state at to_tic */
 typedef struct game_state_delta_s {
-  int   from_tic;
-  int   to_tic;
-  buf_t data;
+  int          from_tic;
+  int          to_tic;
+  buf_t        data;
+  state_hash_t hash;
 } game_state_delta_t;
 
 void G_DeltaInit(game_state_delta_t *delta);
@@ -41,16 +62,31 @@ void G_DeltaFree(game_state_delta_t *delta);
 
 void          G_InitStates(void);
 void          G_SaveState(void);
+bool          G_HaveState(int tic);
 bool          G_LoadState(int tic, bool call_init_new);
 void          G_RemoveOldStates(int tic);
 void          G_ClearStates(void);
 game_state_t* G_ReadNewStateFromPackedBuffer(int tic, pbuf_t *pbuf);
+void          G_WriteStateToPackedBuffer(game_state_t *gs, pbuf_t *pbuf);
 game_state_t* G_GetLatestState(void);
 void          G_SetLatestState(game_state_t *state);
 bool          G_LoadLatestState(bool call_init_new);
-bool          G_ApplyStateDelta(game_state_delta_t *delta);
+bool          G_ApplyStateDelta(int from_tic, int to_tic,
+                                const state_hash_t *hash,
+                                const char *data, size_t size);
+game_state_delta_t* G_GetStateDelta(int tic);
 void          G_BuildStateDelta(int tic, game_state_delta_t *delta);
+void          G_BuildRelevantState(game_state_t *gs,
+                                   unsigned int relevance_mark);
 int           G_GetStateFromTic(void);
+unsigned int  G_GetStateDeltaCacheHits(void);
+unsigned int  G_GetStateDeltaCacheMisses(void);
+unsigned int  G_GetStateEvictions(void);
+size_t        G_GetStateResidentBytes(void);
+const char*   G_GetStateSectionName(state_section_e section);
+void          G_HashCurrentState(state_hash_t *hash);
+bool          G_CompareStateHashes(state_hash_t *hash, state_hash_t *other,
+                                                       GString *mismatches);
 
 #endif
 
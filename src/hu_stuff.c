@@ -1617,22 +1617,17 @@ void HU_widget_build_keys(void)
     {
       int top1=-999,top2=-999,top3=-999,top4=-999;
       int idx1=-1,idx2=-1,idx3=-1,idx4=-1;
-      int fragcount,m;
+      int fragcount;
       char numbuf[32];
 
-      // scan thru players
-      for (k=0;k<MAXPLAYERS;k++)
+      // scan thru players in game
+      PLAYERS_FOR_EACH(k)
       {
-        // skip players not in game
-        if (!playeringame[k])
-          continue;
-
         fragcount = 0;
         // compute number of times they've fragged each player
         // minus number of times they've been fragged by them
-        for (m=0;m<MAXPLAYERS;m++)
+        PLAYERS_FOR_EACH(m)
         {
-          if (!playeringame[m]) continue;
           fragcount += (m!=k)?  players[k].frags[m] : -players[k].frags[m];
         }
 
@@ -1793,7 +1788,6 @@ void HU_widget_draw_keys(void)
 
 void HU_widget_build_monsec(void)
 {
-  int i;
   char *s;
 
   //e6y
@@ -1824,29 +1818,26 @@ void HU_widget_build_monsec(void)
     fullkillcount = 0;
     fullitemcount = 0;
     fullsecretcount = 0;
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    PLAYERS_FOR_EACH(i)
     {
-      if (playeringame[i])
+      color = i==displayplayer?0x33:0x32;
+      if (playerscount==0)
       {
-        color = i==displayplayer?0x33:0x32;
-        if (playerscount==0)
-        {
-          allkills_len = sprintf(allkills, "\x1b%c%d", color, players[i].killcount - players[i].resurectedkillcount);
-          allsecrets_len = sprintf(allsecrets, "\x1b%c%d", color, players[i].secretcount);
-        }
-        else
+        allkills_len = sprintf(allkills, "\x1b%c%d", color, players[i].killcount - players[i].resurectedkillcount);
+        allsecrets_len = sprintf(allsecrets, "\x1b%c%d", color, players[i].secretcount);
+      }
+      else
+      {
+        if (allkills_len >= 0 && allsecrets_len >=0)
         {
-          if (allkills_len >= 0 && allsecrets_len >=0)
-          {
-            allkills_len += sprintf(&allkills[allkills_len], "\x1b%c+%d", color, players[i].killcount - players[i].resurectedkillcount);
-            allsecrets_len += sprintf(&allsecrets[allsecrets_len], "\x1b%c+%d", color, players[i].secretcount);
-          }
+          allkills_len += sprintf(&allkills[allkills_len], "\x1b%c+%d", color, players[i].killcount - players[i].resurectedkillcount);
+          allsecrets_len += sprintf(&allsecrets[allsecrets_len], "\x1b%c+%d", color, players[i].secretcount);
         }
-        playerscount++;
-        fullkillcount += players[i].killcount - players[i].resurectedkillcount;
-        fullitemcount += players[i].itemcount;
-        fullsecretcount += players[i].secretcount;
       }
+      playerscount++;
+      fullkillcount += players[i].killcount - players[i].resurectedkillcount;
+      fullitemcount += players[i].itemcount;
+      fullsecretcount += players[i].secretcount;
     }
     killcolor = (fullkillcount >= totalkills ? 0x37 : 0x35);
     secretcolor = (fullsecretcount >= totalsecret ? 0x37 : 0x35);
@@ -65,6 +65,14 @@ void M_BufferInitWithCapacity(buf_t *buf, size_t capacity) {
   M_BufferEnsureTotalCapacity(buf, capacity);
 }
 
+/* A view must not be written to, grown, cleared or freed */
+void M_BufferInitView(buf_t *buf, const void *data, size_t size) {
+  buf->capacity = size;
+  buf->size = size;
+  buf->cursor = 0;
+  buf->data = (char *)data;
+}
+
 size_t M_BufferGetCapacity(buf_t *buf) {
   return buf->capacity;
 }
@@ -339,6 +347,17 @@ bool M_BufferRead(buf_t *buf, void *data, size_t size) {
   return true;
 }
 
+/* data is only valid until buf is next written to, cleared or freed */
+bool M_BufferReadSlice(buf_t *buf, size_t size, const char **data) {
+  if (size > buf->size - buf->cursor)
+    return false;
+
+  *data = buf->data + buf->cursor;
+  buf->cursor += size;
+
+  return true;
+}
+
 bool M_BufferReadBool(buf_t *buf, bool *b) {
   return M_BufferReadBools(buf, b, 1);
 }
@@ -35,6 +35,7 @@ buf_t* M_BufferNew(void);
 buf_t* M_BufferNewWithCapacity(size_t capacity);
 void   M_BufferInit(buf_t *buf);
 void   M_BufferInitWithCapacity(buf_t *buf, size_t capacity);
+void   M_BufferInitView(buf_t *buf, const void *data, size_t size);
 
 size_t M_BufferGetCapacity(buf_t *buf);
 size_t M_BufferGetSize(buf_t *buf);
@@ -93,6 +94,7 @@ bool M_BufferEqualsString(buf_t *buf, const char *s);
 bool M_BufferEqualsData(buf_t *buf, const void *d, size_t size);
 
 bool M_BufferRead(buf_t *buf, void *data, size_t size);
+bool M_BufferReadSlice(buf_t *buf, size_t size, const char **data);
 bool M_BufferReadBool(buf_t *buf, bool *b);
 bool M_BufferReadBools(buf_t *buf, bool *b, size_t count);
 bool M_BufferReadChar(buf_t *buf, char *c);
@@ -27,124 +27,651 @@
 
 #include "z_zone.h"
 
-#include <xdiff.h>
-
 #include "doomdef.h"
 #include "m_delta.h"
 
-#define BLKSIZE 1024
+/*
+ * A delta describes the new state's records as operations on the old ones:
+ *
+ * - COPY:   <old index> <count>, records that didn't change at all
+ * - PATCH:  <old index> <runs>, records where only some fields changed.  Runs
+ *           are <skip> <take> pairs followed by the <take> changed fields,
+ *           terminated by 0 0.
+ * - INSERT: <key> <size> <bytes>, records with no usable counterpart
+ *
+ * Fields are MessagePack objects, so they're copied verbatim.  All other
+ * numbers are varints.
+ */
+
+#define DELTA_OP_END    0
+#define DELTA_OP_COPY   1
+#define DELTA_OP_PATCH  2
+#define DELTA_OP_INSERT 3
+
+static GArray *recording_records = NULL;
+static pbuf_t *source_pbuf = NULL;
+static GArray *source_records = NULL;
+static GHashTable *source_index = NULL;
+static size_t source_next = 0;
+static buf_t   patch_buf;
+static bool    deltas_initialized = false;
+
+static void write_varint(buf_t *buf, uint64_t value) {
+  unsigned char bytes[10];
+  size_t count = 0;
+
+  do {
+    bytes[count] = value & 0x7F;
+    value >>= 7;
+
+    if (value) {
+      bytes[count] |= 0x80;
+    }
+
+    count++;
+  } while (value);
+
+  M_BufferWrite(buf, bytes, count);
+}
+
+static bool read_varint(buf_t *buf, uint64_t *value) {
+  uint64_t result = 0;
+
+  for (unsigned int shift = 0; shift < 64; shift += 7) {
+    unsigned char byte;
 
-static bool xdiff_initialized = false;
+    if (!M_BufferReadUChar(buf, &byte)) {
+      return false;
+    }
+
+    result |= ((uint64_t)(byte & 0x7F)) << shift;
+
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
 
-static void* wrap_malloc(void *priv, unsigned int size) {
-  return malloc(size);
+  return false;
 }
 
-static void wrap_free(void *priv, void *ptr) {
-  free(ptr);
+static uint32_t read_be(const unsigned char *data, size_t count) {
+  uint32_t value = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    value = (value << 8) | data[i];
+  }
+
+  return value;
 }
 
-static void* wrap_realloc(void *priv, void *ptr, unsigned int size) {
-  return realloc(ptr, size);
+/* Returns 0 if truncated; arrays and maps only count their header */
+static size_t field_size(const unsigned char *data, size_t remaining) {
+  unsigned char b;
+  size_t header = 1;
+  size_t length_size = 0;
+  size_t payload = 0;
+
+  if (remaining == 0) {
+    return 0;
+  }
+
+  b = data[0];
+
+  if (b <= 0x9F || b >= 0xE0 || b == 0xC0 || b == 0xC2 || b == 0xC3) {
+    return 1;
+  }
+
+  if (b >= 0xA0 && b <= 0xBF) {
+    payload = b & 0x1F;
+  }
+  else {
+    switch (b) {
+      case 0xCC: case 0xD0:            payload = 1;             break;
+      case 0xCD: case 0xD1:            payload = 2;             break;
+      case 0xCA: case 0xCE: case 0xD2: payload = 4;             break;
+      case 0xCB: case 0xCF: case 0xD3: payload = 8;             break;
+      case 0xDC: case 0xDE:            payload = 2;             break;
+      case 0xDD: case 0xDF:            payload = 4;             break;
+      case 0xD4:                       payload = 2;             break;
+      case 0xD5:                       payload = 3;             break;
+      case 0xD6:                       payload = 5;             break;
+      case 0xD7:                       payload = 9;             break;
+      case 0xD8:                       payload = 17;            break;
+      case 0xC4: case 0xD9:            length_size = 1;         break;
+      case 0xC5: case 0xDA:            length_size = 2;         break;
+      case 0xC6: case 0xDB:            length_size = 4;         break;
+      case 0xC7: length_size = 1; header++;                     break;
+      case 0xC8: length_size = 2; header++;                     break;
+      case 0xC9: length_size = 4; header++;                     break;
+      default:
+        return 0;
+      break;
+    }
+  }
+
+  if (length_size) {
+    if (remaining < 1 + length_size) {
+      return 0;
+    }
+
+    payload = read_be(data + 1, length_size);
+    header += length_size;
+  }
+
+  if ((header + payload) > remaining) {
+    return 0;
+  }
+
+  return header + payload;
 }
 
-static int write_to_buffer(void *priv, mmbuffer_t *mb, int nbuf) {
-  int i;
-  size_t delta_size;
-  buf_t *delta = (buf_t *)priv;
+static delta_record_t* get_records(GArray *records, pbuf_t *pbuf,
+                                                    delta_record_t *whole,
+                                                    size_t *count) {
+  if (records && records->len > 0) {
+    *count = records->len;
+    return (delta_record_t *)records->data;
+  }
 
-  for (delta_size = 0, i = 0; i < nbuf; i++)
-    delta_size += mb[i].size;
+  whole->key = 0;
+  whole->offset = 0;
+  whole->size = M_PBufGetSize(pbuf);
+  *count = 1;
 
-  M_BufferEnsureCapacity(delta, delta_size);
+  return whole;
+}
 
-  for (i = 0; i < nbuf; i++)
-    M_BufferWrite(delta, (char *)mb[i].ptr, mb[i].size);
+static void close_last_record(size_t end) {
+  delta_record_t *last;
 
-  return 0;
+  if (recording_records->len == 0) {
+    return;
+  }
+
+  last = &g_array_index(
+    recording_records, delta_record_t, recording_records->len - 1
+  );
+
+  last->size = end - last->offset;
+
+  if (last->size == 0) {
+    g_array_set_size(recording_records, recording_records->len - 1);
+  }
 }
 
-static void build_mmfile(mmfile_t *mmf, char *data, size_t size) {
-  char *blk;
+static void append_record(buf_t *out, GArray *records, uint64_t key,
+                                                       const char *data,
+                                                       size_t size) {
+  if (records) {
+    delta_record_t record;
 
-  if ((xdl_init_mmfile(mmf, BLKSIZE, XDL_MMF_ATOMIC)) != 0)
-    I_Error("Error initializing mmfile");
+    record.key = key;
+    record.offset = M_BufferGetSize(out);
+    record.size = size;
 
-  blk = xdl_mmfile_writeallocate(mmf, size);
-  if (blk == NULL)
-    I_Error("Error allocating mmfile buffer");
+    g_array_append_val(records, record);
+  }
 
-  memcpy(blk, data, size);
+  M_BufferWrite(out, data, size);
 }
 
-void M_InitDeltas(void) {
-  memallocator_t malt;
+static bool build_patch(buf_t *patch, const char *old_data, size_t old_size,
+                                      const char *new_data, size_t new_size) {
+  const unsigned char *op = (const unsigned char *)old_data;
+  const unsigned char *np = (const unsigned char *)new_data;
+  const unsigned char *run_start = NULL;
+  size_t o_rem = old_size;
+  size_t n_rem = new_size;
+  uint64_t skip = 0;
+  uint64_t take = 0;
+
+  M_BufferClear(patch);
+
+  while (n_rem > 0) {
+    size_t nsz = field_size(np, n_rem);
+    size_t osz = field_size(op, o_rem);
+
+    if (nsz == 0 || osz == 0) {
+      return false;
+    }
+
+    if (nsz == osz && memcmp(np, op, nsz) == 0) {
+      if (take > 0) {
+        write_varint(patch, skip);
+        write_varint(patch, take);
+        M_BufferWrite(patch, run_start, np - run_start);
+        skip = 0;
+        take = 0;
+      }
+
+      skip++;
+    }
+    else {
+      if (take == 0) {
+        run_start = np;
+      }
+
+      take++;
+    }
+
+    np += nsz;
+    n_rem -= nsz;
+    op += osz;
+    o_rem -= osz;
+  }
+
+  /* Field layouts differ, can't patch */
+  if (o_rem != 0) {
+    return false;
+  }
+
+  if (take > 0) {
+    write_varint(patch, skip);
+    write_varint(patch, take);
+    M_BufferWrite(patch, run_start, np - run_start);
+  }
 
-  if (xdiff_initialized)
+  write_varint(patch, 0);
+  write_varint(patch, 0);
+
+  return true;
+}
+
+static void write_copy(buf_t *delta, size_t start, size_t count) {
+  if (count == 0) {
     return;
+  }
+
+  M_BufferWriteUChar(delta, DELTA_OP_COPY);
+  write_varint(delta, start);
+  write_varint(delta, count);
+}
+
+static bool copy_fields(buf_t *out, const unsigned char **data,
+                                    size_t *remaining,
+                                    uint64_t count) {
+  const unsigned char *start = *data;
 
-  xdiff_initialized = true;
+  for (uint64_t i = 0; i < count; i++) {
+    size_t size = field_size(*data, *remaining);
 
-  malt.priv = NULL;
-  malt.malloc = wrap_malloc;
-  malt.free = wrap_free;
-  malt.realloc = wrap_realloc;
+    if (size == 0) {
+      return false;
+    }
 
-  xdl_set_allocator(&malt);
+    *data += size;
+    *remaining -= size;
+  }
+
+  if (out) {
+    M_BufferWrite(out, start, *data - start);
+  }
+
+  return true;
 }
 
-void M_BuildDelta(pbuf_t *b1, pbuf_t *b2, buf_t *delta) {
-  mmbuffer_t mmb1, mmb2;
-  xdemitcb_t ecb;
-  int res = 0;
+static bool apply_patch(buf_t *out, delta_record_t *old_record,
+                                    const char *old_data,
+                                    buf_t *delta) {
+  const unsigned char *op = (const unsigned char *)(
+    old_data + old_record->offset
+  );
+  size_t o_rem = old_record->size;
+
+  while (true) {
+    uint64_t skip;
+    uint64_t take;
+    const unsigned char *dp;
+    size_t d_rem;
+
+    if (!read_varint(delta, &skip) || !read_varint(delta, &take)) {
+      return false;
+    }
+
+    if (take == 0) {
+      break;
+    }
+
+    if (!copy_fields(out, &op, &o_rem, skip)) {
+      return false;
+    }
+
+    if (!copy_fields(NULL, &op, &o_rem, take)) {
+      return false;
+    }
+
+    dp = (const unsigned char *)M_BufferGetDataAtCursor(delta);
+    d_rem = M_BufferGetDataRemaining(delta);
+
+    if (!copy_fields(out, &dp, &d_rem, take)) {
+      return false;
+    }
+
+    M_BufferSeekForward(
+      delta, dp - (const unsigned char *)M_BufferGetDataAtCursor(delta)
+    );
+  }
 
-  ecb.priv = delta;
-  ecb.outf = write_to_buffer;
+  M_BufferWrite(out, op, o_rem);
 
-  mmb1.ptr = (char *)M_PBufGetData(b1);
-  mmb1.size = (long)M_PBufGetSize(b1);
+  return true;
+}
 
-  mmb2.ptr = (char *)M_PBufGetData(b2);
-  mmb2.size = (long)M_PBufGetSize(b2);
+static delta_record_t* find_source_record(uint64_t key) {
+  delta_record_t *records = (delta_record_t *)source_records->data;
+  gpointer found;
 
-  M_BufferClear(delta);
+  if (source_next < source_records->len &&
+      records[source_next].key == key) {
+    return &records[source_next++];
+  }
 
-  res = xdl_rabdiff_mb(&mmb1, &mmb2, &ecb);
-  if (res != 0) {
-    perror("");
-    I_Error("M_BuildDelta: Error building delta: %d", res);
+  if (!source_index) {
+    source_index = g_hash_table_new(g_int64_hash, g_int64_equal);
+
+    for (size_t i = source_records->len; i > 0; i--) {
+      g_hash_table_insert(
+        source_index, &records[i - 1].key, GSIZE_TO_POINTER(i)
+      );
+    }
   }
+
+  found = g_hash_table_lookup(source_index, &key);
+
+  if (!found) {
+    return NULL;
+  }
+
+  source_next = GPOINTER_TO_SIZE(found);
+
+  return &records[source_next - 1];
 }
 
-bool M_ApplyDelta(pbuf_t *b1, pbuf_t *b2, buf_t *delta) {
-  mmfile_t cs, is;
-  xdemitcb_t ecb;
-  buf_t delta_copy;
-  bool res = false;
+void M_InitDeltas(void) {
+  if (deltas_initialized)
+    return;
+
+  deltas_initialized = true;
+
+  M_BufferInit(&patch_buf);
+}
 
-  ecb.priv = b2;
-  ecb.outf = write_to_buffer;
+void M_DeltaBeginRecords(pbuf_t *pbuf, GArray *records) {
+  recording_records = records;
+  g_array_set_size(recording_records, 0);
 
-  build_mmfile(&cs, M_PBufGetData(b1), M_PBufGetSize(b1));
-  build_mmfile(&is, M_BufferGetData(delta), M_BufferGetSize(delta));
+  M_DeltaMarkRecord(pbuf, 0, 0);
+}
 
-  M_BufferInitWithCapacity(&delta_copy, M_BufferGetSize(delta));
-  M_BufferCopy(&delta_copy, delta);
+void M_DeltaMarkRecord(pbuf_t *pbuf, uint32_t type, uint32_t id) {
+  delta_record_t record;
 
-  if (xdl_bpatch(&cs, &is, &ecb) == 0) {
-    res = true;
+  if (!recording_records) {
+    return;
   }
-  else {
-    perror("M_BuildDelta: Error applying delta");
+
+  close_last_record(M_PBufGetCursor(pbuf));
+
+  record.key = M_DeltaRecordKey(type, id);
+  record.offset = M_PBufGetCursor(pbuf);
+  record.size = 0;
+
+  g_array_append_val(recording_records, record);
+}
+
+void M_DeltaEndRecords(pbuf_t *pbuf) {
+  if (!recording_records) {
+    return;
   }
 
-  M_BufferFree(&delta_copy);
+  close_last_record(M_PBufGetSize(pbuf));
 
-  xdl_free_mmfile(&cs);
-  xdl_free_mmfile(&is);
+  recording_records = NULL;
 
-  return res;
+  M_DeltaSetRecordSource(NULL, NULL);
 }
 
-/* vi: set et ts=2 sw=2: */
+/* Records can be copied from this buffer instead of re-serialized */
+void M_DeltaSetRecordSource(pbuf_t *pbuf, GArray *records) {
+  if (source_index) {
+    g_hash_table_destroy(source_index);
+    source_index = NULL;
+  }
+
+  source_pbuf = pbuf;
+  source_records = records;
+  source_next = 0;
+}
 
+bool M_DeltaCopyRecord(pbuf_t *pbuf, uint32_t type, uint32_t id) {
+  delta_record_t *record;
+
+  if (!recording_records || !source_pbuf || !source_records) {
+    return false;
+  }
+
+  record = find_source_record(M_DeltaRecordKey(type, id));
+
+  if (!record) {
+    return false;
+  }
+
+  M_DeltaMarkRecord(pbuf, type, id);
+  M_BufferWrite(
+    M_PBufGetBuffer(pbuf),
+    M_PBufGetData(source_pbuf) + record->offset,
+    record->size
+  );
+
+  return true;
+}
+
+void M_BuildDelta(pbuf_t *b1, GArray *r1, pbuf_t *b2, GArray *r2,
+                  buf_t *delta) {
+  delta_record_t old_whole;
+  delta_record_t new_whole;
+  size_t old_count;
+  size_t new_count;
+  delta_record_t *old_records = get_records(r1, b1, &old_whole, &old_count);
+  delta_record_t *new_records = get_records(r2, b2, &new_whole, &new_count);
+  const char *old_data = M_PBufGetData(b1);
+  const char *new_data = M_PBufGetData(b2);
+  GHashTable *old_index = NULL;
+  size_t next_old = 0;
+  size_t copy_start = 0;
+  size_t copy_count = 0;
+
+  M_InitDeltas();
+  M_BufferClear(delta);
+
+  for (size_t i = 0; i < new_count; i++) {
+    delta_record_t *nr = &new_records[i];
+    const char *nr_data = new_data + nr->offset;
+    delta_record_t *old_rec = NULL;
+    size_t oi = 0;
+    bool patched = false;
+
+    /* Records are almost always in the same order */
+    if (next_old < old_count && old_records[next_old].key == nr->key) {
+      oi = next_old;
+      old_rec = &old_records[oi];
+    }
+    else {
+      gpointer found;
+
+      if (!old_index) {
+        old_index = g_hash_table_new(g_int64_hash, g_int64_equal);
+
+        for (size_t j = old_count; j > 0; j--) {
+          g_hash_table_insert(
+            old_index, &old_records[j - 1].key, GSIZE_TO_POINTER(j)
+          );
+        }
+      }
+
+      found = g_hash_table_lookup(old_index, &nr->key);
+
+      if (found) {
+        oi = GPOINTER_TO_SIZE(found) - 1;
+        old_rec = &old_records[oi];
+      }
+    }
+
+    if (old_rec) {
+      next_old = oi + 1;
+
+      if (old_rec->size == nr->size &&
+          memcmp(old_data + old_rec->offset, nr_data, nr->size) == 0) {
+        if (copy_count > 0 && (copy_start + copy_count) == oi) {
+          copy_count++;
+          continue;
+        }
+
+        write_copy(delta, copy_start, copy_count);
+
+        copy_start = oi;
+        copy_count = 1;
+        continue;
+      }
+    }
+
+    write_copy(delta, copy_start, copy_count);
+    copy_count = 0;
+
+    if (old_rec && build_patch(&patch_buf, old_data + old_rec->offset,
+                                           old_rec->size,
+                                           nr_data,
+                                           nr->size)) {
+      patched = M_BufferGetSize(&patch_buf) < nr->size;
+    }
+
+    if (patched) {
+      M_BufferWriteUChar(delta, DELTA_OP_PATCH);
+      write_varint(delta, oi);
+      M_BufferWrite(
+        delta, M_BufferGetData(&patch_buf), M_BufferGetSize(&patch_buf)
+      );
+      continue;
+    }
+
+    M_BufferWriteUChar(delta, DELTA_OP_INSERT);
+    write_varint(delta, nr->key);
+    write_varint(delta, nr->size);
+    M_BufferWrite(delta, nr_data, nr->size);
+  }
+
+  write_copy(delta, copy_start, copy_count);
+  M_BufferWriteUChar(delta, DELTA_OP_END);
+
+  if (old_index) {
+    g_hash_table_destroy(old_index);
+  }
+}
+
+bool M_ApplyDelta(pbuf_t *b1, GArray *r1, pbuf_t *b2, GArray *r2,
+                  buf_t *delta) {
+  delta_record_t old_whole;
+  size_t old_count;
+  delta_record_t *old_records = get_records(r1, b1, &old_whole, &old_count);
+  const char *old_data = M_PBufGetData(b1);
+  buf_t *out = M_PBufGetBuffer(b2);
+
+  M_BufferClear(out);
+
+  if (r2) {
+    g_array_set_size(r2, 0);
+  }
+
+  while (true) {
+    unsigned char op;
+    uint64_t index;
+    uint64_t count;
+    uint64_t key;
+    size_t start;
+
+    if (!M_BufferReadUChar(delta, &op)) {
+      D_Msg(MSG_WARN, "M_ApplyDelta: Truncated delta\n");
+      return false;
+    }
+
+    switch (op) {
+      case DELTA_OP_END:
+        return true;
+      break;
+      case DELTA_OP_COPY:
+        if (!read_varint(delta, &index) || !read_varint(delta, &count)) {
+          D_Msg(MSG_WARN, "M_ApplyDelta: Truncated copy\n");
+          return false;
+        }
+
+        if (index > old_count || count > (old_count - index)) {
+          D_Msg(MSG_WARN, "M_ApplyDelta: Invalid copy %" PRIu64 "/%" PRIu64
+                          " (%zu records)\n", index, count, old_count);
+          return false;
+        }
+
+        for (uint64_t i = index; i < index + count; i++) {
+          append_record(
+            out,
+            r2,
+            old_records[i].key,
+            old_data + old_records[i].offset,
+            old_records[i].size
+          );
+        }
+      break;
+      case DELTA_OP_PATCH:
+        if (!read_varint(delta, &index)) {
+          D_Msg(MSG_WARN, "M_ApplyDelta: Truncated patch\n");
+          return false;
+        }
+
+        if (index >= old_count) {
+          D_Msg(MSG_WARN, "M_ApplyDelta: Invalid patch %" PRIu64
+                          " (%zu records)\n", index, old_count);
+          return false;
+        }
+
+        start = M_BufferGetSize(out);
+
+        if (!apply_patch(out, &old_records[index], old_data, delta)) {
+          D_Msg(MSG_WARN, "M_ApplyDelta: Malformed patch\n");
+          return false;
+        }
+
+        if (r2) {
+          delta_record_t record;
+
+          record.key = old_records[index].key;
+          record.offset = start;
+          record.size = M_BufferGetSize(out) - start;
+
+          g_array_append_val(r2, record);
+        }
+      break;
+      case DELTA_OP_INSERT:
+        if (!read_varint(delta, &key) || !read_varint(delta, &count)) {
+          D_Msg(MSG_WARN, "M_ApplyDelta: Truncated insert\n");
+          return false;
+        }
+
+        if (count > M_BufferGetDataRemaining(delta)) {
+          D_Msg(MSG_WARN, "M_ApplyDelta: Insert overruns delta\n");
+          return false;
+        }
+
+        append_record(out, r2, key, M_BufferGetDataAtCursor(delta), count);
+        M_BufferSeekForward(delta, count);
+      break;
+      default:
+        D_Msg(MSG_WARN, "M_ApplyDelta: Unknown delta operation %u\n", op);
+        return false;
+      break;
+    }
+  }
+
+  return true;
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -24,11 +24,31 @@
 #ifndef M_DELTA_H__
 #define M_DELTA_H__
 
+/* Keys are the record's type (high 32 bits) and ID (low 32 bits) */
+typedef struct delta_record_s {
+  uint64_t key;
+  uint32_t offset;
+  uint32_t size;
+} delta_record_t;
+
+#define M_DeltaRecordKey(type, id) \
+  ((((uint64_t)(type)) << 32) | ((uint64_t)(id) & 0xFFFFFFFF))
+#define M_DeltaRecordType(key) ((uint32_t)((key) >> 32))
+#define M_DeltaRecordID(key)   ((uint32_t)((key) & 0xFFFFFFFF))
+
 void M_InitDeltas(void);
-void M_BuildDelta(pbuf_t *b1, pbuf_t *b2, buf_t *delta);
-bool M_ApplyDelta(pbuf_t *b1, pbuf_t *b2, buf_t *delta);
+
+void M_DeltaBeginRecords(pbuf_t *pbuf, GArray *records);
+void M_DeltaMarkRecord(pbuf_t *pbuf, uint32_t type, uint32_t id);
+void M_DeltaEndRecords(pbuf_t *pbuf);
+void M_DeltaSetRecordSource(pbuf_t *pbuf, GArray *records);
+bool M_DeltaCopyRecord(pbuf_t *pbuf, uint32_t type, uint32_t id);
+
+void M_BuildDelta(pbuf_t *b1, GArray *r1, pbuf_t *b2, GArray *r2,
+                  buf_t *delta);
+bool M_ApplyDelta(pbuf_t *b1, GArray *r1, pbuf_t *b2, GArray *r2,
+                  buf_t *delta);
 
 #endif
 
 /* vi: set et ts=2 sw=2: */
-
@@ -0,0 +1,129 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "m_hash.h"
+
+/* XXH64, reading input as little-endian so hashes match across platforms */
+
+#define PRIME64_1 UINT64_C(0x9E3779B185EBCA87)
+#define PRIME64_2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define PRIME64_3 UINT64_C(0x165667B19E3779F9)
+#define PRIME64_4 UINT64_C(0x85EBCA77C2B2AE63)
+#define PRIME64_5 UINT64_C(0x27D4EB2F165667C5)
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char *p) {
+  return ((uint64_t)p[0])       | ((uint64_t)p[1] << 8)  |
+         ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+         ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+         ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+  return ((uint32_t)p[0])       | ((uint32_t)p[1] << 8) |
+         ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input) {
+  acc += input * PRIME64_2;
+  acc = rotl64(acc, 31);
+
+  return acc * PRIME64_1;
+}
+
+static inline uint64_t merge_round(uint64_t acc, uint64_t value) {
+  acc ^= hash_round(0, value);
+
+  return (acc * PRIME64_1) + PRIME64_4;
+}
+
+uint64_t M_HashBytes(const void *data, size_t size, uint64_t seed) {
+  const unsigned char *p = data;
+  const unsigned char *end = p + size;
+  uint64_t hash;
+
+  if (size >= 32) {
+    const unsigned char *limit = end - 32;
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME64_1;
+
+    do {
+      v1 = hash_round(v1, read64(p));
+      v2 = hash_round(v2, read64(p + 8));
+      v3 = hash_round(v3, read64(p + 16));
+      v4 = hash_round(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    hash = merge_round(hash, v1);
+    hash = merge_round(hash, v2);
+    hash = merge_round(hash, v3);
+    hash = merge_round(hash, v4);
+  }
+  else {
+    hash = seed + PRIME64_5;
+  }
+
+  hash += (uint64_t)size;
+
+  while (p + 8 <= end) {
+    hash ^= hash_round(0, read64(p));
+    hash = (rotl64(hash, 27) * PRIME64_1) + PRIME64_4;
+    p += 8;
+  }
+
+  if (p + 4 <= end) {
+    hash ^= (uint64_t)read32(p) * PRIME64_1;
+    hash = (rotl64(hash, 23) * PRIME64_2) + PRIME64_3;
+    p += 4;
+  }
+
+  while (p < end) {
+    hash ^= (*p) * PRIME64_5;
+    hash = rotl64(hash, 11) * PRIME64_1;
+    p++;
+  }
+
+  hash ^= hash >> 33;
+  hash *= PRIME64_2;
+  hash ^= hash >> 29;
+  hash *= PRIME64_3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+/* Hashes value itself rather than its bytes, so endianness doesn't matter */
+uint64_t M_HashValue(uint64_t hash, uint64_t value) {
+  return merge_round(hash, value);
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -1169,6 +1169,10 @@ default_t defaults[] =
     "limit_player_commands",
     {&sv_limit_player_commands}, {1}, 0, 1, def_bool, ss_none
   },
+  {
+    "allow_relays",
+    {&sv_allow_relays}, {0}, 0, 1, def_bool, ss_none
+  },
   {
     "sv_spectate_password",
     {NULL, (const char **)&sv_spectate_password}, {0, ""}, UL, UL, def_str, ss_none
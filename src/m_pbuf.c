@@ -761,23 +761,32 @@ bool M_PBufReadMap(pbuf_t *pbuf, unsigned int *map_size) {
 }
 
 bool M_PBufReadBytes(pbuf_t *pbuf, buf_t *buf) {
-  uint32_t size = 0;
+  const char *data = NULL;
+  size_t size = 0;
 
-  if (!cmp_read_bin_size(&pbuf->cmp, &size))
+  if (!M_PBufReadBytesSlice(pbuf, &data, &size))
     return false;
 
-  /*
-   * CG: This is a hack to prevent overallocating like crazy: limit the size to
-   *     16MB
-   */
-  if (size > 0x00FFFFFF) {
-    P_Echo(consoleplayer, "M_PBufReadBytes: Tried to read more than 16MB.");
+  M_BufferWrite(buf, data, size);
+
+  return true;
+}
+
+/* Like M_PBufReadBytes, but points into pbuf instead of copying */
+bool M_PBufReadBytesSlice(pbuf_t *pbuf, const char **data, size_t *size) {
+  uint32_t bin_size = 0;
+
+  if (!cmp_read_bin_size(&pbuf->cmp, &bin_size))
     return false;
-  }
 
-  M_BufferWrite(buf, M_PBufGetDataAtCursor(pbuf), size);
+  if (!M_BufferReadSlice(&pbuf->buf, bin_size, data)) {
+    P_Echo(consoleplayer,
+      "M_PBufReadBytesSlice: Binary data overruns buffer."
+    );
+    return false;
+  }
 
-  M_BufferSeekForward(&pbuf->buf, size);
+  *size = bin_size;
 
   return true;
 }
@@ -876,15 +885,30 @@ bool M_PBufReadStringArray(pbuf_t *pbuf, GPtrArray *strings,
   return true;
 }
 
-bool M_PBufReadBitmap(pbuf_t *pbuf, const char *bitmap, size_t limit) {
+/* Senders may trim trailing zero bytes, so the rest is cleared */
+bool M_PBufReadBitmap(pbuf_t *pbuf, char *bitmap, size_t limit) {
   int8_t type;
-  uint32_t size = limit;
+  uint32_t size = 0;
 
-  if (!cmp_read_ext(&pbuf->cmp, &type, &size, (void *)bitmap)) {
+  if (!cmp_read_ext_marker(&pbuf->cmp, &type, &size)) {
     return false;
   }
 
-  return type == EXT_TYPE_BITMAP;
+  if (type != EXT_TYPE_BITMAP) {
+    return false;
+  }
+
+  if (size > limit) {
+    return false;
+  }
+
+  if (!pbuf->cmp.read(&pbuf->cmp, bitmap, size)) {
+    return false;
+  }
+
+  memset(bitmap + size, 0, limit - size);
+
+  return true;
 }
 
 bool M_PBufAtEOF(pbuf_t *pbuf) {
@@ -919,5 +943,55 @@ void M_PBufPrint(pbuf_t *pbuf) {
   printf("\n]\n");
 }
 
+void M_PBufBeginRecord(pbuf_t *pbuf, pbuf_record_t *record,
+                                     size_t field_count) {
+  buf_t *buf = &pbuf->buf;
+  size_t reserved = field_count * PBUF_RECORD_FIELD_SIZE_MAX;
+  size_t needed_capacity = buf->cursor + reserved;
+
+  /* Grow geometrically, not to exactly what's needed */
+  if (buf->capacity < needed_capacity) {
+    M_BufferEnsureTotalCapacity(buf, MAX(needed_capacity, buf->capacity * 2));
+  }
+
+  record->pbuf = pbuf;
+  record->start = (unsigned char *)buf->data + buf->cursor;
+  record->cursor = record->start;
+  record->end = record->start + reserved;
+}
+
+void M_PBufEndRecord(pbuf_record_t *record) {
+  buf_t *buf = &record->pbuf->buf;
+
+  if (record->cursor > record->end) {
+    I_Error("M_PBufEndRecord: Record overran its reservation (%zu > %zu)",
+      (size_t)(record->cursor - record->start),
+      (size_t)(record->end - record->start)
+    );
+  }
+
+  buf->cursor += record->cursor - record->start;
+
+  if (buf->cursor > buf->size)
+    buf->size = buf->cursor;
+}
+
+void M_PBufBeginReader(pbuf_t *pbuf, pbuf_reader_t *reader) {
+  const unsigned char *data = (const unsigned char *)pbuf->buf.data;
+
+  reader->pbuf = pbuf;
+  reader->cursor = data + pbuf->buf.cursor;
+  reader->end = data + pbuf->buf.size;
+  reader->ok = true;
+}
+
+bool M_PBufEndReader(pbuf_reader_t *reader) {
+  buf_t *buf = &reader->pbuf->buf;
+
+  buf->cursor = reader->cursor - (const unsigned char *)buf->data;
+
+  return reader->ok;
+}
+
 /* vi: set et ts=2 sw=2: */
 
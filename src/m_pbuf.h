@@ -125,12 +125,13 @@ bool M_PBufReadNil(pbuf_t *pbuf);
 bool M_PBufReadArray(pbuf_t *pbuf, unsigned int *array_size);
 bool M_PBufReadMap(pbuf_t *pbuf, unsigned int *map_size);
 bool M_PBufReadBytes(pbuf_t *pbuf, buf_t *buf);
+bool M_PBufReadBytesSlice(pbuf_t *pbuf, const char **data, size_t *size);
 bool M_PBufReadBytesRaw(pbuf_t *pbuf, char *buf, size_t limit);
 bool M_PBufReadString(pbuf_t *pbuf, buf_t *buf, size_t limit);
 bool M_PBufReadStringArray(pbuf_t *pbuf, GPtrArray *strings,
                                          size_t string_count_limit,
                                          size_t string_size_limit);
-bool M_PBufReadBitmap(pbuf_t *pbuf, const char *bitmap, size_t limit);
+bool M_PBufReadBitmap(pbuf_t *pbuf, char *bitmap, size_t limit);
 bool M_PBufAtEOF(pbuf_t *pbuf);
 
 void M_PBufCompact(pbuf_t *pbuf);
@@ -142,6 +143,370 @@ const char* M_PBufGetError(pbuf_t *pbuf);
 
 void M_PBufPrint(pbuf_t *pbuf);
 
+/*
+ * Fast paths for records of integer and boolean fields.  Space for every
+ * field is reserved up front, and the bytes match the M_PBufWrite* functions.
+ * Nothing else may touch the pbuf until M_PBufEndRecord.
+ */
+
+#define PBUF_RECORD_FIELD_SIZE_MAX 9
+
+typedef struct pbuf_record_s {
+  pbuf_t        *pbuf;
+  unsigned char *start;
+  unsigned char *cursor;
+  unsigned char *end;
+} pbuf_record_t;
+
+/* Once a read fails every later read fails too */
+typedef struct pbuf_reader_s {
+  pbuf_t              *pbuf;
+  const unsigned char *cursor;
+  const unsigned char *end;
+  bool                 ok;
+} pbuf_reader_t;
+
+void M_PBufBeginRecord(pbuf_t *pbuf, pbuf_record_t *record,
+                                     size_t field_count);
+void M_PBufEndRecord(pbuf_record_t *record);
+
+void M_PBufBeginReader(pbuf_t *pbuf, pbuf_reader_t *reader);
+bool M_PBufEndReader(pbuf_reader_t *reader);
+
+static inline unsigned char* pbuf_store_be16(unsigned char *p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+
+  return p + 2;
+}
+
+static inline unsigned char* pbuf_store_be32(unsigned char *p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+
+  return p + 4;
+}
+
+static inline unsigned char* pbuf_store_be64(unsigned char *p, uint64_t v) {
+  p = pbuf_store_be32(p, v >> 32);
+
+  return pbuf_store_be32(p, (uint32_t)v);
+}
+
+static inline uint16_t pbuf_load_be16(const unsigned char *p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t pbuf_load_be32(const unsigned char *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8)  |  (uint32_t)p[3];
+}
+
+static inline uint64_t pbuf_load_be64(const unsigned char *p) {
+  return ((uint64_t)pbuf_load_be32(p) << 32) | pbuf_load_be32(p + 4);
+}
+
+/* Same encoding as cmp_write_uinteger */
+static inline void M_PBufRecordWriteUNum(pbuf_record_t *record,
+                                         uint64_t num) {
+  unsigned char *p = record->cursor;
+
+  if (num <= 0x7F) {
+    *p++ = (unsigned char)num;
+  }
+  else if (num <= 0xFF) {
+    *p++ = 0xCC;
+    *p++ = (unsigned char)num;
+  }
+  else if (num <= 0xFFFF) {
+    *p++ = 0xCD;
+    p = pbuf_store_be16(p, (uint16_t)num);
+  }
+  else if (num <= 0xFFFFFFFF) {
+    *p++ = 0xCE;
+    p = pbuf_store_be32(p, (uint32_t)num);
+  }
+  else {
+    *p++ = 0xCF;
+    p = pbuf_store_be64(p, num);
+  }
+
+  record->cursor = p;
+}
+
+/* Same encoding as cmp_write_integer */
+static inline void M_PBufRecordWriteNum(pbuf_record_t *record, int64_t num) {
+  unsigned char *p = record->cursor;
+
+  if (num >= 0) {
+    M_PBufRecordWriteUNum(record, (uint64_t)num);
+    return;
+  }
+
+  if (num >= -32) {
+    *p++ = (unsigned char)(int8_t)num;
+  }
+  else if (num >= -128) {
+    *p++ = 0xD0;
+    *p++ = (unsigned char)(int8_t)num;
+  }
+  else if (num >= -32768) {
+    *p++ = 0xD1;
+    p = pbuf_store_be16(p, (uint16_t)(int16_t)num);
+  }
+  else if (num >= (-2147483647 - 1)) {
+    *p++ = 0xD2;
+    p = pbuf_store_be32(p, (uint32_t)(int32_t)num);
+  }
+  else {
+    *p++ = 0xD3;
+    p = pbuf_store_be64(p, (uint64_t)num);
+  }
+
+  record->cursor = p;
+}
+
+static inline void M_PBufRecordWriteUChar(pbuf_record_t *record,
+                                          unsigned char c) {
+  M_PBufRecordWriteUNum(record, c);
+}
+
+static inline void M_PBufRecordWriteShort(pbuf_record_t *record, short s) {
+  M_PBufRecordWriteNum(record, s);
+}
+
+static inline void M_PBufRecordWriteUShort(pbuf_record_t *record,
+                                           unsigned short s) {
+  M_PBufRecordWriteUNum(record, s);
+}
+
+static inline void M_PBufRecordWriteInt(pbuf_record_t *record, int i) {
+  M_PBufRecordWriteNum(record, i);
+}
+
+static inline void M_PBufRecordWriteUInt(pbuf_record_t *record,
+                                         unsigned int i) {
+  M_PBufRecordWriteUNum(record, i);
+}
+
+static inline void M_PBufRecordWriteULong(pbuf_record_t *record,
+                                          uint64_t l) {
+  M_PBufRecordWriteUNum(record, l);
+}
+
+static inline void M_PBufRecordWriteBool(pbuf_record_t *record, bool b) {
+  *record->cursor++ = b ? 0xC3 : 0xC2;
+}
+
+/* Negative values are returned as their two's complement */
+static inline bool M_PBufReaderReadNum(pbuf_reader_t *reader,
+                                       bool *negative,
+                                       uint64_t *num) {
+  const unsigned char *p = reader->cursor;
+  size_t available = reader->end - p;
+  size_t size;
+  int64_t s;
+
+  if ((!reader->ok) || available < 1) {
+    reader->ok = false;
+    return false;
+  }
+
+  if (p[0] <= 0x7F) {
+    *negative = false;
+    *num = p[0];
+    reader->cursor = p + 1;
+    return true;
+  }
+
+  if (p[0] >= 0xE0) {
+    *negative = true;
+    *num = (uint64_t)(int64_t)(int8_t)p[0];
+    reader->cursor = p + 1;
+    return true;
+  }
+
+  switch (p[0]) {
+    case 0xCC: size = 2; break;
+    case 0xCD: size = 3; break;
+    case 0xCE: size = 5; break;
+    case 0xCF: size = 9; break;
+    case 0xD0: size = 2; break;
+    case 0xD1: size = 3; break;
+    case 0xD2: size = 5; break;
+    case 0xD3: size = 9; break;
+    default:
+      reader->ok = false;
+      return false;
+  }
+
+  if (available < size) {
+    reader->ok = false;
+    return false;
+  }
+
+  switch (p[0]) {
+    case 0xCC:
+      *negative = false;
+      *num = p[1];
+      break;
+    case 0xCD:
+      *negative = false;
+      *num = pbuf_load_be16(p + 1);
+      break;
+    case 0xCE:
+      *negative = false;
+      *num = pbuf_load_be32(p + 1);
+      break;
+    case 0xCF:
+      *negative = false;
+      *num = pbuf_load_be64(p + 1);
+      break;
+    default:
+      if (p[0] == 0xD0)
+        s = (int8_t)p[1];
+      else if (p[0] == 0xD1)
+        s = (int16_t)pbuf_load_be16(p + 1);
+      else if (p[0] == 0xD2)
+        s = (int32_t)pbuf_load_be32(p + 1);
+      else
+        s = (int64_t)pbuf_load_be64(p + 1);
+
+      *negative = s < 0;
+      *num = (uint64_t)s;
+      break;
+  }
+
+  reader->cursor = p + size;
+
+  return true;
+}
+
+static inline bool pbuf_reader_read_signed(pbuf_reader_t *reader,
+                                           int64_t min, int64_t max,
+                                           int64_t *out) {
+  bool negative;
+  uint64_t num;
+
+  if (!M_PBufReaderReadNum(reader, &negative, &num))
+    return false;
+
+  if (negative ? ((int64_t)num < min) : (num > (uint64_t)max)) {
+    reader->ok = false;
+    return false;
+  }
+
+  *out = (int64_t)num;
+
+  return true;
+}
+
+static inline bool pbuf_reader_read_unsigned(pbuf_reader_t *reader,
+                                             uint64_t max,
+                                             uint64_t *out) {
+  bool negative;
+  uint64_t num;
+
+  if (!M_PBufReaderReadNum(reader, &negative, &num))
+    return false;
+
+  if (negative || num > max) {
+    reader->ok = false;
+    return false;
+  }
+
+  *out = num;
+
+  return true;
+}
+
+static inline bool M_PBufReaderReadUChar(pbuf_reader_t *reader,
+                                         unsigned char *c) {
+  uint64_t num;
+
+  if (!pbuf_reader_read_unsigned(reader, 0xFF, &num))
+    return false;
+
+  *c = (unsigned char)num;
+
+  return true;
+}
+
+static inline bool M_PBufReaderReadShort(pbuf_reader_t *reader, short *s) {
+  int64_t num;
+
+  if (!pbuf_reader_read_signed(reader, -32768, 32767, &num))
+    return false;
+
+  *s = (short)num;
+
+  return true;
+}
+
+static inline bool M_PBufReaderReadUShort(pbuf_reader_t *reader,
+                                          unsigned short *s) {
+  uint64_t num;
+
+  if (!pbuf_reader_read_unsigned(reader, 0xFFFF, &num))
+    return false;
+
+  *s = (unsigned short)num;
+
+  return true;
+}
+
+static inline bool M_PBufReaderReadInt(pbuf_reader_t *reader, int *i) {
+  int64_t num;
+
+  if (!pbuf_reader_read_signed(reader, -2147483647 - 1, 2147483647, &num))
+    return false;
+
+  *i = (int)num;
+
+  return true;
+}
+
+static inline bool M_PBufReaderReadUInt(pbuf_reader_t *reader,
+                                        unsigned int *i) {
+  uint64_t num;
+
+  if (!pbuf_reader_read_unsigned(reader, 0xFFFFFFFF, &num))
+    return false;
+
+  *i = (unsigned int)num;
+
+  return true;
+}
+
+static inline bool M_PBufReaderReadULong(pbuf_reader_t *reader,
+                                         uint64_t *l) {
+  return pbuf_reader_read_unsigned(reader, UINT64_MAX, l);
+}
+
+static inline bool M_PBufReaderReadBool(pbuf_reader_t *reader, bool *b) {
+  if ((!reader->ok) || reader->cursor >= reader->end) {
+    reader->ok = false;
+    return false;
+  }
+
+  if (*reader->cursor == 0xC3) {
+    *b = true;
+  }
+  else if (*reader->cursor == 0xC2) {
+    *b = false;
+  }
+  else {
+    reader->ok = false;
+    return false;
+  }
+
+  reader->cursor++;
+
+  return true;
+}
+
 #endif
 
 /* vi: set et ts=2 sw=2: */
@@ -0,0 +1,450 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#ifdef G_OS_WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#endif
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "d_event.h"
+#include "g_game.h"
+#include "i_main.h"
+#include "m_argv.h"
+#include "n_main.h"
+#include "n_transport.h"
+#include "p_user.h"
+
+/*
+ * -netbench <N> launches N headless clients over loopback, measures
+ * -netbenchtics TICs once they've synchronized, prints a report and exits.
+ * -netbenchscript replays "forward side angle buttons" lines instead of
+ * moving randomly.
+ */
+
+#define BENCH_DEFAULT_TICS (TICRATE * 60)
+#define BENCH_COMMAND_HOLD_TICS (TICRATE / 2)
+#define BENCH_MAX_MOVE 50
+#define BENCH_MAX_TURN 1280
+
+typedef enum {
+  BENCH_IDLE,
+  BENCH_WAITING,
+  BENCH_RUNNING,
+  BENCH_DONE,
+} bench_state_e;
+
+static bench_state_e bench_state = BENCH_IDLE;
+static unsigned int  bench_client_count = 0;
+static int           bench_tic_count = BENCH_DEFAULT_TICS;
+static char         *bench_host = NULL;
+static uint16_t      bench_port = 0;
+static GArray       *bench_pids = NULL;
+
+static int           bench_tics_run = 0;
+static gint64        bench_start_time = 0;
+static gint64        bench_tic_start_time = 0;
+static size_t        bench_start_bytes = 0;
+static GArray       *bench_tic_times = NULL;
+static GArray       *bench_delta_times = NULL;
+static GArray       *bench_pack_times = NULL;
+static GArray       *bench_sync_sizes = NULL;
+
+static bool          bench_client = false;
+static GRand        *bench_rand = NULL;
+static GArray       *bench_script = NULL;
+static unsigned int  bench_script_index = 0;
+static netticcmd_t   bench_command;
+static int           bench_command_tics = 0;
+
+static size_t get_bytes_uploaded(void) {
+  size_t bytes = 0;
+
+  NETPEER_FOR_EACH(iter) {
+    bytes += N_PeerGetBytesUploaded(iter.np);
+  }
+
+  return bytes;
+}
+
+static bool all_clients_synchronized(void) {
+  unsigned int synchronized = 0;
+
+  NETPEER_FOR_EACH(iter) {
+    if (N_PeerSynchronized(iter.np)) {
+      synchronized++;
+    }
+  }
+
+  return synchronized >= bench_client_count;
+}
+
+/* Clients get the server's command line minus the benchmark options */
+static void spawn_clients(void) {
+  GPtrArray *args = g_ptr_array_new_with_free_func(g_free);
+  gchar *address = g_strdup_printf("%s:%u",
+    strcmp(bench_host, "0.0.0.0") == 0 ? "127.0.0.1" : bench_host,
+    bench_port
+  );
+
+  g_ptr_array_add(args, g_strdup(myargv[0]));
+
+  for (int i = 1; i < myargc; i++) {
+    if (strcasecmp(myargv[i], "-serve") == 0) {
+      if (i < myargc - 1 && myargv[i + 1][0] != '-') {
+        i++;
+      }
+      continue;
+    }
+
+    if ((strcasecmp(myargv[i], "-netbench") == 0) ||
+        (strcasecmp(myargv[i], "-netbenchtics") == 0)) {
+      i++;
+      continue;
+    }
+
+    g_ptr_array_add(args, g_strdup(myargv[i]));
+  }
+
+  g_ptr_array_add(args, g_strdup("-connect"));
+  g_ptr_array_add(args, address);
+  g_ptr_array_add(args, g_strdup("-nodraw"));
+  g_ptr_array_add(args, g_strdup("-nosound"));
+  g_ptr_array_add(args, g_strdup("-nomusic"));
+  g_ptr_array_add(args, g_strdup("-netbenchclient"));
+  g_ptr_array_add(args, NULL);
+
+  for (unsigned int i = 0; i < bench_client_count; i++) {
+    GError *error = NULL;
+    GPid pid;
+
+    if (!g_spawn_async(NULL, (gchar **)args->pdata, NULL,
+                       G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &pid,
+                       &error)) {
+      I_Error("N_Bench: Error launching client %u: %s\n", i, error->message);
+    }
+
+    g_array_append_val(bench_pids, pid);
+  }
+
+  g_ptr_array_free(args, true);
+
+  D_Msg(MSG_INFO, "N_Bench: Launched %u clients\n", bench_client_count);
+}
+
+static void stop_clients(void) {
+  if (!bench_pids) {
+    return;
+  }
+
+  for (unsigned int i = 0; i < bench_pids->len; i++) {
+    GPid pid = g_array_index(bench_pids, GPid, i);
+
+#ifdef G_OS_WIN32
+    TerminateProcess(pid, 0);
+#else
+    kill(pid, SIGTERM);
+#endif
+    g_spawn_close_pid(pid);
+  }
+
+  g_array_set_size(bench_pids, 0);
+}
+
+static gint compare_samples(gconstpointer a, gconstpointer b) {
+  double sample_a = *(const double *)a;
+  double sample_b = *(const double *)b;
+
+  if (sample_a < sample_b) {
+    return -1;
+  }
+
+  if (sample_a > sample_b) {
+    return 1;
+  }
+
+  return 0;
+}
+
+static double get_percentile(GArray *samples, unsigned int percentile) {
+  if (samples->len == 0) {
+    return 0.0;
+  }
+
+  return g_array_index(
+    samples, double, ((samples->len - 1) * percentile) / 100
+  );
+}
+
+static void report_samples(const char *name, GArray *samples) {
+  g_array_sort(samples, compare_samples);
+
+  D_Msg(MSG_INFO, "  %-20s %10.3f %10.3f %10.3f %10.3f\n",
+    name,
+    get_percentile(samples, 50),
+    get_percentile(samples, 90),
+    get_percentile(samples, 99),
+    get_percentile(samples, 100)
+  );
+}
+
+static void report(void) {
+  double seconds = (g_get_monotonic_time() - bench_start_time) / 1000000.0;
+  size_t bytes = get_bytes_uploaded() - bench_start_bytes;
+
+  D_Msg(MSG_INFO, "\nNetwork benchmark: %u clients, %d TICs in %.1fs\n",
+    bench_client_count, bench_tics_run, seconds
+  );
+
+  if (N_SimActive()) {
+    unsigned int latency;
+    unsigned int jitter;
+    double loss;
+
+    N_SimGetConditions(&latency, &jitter, &loss);
+
+    D_Msg(MSG_INFO,
+      "  Link: %ums latency, %ums jitter, %.1f%% loss (%u packets dropped)\n",
+      latency, jitter, loss, N_SimGetDroppedPackets()
+    );
+  }
+
+  D_Msg(MSG_INFO, "  %-20s %10s %10s %10s %10s\n",
+    "", "p50", "p90", "p99", "max"
+  );
+  report_samples("TIC time (ms)", bench_tic_times);
+  report_samples("Delta build (ms)", bench_delta_times);
+  report_samples("Sync pack (ms)", bench_pack_times);
+  report_samples("Sync size (bytes)", bench_sync_sizes);
+
+  if (seconds > 0.0) {
+    D_Msg(MSG_INFO, "  Upload: %.0f bytes/client/s\n",
+      (bytes / seconds) / bench_client_count
+    );
+  }
+}
+
+static void record_sample(GArray *samples, double sample) {
+  g_array_append_val(samples, sample);
+}
+
+static void load_script(const char *path) {
+  gchar *contents = NULL;
+  gchar **lines;
+  GError *error = NULL;
+
+  if (!g_file_get_contents(path, &contents, NULL, &error)) {
+    I_Error("N_Bench: Error loading script %s: %s\n", path, error->message);
+  }
+
+  bench_script = g_array_new(false, true, sizeof(netticcmd_t));
+  lines = g_strsplit(contents, "\n", -1);
+
+  for (gchar **line = lines; *line; line++) {
+    netticcmd_t ncmd;
+    int forward;
+    int side;
+    int angle;
+    int buttons;
+
+    if (sscanf(*line, "%d %d %d %d", &forward, &side, &angle, &buttons) != 4) {
+      continue;
+    }
+
+    memset(&ncmd, 0, sizeof(netticcmd_t));
+    ncmd.forward = CLAMP(forward, -127, 127);
+    ncmd.side = CLAMP(side, -127, 127);
+    ncmd.angle = CLAMP(angle, -32768, 32767);
+    ncmd.buttons = buttons & 0xFF;
+
+    g_array_append_val(bench_script, ncmd);
+  }
+
+  g_strfreev(lines);
+  g_free(contents);
+
+  if (bench_script->len == 0) {
+    I_Error("N_Bench: Script %s has no commands\n", path);
+  }
+}
+
+void N_BenchInit(const char *host, uint16_t port) {
+  int p;
+
+  if (M_CheckParm("-netbenchclient")) {
+    bench_client = true;
+    bench_rand = g_rand_new();
+
+    if ((p = M_CheckParm("-netbenchscript")) && p < myargc - 1) {
+      load_script(myargv[p + 1]);
+    }
+
+    return;
+  }
+
+  if (!SERVER) {
+    return;
+  }
+
+  if (!((p = M_CheckParm("-netbench")) && p < myargc - 1)) {
+    return;
+  }
+
+  bench_client_count = MAX(atoi(myargv[p + 1]), 1);
+
+  if ((p = M_CheckParm("-netbenchtics")) && p < myargc - 1) {
+    bench_tic_count = MAX(atoi(myargv[p + 1]), 1);
+  }
+
+  bench_host = strdup(host);
+  bench_port = port;
+  bench_pids = g_array_new(false, false, sizeof(GPid));
+  bench_tic_times = g_array_new(false, false, sizeof(double));
+  bench_delta_times = g_array_new(false, false, sizeof(double));
+  bench_pack_times = g_array_new(false, false, sizeof(double));
+  bench_sync_sizes = g_array_new(false, false, sizeof(double));
+  bench_state = BENCH_WAITING;
+
+  atexit(stop_clients);
+}
+
+bool N_BenchClient(void) {
+  return bench_client;
+}
+
+void N_BenchBuildCommand(struct netticcmd_s *ncmd) {
+  if (bench_script) {
+    netticcmd_t *scripted = &g_array_index(
+      bench_script, netticcmd_t, bench_script_index
+    );
+
+    bench_script_index = (bench_script_index + 1) % bench_script->len;
+    ncmd->forward = scripted->forward;
+    ncmd->side = scripted->side;
+    ncmd->angle = scripted->angle;
+    ncmd->buttons = scripted->buttons;
+
+    return;
+  }
+
+  if (bench_command_tics-- <= 0) {
+    bench_command.forward = g_rand_int_range(
+      bench_rand, -BENCH_MAX_MOVE, BENCH_MAX_MOVE + 1
+    );
+    bench_command.side = g_rand_int_range(
+      bench_rand, -BENCH_MAX_MOVE, BENCH_MAX_MOVE + 1
+    );
+    bench_command.angle = g_rand_int_range(
+      bench_rand, -BENCH_MAX_TURN, BENCH_MAX_TURN + 1
+    );
+    bench_command_tics = BENCH_COMMAND_HOLD_TICS;
+  }
+
+  ncmd->forward = bench_command.forward;
+  ncmd->side = bench_command.side;
+  ncmd->angle = bench_command.angle;
+  ncmd->buttons = g_rand_int_range(bench_rand, 0, 4) == 0 ? BT_ATTACK : 0;
+}
+
+void N_BenchUpdate(void) {
+  switch (bench_state) {
+    case BENCH_WAITING:
+      if (G_GetGameState() != GS_LEVEL) {
+        break;
+      }
+
+      if (bench_pids->len == 0) {
+        spawn_clients();
+        break;
+      }
+
+      if (!all_clients_synchronized()) {
+        break;
+      }
+
+      D_Msg(MSG_INFO, "N_Bench: All clients synchronized, measuring %d TICs\n",
+        bench_tic_count
+      );
+
+      bench_start_time = g_get_monotonic_time();
+      bench_start_bytes = get_bytes_uploaded();
+      bench_tics_run = 0;
+      bench_state = BENCH_RUNNING;
+    break;
+    case BENCH_RUNNING:
+      if (bench_tics_run < bench_tic_count) {
+        break;
+      }
+
+      report();
+      stop_clients();
+      bench_state = BENCH_DONE;
+      I_SafeExit(0);
+    break;
+    default:
+    break;
+  }
+}
+
+void N_BenchStartTic(void) {
+  if (bench_state != BENCH_RUNNING) {
+    return;
+  }
+
+  bench_tic_start_time = g_get_monotonic_time();
+}
+
+void N_BenchFinishTic(void) {
+  if (bench_state != BENCH_RUNNING) {
+    return;
+  }
+
+  record_sample(bench_tic_times,
+    (g_get_monotonic_time() - bench_tic_start_time) / 1000.0
+  );
+  bench_tics_run++;
+}
+
+void N_BenchRecordSync(gint64 delta_time, gint64 pack_time,
+                                          GPtrArray *sync_peers) {
+  if (bench_state != BENCH_RUNNING) {
+    return;
+  }
+
+  record_sample(bench_delta_times, delta_time / 1000.0);
+  record_sample(bench_pack_times, pack_time / 1000.0);
+
+  for (unsigned int i = 0; i < sync_peers->len; i++) {
+    netpeer_t *np = g_ptr_array_index(sync_peers, i);
+
+    record_sample(bench_sync_sizes, N_PeerGetChannelMessageSize(
+      np, network_message_info[NM_SYNC].channel
+    ));
+  }
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -23,14 +23,20 @@
 
 #include "z_zone.h"
 
-#include <enet/enet.h>
-
 #include "doomdef.h"
 #include "i_main.h"
+#include "i_system.h"
 #include "g_game.h"
 #include "n_main.h"
 #include "p_user.h"
 #include "n_chan.h"
+#include "n_transport.h"
+
+#define NET_CHANNEL_INITIAL_RTO 200
+#define NET_CHANNEL_MINIMUM_RTO 50
+#define NET_CHANNEL_MAXIMUM_RTO 2000
+#define NET_CHANNEL_MAX_BACKOFF 4
+#define NET_CHANNEL_MAX_FRAGMENTED_SIZE (8 * 1024 * 1024)
 
 typedef struct tocentry_s {
   unsigned int  index;
@@ -43,6 +49,15 @@ typedef struct packet_buf_s {
   unsigned int   cursor;
 } packet_buf_t;
 
+struct netpacket_s {
+  uint16_t      sequence;
+  unsigned char flags;
+  unsigned int  send_count;
+  uint32_t      send_time;
+  size_t        size;
+  unsigned char data[];
+};
+
 static void serialize_toc(netchan_t *chan) {
   M_PBufClear(&chan->packed_toc);
 
@@ -126,6 +141,114 @@ static bool deserialize_toc(GArray *toc, unsigned char *data,
   return true;
 }
 
+static int16_t sequence_diff(uint16_t s1, uint16_t s2) {
+  return (int16_t)(s1 - s2);
+}
+
+/* Room for the header is kept in front of the payload */
+static netpacket_t* new_packet(uint16_t sequence, unsigned char flags,
+                                                  const unsigned char *data,
+                                                  size_t size) {
+  netpacket_t *packet = malloc(
+    sizeof(netpacket_t) + NET_CHANNEL_HEADER_SIZE + size
+  );
+
+  if (!packet) {
+    I_Error("new_packet: Error allocating packet");
+  }
+
+  packet->sequence = sequence;
+  packet->flags = flags;
+  packet->send_count = 0;
+  packet->send_time = 0;
+  packet->size = size;
+  memcpy(packet->data + NET_CHANNEL_HEADER_SIZE, data, size);
+
+  return packet;
+}
+
+static uint32_t get_retransmission_timeout(netchan_t *nc,
+                                           unsigned int send_count) {
+  uint32_t rto = NET_CHANNEL_INITIAL_RTO;
+
+  if (nc->round_trip_time != 0) {
+    rto = nc->round_trip_time + (4 * nc->round_trip_time_variance);
+  }
+
+  rto = MAX(rto, NET_CHANNEL_MINIMUM_RTO);
+
+  /* Back off while a packet keeps getting lost */
+  rto <<= MIN(send_count - 1, NET_CHANNEL_MAX_BACKOFF);
+
+  return MIN(rto, NET_CHANNEL_MAXIMUM_RTO);
+}
+
+static void update_round_trip_time(netchan_t *nc, uint32_t sample) {
+  uint32_t difference;
+
+  sample = MAX(sample, 1);
+
+  if (nc->round_trip_time == 0) {
+    nc->round_trip_time = sample;
+    nc->round_trip_time_variance = sample / 2;
+    return;
+  }
+
+  if (sample > nc->round_trip_time) {
+    difference = sample - nc->round_trip_time;
+  }
+  else {
+    difference = nc->round_trip_time - sample;
+  }
+
+  nc->round_trip_time_variance =
+    ((3 * nc->round_trip_time_variance) + difference) / 4;
+  nc->round_trip_time = ((7 * nc->round_trip_time) + sample) / 8;
+}
+
+static void deliver_packet(netchan_t *nc, netpacket_t *packet) {
+  bool more_fragments = (
+    (packet->flags & NET_CHANNEL_MORE_FRAGMENTS) == NET_CHANNEL_MORE_FRAGMENTS
+  );
+  size_t fragments_size = M_BufferGetSize(&nc->fragments);
+
+  if ((!more_fragments) &&
+      (fragments_size == 0) &&
+      (!nc->fragments_overflowed)) {
+    g_queue_push_tail(nc->packets, packet);
+    return;
+  }
+
+  if (!nc->fragments_overflowed) {
+    if ((fragments_size + packet->size) > NET_CHANNEL_MAX_FRAGMENTED_SIZE) {
+      D_Msg(MSG_WARN, "deliver_packet: Dropping oversized packet\n");
+      M_BufferFree(&nc->fragments);
+      nc->fragments_overflowed = true;
+    }
+    else {
+      M_BufferWrite(
+        &nc->fragments, packet->data + NET_CHANNEL_HEADER_SIZE, packet->size
+      );
+    }
+  }
+
+  if (!more_fragments) {
+    if (!nc->fragments_overflowed) {
+      g_queue_push_tail(nc->packets, new_packet(
+        packet->sequence,
+        0,
+        (unsigned char *)M_BufferGetData(&nc->fragments),
+        M_BufferGetSize(&nc->fragments)
+      ));
+    }
+
+    M_BufferClear(&nc->fragments);
+    nc->fragments_overflowed = false;
+  }
+
+  free(packet);
+}
+
 void N_ChannelInit(netchan_t *nc, bool reliable, bool throttled) {
   nc->reliable = reliable;
   nc->throttled = throttled;
@@ -134,6 +257,47 @@ void N_ChannelInit(netchan_t *nc, bool reliable, bool throttled) {
   M_PBufInit(&nc->packet_data);
   M_PBufInit(&nc->packed_toc);
   nc->last_flush_tic = 0;
+  nc->sequence = 0;
+  nc->packets = g_queue_new();
+  nc->window = NULL;
+  nc->delivered = NULL;
+  M_BufferInit(&nc->fragments);
+  nc->fragments_overflowed = false;
+  nc->fragment_group = 0;
+  nc->fragment_count = 0;
+  nc->fragment_chunk = 0;
+  nc->fragments_received = 0;
+  M_BufferInit(&nc->fragments_seen);
+  M_BufferInit(&nc->unreliable_fragments);
+  nc->ack_pending = false;
+  nc->round_trip_time = 0;
+  nc->round_trip_time_variance = 0;
+  nc->retransmissions = 0;
+}
+
+void N_ChannelFree(netchan_t *nc) {
+  g_array_free(nc->toc, true);
+  M_PBufFree(&nc->messages);
+  M_PBufFree(&nc->packet_data);
+  M_PBufFree(&nc->packed_toc);
+  g_queue_free_full(nc->packets, free);
+
+  if (nc->window) {
+    for (size_t i = 0; i < NET_CHANNEL_WINDOW; i++) {
+      free(nc->window[i]);
+    }
+
+    free(nc->window);
+  }
+
+  free(nc->delivered);
+  M_BufferFree(&nc->fragments);
+  M_BufferFree(&nc->fragments_seen);
+  M_BufferFree(&nc->unreliable_fragments);
+}
+
+size_t N_ChannelGetMessageSize(netchan_t *nc) {
+  return M_PBufGetSize(&nc->messages);
 }
 
 void N_ChannelClear(netchan_t *nc) {
@@ -146,42 +310,33 @@ void N_ChannelClear(netchan_t *nc) {
   M_PBufClear(&nc->packed_toc);
 }
 
-void* N_ChannelGetPacket(netchan_t *nc) {
-  size_t toc_size;
-  size_t msg_size;
-  size_t packet_size;
-  ENetPacket *packet = NULL;
+unsigned char* N_ChannelGetPacket(netchan_t *nc, size_t header_size,
+                                                 size_t *size) {
+  buf_t *packet = &nc->packet_data.buf;
+  unsigned char *data = NULL;
 
   M_PBufClear(&nc->packed_toc);
   serialize_toc(nc);
 
-  toc_size = M_PBufGetSize(&nc->packed_toc);
-  msg_size = M_PBufGetSize(&nc->messages);
-  packet_size = toc_size + msg_size;
-
-  if (nc->reliable) {
-    packet = enet_packet_create(NULL, packet_size, ENET_PACKET_FLAG_RELIABLE);
-  }
-  else {
-    packet = enet_packet_create(
-      NULL, packet_size, ENET_PACKET_FLAG_UNSEQUENCED
-    );
-  }
-
-  if (!packet) {
-    I_Error("Error allocating packet\n");
-  }
+  M_BufferClear(packet);
+  M_BufferWriteZeros(packet, header_size);
+  M_BufferWrite(packet,
+    M_PBufGetData(&nc->packed_toc), M_PBufGetSize(&nc->packed_toc)
+  );
+  M_BufferWrite(packet,
+    M_PBufGetData(&nc->messages), M_PBufGetSize(&nc->messages)
+  );
 
-  memcpy(packet->data, M_PBufGetData(&nc->packed_toc), toc_size);
-  memcpy(packet->data + toc_size, M_PBufGetData(&nc->messages), msg_size);
+  data = (unsigned char *)M_BufferGetData(packet);
+  *size = M_BufferGetSize(packet);
 
-  if (packet->data[2] != 4) {
+  if (data[header_size + 2] != 4) {
     D_Msg(MSG_NET,
-      "Sending packet (packet size %zu):\n", packet->dataLength
+      "Sending packet (packet size %zu):\n", *size - header_size
     );
 
-    for (int i = 0; i < MIN(26, packet->dataLength); i++) {
-      D_Msg(MSG_NET, "%02X ", packet->data[i] & 0xFF);
+    for (size_t i = header_size; i < MIN(header_size + 26, *size); i++) {
+      D_Msg(MSG_NET, "%02X ", data[i] & 0xFF);
     }
 
     D_Msg(MSG_NET, "\n");
@@ -191,7 +346,7 @@ void* N_ChannelGetPacket(netchan_t *nc) {
     nc->last_flush_tic = I_GetTime();
   }
 
-  return packet;
+  return data;
 }
 
 pbuf_t* N_ChannelBeginMessage(netchan_t *nc, unsigned char type) {
@@ -299,4 +454,332 @@ bool N_ChannelLoadNextMessage(netchan_t *nc, net_message_e *message_type) {
   return valid_message;
 }
 
+void N_ChannelWriteHeader(unsigned char *header, unsigned char flags,
+                                                 uint16_t sequence,
+                                                 uint16_t ack) {
+  header[0] = flags;
+  header[1] = (sequence >> 8) & 0xFF;
+  header[2] = sequence & 0xFF;
+  header[3] = (ack >> 8) & 0xFF;
+  header[4] = ack & 0xFF;
+}
+
+bool N_ChannelReadHeader(const unsigned char *data, size_t size,
+                                                    unsigned char *flags,
+                                                    uint16_t *sequence,
+                                                    uint16_t *ack) {
+  if (size < NET_CHANNEL_HEADER_SIZE) {
+    return false;
+  }
+
+  if ((data[0] & ~(NET_CHANNEL_SEQUENCED |
+                   NET_CHANNEL_MORE_FRAGMENTS |
+                   NET_CHANNEL_FRAGMENT)) != 0) {
+    return false;
+  }
+
+  if ((data[0] & NET_CHANNEL_FRAGMENT) && data[0] != NET_CHANNEL_FRAGMENT) {
+    return false;
+  }
+
+  *flags = data[0];
+  *sequence = (data[1] << 8) | data[2];
+  *ack = (data[3] << 8) | data[4];
+
+  return true;
+}
+
+void N_ChannelQueuePacket(netchan_t *nc, const unsigned char *data,
+                                         size_t size,
+                                         size_t max_packet_size) {
+  size_t fragment_size = max_packet_size - NET_CHANNEL_HEADER_SIZE;
+
+  do {
+    size_t payload_size = MIN(size, fragment_size);
+    unsigned char flags = NET_CHANNEL_SEQUENCED;
+
+    if (payload_size < size) {
+      flags |= NET_CHANNEL_MORE_FRAGMENTS;
+    }
+
+    g_queue_push_tail(nc->packets, new_packet(
+      nc->sequence, flags, data, payload_size
+    ));
+
+    nc->sequence++;
+    data += payload_size;
+    size -= payload_size;
+  } while (size > 0);
+}
+
+/* Fragments aren't retransmitted; the next sync supersedes a lost group */
+size_t N_ChannelSendFragments(netchan_t *nc, void *transport_peer,
+                                             const unsigned char *data,
+                                             size_t size,
+                                             size_t max_packet_size,
+                                             uint16_t ack) {
+  net_transport_t *transport = N_GetTransport();
+  size_t chunk = MIN(
+    max_packet_size - NET_CHANNEL_HEADER_SIZE -
+                      NET_CHANNEL_FRAGMENT_HEADER_SIZE,
+    UINT16_MAX
+  );
+  size_t count = (size + chunk - 1) / chunk;
+  uint16_t group = nc->sequence++;
+
+  if (size > NET_CHANNEL_MAX_FRAGMENTED_SIZE || count > UINT16_MAX) {
+    D_Msg(MSG_WARN, "N_ChannelSendFragments: Dropping oversized packet\n");
+    return 0;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    size_t offset = i * chunk;
+    size_t payload_size = MIN(chunk, size - offset);
+    unsigned char *packet;
+
+    M_BufferClear(&nc->fragments);
+    M_BufferWriteZeros(
+      &nc->fragments,
+      NET_CHANNEL_HEADER_SIZE + NET_CHANNEL_FRAGMENT_HEADER_SIZE
+    );
+    M_BufferWrite(&nc->fragments, data + offset, payload_size);
+
+    packet = (unsigned char *)M_BufferGetData(&nc->fragments);
+    N_ChannelWriteHeader(packet, NET_CHANNEL_FRAGMENT, group, ack);
+    packet += NET_CHANNEL_HEADER_SIZE;
+    packet[0] = (i >> 8) & 0xFF;
+    packet[1] = i & 0xFF;
+    packet[2] = (count >> 8) & 0xFF;
+    packet[3] = count & 0xFF;
+    packet[4] = (chunk >> 8) & 0xFF;
+    packet[5] = chunk & 0xFF;
+    packet[6] = (size >> 24) & 0xFF;
+    packet[7] = (size >> 16) & 0xFF;
+    packet[8] = (size >> 8) & 0xFF;
+    packet[9] = size & 0xFF;
+
+    transport->send(
+      transport_peer,
+      NET_CHANNEL_UNRELIABLE,
+      false,
+      (unsigned char *)M_BufferGetData(&nc->fragments),
+      M_BufferGetSize(&nc->fragments)
+    );
+  }
+
+  M_BufferClear(&nc->fragments);
+
+  return count;
+}
+
+/* Only the newest group of fragments is reassembled */
+bool N_ChannelReceiveFragment(netchan_t *nc, uint16_t group,
+                                             const unsigned char *data,
+                                             size_t size,
+                                             unsigned char **packet,
+                                             size_t *packet_size) {
+  unsigned int index;
+  unsigned int count;
+  unsigned int chunk;
+  size_t total;
+  size_t offset;
+  char *seen;
+
+  if (size < NET_CHANNEL_FRAGMENT_HEADER_SIZE) {
+    return false;
+  }
+
+  index = (data[0] << 8) | data[1];
+  count = (data[2] << 8) | data[3];
+  chunk = (data[4] << 8) | data[5];
+  total = ((size_t)data[6] << 24) | (data[7] << 16) | (data[8] << 8) | data[9];
+
+  data += NET_CHANNEL_FRAGMENT_HEADER_SIZE;
+  size -= NET_CHANNEL_FRAGMENT_HEADER_SIZE;
+
+  if (chunk == 0 ||
+      total == 0 ||
+      total > NET_CHANNEL_MAX_FRAGMENTED_SIZE ||
+      count != ((total + chunk - 1) / chunk) ||
+      index >= count) {
+    return false;
+  }
+
+  offset = index * chunk;
+
+  if (size != MIN(chunk, total - offset)) {
+    return false;
+  }
+
+  if (nc->fragment_count == 0 ||
+      sequence_diff(group, nc->fragment_group) > 0) {
+    nc->fragment_group = group;
+    nc->fragment_count = count;
+    nc->fragment_chunk = chunk;
+    nc->fragments_received = 0;
+    M_BufferClear(&nc->fragments_seen);
+    M_BufferWriteZeros(&nc->fragments_seen, count);
+    M_BufferClear(&nc->unreliable_fragments);
+    M_BufferWriteZeros(&nc->unreliable_fragments, total);
+  }
+  else if (group != nc->fragment_group) {
+    return true;
+  }
+
+  if (count != nc->fragment_count ||
+      chunk != nc->fragment_chunk ||
+      total != M_BufferGetSize(&nc->unreliable_fragments)) {
+    return false;
+  }
+
+  seen = M_BufferGetData(&nc->fragments_seen);
+
+  if (seen[index]) {
+    return true;
+  }
+
+  seen[index] = 1;
+  memcpy(M_BufferGetData(&nc->unreliable_fragments) + offset, data, size);
+  nc->fragments_received++;
+
+  if (nc->fragments_received == nc->fragment_count) {
+    *packet = (unsigned char *)M_BufferGetData(&nc->unreliable_fragments);
+    *packet_size = total;
+  }
+
+  return true;
+}
+
+void N_ChannelAcknowledge(netchan_t *nc, uint16_t ack) {
+  uint32_t now = I_GetTicks();
+  netpacket_t *packet;
+
+  while ((packet = g_queue_peek_head(nc->packets))) {
+    if (packet->send_count == 0) {
+      break;
+    }
+
+    if (sequence_diff(packet->sequence, ack) > 0) {
+      break;
+    }
+
+    /* Retransmitted packets give ambiguous samples (Karn) */
+    if (packet->send_count == 1) {
+      update_round_trip_time(nc, now - packet->send_time);
+    }
+
+    g_queue_pop_head(nc->packets);
+    free(packet);
+  }
+}
+
+/* Only NET_CHANNEL_WINDOW packets are in flight at once */
+size_t N_ChannelTransmit(netchan_t *nc, void *transport_peer, uint16_t ack) {
+  net_transport_t *transport = N_GetTransport();
+  netpacket_t *oldest = g_queue_peek_head(nc->packets);
+  uint32_t now = I_GetTicks();
+  size_t sent = 0;
+
+  if (!oldest) {
+    return 0;
+  }
+
+  for (GList *node = g_queue_peek_head_link(nc->packets);
+       node;
+       node = node->next) {
+    netpacket_t *packet = (netpacket_t *)node->data;
+
+    if (sequence_diff(packet->sequence, oldest->sequence) >=
+        NET_CHANNEL_WINDOW) {
+      break;
+    }
+
+    if (packet->send_count > 0) {
+      uint32_t rto = get_retransmission_timeout(nc, packet->send_count);
+
+      if ((now - packet->send_time) < rto) {
+        continue;
+      }
+
+      nc->retransmissions++;
+    }
+
+    N_ChannelWriteHeader(packet->data, packet->flags, packet->sequence, ack);
+    transport->send(
+      transport_peer,
+      NET_CHANNEL_RELIABLE,
+      false,
+      packet->data,
+      NET_CHANNEL_HEADER_SIZE + packet->size
+    );
+
+    packet->send_count++;
+    packet->send_time = now;
+    sent++;
+  }
+
+  return sent;
+}
+
+bool N_ChannelReceiveSequenced(netchan_t *nc, unsigned char flags,
+                                              uint16_t sequence,
+                                              const unsigned char *data,
+                                              size_t size) {
+  int16_t distance = sequence_diff(sequence, nc->sequence);
+  unsigned int slot = sequence % NET_CHANNEL_WINDOW;
+  netpacket_t *packet;
+
+  nc->ack_pending = true;
+
+  /* Already delivered; our acknowledgement was probably lost */
+  if (distance < 0) {
+    return true;
+  }
+
+  if (distance >= NET_CHANNEL_WINDOW) {
+    return false;
+  }
+
+  if (!nc->window) {
+    nc->window = calloc(NET_CHANNEL_WINDOW, sizeof(netpacket_t *));
+
+    if (!nc->window) {
+      I_Error("N_ChannelReceiveSequenced: Error allocating window");
+    }
+  }
+
+  if (nc->window[slot]) {
+    return true;
+  }
+
+  nc->window[slot] = new_packet(sequence, flags, data, size);
+
+  while ((packet = nc->window[nc->sequence % NET_CHANNEL_WINDOW])) {
+    nc->window[nc->sequence % NET_CHANNEL_WINDOW] = NULL;
+    nc->sequence++;
+    deliver_packet(nc, packet);
+  }
+
+  return true;
+}
+
+bool N_ChannelGetNextPacket(netchan_t *nc, unsigned char **data,
+                                           size_t *size) {
+  free(nc->delivered);
+  nc->delivered = g_queue_pop_head(nc->packets);
+
+  if (!nc->delivered) {
+    return false;
+  }
+
+  *data = nc->delivered->data + NET_CHANNEL_HEADER_SIZE;
+  *size = nc->delivered->size;
+
+  return true;
+}
+
+uint16_t N_ChannelGetAck(netchan_t *nc) {
+  return nc->sequence - 1;
+}
+
 /* vi: set et ts=2 sw=2: */
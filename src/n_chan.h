@@ -24,24 +24,90 @@
 #ifndef N_CHAN_H__
 #define N_CHAN_H__
 
+#define NET_CHANNEL_HEADER_SIZE 5
+#define NET_CHANNEL_FRAGMENT_HEADER_SIZE 10
+#define NET_CHANNEL_WINDOW 256
+
+#define NET_CHANNEL_SEQUENCED      (1 << 0)
+#define NET_CHANNEL_MORE_FRAGMENTS (1 << 1)
+#define NET_CHANNEL_FRAGMENT       (1 << 2)
+
+struct netpacket_s;
+typedef struct netpacket_s netpacket_t;
+
+/*
+ * Channels sequence their own packets when the transport only moves
+ * datagrams.  Oversized unreliable packets are sent as fragments.
+ */
 typedef struct netchan_s {
-  bool    reliable;
-  bool    throttled;
-  GArray *toc;
-  pbuf_t  messages;
-  pbuf_t  packet_data;
-  pbuf_t  packed_toc;
-  int     last_flush_tic;
+  bool          reliable;
+  bool          throttled;
+  GArray       *toc;
+  pbuf_t        messages;
+  pbuf_t        packet_data;
+  pbuf_t        packed_toc;
+  int           last_flush_tic;
+  uint16_t      sequence;
+  GQueue       *packets;
+  netpacket_t **window;
+  netpacket_t  *delivered;
+  buf_t         fragments;
+  bool          fragments_overflowed;
+  uint16_t      fragment_group;
+  uint16_t      fragment_count;
+  uint16_t      fragment_chunk;
+  uint16_t      fragments_received;
+  buf_t         fragments_seen;
+  buf_t         unreliable_fragments;
+  bool          ack_pending;
+  uint32_t      round_trip_time;
+  uint32_t      round_trip_time_variance;
+  uint32_t      retransmissions;
 } netchan_t;
 
-void    N_ChannelInit(netchan_t *nc, bool reliable, bool throttled);
-void    N_ChannelClear(netchan_t *nc);
-void*   N_ChannelGetPacket(netchan_t *nc);
-pbuf_t* N_ChannelBeginMessage(netchan_t *nc, unsigned char type);
-bool    N_ChannelReady(netchan_t *nc);
-pbuf_t* N_ChannelGetMessage(netchan_t *nc);
-bool    N_ChannelLoadFromData(netchan_t *nc, unsigned char *data, size_t size);
-bool    N_ChannelLoadNextMessage(netchan_t *nc, net_message_e *message_type);
+void           N_ChannelInit(netchan_t *nc, bool reliable, bool throttled);
+void           N_ChannelFree(netchan_t *nc);
+void           N_ChannelClear(netchan_t *nc);
+size_t         N_ChannelGetMessageSize(netchan_t *nc);
+unsigned char* N_ChannelGetPacket(netchan_t *nc, size_t header_size,
+                                                 size_t *size);
+pbuf_t*        N_ChannelBeginMessage(netchan_t *nc, unsigned char type);
+bool           N_ChannelReady(netchan_t *nc);
+pbuf_t*        N_ChannelGetMessage(netchan_t *nc);
+bool           N_ChannelLoadFromData(netchan_t *nc, unsigned char *data,
+                                                    size_t size);
+bool           N_ChannelLoadNextMessage(netchan_t *nc,
+                                        net_message_e *message_type);
+
+void     N_ChannelWriteHeader(unsigned char *header, unsigned char flags,
+                                                     uint16_t sequence,
+                                                     uint16_t ack);
+bool     N_ChannelReadHeader(const unsigned char *data, size_t size,
+                                                    unsigned char *flags,
+                                                    uint16_t *sequence,
+                                                    uint16_t *ack);
+void     N_ChannelQueuePacket(netchan_t *nc, const unsigned char *data,
+                                             size_t size,
+                                             size_t max_packet_size);
+size_t   N_ChannelSendFragments(netchan_t *nc, void *transport_peer,
+                                               const unsigned char *data,
+                                               size_t size,
+                                               size_t max_packet_size,
+                                               uint16_t ack);
+bool     N_ChannelReceiveFragment(netchan_t *nc, uint16_t group,
+                                                 const unsigned char *data,
+                                                 size_t size,
+                                                 unsigned char **packet,
+                                                 size_t *packet_size);
+void     N_ChannelAcknowledge(netchan_t *nc, uint16_t ack);
+size_t   N_ChannelTransmit(netchan_t *nc, void *transport_peer, uint16_t ack);
+bool     N_ChannelReceiveSequenced(netchan_t *nc, unsigned char flags,
+                                                  uint16_t sequence,
+                                                  const unsigned char *data,
+                                                  size_t size);
+bool     N_ChannelGetNextPacket(netchan_t *nc, unsigned char **data,
+                                               size_t *size);
+uint16_t N_ChannelGetAck(netchan_t *nc);
 
 #endif
 
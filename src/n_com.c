@@ -22,19 +22,39 @@
 
 #include "z_zone.h"
 
-#include <enet/enet.h>
-
 #include "doomdef.h"
 #include "n_main.h"
 #include "n_chan.h"
 #include "n_com.h"
+#include "n_transport.h"
 
 net_channel_info_t net_channel_info[NET_CHANNEL_MAX] = {
   {true, false}, /* NET_CHANNEL_RELIABLE is reliable and not throttled */
   {false, true}, /* NET_CHANNEL_UNRELIABLE is unreliable and throttled */
 };
 
-void N_ComInit(netcom_t *nc, void *enet_peer) {
+/* Sends a bare acknowledgement if there's nothing to carry it on */
+static void transmit_sequenced(netcom_t *nc) {
+  net_transport_t *transport = N_GetTransport();
+  uint16_t ack = N_ChannelGetAck(&nc->incoming);
+  unsigned char header[NET_CHANNEL_HEADER_SIZE];
+  size_t sent;
+
+  sent = N_ChannelTransmit(
+    &nc->outgoing[NET_CHANNEL_RELIABLE], nc->transport_peer, ack
+  );
+
+  if (sent == 0 && nc->incoming.ack_pending) {
+    N_ChannelWriteHeader(header, 0, 0, ack);
+    transport->send(
+      nc->transport_peer, NET_CHANNEL_UNRELIABLE, false, header, sizeof(header)
+    );
+  }
+
+  nc->incoming.ack_pending = false;
+}
+
+void N_ComInit(netcom_t *nc, void *transport_peer) {
   N_ChannelInit(&nc->incoming, false, false);
   for (size_t i = 0; i < NET_CHANNEL_MAX; i++) {
     N_ChannelInit(
@@ -45,17 +65,16 @@ void N_ComInit(netcom_t *nc, void *enet_peer) {
   }
   nc->bytes_uploaded = 0;
   nc->bytes_downloaded = 0;
-  nc->enet_peer = enet_peer;
+  nc->transport_peer = transport_peer;
+  nc->sequenced = !N_GetTransport()->reliable;
+  nc->received_data = NULL;
+  nc->received_size = 0;
 }
 
 void N_ComFree(netcom_t *nc) {
-  g_array_free(nc->incoming.toc, true);
-  M_PBufFree(&nc->incoming.messages);
-  M_PBufFree(&nc->incoming.packet_data);
+  N_ChannelFree(&nc->incoming);
   for (size_t i = 0; i < NET_CHANNEL_MAX; i++) {
-    g_array_free(nc->outgoing[i].toc, true);
-    M_PBufFree(&nc->outgoing[i].messages);
-    M_PBufFree(&nc->outgoing[i].packet_data);
+    N_ChannelFree(&nc->outgoing[i]);
   }
 }
 
@@ -93,37 +112,142 @@ bool N_ComLoadNextMessage(netcom_t *nc, net_message_e *message_type) {
   return N_ChannelLoadNextMessage(&nc->incoming, message_type);
 }
 
-void N_ComFlushChannel(netcom_t *nc, net_channel_e channel) {
-  netchan_t *netchan = &nc->outgoing[channel];
-  ENetPacket *packet = NULL;
+/* A packet can make any number of packets ready, see N_ComGetNextPacket */
+bool N_ComReceive(netcom_t *nc, unsigned char *data, size_t size) {
+  unsigned char flags;
+  uint16_t sequence;
+  uint16_t ack;
+
+  if (!nc->sequenced) {
+    nc->received_data = data;
+    nc->received_size = size;
+    return true;
+  }
+
+  if (!N_ChannelReadHeader(data, size, &flags, &sequence, &ack)) {
+    return false;
+  }
+
+  N_ChannelAcknowledge(&nc->outgoing[NET_CHANNEL_RELIABLE], ack);
+
+  data += NET_CHANNEL_HEADER_SIZE;
+  size -= NET_CHANNEL_HEADER_SIZE;
+
+  if ((flags & NET_CHANNEL_SEQUENCED) == NET_CHANNEL_SEQUENCED) {
+    return N_ChannelReceiveSequenced(
+      &nc->incoming, flags, sequence, data, size
+    );
+  }
+
+  if ((flags & NET_CHANNEL_FRAGMENT) == NET_CHANNEL_FRAGMENT) {
+    return N_ChannelReceiveFragment(
+      &nc->incoming,
+      sequence,
+      data,
+      size,
+      &nc->received_data,
+      &nc->received_size
+    );
+  }
+
+  if (size > 0) {
+    nc->received_data = data;
+    nc->received_size = size;
+  }
 
-  if (!N_ChannelReady(netchan)) {
-    return;
+  return true;
+}
+
+bool N_ComGetNextPacket(netcom_t *nc, unsigned char **data, size_t *size) {
+  if (nc->received_data) {
+    *data = nc->received_data;
+    *size = nc->received_size;
+    nc->received_data = NULL;
+    nc->received_size = 0;
+    return true;
   }
 
-  packet = N_ChannelGetPacket(netchan);
+  if (!nc->sequenced) {
+    return false;
+  }
 
-  enet_peer_send((ENetPeer *)nc->enet_peer, channel, packet);
+  return N_ChannelGetNextPacket(&nc->incoming, data, size);
+}
 
-  N_ChannelClear(netchan);
+void N_ComFlushChannel(netcom_t *nc, net_channel_e channel) {
+  net_transport_t *transport = N_GetTransport();
+  netchan_t *netchan = &nc->outgoing[channel];
+  unsigned char *data = NULL;
+  size_t size = 0;
+
+  if (N_ChannelReady(netchan)) {
+    if (!nc->sequenced) {
+      data = N_ChannelGetPacket(netchan, 0, &size);
+      transport->send(
+        nc->transport_peer, channel, netchan->reliable, data, size
+      );
+    }
+    else {
+      data = N_ChannelGetPacket(netchan, NET_CHANNEL_HEADER_SIZE, &size);
+
+      if (netchan->reliable) {
+        N_ChannelQueuePacket(
+          &nc->outgoing[NET_CHANNEL_RELIABLE],
+          data + NET_CHANNEL_HEADER_SIZE,
+          size - NET_CHANNEL_HEADER_SIZE,
+          transport->max_packet_size
+        );
+      }
+      else if (size > transport->max_packet_size) {
+        N_ChannelSendFragments(
+          netchan,
+          nc->transport_peer,
+          data + NET_CHANNEL_HEADER_SIZE,
+          size - NET_CHANNEL_HEADER_SIZE,
+          transport->max_packet_size,
+          N_ChannelGetAck(&nc->incoming)
+        );
+        nc->incoming.ack_pending = false;
+      }
+      else {
+        N_ChannelWriteHeader(data, 0, 0, N_ChannelGetAck(&nc->incoming));
+        transport->send(nc->transport_peer, channel, false, data, size);
+        nc->incoming.ack_pending = false;
+      }
+    }
+
+    N_ChannelClear(netchan);
+
+    nc->bytes_uploaded += size;
+  }
 
-  nc->bytes_uploaded += packet->dataLength;
+  if (nc->sequenced && channel == NET_CHANNEL_RELIABLE) {
+    transmit_sequenced(nc);
+  }
 }
 
 void N_ComClearChannel(netcom_t *nc, net_channel_e channel) {
   N_ChannelClear(&nc->outgoing[channel]);
 }
 
+size_t N_ComGetChannelMessageSize(netcom_t *nc, net_channel_e channel) {
+  return N_ChannelGetMessageSize(&nc->outgoing[channel]);
+}
+
 void N_ComSendReset(netcom_t *nc) {
-  enet_peer_reset((ENetPeer *)nc->enet_peer);
+  N_GetTransport()->reset(nc->transport_peer);
 }
 
 pbuf_t* N_ComGetIncomingMessageData(netcom_t *nc) {
   return N_ChannelGetMessage(&nc->incoming);
 }
 
-void* N_ComGetENetPeer(netcom_t *nc) {
-  return nc->enet_peer;
+void* N_ComGetTransportPeer(netcom_t *nc) {
+  return nc->transport_peer;
+}
+
+void N_ComGetStats(netcom_t *nc, net_peer_stats_t *stats) {
+  N_GetTransport()->get_stats(nc->transport_peer, stats);
 }
 
 /* vi: set et ts=2 sw=2: */
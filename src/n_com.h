@@ -25,11 +25,14 @@
 #define N_COM_H__
 
 typedef struct netcom_s {
-  netchan_t  incoming;
-  netchan_t  outgoing[NET_CHANNEL_MAX];
-  size_t     bytes_uploaded;
-  size_t     bytes_downloaded;
-  void      *enet_peer;
+  netchan_t      incoming;
+  netchan_t      outgoing[NET_CHANNEL_MAX];
+  size_t         bytes_uploaded;
+  size_t         bytes_downloaded;
+  void          *transport_peer;
+  bool           sequenced;
+  unsigned char *received_data;
+  size_t         received_size;
 } netcom_t;
 
 typedef struct {
@@ -39,19 +42,23 @@ typedef struct {
 
 extern net_channel_info_t net_channel_info[NET_CHANNEL_MAX];
 
-void    N_ComInit(netcom_t *nc, void *enet_peer);
+void    N_ComInit(netcom_t *nc, void *transport_peer);
 void    N_ComFree(netcom_t *nc);
 void    N_ComReset(netcom_t *nc);
 size_t  N_ComGetBytesUploaded(netcom_t *nc);
 size_t  N_ComGetBytesDownloaded(netcom_t *nc);
 pbuf_t* N_ComBeginMessage(netcom_t *nc, net_message_e type);
 bool    N_ComSetIncoming(netcom_t *nc, unsigned char *data, size_t size);
+bool    N_ComReceive(netcom_t *nc, unsigned char *data, size_t size);
+bool    N_ComGetNextPacket(netcom_t *nc, unsigned char **data, size_t *size);
 void    N_ComFlushChannel(netcom_t *nc, net_channel_e channel);
 void    N_ComClearChannel(netcom_t *nc, net_channel_e channel);
+size_t  N_ComGetChannelMessageSize(netcom_t *nc, net_channel_e channel);
 void    N_ComSendReset(netcom_t *nc);
 pbuf_t* N_ComGetIncomingMessageData(netcom_t *nc);
 bool    N_ComLoadNextMessage(netcom_t *nc, net_message_e *message_type);
-void*   N_ComGetENetPeer(netcom_t *nc);
+void*   N_ComGetTransportPeer(netcom_t *nc);
+void    N_ComGetStats(netcom_t *nc, net_peer_stats_t *stats);
 
 #endif
 
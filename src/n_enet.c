@@ -0,0 +1,265 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include <enet/enet.h>
+
+#include "doomdef.h"
+#include "n_main.h"
+#include "n_transport.h"
+
+#define USE_RANGE_CODER 1
+#define MAX_DOWNLOAD 0
+#define MAX_UPLOAD 0
+
+#define NET_THROTTLE_INTERVAL 300
+#define NET_THROTTLE_ACCEL 2
+#define NET_THROTTLE_DECEL 1
+
+static ENetHost *net_host = NULL;
+static bool      net_listening = false;
+
+static bool transport_enet_create_host(ENetAddress *address,
+                                       size_t max_peers) {
+  net_host = enet_host_create(
+    address, max_peers, NET_CHANNEL_MAX, MAX_DOWNLOAD, MAX_UPLOAD
+  );
+
+  if (!net_host) {
+    D_Msg(MSG_ERROR, "N_Transport: Error creating ENet host\n");
+    return false;
+  }
+
+#if USE_RANGE_CODER
+  if (enet_host_compress_with_range_coder(net_host) < 0) {
+    D_Msg(MSG_ERROR, "N_Transport: Error activating range coder\n");
+    return false;
+  }
+#endif
+
+  return true;
+}
+
+static bool transport_enet_init(void) {
+  return enet_initialize() == 0;
+}
+
+static void transport_enet_shutdown(void) {
+  enet_deinitialize();
+}
+
+static bool transport_enet_listen(const char *host, uint16_t port,
+                                                     size_t max_peers) {
+  ENetAddress address;
+
+  if (host) {
+    enet_address_set_host(&address, host);
+  }
+  else {
+    address.host = ENET_HOST_ANY;
+  }
+
+  address.port = port;
+
+  if (!transport_enet_create_host(&address, max_peers)) {
+    return false;
+  }
+
+  net_listening = true;
+
+  return true;
+}
+
+/* Relays connect upstream from the host they're listening on */
+static void* transport_enet_connect(const char *host, uint16_t port) {
+  ENetAddress address;
+
+  if ((!net_listening) && (!transport_enet_create_host(NULL, 1))) {
+    return NULL;
+  }
+
+  enet_address_set_host(&address, host);
+  address.port = port;
+
+  return enet_host_connect(net_host, &address, NET_CHANNEL_MAX, 0);
+}
+
+static void transport_enet_destroy(void) {
+  if (net_host) {
+    enet_host_destroy(net_host);
+    net_host = NULL;
+  }
+
+  net_listening = false;
+}
+
+static int transport_enet_service(net_event_t *event, int timeout_ms) {
+  ENetEvent enet_event;
+  int status;
+
+  memset(event, 0, sizeof(net_event_t));
+
+  if (!net_host) {
+    return 0;
+  }
+
+  status = enet_host_service(net_host, &enet_event, timeout_ms);
+
+  if (status <= 0) {
+    return status;
+  }
+
+  /*
+   * [CG]: ENet says this must be cleared, so do it right away here at the
+   *       top since we don't use it.
+   */
+  if (enet_event.peer && enet_event.peer->data) {
+    enet_event.peer->data = NULL;
+  }
+
+  event->peer = enet_event.peer;
+  event->data = enet_event.data;
+
+  switch (enet_event.type) {
+    case ENET_EVENT_TYPE_CONNECT:
+      event->type = NET_EVENT_CONNECT;
+
+      if (net_listening) {
+        enet_peer_throttle_configure(
+          enet_event.peer,
+          NET_THROTTLE_INTERVAL,
+          NET_THROTTLE_ACCEL,
+          NET_THROTTLE_DECEL
+        );
+      }
+    break;
+    case ENET_EVENT_TYPE_DISCONNECT:
+      event->type = NET_EVENT_DISCONNECT;
+    break;
+    case ENET_EVENT_TYPE_RECEIVE:
+      event->type = NET_EVENT_RECEIVE;
+      event->packet = enet_event.packet;
+      event->packet_data = enet_event.packet->data;
+      event->packet_size = enet_event.packet->dataLength;
+    break;
+    default:
+      event->type = NET_EVENT_NONE;
+    break;
+  }
+
+  return status;
+}
+
+static void transport_enet_free_event(net_event_t *event) {
+  if (event->packet) {
+    enet_packet_destroy((ENetPacket *)event->packet);
+    event->packet = NULL;
+  }
+}
+
+static void transport_enet_send(void *peer, net_channel_e channel,
+                                            bool reliable,
+                                            unsigned char *data,
+                                            size_t size) {
+  ENetPacket *packet;
+
+  if (reliable) {
+    packet = enet_packet_create(data, size, ENET_PACKET_FLAG_RELIABLE);
+  }
+  else {
+    packet = enet_packet_create(data, size, ENET_PACKET_FLAG_UNSEQUENCED);
+  }
+
+  if (!packet) {
+    I_Error("Error allocating packet\n");
+  }
+
+  enet_peer_send((ENetPeer *)peer, channel, packet);
+}
+
+static void transport_enet_disconnect(void *peer, uint32_t reason) {
+  enet_peer_disconnect((ENetPeer *)peer, reason);
+}
+
+static void transport_enet_reset(void *peer) {
+  enet_peer_reset((ENetPeer *)peer);
+}
+
+static uint32_t transport_enet_get_peer_id(void *peer) {
+  return ((ENetPeer *)peer)->connectID;
+}
+
+static uint32_t transport_enet_get_address(void *peer) {
+  return ENET_NET_TO_HOST_32(((ENetPeer *)peer)->address.host);
+}
+
+static uint16_t transport_enet_get_port(void *peer) {
+  return ((ENetPeer *)peer)->address.port;
+}
+
+static void transport_enet_get_stats(void *peer, net_peer_stats_t *stats) {
+  ENetPeer *epeer = (ENetPeer *)peer;
+
+  stats->round_trip_time = epeer->roundTripTime;
+  stats->lowest_round_trip_time = epeer->lowestRoundTripTime;
+  stats->last_round_trip_time = epeer->lastRoundTripTime;
+  stats->round_trip_time_variance = epeer->roundTripTimeVariance;
+  stats->highest_round_trip_time_variance =
+    epeer->highestRoundTripTimeVariance;
+  stats->last_round_trip_time_variance = epeer->lastRoundTripTimeVariance;
+  stats->packet_loss =
+    epeer->packetLoss / (float)ENET_PEER_PACKET_LOSS_SCALE;
+  stats->packet_loss_variance =
+    epeer->packetLossVariance / (float)ENET_PEER_PACKET_LOSS_SCALE;
+  stats->packets_sent = epeer->packetsSent;
+  stats->packets_lost = epeer->packetsLost;
+  stats->throttle = epeer->packetThrottle;
+  stats->throttle_acceleration = epeer->packetThrottleAcceleration;
+  stats->throttle_counter = epeer->packetThrottleCounter;
+  stats->throttle_deceleration = epeer->packetThrottleDeceleration;
+  stats->throttle_interval = epeer->packetThrottleInterval;
+  stats->throttle_limit = epeer->packetThrottleLimit;
+}
+
+net_transport_t net_transport_enet = {
+  "enet",
+  true,
+  0,
+  transport_enet_init,
+  transport_enet_shutdown,
+  transport_enet_listen,
+  transport_enet_connect,
+  transport_enet_destroy,
+  transport_enet_service,
+  transport_enet_free_event,
+  transport_enet_send,
+  transport_enet_disconnect,
+  transport_enet_reset,
+  transport_enet_get_peer_id,
+  transport_enet_get_address,
+  transport_enet_get_port,
+  transport_enet_get_stats,
+};
+
+/* vi: set et ts=2 sw=2: */
@@ -0,0 +1,430 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include <gio/gio.h>
+
+#include "doomdef.h"
+#include "c_eci.h"
+#include "c_main.h"
+#include "i_system.h"
+#include "n_main.h"
+
+/*
+ * Does the expensive startup once, then forks game instances on request.
+ * Instances share the host's mmap'd lumps.  The host mustn't start threads
+ * before forking, so it doesn't call N_Init.
+ *
+ * Control commands (one per datagram):
+ *   spawn [port] [config]  Start an instance; config is a file of console
+ *                          commands run before the game starts
+ *   kill <port>            Stop the instance on port
+ *   list                   Reply with "<port> <pid> <config>" per instance
+ *   shutdown               Stop every instance and exit
+ */
+
+#define HOST_CONTROL_SOCKET_NAME "d2k-host.sock"
+#define HOST_INSTANCE_SOCKET_NAME_FORMAT "d2k-%u.sock"
+#define HOST_SERVICE_INTERVAL 10
+#define HOST_CONFIG_PATH_MAX 4096
+
+static bool           host_enabled = false;
+static char          *host_control_path = NULL;
+static char          *host_address = NULL;
+static unsigned short host_base_port = DEFAULT_PORT;
+
+#ifdef G_OS_UNIX
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gio/gunixsocketaddress.h>
+
+#include "n_uds.h"
+
+typedef struct host_instance_s {
+  pid_t           pid;
+  unsigned short  port;
+  char           *config;
+} host_instance_t;
+
+typedef struct spawn_request_s {
+  bool            pending;
+  unsigned short  port;
+  char           *config;
+  char           *peer_address;
+} spawn_request_t;
+
+static uds_t            control;
+static GPtrArray       *instances = NULL;
+static spawn_request_t  spawn_request;
+static bool             is_instance = false;
+
+static void instance_free(gpointer data) {
+  host_instance_t *instance = (host_instance_t *)data;
+
+  free(instance->config);
+  free(instance);
+}
+
+static host_instance_t* find_instance(unsigned short port) {
+  for (unsigned int i = 0; i < instances->len; i++) {
+    host_instance_t *instance = g_ptr_array_index(instances, i);
+
+    if (instance->port == port) {
+      return instance;
+    }
+  }
+
+  return NULL;
+}
+
+static unsigned short next_free_port(void) {
+  unsigned int port = host_base_port;
+
+  while (find_instance(port)) {
+    port++;
+  }
+
+  if (port > 65535) {
+    return 0;
+  }
+
+  return port;
+}
+
+static void reply(uds_peer_t *peer, const char *fmt, ...) {
+  va_list args;
+  gchar *message;
+
+  va_start(args, fmt);
+  message = g_strdup_vprintf(fmt, args);
+  va_end(args);
+
+  N_UDSPeerSendTo(peer, message);
+
+  g_free(message);
+}
+
+static void stop_instance(host_instance_t *instance) {
+  if (kill(instance->pid, SIGTERM) == -1) {
+    D_Msg(MSG_WARN, "N_Host: Error stopping instance on port %u: %s\n",
+      instance->port, strerror(errno)
+    );
+  }
+}
+
+static void reap_instances(void) {
+  pid_t pid;
+  int status;
+
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+    for (unsigned int i = 0; i < instances->len; i++) {
+      host_instance_t *instance = g_ptr_array_index(instances, i);
+
+      if (instance->pid != pid) {
+        continue;
+      }
+
+      if (WIFEXITED(status)) {
+        D_Msg(MSG_INFO, "N_Host: Instance on port %u exited (%d)\n",
+          instance->port, WEXITSTATUS(status)
+        );
+      }
+      else if (WIFSIGNALED(status)) {
+        D_Msg(MSG_INFO, "N_Host: Instance on port %u killed by signal %d\n",
+          instance->port, WTERMSIG(status)
+        );
+      }
+
+      g_ptr_array_remove_index_fast(instances, i);
+      break;
+    }
+  }
+}
+
+/* Forking inside N_UDSService would leave the child servicing the socket */
+static void handle_spawn(uds_peer_t *peer, const char *args) {
+  unsigned int port = 0;
+  char config[HOST_CONFIG_PATH_MAX];
+
+  config[0] = '\0';
+
+  if (sscanf(args, "%u %4095s", &port, config) < 1) {
+    port = next_free_port();
+  }
+
+  if (port == 0 || port > 65535) {
+    reply(peer, "error invalid port\n");
+    return;
+  }
+
+  if (find_instance(port)) {
+    reply(peer, "error port %u in use\n", port);
+    return;
+  }
+
+  if (config[0] && !g_file_test(config, G_FILE_TEST_IS_REGULAR)) {
+    reply(peer, "error config %s not found\n", config);
+    return;
+  }
+
+  if (spawn_request.pending) {
+    reply(peer, "error busy\n");
+    return;
+  }
+
+  spawn_request.pending = true;
+  spawn_request.port = port;
+  spawn_request.config = config[0] ? strdup(config) : NULL;
+  spawn_request.peer_address = g_strdup(g_unix_socket_address_get_path(
+    G_UNIX_SOCKET_ADDRESS(peer->address)
+  ));
+}
+
+static void handle_kill(uds_peer_t *peer, const char *args) {
+  unsigned int port;
+  host_instance_t *instance;
+
+  if (sscanf(args, "%u", &port) != 1) {
+    reply(peer, "error no port given\n");
+    return;
+  }
+
+  instance = find_instance(port);
+
+  if (!instance) {
+    reply(peer, "error no instance on port %u\n", port);
+    return;
+  }
+
+  stop_instance(instance);
+  reply(peer, "killed %u\n", port);
+}
+
+static void handle_list(uds_peer_t *peer) {
+  GString *out = g_string_new("");
+
+  for (unsigned int i = 0; i < instances->len; i++) {
+    host_instance_t *instance = g_ptr_array_index(instances, i);
+
+    g_string_append_printf(out, "%u %d %s\n",
+      instance->port,
+      instance->pid,
+      instance->config ? instance->config : "-"
+    );
+  }
+
+  g_string_append(out, "end\n");
+
+  N_UDSPeerSendTo(peer, out->str);
+  g_string_free(out, true);
+}
+
+static void handle_data(uds_t *uds, uds_peer_t *peer) {
+  gchar *input = g_strstrip(g_strdup(uds->input->str));
+
+  if (g_str_has_prefix(input, "spawn")) {
+    handle_spawn(peer, input + strlen("spawn"));
+  }
+  else if (g_str_has_prefix(input, "kill")) {
+    handle_kill(peer, input + strlen("kill"));
+  }
+  else if (strcmp(input, "list") == 0) {
+    handle_list(peer);
+  }
+  else if (strcmp(input, "shutdown") == 0) {
+    D_Msg(MSG_INFO, "N_Host: Shutting down\n");
+    exit(EXIT_SUCCESS);
+  }
+  else {
+    reply(peer, "error unknown command [%s]\n", input);
+  }
+
+  g_free(input);
+}
+
+static void handle_oob(uds_t *uds) {
+  D_Msg(MSG_ERROR, "N_Host: Got out-of-band data [%s]\n", uds->oob->str);
+}
+
+static void host_cleanup(void) {
+  if (is_instance) {
+    return;
+  }
+
+  for (unsigned int i = 0; i < instances->len; i++) {
+    stop_instance(g_ptr_array_index(instances, i));
+  }
+
+  N_UDSFree(&control);
+}
+
+static void run_config(const char *path) {
+  gchar *contents = NULL;
+  gchar **lines;
+  GError *error = NULL;
+
+  if (!g_file_get_contents(path, &contents, NULL, &error)) {
+    I_Error("N_Host: Error loading config %s: %s\n", path, error->message);
+  }
+
+  lines = g_strsplit(contents, "\n", -1);
+
+  for (gchar **line = lines; *line; line++) {
+    g_strstrip(*line);
+
+    if (!(*line)[0] || (*line)[0] == '#') {
+      continue;
+    }
+
+    C_HandleInput(*line);
+  }
+
+  g_strfreev(lines);
+  g_free(contents);
+}
+
+static void start_instance(unsigned short port, const char *config) {
+  gchar *eci_socket_name;
+  GError *error = NULL;
+
+  is_instance = true;
+
+  /* The host still owns the control socket, so don't unlink it */
+  if (!g_socket_close(control.socket, &error)) {
+    D_Msg(MSG_WARN, "N_Host: Error closing control socket: %s\n",
+      error->message
+    );
+    g_error_free(error);
+  }
+
+  eci_socket_name = g_strdup_printf(HOST_INSTANCE_SOCKET_NAME_FORMAT, port);
+  C_ECIInit(eci_socket_name);
+  g_free(eci_socket_name);
+
+  N_ServerListen(host_address, port);
+
+  if (config) {
+    D_Msg(MSG_INFO, "N_Host: Running config %s\n", config);
+    run_config(config);
+  }
+}
+
+static bool fork_instance(void) {
+  host_instance_t *instance;
+  pid_t pid;
+
+  spawn_request.pending = false;
+
+  pid = fork();
+
+  if (pid == -1) {
+    N_UDSSendTo(&control, spawn_request.peer_address, "error fork failed\n");
+    D_Msg(MSG_ERROR, "N_Host: Error forking instance: %s\n", strerror(errno));
+    free(spawn_request.config);
+  }
+  else if (pid == 0) {
+    start_instance(spawn_request.port, spawn_request.config);
+    return true;
+  }
+  else {
+    gchar *message = g_strdup_printf("spawned %u %d\n",
+      spawn_request.port, pid
+    );
+
+    instance = calloc(1, sizeof(host_instance_t));
+    instance->pid = pid;
+    instance->port = spawn_request.port;
+    instance->config = spawn_request.config;
+    g_ptr_array_add(instances, instance);
+
+    D_Msg(MSG_INFO, "N_Host: Started instance %d on port %u\n",
+      pid, spawn_request.port
+    );
+
+    N_UDSSendTo(&control, spawn_request.peer_address, message);
+    g_free(message);
+  }
+
+  g_free(spawn_request.peer_address);
+  spawn_request.config = NULL;
+  spawn_request.peer_address = NULL;
+
+  return false;
+}
+
+void N_HostRun(void) {
+  if (!host_enabled) {
+    return;
+  }
+
+  instances = g_ptr_array_new_with_free_func(instance_free);
+  memset(&spawn_request, 0, sizeof(spawn_request_t));
+  memset(&control, 0, sizeof(uds_t));
+
+  N_UDSInit(&control, host_control_path, handle_data, handle_oob, true);
+  atexit(host_cleanup);
+
+  D_Msg(MSG_INFO, "N_Host: Waiting for commands on %s\n", host_control_path);
+
+  while (true) {
+    N_UDSService(&control);
+
+    if (spawn_request.pending && fork_instance()) {
+      return;
+    }
+
+    reap_instances();
+    I_Sleep(HOST_SERVICE_INTERVAL);
+  }
+}
+
+#else
+
+void N_HostRun(void) {
+  if (host_enabled) {
+    I_Error("N_HostRun: -host is only supported on UNIX platforms");
+  }
+}
+
+#endif
+
+void N_HostInit(const char *control_path, const char *host,
+                                          unsigned short base_port) {
+  host_enabled = true;
+  host_control_path = strdup(control_path ? control_path :
+                                            HOST_CONTROL_SOCKET_NAME);
+  host_address = strdup(host);
+  host_base_port = base_port ? base_port : DEFAULT_PORT;
+}
+
+bool N_HostEnabled(void) {
+  return host_enabled;
+}
+
+/* vi: set et ts=2 sw=2: */
+
@@ -127,6 +127,8 @@ static bool should_render(void) {
 
 void N_InitNetGame(void) {
   int i;
+  int h;
+  int r;
   time_t start_request_time;
 
   netgame   = false;
@@ -134,7 +136,7 @@ void N_InitNetGame(void) {
   netserver = false;
 
   displayplayer = consoleplayer = 0;
-  playeringame[consoleplayer] = true;
+  G_SetPlayerInGame(consoleplayer, true);
 
   M_InitDeltas();
 
@@ -204,6 +206,17 @@ void N_InitNetGame(void) {
     }
 
     CL_Init();
+    N_BenchInit(NULL, 0);
+
+    /* Listen first so the connection to the server shares the host */
+    if ((r = M_CheckParm("-relay"))) {
+      if (r < (myargc - 1) && myargv[r + 1][0] != '-') {
+        N_RelayInit(myargv[r + 1]);
+      }
+      else {
+        N_RelayInit(NULL);
+      }
+    }
 
     if (i < (myargc - 1)) {
       N_ParseAddressString(myargv[i + 1], &host, &port);
@@ -269,6 +282,11 @@ void N_InitNetGame(void) {
       netserver = true;
     }
 
+    if ((h = M_CheckParm("-host"))) {
+      netgame = true;
+      netserver = true;
+    }
+
     if (MULTINET) {
       char *host = NULL;
       unsigned short port = DEFAULT_PORT;
@@ -277,9 +295,7 @@ void N_InitNetGame(void) {
       nosfxparm   = true;
       nomusicparm = true;
 
-      N_Init();
-
-      if (i < (myargc - 1)) {
+      if (i && i < (myargc - 1)) {
         size_t host_length = N_ParseAddressString(myargv[i + 1], &host, &port);
 
         if (host_length == 0) {
@@ -290,47 +306,70 @@ void N_InitNetGame(void) {
         host = strdup("0.0.0.0");
       }
 
-      if (!N_Listen(host, port)) {
-        I_Error("Error listening on %s:%d\n", host, port);
+      /* Forked instances listen themselves */
+      if (h) {
+        if (h < (myargc - 1) && myargv[h + 1][0] != '-') {
+          N_HostInit(myargv[h + 1], host, port);
+        }
+        else {
+          N_HostInit(NULL, host, port);
+        }
+      }
+      else {
+        N_ServerListen(host, port);
       }
 
-      D_Msg(MSG_INFO, "N_InitNetGame: Listening on %s:%u.\n", host, port);
+      free(host);
+    }
+  }
+}
 
-      if (DEBUG_NET && SERVER) {
-        if (!D_MsgActivateWithPath(MSG_NET, "server-net.log")) {
-          I_Error("Error activating server-net.log: %s", strerror(errno));
-        }
-      }
+void N_ServerListen(const char *host, unsigned short port) {
+  N_Init();
 
-      if (DEBUG_SAVE && SERVER) {
-        if (!D_MsgActivateWithPath(MSG_SAVE, "server-save.log")) {
-          I_Error("Error activating server-save.log: %s", strerror(errno));
-        }
-      }
+  if (!N_Listen(host, port)) {
+    I_Error("Error listening on %s:%d\n", host, port);
+  }
 
-      if (DEBUG_SYNC && SERVER) {
-        if (!D_MsgActivateWithPath(MSG_SYNC, "server-sync.log")) {
-          I_Error("Error activating server-sync.log: %s", strerror(errno));
-        }
-      }
+  D_Msg(MSG_INFO, "N_InitNetGame: Listening on %s:%u.\n", host, port);
+
+  N_BenchInit(host, port);
+
+  if (DEBUG_NET && SERVER) {
+    if (!D_MsgActivateWithPath(MSG_NET, "server-net.log")) {
+      I_Error("Error activating server-net.log: %s", strerror(errno));
+    }
+  }
+
+  if (DEBUG_SAVE && SERVER) {
+    if (!D_MsgActivateWithPath(MSG_SAVE, "server-save.log")) {
+      I_Error("Error activating server-save.log: %s", strerror(errno));
+    }
+  }
+
+  if (DEBUG_SYNC && SERVER) {
+    if (!D_MsgActivateWithPath(MSG_SYNC, "server-sync.log")) {
+      I_Error("Error activating server-sync.log: %s", strerror(errno));
+    }
+  }
 #if DEBUG_SYNC_STDERR
-      else if (SERVER) {
-        if (!D_MsgActivateWithFile(MSG_SYNC, stderr)) {
-          I_Error("Error logging sync to stderr: %s", strerror(errno));
-        }
-      }
+  else if (SERVER) {
+    if (!D_MsgActivateWithFile(MSG_SYNC, stderr)) {
+      I_Error("Error logging sync to stderr: %s", strerror(errno));
+    }
+  }
 #endif
 
-      if (DEBUG_CMD && SERVER) {
-        if (!D_MsgActivateWithPath(MSG_CMD, "server-cmd.log")) {
-          I_Error("Error activating server-cmd.log: %s", strerror(errno));
-        }
-      }
+  if (DEBUG_CMD && SERVER) {
+    if (!D_MsgActivateWithPath(MSG_CMD, "server-cmd.log")) {
+      I_Error("Error activating server-cmd.log: %s", strerror(errno));
     }
   }
 }
 
 void N_RunTic(void) {
+  N_BenchStartTic();
+
   if (advancedemo) {
     D_DoAdvanceDemo();
   }
@@ -360,6 +399,8 @@ void N_RunTic(void) {
 
   P_Checksum(gametic);
 
+  CL_RecordPredictedStateHash();
+
   if ((G_GetGameState() == GS_LEVEL) && SERVER && (gametic > 0)) {
     NETPEER_FOR_EACH(iter) {
       if (N_PeerSynchronized(iter.np)) {
@@ -367,6 +408,8 @@ void N_RunTic(void) {
       }
     }
 
+    SV_UnlagRecordTIC();
+
     if (N_PeerGetCount() > 0) {
       G_SaveState();
     }
@@ -375,6 +418,8 @@ void N_RunTic(void) {
   }
 
   gametic++;
+
+  N_BenchFinishTic();
 }
 
 void SV_DisconnectLaggedClients(void) {
@@ -433,6 +478,10 @@ bool N_TryRunTics(void) {
   int tics_elapsed = I_GetTime() - tics_built;
   bool needs_rendering = (tics_elapsed > 0) || should_render();
 
+  if (SERVER) {
+    N_BenchUpdate();
+  }
+
   if (((!needs_rendering) || (SERVER && N_PeerGetCount() == 0))) {
     N_ServiceNetwork();
     C_ECIService();
@@ -38,6 +38,11 @@
 struct game_state_delta_s;
 typedef struct game_state_delta_s game_state_delta_t;
 
+struct state_hash_s;
+typedef struct state_hash_s state_hash_t;
+
+struct netticcmd_s;
+
 typedef enum {
   NET_CHANNEL_RELIABLE,
   NET_CHANNEL_UNRELIABLE,
@@ -89,6 +94,19 @@ typedef enum {
   AUTH_LEVEL_MAX
 } auth_level_e;
 
+/*
+ * Wire encodings for a set of player numbers; the smallest one is sent:
+ *   - INDICES: sorted player numbers as varint gaps (sparse sets)
+ *   - RUNS:    alternating absent/present run lengths (clustered sets)
+ *   - BITMAP:  a bitmap with trailing zero bytes trimmed (dense sets)
+ */
+typedef enum {
+  PLAYER_SET_INDICES,
+  PLAYER_SET_RUNS,
+  PLAYER_SET_BITMAP,
+  PLAYER_SET_ENCODING_MAX
+} player_set_encoding_e;
+
 typedef struct {
   const char *name;
   net_channel_e channel;
@@ -97,6 +115,25 @@ typedef struct {
 struct netpeer_s;
 typedef struct netpeer_s netpeer_t;
 
+typedef struct net_peer_stats_s {
+  uint32_t round_trip_time;
+  uint32_t lowest_round_trip_time;
+  uint32_t last_round_trip_time;
+  uint32_t round_trip_time_variance;
+  uint32_t highest_round_trip_time_variance;
+  uint32_t last_round_trip_time_variance;
+  float    packet_loss;
+  float    packet_loss_variance;
+  uint32_t packets_sent;
+  uint32_t packets_lost;
+  uint32_t throttle;
+  uint32_t throttle_acceleration;
+  uint32_t throttle_counter;
+  uint32_t throttle_deceleration;
+  uint32_t throttle_interval;
+  uint32_t throttle_limit;
+} net_peer_stats_t;
+
 typedef void netpeer_iter_t;
 
 #define NETPEER_FOR_EACH(pin) \
@@ -126,21 +163,23 @@ size_t      N_ParseAddressString(const char *address, char **host,
 
 /* General Networking (n_net.c) */
 
-void     N_Init(void);
-void     N_Disconnect(disconnection_reason_e reason);
-void     N_Shutdown(void);
-bool     N_Listen(const char *host, uint16_t port);
-bool     N_Connect(const char *host, uint16_t port);
-bool     N_Connected(void);
-bool     N_Reconnect(void);
-bool     N_ConnectToServer(const char *address);
-void     N_DisconnectPeer(netpeer_t *np, disconnection_reason_e reason);
-void     N_DisconnectPlayer(unsigned short playernum,
-                            disconnection_reason_e reason);
-void     N_ServiceNetworkTimeout(int timeout_ms);
-void     N_ServiceNetwork(void);
-uint32_t N_GetUploadBandwidth(void);
-uint32_t N_GetDownloadBandwidth(void);
+void        N_Init(void);
+bool        N_SetTransport(const char *name);
+const char* N_GetTransportName(void);
+void        N_Disconnect(disconnection_reason_e reason);
+void        N_Shutdown(void);
+bool        N_Listen(const char *host, uint16_t port);
+bool        N_Connect(const char *host, uint16_t port);
+bool        N_Connected(void);
+bool        N_Reconnect(void);
+bool        N_ConnectToServer(const char *address);
+void        N_DisconnectPeer(netpeer_t *np, disconnection_reason_e reason);
+void        N_DisconnectPlayer(unsigned short playernum,
+                               disconnection_reason_e reason);
+void        N_ServiceNetworkTimeout(int timeout_ms);
+void        N_ServiceNetwork(void);
+uint32_t    N_GetUploadBandwidth(void);
+uint32_t    N_GetDownloadBandwidth(void);
 
 /* Miscellaneous Networking (n_misc.c) */
 
@@ -148,9 +187,46 @@ bool        N_GetWad(const char *name);
 const char* N_RunningStateName(void);
 const char* N_GetDisconnectionReason(uint32_t reason);
 
+/* Network Workers (n_work.c) */
+
+typedef void (*net_work_f)(netpeer_t *np);
+
+unsigned int N_GetWorkerCount(void);
+void         N_ShutdownWorkers(void);
+void         N_WorkRun(GPtrArray *peers, net_work_f func);
+
+/* Network Benchmark (n_bench.c) */
+
+void N_BenchInit(const char *host, uint16_t port);
+bool N_BenchClient(void);
+void N_BenchBuildCommand(struct netticcmd_s *ncmd);
+void N_BenchUpdate(void);
+void N_BenchStartTic(void);
+void N_BenchFinishTic(void);
+void N_BenchRecordSync(gint64 delta_time, gint64 pack_time,
+                                          GPtrArray *sync_peers);
+
+/* Instance Host (n_host.c) */
+
+void N_HostInit(const char *control_path, const char *host,
+                                          unsigned short base_port);
+bool N_HostEnabled(void);
+void N_HostRun(void);
+
+/* Spectator Relay (n_relay.c) */
+
+void N_RelayInit(const char *address);
+bool N_RelayEnabled(void);
+bool N_RelayIsDownstream(netpeer_t *np);
+int  N_RelayGetOldestStateTIC(int tic);
+void N_RelayHandleMessage(netpeer_t *np, net_message_e message_type);
+void N_RelayGameActionChange(gameaction_t new_gameaction, int new_gametic);
+void N_RelayUpdateSync(void);
+
 /* Main Networking (n_main.c) */
 
 void N_InitNetGame(void);
+void N_ServerListen(const char *host, unsigned short port);
 void N_RunTic(void);
 bool N_TryRunTics(void);
 
@@ -216,7 +292,20 @@ void CL_SendVoteRequest(const char *command);
 
 /* Net Message Packing (n_pack.c) */
 
+size_t N_GetPlayerSetSize(const uint8_t *bitmap,
+                          player_set_encoding_e encoding);
+player_set_encoding_e N_ChoosePlayerSetEncoding(const uint8_t *bitmap);
+void N_PackPlayerSetAs(pbuf_t *pbuf, const uint8_t *bitmap,
+                                     player_set_encoding_e encoding);
+void N_PackPlayerSet(pbuf_t *pbuf, const uint8_t *bitmap);
+bool N_UnpackPlayerSet(pbuf_t *pbuf, uint8_t *bitmap);
+void N_PackCommand(pbuf_t *pbuf, const struct netticcmd_s *previous,
+                                 const struct netticcmd_s *ncmd);
+bool N_UnpackCommand(pbuf_t *pbuf, const struct netticcmd_s *previous,
+                                   struct netticcmd_s *ncmd);
+
 void N_PackSetupRequest(netpeer_t *np);
+bool N_UnpackSetupRequest(netpeer_t *np, bool *relay);
 
 void N_PackSetup(netpeer_t *np);
 
@@ -256,6 +345,8 @@ bool N_UnpackChatMessage(netpeer_t *np,
 
 void N_PackSync(netpeer_t *np);
 bool N_UnpackSync(netpeer_t *np);
+void N_PackRelaySync(netpeer_t *np);
+bool N_UnpackRelaySync(netpeer_t *np);
 
 bool N_UnpackPlayerPreferenceChange(netpeer_t *np,
                                     int *tic,
@@ -316,6 +407,9 @@ void N_PackVoteRequest(netpeer_t *np, const char *command);
 bool N_UnpackVoteRequest(netpeer_t *np, buf_t *buf);
 
 void N_PackGameActionChange(netpeer_t *np);
+void N_PackRelayedGameActionChange(netpeer_t *np,
+                                   gameaction_t new_gameaction,
+                                   int new_gametic);
 bool N_UnpackGameActionChange(netpeer_t *np, gameaction_t *new_gameaction,
                                              int *new_gametic);
 
@@ -329,6 +423,8 @@ double       N_PeerGetLastSetupRequestTime(netpeer_t *np);
 void         N_PeerUpdateLastSetupRequestTime(netpeer_t *np);
 auth_level_e N_PeerGetAuthLevel(netpeer_t *np);
 void         N_PeerSetAuthLevel(netpeer_t *np, auth_level_e auth_level);
+bool         N_PeerIsRelay(netpeer_t *np);
+void         N_PeerSetRelay(netpeer_t *np, bool relay);
 bool         N_PeerCheckTimeout(netpeer_t *np);
 bool         N_PeerCanRequestSetup(netpeer_t *np);
 
@@ -338,9 +434,9 @@ unsigned short N_PeerGetPort(netpeer_t *np);
 
 void         N_InitPeers(void);
 unsigned int N_PeerGetCount(void);
-netpeer_t*   N_PeerAdd(void *enet_peer);
+netpeer_t*   N_PeerAdd(void *transport_peer);
 netpeer_t*   N_PeerGet(int peernum);
-netpeer_t*   N_PeerForPeer(void *enet_peer);
+netpeer_t*   N_PeerForPeer(void *transport_peer);
 netpeer_t*   N_PeerForPlayer(unsigned int playernum);
 unsigned int N_PeerGetNumForPlayer(unsigned int playernum);
 void         N_PeerRemove(netpeer_t *np);
@@ -355,13 +451,18 @@ void    N_PeerFlushChannel(netpeer_t *np, net_channel_e channel);
 void    N_PeerFlushChannels(netpeer_t *np);
 pbuf_t* N_PeerBeginMessage(netpeer_t *np, net_message_e type);
 bool    N_PeerSetIncoming(netpeer_t *np, unsigned char *data, size_t size);
+bool    N_PeerReceive(netpeer_t *np, unsigned char *data, size_t size);
+bool    N_PeerGetNextPacket(netpeer_t *np, unsigned char **data,
+                                           size_t *size);
 bool    N_PeerLoadNextMessage(netpeer_t *np, net_message_e *message_type);
 pbuf_t* N_PeerGetIncomingMessageData(netpeer_t *np);
 void    N_PeerClearChannel(netpeer_t *np, net_channel_e channel);
+size_t  N_PeerGetChannelMessageSize(netpeer_t *np, net_channel_e channel);
 void    N_PeerSendReset(netpeer_t *np);
 size_t  N_PeerGetBytesUploaded(netpeer_t *np);
 size_t  N_PeerGetBytesDownloaded(netpeer_t *np);
-void*   N_PeerGetENetPeer(netpeer_t *np);
+void*   N_PeerGetTransportPeer(netpeer_t *np);
+void    N_PeerGetStats(netpeer_t *np, net_peer_stats_t *stats);
 
 bool N_PeerSyncNeedsGameInfo(netpeer_t *np);
 void N_PeerSyncSetNeedsGameInfo(netpeer_t *np);
@@ -393,7 +494,9 @@ game_state_delta_t* N_PeerGetSyncStateDelta(netpeer_t *np);
 void                N_PeerUpdateSyncStateDelta(netpeer_t *np,
                                                int from_tic,
                                                int to_tic,
+                                               state_hash_t *hash,
                                                pbuf_t *delta_data);
+void                N_PeerPrepareSyncStateDelta(netpeer_t *np);
 void                N_PeerBuildNewSyncStateDelta(netpeer_t *np);
 bool                N_PeerSyncStateDeltaUpdated(netpeer_t *np);
 void                N_PeerResetSyncStateDelta(netpeer_t *np, int sync_tic,
@@ -411,6 +514,10 @@ void         N_PeerUpdateSyncCommandIndexForPlayer(netpeer_t *np,
 
 void N_PeerResetSync(netpeer_t *np);
 
+struct aoi_views_s* N_PeerGetAOIViews(netpeer_t *np);
+void                N_PeerSetAOIViews(netpeer_t *np,
+                                      struct aoi_views_s *aoi_views);
+
 #endif
 
 /* vi: set et ts=2 sw=2: */
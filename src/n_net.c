@@ -23,8 +23,6 @@
 
 #include "z_zone.h"
 
-#include <enet/enet.h>
-
 #include "doomdef.h"
 #include "doomstat.h"
 #include "d_event.h"
@@ -34,36 +32,90 @@
 #include "g_state.h"
 #include "i_main.h"
 #include "i_system.h"
+#include "m_argv.h"
 #include "m_swap.h"
 #include "n_main.h"
+#include "n_transport.h"
 #include "p_user.h"
 #include "cl_main.h"
 #include "cl_net.h"
 
-#define USE_RANGE_CODER 1
-#define MAX_DOWNLOAD 0
-#define MAX_UPLOAD 0
+static net_transport_t *net_transports[] = {
+  &net_transport_enet,
+#ifdef __linux__
+  &net_transport_udp,
+#endif
+  NULL
+};
 
-static ENetHost   *net_host = NULL;
-static const char *previous_host = NULL;
-static uint16_t    previous_port = 0;
+static net_transport_t *net_transport = &net_transport_enet;
+static bool             net_transport_initialized = false;
+static bool             net_host = false;
+static const char      *previous_host = NULL;
+static uint16_t         previous_port = 0;
 
 bool netgame   = false;
 bool solonet   = false;
 bool netserver = false;
 
+static void warn_unknown_peer(const char *function, const char *event_name,
+                                                    void *transport_peer) {
+  D_Msg(MSG_WARN, "%s: Got '%s' event from unknown peer %s:%u.\n",
+    function,
+    event_name,
+    N_IPToConstString(net_transport->get_address(transport_peer)),
+    net_transport->get_port(transport_peer)
+  );
+}
+
+net_transport_t* N_GetTransport(void) {
+  return net_transport;
+}
+
+bool N_SetTransport(const char *name) {
+  if (net_transport_initialized) {
+    D_Msg(MSG_ERROR, "N_SetTransport: Network already initialized\n");
+    return false;
+  }
+
+  for (size_t i = 0; net_transports[i]; i++) {
+    if (strcasecmp(net_transports[i]->name, name) == 0) {
+      net_transport = net_transports[i];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+const char* N_GetTransportName(void) {
+  return net_transport->name;
+}
+
 void N_Init(void) {
-  if (enet_initialize() != 0) {
-    I_Error("Error initializing ENet");
+  int p;
+
+  if ((p = M_CheckParm("-transport")) && p < myargc - 1) {
+    if (!N_SetTransport(myargv[p + 1])) {
+      I_Error("Unknown network transport '%s'", myargv[p + 1]);
+    }
+  }
+
+  net_transport = N_SimWrapTransport(net_transport);
+
+  if (!net_transport->init()) {
+    I_Error("Error initializing %s network transport", net_transport->name);
   }
 
+  net_transport_initialized = true;
+
   N_InitPeers();
   G_InitStates();
   atexit(N_Shutdown);
 }
 
 void N_Disconnect(disconnection_reason_e reason) {
-  ENetEvent net_event;
+  net_event_t net_event;
 
   if (!net_host) {
     return;
@@ -75,8 +127,8 @@ void N_Disconnect(disconnection_reason_e reason) {
   }
 
   while (true) {
-    int res = enet_host_service(
-      net_host, &net_event, NET_DISCONNECT_TIMEOUT * 1000
+    int res = net_transport->service(
+      &net_event, NET_DISCONNECT_TIMEOUT * 1000
     );
 
     if (res > 0) {
@@ -85,15 +137,15 @@ void N_Disconnect(disconnection_reason_e reason) {
       if (!np) {
         D_Msg(MSG_WARN,
           "N_Disconnect: Received network event from unknown peer %s:%u\n",
-          N_IPToConstString(ENET_NET_TO_HOST_32(net_event.peer->address.host)),
-          net_event.peer->address.port
+          N_IPToConstString(net_transport->get_address(net_event.peer)),
+          net_transport->get_port(net_event.peer)
         );
-        continue;
       }
-
-      if (net_event.type == ENET_EVENT_TYPE_DISCONNECT) {
+      else if (net_event.type == NET_EVENT_DISCONNECT) {
         N_PeerRemove(np);
       }
+
+      net_transport->free_event(&net_event);
     }
     else {
       if (res < 0) {
@@ -108,83 +160,45 @@ void N_Disconnect(disconnection_reason_e reason) {
     N_PeerIterRemove(iter.it, iter.np);
   }
 
-  memset(&net_event, 0, sizeof(ENetEvent));
-
-  enet_host_destroy(net_host);
-  net_host = NULL;
+  net_transport->destroy();
+  net_host = false;
 }
 
 void N_Shutdown(void) {
   D_Msg(MSG_INFO, "N_Shutdown: shutting down\n");
   N_Disconnect(DISCONNECT_REASON_MANUAL);
+  N_ShutdownWorkers();
 
-  enet_deinitialize();
+  if (net_transport_initialized) {
+    net_transport->shutdown();
+    net_transport_initialized = false;
+  }
 }
 
 bool N_Listen(const char *host, uint16_t port) {
-  ENetAddress address;
-
-  if (host) {
-    enet_address_set_host(&address, host);
-  }
-  else {
-    address.host = ENET_HOST_ANY;
-  }
-
-  if (port != 0) {
-    address.port = port;
-  }
-  else {
-    address.port = DEFAULT_PORT;
+  if (port == 0) {
+    port = DEFAULT_PORT;
   }
 
-  net_host = enet_host_create(
-    &address, MAXPLAYERS, NET_CHANNEL_MAX, MAX_DOWNLOAD, MAX_UPLOAD
-  );
-  
-  if (!net_host) {
+  if (!net_transport->listen(host, port, MAXPLAYERS)) {
     D_Msg(MSG_ERROR, "N_Listen: Error creating host on %s:%u\n", host, port);
     return false;
   }
 
-#if USE_RANGE_CODER
-  if (enet_host_compress_with_range_coder(net_host) < 0) {
-    D_Msg(MSG_ERROR, "N_Listen: Error activating range coder\n");
-    return false;
-  }
-#endif
+  net_host = true;
 
   return true;
 }
 
 bool N_Connect(const char *host, uint16_t port) {
-  ENetPeer *server = NULL;
-  ENetAddress address;
-
-  net_host = enet_host_create(NULL, 1, NET_CHANNEL_MAX, 0, 0);
-
-  if (!net_host) {
-    D_Msg(MSG_ERROR, "N_Connect: Error creating host\n");
-    return false;
-  }
-
-#if USE_RANGE_CODER
-  if (enet_host_compress_with_range_coder(net_host) < 0) {
-    D_Msg(MSG_ERROR, "N_Connect: Error activating range coder\n");
-    return false;
-  }
-#endif
-
-  enet_address_set_host(&address, host);
+  void *server = NULL;
 
-  if (port != 0) {
-    address.port = port;
-  }
-  else {
-    address.port = DEFAULT_PORT;
+  if (port == 0) {
+    port = DEFAULT_PORT;
   }
 
-  server = enet_host_connect(net_host, &address, NET_CHANNEL_MAX, 0);
+  server = net_transport->connect(host, port);
+  net_host = true;
 
   if (!server) {
     D_Msg(MSG_ERROR, "N_Connect: Error connecting to server\n");
@@ -201,7 +215,7 @@ bool N_Connect(const char *host, uint16_t port) {
 }
 
 bool N_Connected(void) {
-  return (net_host != NULL);
+  return net_host;
 }
 
 bool N_Reconnect(void) {
@@ -214,9 +228,11 @@ bool N_Reconnect(void) {
 }
 
 void N_WaitForPacket(int ms) {
-  ENetEvent net_event;
+  net_event_t net_event;
 
-  enet_host_service(net_host, &net_event, ms);
+  if (net_transport->service(&net_event, ms) > 0) {
+    net_transport->free_event(&net_event);
+  }
 }
 
 bool N_ConnectToServer(const char *address) {
@@ -264,15 +280,18 @@ void N_DisconnectPlayer(unsigned short playernum,
   N_DisconnectPeer(np, reason);
 }
 
-static void handle_enet_connection(ENetEvent *net_event) {
+static void handle_connection(net_event_t *net_event) {
   netpeer_t *np;
 
-  if (SERVER) {
+  /* Relays accept downstream peers alongside their upstream server */
+  if (SERVER || (N_RelayEnabled() && !N_PeerForPeer(net_event->peer))) {
     np = N_PeerAdd(net_event->peer);
 
     if (!np) {
       D_Msg(MSG_ERROR, "N_ServiceNetwork: Adding new peer failed\n");
-      enet_peer_disconnect(net_event->peer, DISCONNECT_REASON_SERVER_FULL);
+      net_transport->disconnect(
+        net_event->peer, DISCONNECT_REASON_SERVER_FULL
+      );
       return;
     }
   }
@@ -291,19 +310,15 @@ static void handle_enet_connection(ENetEvent *net_event) {
   }
 }
 
-static void handle_enet_disconnection(ENetEvent *net_event) {
+static void handle_disconnection(net_event_t *net_event) {
   netpeer_t *np = N_PeerForPeer(net_event->peer);
 
   if (!np) {
-    D_Msg(MSG_WARN,
-      "N_ServiceNetwork: Got 'disconnect' event from unknown peer %s:%u.\n",
-      N_IPToConstString(ENET_NET_TO_HOST_32(net_event->peer->address.host)),
-      net_event->peer->address.port
-    );
+    warn_unknown_peer("N_ServiceNetwork", "disconnect", net_event->peer);
     return;
   }
 
-  if (CLIENT) {
+  if (CLIENT && !N_RelayIsDownstream(np)) {
     N_Disconnect(DISCONNECT_REASON_GOT_PEER_DISCONNECTION);
   }
 
@@ -314,32 +329,33 @@ static void handle_enet_disconnection(ENetEvent *net_event) {
   N_PeerRemove(np);
 }
 
-static void handle_enet_receive(ENetEvent *net_event) {
+/* Handling a packet can remove its peer, so look it up each time */
+static void handle_receive(net_event_t *net_event) {
   netpeer_t *np = N_PeerForPeer(net_event->peer);
+  unsigned char *data = NULL;
+  size_t size = 0;
 
   if (!np) {
-    D_Msg(MSG_WARN,
-      "N_ServiceNetwork: Got 'packet' event from unknown peer %s:%u.\n",
-      N_IPToConstString(ENET_NET_TO_HOST_32(
-        net_event->peer->address.host
-      )),
-      net_event->peer->address.port
-    );
+    warn_unknown_peer("N_ServiceNetwork", "packet", net_event->peer);
     return;
   }
 
-  if ((net_event->packet->data[0] & 0x80) == 0x80) {
-    N_HandlePacket(
-      np, net_event->packet->data, net_event->packet->dataLength
-    );
+  if (!N_PeerReceive(np, net_event->packet_data, net_event->packet_size)) {
+    D_Msg(MSG_NET, "N_ServiceNetwork: Ignoring malformed packet.\n");
   }
 
-  enet_packet_destroy(net_event->packet);
+  while (np && N_PeerGetNextPacket(np, &data, &size)) {
+    if (size > 0 && (data[0] & 0x80) == 0x80) {
+      N_HandlePacket(np, data, size);
+    }
+
+    np = net_host ? N_PeerForPeer(net_event->peer) : NULL;
+  }
 }
 
 void N_ServiceNetworkTimeout(int timeout_ms) {
   int status = 0;
-  ENetEvent net_event;
+  net_event_t net_event;
 
   if (!net_host) {
     return;
@@ -360,15 +376,7 @@ void N_ServiceNetworkTimeout(int timeout_ms) {
   }
 
   while (net_host) {
-    status = enet_host_service(net_host, &net_event, timeout_ms);
-
-    /*
-     * [CG]: ENet says this must be cleared, so do it right away here at the
-     *       top since we don't use it.
-     */
-    if (net_event.peer && net_event.peer->data) {
-      net_event.peer->data = NULL;
-    }
+    status = net_transport->service(&net_event, timeout_ms);
 
     if (status == 0) {
       break;
@@ -382,24 +390,22 @@ void N_ServiceNetworkTimeout(int timeout_ms) {
     }
 
     switch (net_event.type) {
-      case ENET_EVENT_TYPE_CONNECT:
-        handle_enet_connection(&net_event);
+      case NET_EVENT_CONNECT:
+        handle_connection(&net_event);
       break;
-      case ENET_EVENT_TYPE_DISCONNECT:
-        handle_enet_disconnection(&net_event);
+      case NET_EVENT_DISCONNECT:
+        handle_disconnection(&net_event);
       break;
-      case ENET_EVENT_TYPE_RECEIVE:
-        handle_enet_receive(&net_event);
+      case NET_EVENT_RECEIVE:
+        handle_receive(&net_event);
       break;
       default:
-        D_Msg(MSG_WARN,
-          "N_ServiceNetwork: Got unknown event from peer %s:%u.\n",
-          N_IPToConstString(ENET_NET_TO_HOST_32(net_event.peer->address.host)),
-          net_event.peer->address.port
-        );
+        warn_unknown_peer("N_ServiceNetwork", "unknown", net_event.peer);
       break;
     }
 
+    net_transport->free_event(&net_event);
+
     if (timeout_ms != 0) {
       break;
     }
@@ -36,10 +36,12 @@
 #include "m_bitmap.h"
 #include "m_file.h"
 #include "n_main.h"
+#include "p_reject.h"
 #include "p_user.h"
 #include "cl_cmd.h"
 #include "cl_main.h"
 #include "cl_net.h"
+#include "sv_aoi.h"
 #include "p_user.h"
 #include "w_wad.h"
 
@@ -53,6 +55,8 @@
 #define MAX_COMMAND_LENGTH 32
 #define MAX_CHAT_MESSAGE_SIZE 256
 
+#define SETUP_REQUEST_RELAY 0x01
+
 #define check_range(x, min, max)                                              \
   if ((x < min) || (x > max)) {                                               \
     P_Printf(consoleplayer,                                                   \
@@ -290,13 +294,522 @@ static void free_string(gpointer data) {
   free(data);
 }
 
+#define PLAYER_BITMAP_SIZE bit_size_to_byte_size(MAXPLAYERS)
+
+#define player_bitmap_for_each(bitmap, length, pn)                            \
+  for (size_t pn##_byte = 0; pn##_byte < (length); pn##_byte++)               \
+    for (unsigned int pn##_bit = 0, pn = 0;                                   \
+         bitmap[pn##_byte] != 0 && pn##_bit < 8;                              \
+         pn##_bit++)                                                          \
+      if ((bitmap[pn##_byte] & (1 << pn##_bit)) &&                            \
+          ((pn = (pn##_byte << 3) + pn##_bit), true))
+
+typedef struct {
+  size_t length;
+  unsigned int count;
+  unsigned int runs;
+  size_t sizes[PLAYER_SET_ENCODING_MAX];
+} player_set_info_t;
+
+static size_t get_unum_size(uint64_t num) {
+  if (num <= 0x7F) {
+    return 1;
+  }
+
+  if (num <= 0xFF) {
+    return 2;
+  }
+
+  if (num <= 0xFFFF) {
+    return 3;
+  }
+
+  if (num <= 0xFFFFFFFF) {
+    return 5;
+  }
+
+  return 9;
+}
+
+static size_t get_array_header_size(size_t count) {
+  if (count <= 0xF) {
+    return 1;
+  }
+
+  if (count <= 0xFFFF) {
+    return 3;
+  }
+
+  return 5;
+}
+
+static size_t get_bitmap_ext_size(size_t size) {
+  switch (size) {
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+    case 16:
+      return size + 2;
+    default:
+      break;
+  }
+
+  if (size <= 0xFF) {
+    return size + 3;
+  }
+
+  if (size <= 0xFFFF) {
+    return size + 4;
+  }
+
+  return size + 6;
+}
+
+static void get_player_set_info(const uint8_t *bitmap,
+                                player_set_info_t *info) {
+  size_t index_size = 0;
+  size_t run_size = 0;
+  unsigned int next = 0;
+  unsigned int run_length = 0;
+
+  info->length = PLAYER_BITMAP_SIZE;
+
+  while (info->length > 0 && bitmap[info->length - 1] == 0) {
+    info->length--;
+  }
+
+  info->count = 0;
+  info->runs = 0;
+
+  player_bitmap_for_each(bitmap, info->length, i) {
+    if (run_length > 0 && i == next) {
+      run_length++;
+    }
+    else {
+      if (run_length > 0) {
+        run_size += get_unum_size(run_length);
+      }
+
+      run_size += get_unum_size(i - next);
+      run_length = 1;
+      info->runs++;
+    }
+
+    index_size += get_unum_size(i - next);
+    next = i + 1;
+    info->count++;
+  }
+
+  if (run_length > 0) {
+    run_size += get_unum_size(run_length);
+  }
+
+  info->sizes[PLAYER_SET_INDICES] =
+    1 + get_array_header_size(info->count) + index_size;
+  info->sizes[PLAYER_SET_RUNS] =
+    1 + get_array_header_size(info->runs * 2) + run_size;
+  info->sizes[PLAYER_SET_BITMAP] = 1 + get_bitmap_ext_size(info->length);
+}
+
+static player_set_encoding_e choose_player_set_encoding(
+                                                  player_set_info_t *info) {
+  player_set_encoding_e encoding = PLAYER_SET_INDICES;
+
+  for (int i = PLAYER_SET_INDICES + 1; i < PLAYER_SET_ENCODING_MAX; i++) {
+    if (info->sizes[i] < info->sizes[encoding]) {
+      encoding = i;
+    }
+  }
+
+  return encoding;
+}
+
+static void pack_player_set(pbuf_t *pbuf, const uint8_t *bitmap,
+                                          player_set_info_t *info,
+                                          player_set_encoding_e encoding) {
+  unsigned int next = 0;
+  unsigned int run_length = 0;
+
+  M_PBufWriteUChar(pbuf, encoding);
+
+  switch (encoding) {
+    case PLAYER_SET_INDICES:
+      M_PBufWriteArray(pbuf, info->count);
+
+      player_bitmap_for_each(bitmap, info->length, i) {
+        M_PBufWriteUNum(pbuf, i - next);
+        next = i + 1;
+      }
+    break;
+    case PLAYER_SET_RUNS:
+      M_PBufWriteArray(pbuf, info->runs * 2);
+
+      player_bitmap_for_each(bitmap, info->length, i) {
+        if (run_length > 0 && i == next) {
+          run_length++;
+        }
+        else {
+          if (run_length > 0) {
+            M_PBufWriteUNum(pbuf, run_length);
+          }
+
+          M_PBufWriteUNum(pbuf, i - next);
+          run_length = 1;
+        }
+
+        next = i + 1;
+      }
+
+      if (run_length > 0) {
+        M_PBufWriteUNum(pbuf, run_length);
+      }
+    break;
+    case PLAYER_SET_BITMAP:
+      M_PBufWriteBitmap(pbuf, (const char *)bitmap, info->length);
+    break;
+    default:
+      I_Error("pack_player_set: Invalid player set encoding %d", encoding);
+    break;
+  }
+}
+
+size_t N_GetPlayerSetSize(const uint8_t *bitmap,
+                          player_set_encoding_e encoding) {
+  player_set_info_t info;
+
+  if (encoding >= PLAYER_SET_ENCODING_MAX) {
+    I_Error("N_GetPlayerSetSize: Invalid player set encoding %d", encoding);
+  }
+
+  get_player_set_info(bitmap, &info);
+
+  return info.sizes[encoding];
+}
+
+player_set_encoding_e N_ChoosePlayerSetEncoding(const uint8_t *bitmap) {
+  player_set_info_t info;
+
+  get_player_set_info(bitmap, &info);
+
+  return choose_player_set_encoding(&info);
+}
+
+void N_PackPlayerSetAs(pbuf_t *pbuf, const uint8_t *bitmap,
+                                     player_set_encoding_e encoding) {
+  player_set_info_t info;
+
+  get_player_set_info(bitmap, &info);
+  pack_player_set(pbuf, bitmap, &info, encoding);
+}
+
+void N_PackPlayerSet(pbuf_t *pbuf, const uint8_t *bitmap) {
+  player_set_info_t info;
+
+  get_player_set_info(bitmap, &info);
+  pack_player_set(pbuf, bitmap, &info, choose_player_set_encoding(&info));
+}
+
+bool N_UnpackPlayerSet(pbuf_t *pbuf, uint8_t *bitmap) {
+  unsigned char m_encoding = 0;
+  unsigned int m_count = 0;
+  unsigned int m_value = 0;
+  uint64_t position = 0;
+
+  memset(bitmap, 0, PLAYER_BITMAP_SIZE);
+
+  read_uchar(pbuf, m_encoding, "player set encoding");
+
+  switch (m_encoding) {
+    case PLAYER_SET_INDICES:
+      read_array(pbuf, m_count, "player set index count");
+
+      if (m_count > MAXPLAYERS) {
+        P_Printf(consoleplayer, "%s: Invalid player set index count %u.\n",
+          __func__, m_count
+        );
+        return false;
+      }
+
+      for (unsigned int i = 0; i < m_count; i++) {
+        read_uint(pbuf, m_value, "player set index");
+
+        position += m_value;
+
+        if (position >= MAXPLAYERS) {
+          P_Printf(consoleplayer, "%s: Invalid player number %" PRIu64 ".\n",
+            __func__, position
+          );
+          return false;
+        }
+
+        bitmap_set_bit(bitmap, position);
+        position++;
+      }
+    break;
+    case PLAYER_SET_RUNS:
+      read_array(pbuf, m_count, "player set run count");
+
+      for (unsigned int i = 0; i < m_count; i++) {
+        read_uint(pbuf, m_value, "player set run length");
+
+        if ((i & 1) == 0) {
+          position += m_value;
+
+          if (position > MAXPLAYERS) {
+            P_Printf(consoleplayer, "%s: Invalid player gap %u.\n",
+              __func__, m_value
+            );
+            return false;
+          }
+
+          continue;
+        }
+
+        if (position + m_value > MAXPLAYERS) {
+          P_Printf(consoleplayer,
+            "%s: Invalid player run %" PRIu64 " + %u.\n",
+            __func__, position, m_value
+          );
+          return false;
+        }
+
+        while (m_value--) {
+          bitmap_set_bit(bitmap, position);
+          position++;
+        }
+      }
+    break;
+    case PLAYER_SET_BITMAP:
+      read_bitmap(pbuf, bitmap, PLAYER_BITMAP_SIZE, "player set bitmap");
+    break;
+    default:
+      P_Printf(consoleplayer, "%s: Invalid player set encoding %u.\n",
+        __func__, m_encoding
+      );
+      return false;
+  }
+
+  return true;
+}
+
+/*
+ * Commands are a byte of changed-field flags and a zigzag delta per changed
+ * field, against the previous command in the message advanced by one TIC.
+ */
+
+#define COMMAND_INDEX_CHANGED      (1 << 0)
+#define COMMAND_TIC_CHANGED        (1 << 1)
+#define COMMAND_SERVER_TIC_CHANGED (1 << 2)
+#define COMMAND_FORWARD_CHANGED    (1 << 3)
+#define COMMAND_SIDE_CHANGED       (1 << 4)
+#define COMMAND_ANGLE_CHANGED      (1 << 5)
+#define COMMAND_BUTTONS_CHANGED    (1 << 6)
+#define COMMAND_FULL               (1 << 7)
+
+#define read_command_delta(pbuf, flags, flag, base, var, type, min, max, name)\
+  if (flags & flag) {                                                         \
+    uint64_t m_delta;                                                         \
+    int64_t m_value;                                                          \
+                                                                              \
+    read_ulong(pbuf, m_delta, name);                                          \
+    m_value = ((int64_t)base) + zigzag_decode(m_delta);                       \
+                                                                              \
+    if ((m_value < min) || (m_value > max)) {                                 \
+      P_Printf(consoleplayer, "%s: Invalid %s %" PRId64 ".\n",                \
+        __func__, name, m_value                                               \
+      );                                                                      \
+      return false;                                                           \
+    }                                                                         \
+                                                                              \
+    var = (type)m_value;                                                      \
+  }                                                                           \
+  else {                                                                      \
+    var = base;                                                               \
+  }
+
+static uint64_t zigzag_encode(int64_t n) {
+  return (((uint64_t)n) << 1) ^ ((uint64_t)(n >> 63));
+}
+
+static int64_t zigzag_decode(uint64_t n) {
+  return ((int64_t)(n >> 1)) ^ -((int64_t)(n & 1));
+}
+
+static size_t get_num_size(int64_t num) {
+  if (num >= 0) {
+    return get_unum_size(num);
+  }
+
+  if (num >= -32) {
+    return 1;
+  }
+
+  if (num >= INT8_MIN) {
+    return 2;
+  }
+
+  if (num >= INT16_MIN) {
+    return 3;
+  }
+
+  if (num >= INT32_MIN) {
+    return 5;
+  }
+
+  return 9;
+}
+
+static void predict_command(const netticcmd_t *previous,
+                            netticcmd_t *prediction) {
+  *prediction = *previous;
+
+  prediction->index++;
+  prediction->tic++;
+
+  if (prediction->server_tic != 0) {
+    prediction->server_tic++;
+  }
+}
+
+void N_PackCommand(pbuf_t *pbuf, const netticcmd_t *previous,
+                                 const netticcmd_t *ncmd) {
+  netticcmd_t prediction;
+  int64_t deltas[7];
+  unsigned char flags = 0;
+  size_t full_size;
+  size_t delta_size;
+
+  full_size = get_unum_size(COMMAND_FULL) +
+              get_unum_size(ncmd->index) +
+              get_unum_size(ncmd->tic) +
+              get_unum_size(ncmd->server_tic) +
+              get_num_size(ncmd->forward) +
+              get_num_size(ncmd->side) +
+              get_num_size(ncmd->angle) +
+              get_unum_size(ncmd->buttons);
+
+  if (previous) {
+    predict_command(previous, &prediction);
+
+    deltas[0] = ((int64_t)ncmd->index)      - prediction.index;
+    deltas[1] = ((int64_t)ncmd->tic)        - prediction.tic;
+    deltas[2] = ((int64_t)ncmd->server_tic) - prediction.server_tic;
+    deltas[3] = ((int64_t)ncmd->forward)    - prediction.forward;
+    deltas[4] = ((int64_t)ncmd->side)       - prediction.side;
+    deltas[5] = ((int64_t)ncmd->angle)      - prediction.angle;
+    deltas[6] = ((int64_t)ncmd->buttons)    - prediction.buttons;
+
+    delta_size = 0;
+
+    for (int i = 0; i < 7; i++) {
+      if (deltas[i] != 0) {
+        flags |= (1 << i);
+        delta_size += get_unum_size(zigzag_encode(deltas[i]));
+      }
+    }
+
+    delta_size += get_unum_size(flags);
+
+    if (delta_size <= full_size) {
+      M_PBufWriteUChar(pbuf, flags);
+
+      for (int i = 0; i < 7; i++) {
+        if (flags & (1 << i)) {
+          M_PBufWriteUNum(pbuf, zigzag_encode(deltas[i]));
+        }
+      }
+
+      return;
+    }
+  }
+
+  M_PBufWriteUChar(pbuf, COMMAND_FULL);
+  M_PBufWriteUNum(pbuf, ncmd->index);
+  M_PBufWriteUNum(pbuf, ncmd->tic);
+  M_PBufWriteUNum(pbuf, ncmd->server_tic);
+  M_PBufWriteNum(pbuf, ncmd->forward);
+  M_PBufWriteNum(pbuf, ncmd->side);
+  M_PBufWriteNum(pbuf, ncmd->angle);
+  M_PBufWriteUNum(pbuf, ncmd->buttons);
+}
+
+bool N_UnpackCommand(pbuf_t *pbuf, const netticcmd_t *previous,
+                                   netticcmd_t *ncmd) {
+  netticcmd_t prediction;
+  netticcmd_t m_ncmd;
+  unsigned char m_flags;
+
+  read_uchar(pbuf, m_flags, "command flags");
+
+  if (m_flags == COMMAND_FULL) {
+    unpack_net_command(pbuf, m_ncmd);
+    *ncmd = m_ncmd;
+    return true;
+  }
+
+  if (m_flags & COMMAND_FULL) {
+    P_Printf(consoleplayer, "%s: Invalid command flags %u.\n",
+      __func__, m_flags
+    );
+    return false;
+  }
+
+  if (!previous) {
+    P_Printf(consoleplayer, "%s: Command delta without a previous command.\n",
+      __func__
+    );
+    return false;
+  }
+
+  predict_command(previous, &prediction);
+
+  read_command_delta(
+    pbuf, m_flags, COMMAND_INDEX_CHANGED, prediction.index, m_ncmd.index,
+    unsigned int, 0, UINT_MAX, "command index"
+  );
+  read_command_delta(
+    pbuf, m_flags, COMMAND_TIC_CHANGED, prediction.tic, m_ncmd.tic,
+    unsigned int, 0, UINT_MAX, "command TIC"
+  );
+  read_command_delta(
+    pbuf, m_flags, COMMAND_SERVER_TIC_CHANGED, prediction.server_tic,
+    m_ncmd.server_tic, unsigned int, 0, UINT_MAX, "server command TIC"
+  );
+  read_command_delta(
+    pbuf, m_flags, COMMAND_FORWARD_CHANGED, prediction.forward,
+    m_ncmd.forward, char, SCHAR_MIN, SCHAR_MAX, "command forward value"
+  );
+  read_command_delta(
+    pbuf, m_flags, COMMAND_SIDE_CHANGED, prediction.side, m_ncmd.side,
+    char, SCHAR_MIN, SCHAR_MAX, "command side value"
+  );
+  read_command_delta(
+    pbuf, m_flags, COMMAND_ANGLE_CHANGED, prediction.angle, m_ncmd.angle,
+    short, SHRT_MIN, SHRT_MAX, "command angle value"
+  );
+  read_command_delta(
+    pbuf, m_flags, COMMAND_BUTTONS_CHANGED, prediction.buttons,
+    m_ncmd.buttons, unsigned char, 0, UCHAR_MAX, "command buttons value"
+  );
+
+  *ncmd = m_ncmd;
+
+  return true;
+}
+
 static void pack_run_commands(pbuf_t *pbuf, unsigned int playernum) {
-  GPtrArray *commands = players[playernum].cmdq.commands;
+  unsigned int span = P_GetCommandSpan(playernum);
+  netticcmd_t *previous = NULL;
   unsigned int command_count = 0;
   unsigned int total_command_count = 0;
 
-  for (unsigned int i = 0; i < commands->len; i++) {
-    netticcmd_t *ncmd = g_ptr_array_index(commands, i);
+  for (unsigned int i = 0; i < span; i++) {
+    netticcmd_t *ncmd = P_GetCommand(playernum, i);
+
+    if (!ncmd) {
+      continue;
+    }
 
     total_command_count++;
 
@@ -318,14 +831,30 @@ static void pack_run_commands(pbuf_t *pbuf, unsigned int playernum) {
     D_Msg(MSG_SYNC, "(%d) (%d) Ran commands: [", gametic, playernum);
   }
 
-  for (unsigned int i = 0; i < commands->len; i++) {
-    netticcmd_t *ncmd = g_ptr_array_index(commands, i);
+  /* After the first command only the deviation from consecutive is sent */
+  for (unsigned int i = 0; i < span; i++) {
+    netticcmd_t *ncmd = P_GetCommand(playernum, i);
 
-    if (ncmd->server_tic != 0) {
-      D_Msg(MSG_SYNC, " %d/%d/%d", ncmd->index, ncmd->tic, ncmd->server_tic);
+    if (!ncmd || ncmd->server_tic == 0) {
+      continue;
+    }
+
+    D_Msg(MSG_SYNC, " %d/%d/%d", ncmd->index, ncmd->tic, ncmd->server_tic);
+
+    if (!previous) {
       M_PBufWriteUNum(pbuf, ncmd->index);
       M_PBufWriteUNum(pbuf, ncmd->server_tic);
     }
+    else {
+      M_PBufWriteUNum(pbuf, zigzag_encode(
+        ((int64_t)ncmd->index) - previous->index - 1
+      ));
+      M_PBufWriteUNum(pbuf, zigzag_encode(
+        ((int64_t)ncmd->server_tic) - previous->server_tic - 1
+      ));
+    }
+
+    previous = ncmd;
   }
 
   if (command_count > 0) {
@@ -335,11 +864,16 @@ static void pack_run_commands(pbuf_t *pbuf, unsigned int playernum) {
 
 static void pack_unsynchronized_commands(pbuf_t *pbuf, netpeer_t *np,
                                                        int src_playernum) {
-  GPtrArray *commands = players[src_playernum].cmdq.commands;
+  unsigned int span = P_GetCommandSpan(src_playernum);
+  netticcmd_t *previous = NULL;
   unsigned int command_count = 0;
 
-  for (unsigned int i = 0; i < commands->len; i++) {
-    netticcmd_t *ncmd = (netticcmd_t *)g_ptr_array_index(commands, i);
+  for (unsigned int i = 0; i < span; i++) {
+    netticcmd_t *ncmd = P_GetCommand(src_playernum, i);
+
+    if (!ncmd) {
+      continue;
+    }
 
     if (ncmd->index > N_PeerGetSyncCommandIndexForPlayer(np, src_playernum)) {
       command_count++;
@@ -365,18 +899,17 @@ static void pack_unsynchronized_commands(pbuf_t *pbuf, netpeer_t *np,
     );
   }
 
-  for (size_t i = 0; i < commands->len; i++) {
-    netticcmd_t *ncmd = (netticcmd_t *)g_ptr_array_index(commands, i);
+  for (unsigned int i = 0; i < span; i++) {
+    netticcmd_t *ncmd = P_GetCommand(src_playernum, i);
+
+    if (!ncmd) {
+      continue;
+    }
 
     if (ncmd->index > N_PeerGetSyncCommandIndexForPlayer(np, src_playernum)) {
       D_Msg(MSG_SYNC, " %u/%u/%u", ncmd->index, ncmd->tic, ncmd->server_tic);
-      M_PBufWriteUNum(pbuf, ncmd->index);
-      M_PBufWriteUNum(pbuf, ncmd->tic);
-      M_PBufWriteUNum(pbuf, ncmd->server_tic);
-      M_PBufWriteNum(pbuf, ncmd->forward);
-      M_PBufWriteNum(pbuf, ncmd->side);
-      M_PBufWriteNum(pbuf, ncmd->angle);
-      M_PBufWriteUNum(pbuf, ncmd->buttons);
+      N_PackCommand(pbuf, previous, ncmd);
+      previous = ncmd;
     }
   }
 
@@ -388,11 +921,23 @@ static void pack_unsynchronized_commands(pbuf_t *pbuf, netpeer_t *np,
 void N_PackSetupRequest(netpeer_t *np) {
   pbuf_t *pbuf = N_PeerBeginMessage(np, NM_SETUP);
 
-  M_PBufWriteUChar(pbuf, 0);
+  M_PBufWriteUChar(pbuf, N_RelayEnabled() ? SETUP_REQUEST_RELAY : 0);
+}
+
+bool N_UnpackSetupRequest(netpeer_t *np, bool *relay) {
+  pbuf_t *pbuf = N_PeerGetIncomingMessageData(np);
+  unsigned char m_flags;
+
+  read_uchar(pbuf, m_flags, "setup request flags");
+
+  *relay = (m_flags & SETUP_REQUEST_RELAY) == SETUP_REQUEST_RELAY;
+
+  return true;
 }
 
 void N_PackSetup(netpeer_t *np) {
-  game_state_t *gs = G_GetLatestState();
+  game_state_t *gs = SV_AOIFiltersPeer(np) ? SV_AOIGetFullState(np) :
+                                             G_GetLatestState();
   pbuf_t *pbuf = NULL;
   size_t resource_count = 0;
   size_t deh_count = deh_files->len;
@@ -402,23 +947,15 @@ void N_PackSetup(netpeer_t *np) {
   pbuf = N_PeerBeginMessage(np, NM_SETUP);
 
   M_PBufWriteNum(pbuf, deathmatch);
+  M_PBufWriteBool(pbuf, P_RejectBuildEnabled());
+  M_PBufWriteULong(pbuf, P_GetRejectHash());
   M_PBufWriteUNum(pbuf, N_PeerGetPlayernum(np));
 
-  /*
-   * We will support 2048 connections, which is a maximum of 2048 players.  I
-   * could do (and have done) math here to figure out where the optimal
-   * crossover point between indices and a bitmap is, but the fact is that
-   * putting a 2048 short array in a struct is 4k, and that tends to blow
-   * stacks.  So bitmap it (always) is, then.
-   */
-
-  for (size_t i = 0; i < MAXPLAYERS; i++) {
-    if (playeringame[i]) {
-      bitmap_set_bit(bitmap, i);
-    }
+  PLAYERS_FOR_EACH(i) {
+    bitmap_set_bit(bitmap, i);
   }
 
-  M_PBufWriteBitmap(pbuf, (char *)bitmap, sizeof(bitmap));
+  N_PackPlayerSet(pbuf, bitmap);
 
   M_PBufWriteString(pbuf, iwad, strlen(iwad));
 
@@ -474,13 +1011,15 @@ void N_PackSetup(netpeer_t *np) {
   }
 
   M_PBufWriteInt(pbuf, gs->tic);
-  M_PBufWriteBytes(pbuf, M_PBufGetData(gs->data), M_PBufGetSize(gs->data));
+  G_WriteStateToPackedBuffer(gs, pbuf);
   N_PeerUpdateSyncTIC(np, gs->tic);
 }
 
 bool N_UnpackSetup(netpeer_t *np, unsigned short *playernum) {
   pbuf_t *pbuf = N_PeerGetIncomingMessageData(np);
   int m_deathmatch = 0;
+  bool m_build_reject = false;
+  uint64_t m_reject_hash = 0;
   unsigned int m_playernum = 0;
   def_bitmap_zero(bitmap, MAXPLAYERS);
   int m_state_tic;
@@ -496,10 +1035,16 @@ bool N_UnpackSetup(netpeer_t *np, unsigned short *playernum) {
     playeringame[i] = false;
   }
 
+  G_UpdatePlayersInGame();
+
   read_ranged_int(pbuf, m_deathmatch, "deathmatch", 0, 2);
+  read_bool(pbuf, m_build_reject, "build REJECT");
+  read_ulong(pbuf, m_reject_hash, "REJECT hash");
   read_uint(pbuf, m_playernum, "consoleplayer");
 
-  read_bitmap(pbuf, bitmap, MAXPLAYERS, "playeringame bitmap");
+  if (!N_UnpackPlayerSet(pbuf, bitmap)) {
+    return false;
+  }
 
   for (size_t i = 0; i < MAXPLAYERS; i++) {
     if (bitmap_get_bit(bitmap, i)) {
@@ -507,6 +1052,8 @@ bool N_UnpackSetup(netpeer_t *np, unsigned short *playernum) {
     }
   }
 
+  G_UpdatePlayersInGame();
+
   M_BufferInit(&iwad_buf);
   read_string(pbuf, &iwad_buf, "IWAD", MAX_IWAD_NAME_LENGTH);
   iwad_name = M_StripExtension(M_BufferGetData(&iwad_buf));
@@ -592,6 +1139,9 @@ bool N_UnpackSetup(netpeer_t *np, unsigned short *playernum) {
   deathmatch = m_deathmatch;
   *playernum = m_playernum;
 
+  P_SetRejectBuildEnabled(m_build_reject);
+  P_ExpectRejectHash(m_reject_hash);
+
   G_SetLatestState(gs);
 
   N_PeerUpdateSyncTIC(np, gs->tic);
@@ -600,11 +1150,12 @@ bool N_UnpackSetup(netpeer_t *np, unsigned short *playernum) {
 }
 
 void N_PackFullState(netpeer_t *np) {
-  game_state_t *gs = G_GetLatestState();
+  game_state_t *gs = SV_AOIFiltersPeer(np) ? SV_AOIGetFullState(np) :
+                                             G_GetLatestState();
   pbuf_t *pbuf = N_PeerBeginMessage(np, NM_FULL_STATE);
 
   M_PBufWriteInt(pbuf, gs->tic);
-  M_PBufWriteBytes(pbuf, M_PBufGetData(gs->data), M_PBufGetSize(gs->data));
+  G_WriteStateToPackedBuffer(gs, pbuf);
 
   N_PeerUpdateSyncTIC(np, gs->tic);
 }
@@ -787,14 +1338,14 @@ void N_PackSync(netpeer_t *np) {
   def_bitmap_zero(bitmap, MAXPLAYERS);
 
   if (CLIENT) {
-    for (int i = 0; i < MAXPLAYERS; i++) {
-      if (playeringame[i] && (i > 0) && (i != consoleplayer)) {
+    PLAYERS_FOR_EACH(i) {
+      if ((i > 0) && (i != consoleplayer)) {
         bitmap_set_bit(bitmap, i);
       }
     }
 
     M_PBufWriteNum(pbuf, N_PeerGetSyncTIC(np));
-    M_PBufWriteBitmap(pbuf, (char *)bitmap, sizeof(bitmap));
+    N_PackPlayerSet(pbuf, bitmap);
 
     pack_unsynchronized_commands(pbuf, np, consoleplayer);
 
@@ -815,14 +1366,22 @@ void N_PackSync(netpeer_t *np) {
     NETPEER_FOR_EACH(iter) {
       unsigned int playernum  = N_PeerGetPlayernum(iter.np);
 
+      if (N_PeerIsRelay(iter.np)) {
+        continue;
+      }
+
       bitmap_set_bit(bitmap, playernum);
     }
 
-    M_PBufWriteBitmap(pbuf, (char *)bitmap, sizeof(bitmap));
+    N_PackPlayerSet(pbuf, bitmap);
 
     NETPEER_FOR_EACH(iter) {
       unsigned int playernum  = N_PeerGetPlayernum(iter.np);
 
+      if (N_PeerIsRelay(iter.np)) {
+        continue;
+      }
+
       if (playernum == dest_playernum) {
         pack_run_commands(pbuf, dest_playernum);
       }
@@ -839,6 +1398,14 @@ void N_PackSync(netpeer_t *np) {
     );
     M_PBufWriteInt(pbuf, delta->from_tic);
     M_PBufWriteInt(pbuf, delta->to_tic);
+    M_PBufWriteBool(pbuf, delta->hash.valid);
+
+    if (delta->hash.valid) {
+      for (int i = 0; i < STATE_SECTION_MAX; i++) {
+        M_PBufWriteULong(pbuf, delta->hash.sections[i]);
+      }
+    }
+
     M_PBufWriteBytes(pbuf, delta->data.data, delta->data.size);
   }
 }
@@ -851,9 +1418,13 @@ bool N_UnpackSync(netpeer_t *np) {
   if (CLIENT) {
     int m_delta_from_tic;
     int m_delta_to_tic;
+    state_hash_t m_hash;
 
     read_uint(pbuf, m_command_index, "command index");
-    read_bitmap(pbuf, bitmap, MAXPLAYERS, "sync player bitmap");
+
+    if (!N_UnpackPlayerSet(pbuf, bitmap)) {
+      return false;
+    }
 
     for (size_t i = 0; i < MAXPLAYERS; i++) {
       uint32_t m_command_count;
@@ -863,32 +1434,46 @@ bool N_UnpackSync(netpeer_t *np) {
       }
 
       if (i == consoleplayer) {
+        uint32_t m_run_command_index = 0;
+        uint32_t m_server_tic = 0;
+
         read_uint(pbuf, m_command_count, "consoleplayer sync command count");
 
         for (uint32_t j = 0; j < m_command_count; j++) {
-          uint32_t m_run_command_index;
-          uint32_t m_server_tic;
+          if (j == 0) {
+            read_uint(pbuf, m_run_command_index, "run command index");
+            read_uint(pbuf, m_server_tic, "server TIC");
+          }
+          else {
+            uint64_t m_index_delta;
+            uint64_t m_server_tic_delta;
+
+            read_ulong(pbuf, m_index_delta, "run command index delta");
+            read_ulong(pbuf, m_server_tic_delta, "server TIC delta");
 
-          read_uint(pbuf, m_run_command_index, "run command index");
-          read_uint(pbuf, m_server_tic, "server TIC");
+            m_run_command_index += zigzag_decode(m_index_delta) + 1;
+            m_server_tic += zigzag_decode(m_server_tic_delta) + 1;
+          }
 
           P_UpdateCommandServerTic(i, m_run_command_index, m_server_tic);
         }
       }
       else {
+        netticcmd_t m_ncmd;
+
         read_uint(pbuf, m_command_count, "command count");
 
         for (unsigned int j = 0; j < m_command_count; j++) {
-          netticcmd_t m_ncmd;
-
-          unpack_net_command(pbuf, m_ncmd);
+          if (!N_UnpackCommand(pbuf, j > 0 ? &m_ncmd : NULL, &m_ncmd)) {
+            return false;
+          }
 
           P_QueuePlayerCommand(i, &m_ncmd);
         }
 
         m_command_index = 0;
 
-        for (unsigned int ci = 0; ci < P_GetCommandCount(i); ci++) {
+        for (unsigned int ci = 0; ci < P_GetCommandSpan(i); ci++) {
           netticcmd_t *m_ncmd = P_GetCommand(i, ci);
 
           if (!m_ncmd) {
@@ -918,17 +1503,30 @@ bool N_UnpackSync(netpeer_t *np) {
 
     read_int(pbuf, m_delta_from_tic, "delta from tic");
     read_int(pbuf, m_delta_to_tic,   "delta to tic");
+    read_bool(pbuf, m_hash.valid,    "state hash");
+
+    if (m_hash.valid) {
+      for (int i = 0; i < STATE_SECTION_MAX; i++) {
+        read_ulong(pbuf, m_hash.sections[i], "state section hash");
+      }
+    }
 
     /* [CG] pbuf now points to the delta's binary data */
-    N_PeerUpdateSyncStateDelta(np, m_delta_from_tic, m_delta_to_tic, pbuf);
+    N_PeerUpdateSyncStateDelta(
+      np, m_delta_from_tic, m_delta_to_tic, &m_hash, pbuf
+    );
   }
   else if (SERVER) {
     int m_sync_tic;
     unsigned int m_command_count;
     unsigned int playernum = N_PeerGetPlayernum(np);
+    netticcmd_t m_previous;
 
     read_int(pbuf, m_sync_tic, "sync tic");
-    read_bitmap(pbuf, bitmap, MAXPLAYERS, "sync player bitmap");
+
+    if (!N_UnpackPlayerSet(pbuf, bitmap)) {
+      return false;
+    }
 
     read_uint(pbuf, m_command_count, "command count");
 
@@ -937,8 +1535,11 @@ bool N_UnpackSync(netpeer_t *np) {
     for (unsigned int i = 0; i < m_command_count; i++) {
       netticcmd_t m_ncmd;
 
-      unpack_net_command(pbuf, m_ncmd);
+      if (!N_UnpackCommand(pbuf, i > 0 ? &m_previous : NULL, &m_ncmd)) {
+        return false;
+      }
 
+      m_previous = m_ncmd;
       m_ncmd.server_tic = 0;
 
       P_QueuePlayerCommand(playernum, &m_ncmd);
@@ -968,6 +1569,133 @@ bool N_UnpackSync(netpeer_t *np) {
   return true;
 }
 
+/*
+ * Downstream peers, and relays on a server, get the sync a server would send,
+ * with their commands all reported as run at the delta's TIC so they're
+ * trimmed.
+ */
+void N_PackRelaySync(netpeer_t *np) {
+  pbuf_t *pbuf = N_PeerBeginMessage(np, NM_SYNC);
+  unsigned int dest_playernum = N_PeerGetPlayernum(np);
+  unsigned int first_index = N_PeerGetSyncCommandIndex(np);
+  unsigned int latest_index = N_PeerGetSyncCommandIndexForPlayer(
+    np, dest_playernum
+  );
+  game_state_delta_t *delta = N_PeerGetSyncStateDelta(np);
+  def_bitmap_zero(bitmap, MAXPLAYERS);
+
+  /* Servers never send a command index here either, see N_UnpackSync */
+  M_PBufWriteUNum(pbuf, 0);
+
+  bitmap_set_bit(bitmap, dest_playernum);
+
+  PLAYERS_FOR_EACH(i) {
+    if (i > 0) {
+      bitmap_set_bit(bitmap, i);
+    }
+  }
+
+  N_PackPlayerSet(pbuf, bitmap);
+
+  for (size_t i = 0; i < MAXPLAYERS; i++) {
+    if (!bitmap_get_bit(bitmap, i)) {
+      continue;
+    }
+
+    if (i != dest_playernum) {
+      pack_unsynchronized_commands(pbuf, np, i);
+      continue;
+    }
+
+    if (first_index == 0 || latest_index < first_index) {
+      M_PBufWriteUNum(pbuf, 0);
+      continue;
+    }
+
+    M_PBufWriteUNum(pbuf, (latest_index - first_index) + 1);
+    M_PBufWriteUNum(pbuf, first_index);
+    M_PBufWriteUNum(pbuf, delta->from_tic);
+
+    for (unsigned int j = first_index; j < latest_index; j++) {
+      M_PBufWriteUNum(pbuf, zigzag_encode(0));
+      M_PBufWriteUNum(pbuf, zigzag_encode(-1));
+    }
+  }
+
+  D_Msg(MSG_SYNC, "(%d) Relaying %d => %d\n",
+    gametic, delta->from_tic, delta->to_tic
+  );
+  M_PBufWriteInt(pbuf, delta->from_tic);
+  M_PBufWriteInt(pbuf, delta->to_tic);
+  M_PBufWriteBool(pbuf, delta->hash.valid);
+
+  if (delta->hash.valid) {
+    for (int i = 0; i < STATE_SECTION_MAX; i++) {
+      M_PBufWriteULong(pbuf, delta->hash.sections[i]);
+    }
+  }
+
+  M_PBufWriteBytes(pbuf, delta->data.data, delta->data.size);
+}
+
+/* Downstream peers' and relays' commands are never run, only confirmed */
+bool N_UnpackRelaySync(netpeer_t *np) {
+  pbuf_t *pbuf = N_PeerGetIncomingMessageData(np);
+  unsigned int playernum = N_PeerGetPlayernum(np);
+  int m_sync_tic;
+  unsigned int m_command_count;
+  unsigned int m_command_index;
+  netticcmd_t m_previous;
+  def_bitmap_zero(bitmap, MAXPLAYERS);
+
+  read_int(pbuf, m_sync_tic, "sync tic");
+
+  if (!N_UnpackPlayerSet(pbuf, bitmap)) {
+    return false;
+  }
+
+  read_uint(pbuf, m_command_count, "command count");
+
+  N_PeerUpdateSyncTIC(np, m_sync_tic);
+
+  for (unsigned int i = 0; i < m_command_count; i++) {
+    netticcmd_t m_ncmd;
+
+    if (!N_UnpackCommand(pbuf, i > 0 ? &m_previous : NULL, &m_ncmd)) {
+      return false;
+    }
+
+    if (i == 0) {
+      N_PeerSetSyncCommandIndex(np, m_ncmd.index);
+    }
+
+    m_previous = m_ncmd;
+  }
+
+  if (m_command_count > 0) {
+    N_PeerSetSyncCommandIndexForPlayer(np, playernum, m_previous.index);
+  }
+  else {
+    N_PeerSetSyncCommandIndex(np, 0);
+  }
+
+  for (size_t i = 0; i < MAXPLAYERS; i++) {
+    if (i == playernum) {
+      continue;
+    }
+
+    if (!bitmap_get_bit(bitmap, i)) {
+      continue;
+    }
+
+    read_uint(pbuf, m_command_index, "command index");
+
+    N_PeerUpdateSyncCommandIndexForPlayer(np, i, m_command_index);
+  }
+
+  return true;
+}
+
 bool N_UnpackPlayerPreferenceChange(netpeer_t *np, int *tic,
                                                    unsigned short *playernum,
                                                    unsigned int *count) {
@@ -1248,6 +1976,15 @@ void N_PackGameActionChange(netpeer_t *np) {
   M_PBufWriteInt(pbuf, gametic);
 }
 
+void N_PackRelayedGameActionChange(netpeer_t *np,
+                                   gameaction_t new_gameaction,
+                                   int new_gametic) {
+  pbuf_t *pbuf = N_PeerBeginMessage(np, NM_GAME_ACTION);
+
+  M_PBufWriteInt(pbuf, new_gameaction);
+  M_PBufWriteInt(pbuf, new_gametic);
+}
+
 bool N_UnpackGameActionChange(netpeer_t *np, gameaction_t *new_gameaction,
                                              int *new_gametic) {
   pbuf_t *pbuf = N_PeerGetIncomingMessageData(np);
@@ -23,8 +23,6 @@
 
 #include "z_zone.h"
 
-#include <enet/enet.h>
-
 #include "doomdef.h"
 #include "doomstat.h"
 #include "d_event.h"
@@ -32,28 +30,53 @@
 #include "g_state.h"
 #include "n_main.h"
 #include "p_user.h"
+#include "p_setup.h"
+#include "p_mobj.h"
 #include "n_chan.h"
 #include "n_com.h"
 #include "n_sync.h"
-
-#define NET_THROTTLE_INTERVAL 300
-#define NET_THROTTLE_ACCEL 2
-#define NET_THROTTLE_DECEL 1
+#include "n_transport.h"
 
 #define MAX_SETUP_REQUEST_INTERVAL 2.0
 
 struct netpeer_s {
   unsigned int peernum;
   unsigned int playernum;
+  uint32_t     transport_peer_id;
   netcom_t     com;
   netsync_t    sync;
   time_t       connect_start_time;
   time_t       disconnect_start_time;
   time_t       last_setup_request_time;
   auth_level_e auth_level;
+  bool         relay;
 };
 
-static GHashTable *net_peers = NULL;
+/*
+ * Peers are looked up by transport peer for every network event and by player
+ * all over the place, so keep an index for each.  Only a server's player
+ * peers go in the player index; relays and a relay's downstream peers all
+ * share player 0.
+ */
+static GHashTable  *net_peers = NULL;
+static GHashTable  *net_peers_by_transport_id = NULL;
+static netpeer_t  **net_peers_by_player = NULL;
+
+static bool peer_has_player(netpeer_t *np) {
+  return SERVER && (!np->relay) && np->playernum < MAXPLAYERS;
+}
+
+static void index_peer_player(netpeer_t *np) {
+  if (peer_has_player(np)) {
+    net_peers_by_player[np->playernum] = np;
+  }
+}
+
+static void unindex_peer_player(netpeer_t *np) {
+  if (peer_has_player(np) && net_peers_by_player[np->playernum] == np) {
+    net_peers_by_player[np->playernum] = NULL;
+  }
+}
 
 static void free_peer(netpeer_t *np) {
   P_Printf(consoleplayer, "Removing peer for %u (%s:%u)\n",
@@ -62,7 +85,18 @@ static void free_peer(netpeer_t *np) {
     N_PeerGetPort(np)
   );
 
-  players[np->playernum].playerstate = PST_DISCONNECTED;
+  if ((!np->relay) && (!N_RelayIsDownstream(np))) {
+    players[np->playernum].playerstate = PST_DISCONNECTED;
+  }
+
+  if (g_hash_table_lookup(net_peers_by_transport_id,
+                          GUINT_TO_POINTER(np->transport_peer_id)) == np) {
+    g_hash_table_remove(
+      net_peers_by_transport_id, GUINT_TO_POINTER(np->transport_peer_id)
+    );
+  }
+
+  unindex_peer_player(np);
   N_ComFree(&np->com);
   N_SyncFree(&np->sync);
   free(np);
@@ -77,7 +111,9 @@ unsigned int N_PeerGetPlayernum(netpeer_t *np) {
 }
 
 void N_PeerSetPlayernum(netpeer_t *np, unsigned int playernum) {
+  unindex_peer_player(np);
   np->playernum = playernum;
+  index_peer_player(np);
 }
 
 double N_PeerGetConnecionWaitTime(netpeer_t *np) {
@@ -104,6 +140,35 @@ void N_PeerSetAuthLevel(netpeer_t *np, auth_level_e auth_level) {
   np->auth_level = auth_level;
 }
 
+bool N_PeerIsRelay(netpeer_t *np) {
+  return np->relay;
+}
+
+/*
+ * On a server, a relay gives back the player slot it was given on connect and
+ * takes the server's invisible player 0, like its own downstream peers.
+ */
+void N_PeerSetRelay(netpeer_t *np, bool relay) {
+  unsigned int playernum = np->playernum;
+
+  if ((!SERVER) || (!relay) || np->relay) {
+    np->relay = relay;
+    return;
+  }
+
+  unindex_peer_player(np);
+  np->relay = true;
+  np->playernum = 0;
+
+  if (players[playernum].mo) {
+    P_RemoveMobj(players[playernum].mo);
+    players[playernum].mo = NULL;
+  }
+
+  G_SetPlayerInGame(playernum, false);
+  players[playernum].playerstate = PST_LIVE;
+}
+
 bool N_PeerCheckTimeout(netpeer_t *np) {
   time_t now = time(NULL);
 
@@ -137,25 +202,21 @@ bool N_PeerCanRequestSetup(netpeer_t *np) {
 }
 
 uint32_t N_PeerGetIPAddress(netpeer_t *np) {
-  ENetPeer *enet_peer = N_ComGetENetPeer(&np->com);
-
-  return ENET_NET_TO_HOST_32(enet_peer->address.host);
+  return N_GetTransport()->get_address(N_ComGetTransportPeer(&np->com));
 }
 
 const char* N_PeerGetIPAddressConstString(netpeer_t *np) {
-  ENetPeer *enet_peer = N_ComGetENetPeer(&np->com);
-
-  return N_IPToConstString(ENET_NET_TO_HOST_32(enet_peer->address.host));
+  return N_IPToConstString(N_PeerGetIPAddress(np));
 }
 
 unsigned short N_PeerGetPort(netpeer_t * np) {
-  ENetPeer *enet_peer = N_ComGetENetPeer(&np->com);
-
-  return enet_peer->address.port;
+  return N_GetTransport()->get_port(N_ComGetTransportPeer(&np->com));
 }
 
 void N_InitPeers(void) {
   net_peers = g_hash_table_new_full(NULL, NULL, NULL, peer_destroy_func);
+  net_peers_by_transport_id = g_hash_table_new(NULL, NULL);
+  net_peers_by_player = calloc(MAXPLAYERS, sizeof(netpeer_t *));
 }
 
 unsigned int N_PeerGetCount(void) {
@@ -166,7 +227,7 @@ unsigned int N_PeerGetCount(void) {
   return g_hash_table_size(net_peers);
 }
 
-netpeer_t* N_PeerAdd(void *enet_peer) {
+netpeer_t* N_PeerAdd(void *transport_peer) {
   netpeer_t *np = NULL;
   unsigned int playernum = 0;
 
@@ -188,7 +249,7 @@ netpeer_t* N_PeerAdd(void *enet_peer) {
 
   np = calloc(1, sizeof(netpeer_t));
 
-  N_ComInit(&np->com, enet_peer);
+  N_ComInit(&np->com, transport_peer);
   N_SyncInit(&np->sync);
 
   np->peernum = 1;
@@ -197,35 +258,22 @@ netpeer_t* N_PeerAdd(void *enet_peer) {
   }
 
   np->playernum               = playernum;
+  np->transport_peer_id       = N_GetTransport()->get_peer_id(transport_peer);
   np->auth_level              = AUTH_LEVEL_NONE;
+  np->relay                   = false;
   np->connect_start_time      = time(NULL);
   np->disconnect_start_time   = 0;
   np->last_setup_request_time = 0;
 
-  if (SERVER) {
-    enet_peer_throttle_configure(
-      enet_peer,
-      NET_THROTTLE_INTERVAL,
-      NET_THROTTLE_ACCEL,
-      NET_THROTTLE_DECEL
-    );
-  }
-  /*
-  else {
-    enet_peer_throttle_configure(
-      enet_peer,
-      ENET_PEER_PACKET_THROTTLE_INTERVAL,
-      ENET_PEER_PACKET_THROTTLE_SCALE,
-      ENET_PEER_PACKET_THROTTLE_SCALE
-    );
-  }
-  */
-
   g_hash_table_insert(net_peers, GUINT_TO_POINTER(np->peernum), np);
+  g_hash_table_insert(
+    net_peers_by_transport_id, GUINT_TO_POINTER(np->transport_peer_id), np
+  );
+  index_peer_player(np);
 
   if (SERVER) {
     N_SyncSetTIC(&np->sync, gametic);
-    playeringame[playernum] = true;
+    G_SetPlayerInGame(playernum, true);
     players[playernum].playerstate = PST_REBORN;
     players[playernum].connect_tic = gametic;
   }
@@ -241,29 +289,36 @@ netpeer_t* N_PeerGet(int peernum) {
   return g_hash_table_lookup(net_peers, GUINT_TO_POINTER(peernum));
 }
 
-netpeer_t* N_PeerForPeer(void *enet_peer) {
-  GHashTableIter it;
-  gpointer key, value;
-  ENetPeer *epeer = (ENetPeer *)enet_peer;
+netpeer_t* N_PeerForPeer(void *transport_peer) {
+  uint32_t peer_id;
 
-  g_hash_table_iter_init(&it, net_peers);
-
-  while (g_hash_table_iter_next(&it, &key, &value)) {
-    netpeer_t *np = (netpeer_t *)value;
-    ENetPeer *np_epeer = N_ComGetENetPeer(&np->com);
-
-    if (np_epeer->connectID == epeer->connectID) {
-      return np;
-    }
+  if (!net_peers_by_transport_id) {
+    return NULL;
   }
 
-  return NULL;
+  peer_id = N_GetTransport()->get_peer_id(transport_peer);
+
+  return g_hash_table_lookup(
+    net_peers_by_transport_id, GUINT_TO_POINTER(peer_id)
+  );
 }
 
 netpeer_t* N_PeerForPlayer(unsigned int playernum) {
   GHashTableIter it;
   gpointer key, value;
 
+  if (!net_peers) {
+    return NULL;
+  }
+
+  if (SERVER) {
+    if (playernum >= MAXPLAYERS) {
+      return NULL;
+    }
+
+    return net_peers_by_player[playernum];
+  }
+
   g_hash_table_iter_init(&it, net_peers);
 
   while (g_hash_table_iter_next(&it, &key, &value)) {
@@ -296,9 +351,7 @@ void N_PeerSetConnected(netpeer_t *np) {
 }
 
 void N_PeerDisconnect(netpeer_t *np, disconnection_reason_e reason) {
-  ENetPeer *epeer = N_ComGetENetPeer(&np->com);
-
-  enet_peer_disconnect(epeer, reason);
+  N_GetTransport()->disconnect(N_ComGetTransportPeer(&np->com), reason);
   np->disconnect_start_time = time(NULL);
 }
 
@@ -342,6 +395,14 @@ bool N_PeerSetIncoming(netpeer_t *np, unsigned char *data, size_t size) {
   return N_ComSetIncoming(&np->com, data, size);
 }
 
+bool N_PeerReceive(netpeer_t *np, unsigned char *data, size_t size) {
+  return N_ComReceive(&np->com, data, size);
+}
+
+bool N_PeerGetNextPacket(netpeer_t *np, unsigned char **data, size_t *size) {
+  return N_ComGetNextPacket(&np->com, data, size);
+}
+
 bool N_PeerLoadNextMessage(netpeer_t *np, net_message_e *message_type) {
   return N_ComLoadNextMessage(&np->com, message_type);
 }
@@ -354,6 +415,10 @@ void N_PeerClearChannel(netpeer_t *np, net_channel_e channel) {
   N_ComClearChannel(&np->com, channel);
 }
 
+size_t N_PeerGetChannelMessageSize(netpeer_t *np, net_channel_e channel) {
+  return N_ComGetChannelMessageSize(&np->com, channel);
+}
+
 void N_PeerSendReset(netpeer_t *np) {
   N_ComSendReset(&np->com);
 }
@@ -452,8 +517,13 @@ game_state_delta_t* N_PeerGetSyncStateDelta(netpeer_t *np) {
 
 void N_PeerUpdateSyncStateDelta(netpeer_t *np, int from_tic,
                                                int to_tic,
+                                               state_hash_t *hash,
                                                pbuf_t *delta_data) {
-  N_SyncUpdateStateDelta(&np->sync, from_tic, to_tic, delta_data);
+  N_SyncUpdateStateDelta(&np->sync, from_tic, to_tic, hash, delta_data);
+}
+
+void N_PeerPrepareSyncStateDelta(netpeer_t *np) {
+  N_SyncPrepareStateDelta(&np->sync);
 }
 
 void N_PeerBuildNewSyncStateDelta(netpeer_t *np) {
@@ -490,8 +560,20 @@ void N_PeerResetSync(netpeer_t *np) {
   N_SyncReset(&np->sync);
 }
 
-void* N_PeerGetENetPeer(netpeer_t *np) {
-  return N_ComGetENetPeer(&np->com);
+struct aoi_views_s* N_PeerGetAOIViews(netpeer_t *np) {
+  return N_SyncGetAOIViews(&np->sync);
+}
+
+void N_PeerSetAOIViews(netpeer_t *np, struct aoi_views_s *aoi_views) {
+  N_SyncSetAOIViews(&np->sync, aoi_views);
+}
+
+void* N_PeerGetTransportPeer(netpeer_t *np) {
+  return N_ComGetTransportPeer(&np->com);
+}
+
+void N_PeerGetStats(netpeer_t *np, net_peer_stats_t *stats) {
+  N_ComGetStats(&np->com, stats);
 }
 
 /* vi: set et ts=2 sw=2: */
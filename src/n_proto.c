@@ -41,6 +41,7 @@
 #include "cl_net.h"
 #include "s_sound.h"
 #include "sounds.h"
+#include "sv_aoi.h"
 #include "sv_main.h"
 #include "w_wad.h"
 
@@ -138,11 +139,7 @@ static void display_chat_message(chat_channel_e chat_channel,
     break;
   }
 
-  for (size_t i = 0; i < MAXPLAYERS; i++) {
-    if (!playeringame[i]) {
-      continue;
-    }
-
+  PLAYERS_FOR_EACH(i) {
     P_MSPrintf(i, sfx, "%s%s%s%s: %s\n",
       sender_opener,
       sender_name,
@@ -193,10 +190,28 @@ static void handle_setup(netpeer_t *np) {
 }
 
 static void handle_setup_request(netpeer_t *np) {
+  bool relay;
+
+  if (!N_UnpackSetupRequest(np, &relay)) {
+    return;
+  }
+
   if (!N_PeerCanRequestSetup(np)) {
     return;
   }
 
+  /* Relays get the whole state, so only trust them if allowed */
+  if (relay && !sv_allow_relays) {
+    D_Msg(MSG_WARN, "Relay from %s:%u refused (allow_relays is off)\n",
+      N_PeerGetIPAddressConstString(np), N_PeerGetPort(np)
+    );
+    relay = false;
+  }
+
+  if (relay) {
+    N_PeerSetRelay(np, true);
+  }
+
   N_PeerSyncSetNeedsGameInfo(np);
   N_PeerSyncSetNeedsGameState(np);
 }
@@ -300,7 +315,10 @@ static void handle_chat_message(netpeer_t *np) {
 }
 
 static void handle_sync(netpeer_t *np) {
-  if (SERVER || CL_ReceivedSetup()) {
+  if (SERVER && N_PeerIsRelay(np)) {
+    N_UnpackRelaySync(np);
+  }
+  else if (SERVER || CL_ReceivedSetup()) {
     N_UnpackSync(np);
   }
 }
@@ -480,6 +498,8 @@ static void handle_game_action_change(netpeer_t *np) {
     default:
     break;
   }
+
+  N_RelayGameActionChange(new_gameaction, new_gametic);
 }
 
 static void handle_rcon(netpeer_t *np) {
@@ -512,6 +532,22 @@ void N_HandlePacket(netpeer_t *np, void *data, size_t data_size) {
   }
 
   while (N_PeerLoadNextMessage(np, &message_type)) {
+    if (N_RelayIsDownstream(np)) {
+      N_RelayHandleMessage(np, message_type);
+      continue;
+    }
+
+    /* Relays have no player of their own to chat, vote or set prefs for */
+    if (SERVER && N_PeerIsRelay(np) &&
+        (message_type == NM_CHAT_MESSAGE ||
+         message_type == NM_PLAYER_PREFERENCE_CHANGE ||
+         message_type == NM_VOTE_REQUEST)) {
+      D_Msg(MSG_NET, "Ignoring [%s] message from relay.\n",
+        network_message_info[message_type].name
+      );
+      continue;
+    }
+
     if (message_type > NM_NONE &&
         message_type != NM_SYNC &&
         message_type < NM_MAX) {
@@ -578,7 +614,33 @@ void N_HandlePacket(netpeer_t *np, void *data, size_t data_size) {
   }
 }
 
+static void build_sync(netpeer_t *np) {
+  /* Area of interest deltas are built on the main thread beforehand */
+  if (!SV_AOIFiltersPeer(np)) {
+    N_PeerBuildNewSyncStateDelta(np);
+  }
+
+  if (N_PeerIsRelay(np)) {
+    N_PackRelaySync(np);
+  }
+  else {
+    N_PackSync(np);
+  }
+}
+
+static gint compare_sync_tics(gconstpointer a, gconstpointer b) {
+  netpeer_t *np_a = *(netpeer_t **)a;
+  netpeer_t *np_b = *(netpeer_t **)b;
+
+  return N_PeerGetSyncTIC(np_a) - N_PeerGetSyncTIC(np_b);
+}
+
+/* Each peer's sync only writes to its own channel, so it's fanned out */
 void N_UpdateSync(void) {
+  static GPtrArray *sync_peers = NULL;
+  gint64 delta_start_time;
+  gint64 pack_start_time;
+
   if (CLIENT) {
     netpeer_t *server = CL_GetServerPeer();
 
@@ -597,7 +659,28 @@ void N_UpdateSync(void) {
     return;
   }
 
+  if (!sync_peers) {
+    sync_peers = g_ptr_array_new();
+  }
+
+  g_ptr_array_set_size(sync_peers, 0);
+
   NETPEER_FOR_EACH(iter) {
+    int sync_tic = N_PeerGetSyncTIC(iter.np);
+
+    /* The state this peer last synced to was evicted */
+    if (N_PeerSyncOutdated(iter.np) &&
+        (sync_tic != 0) &&
+        (sync_tic < G_GetLatestState()->tic) &&
+        (!N_PeerSyncNeedsGameState(iter.np)) &&
+        (SV_AOIFiltersPeer(iter.np) ? !SV_AOIHaveView(iter.np, sync_tic) :
+                                      !G_HaveState(sync_tic))) {
+      D_Msg(MSG_WARN, "(%d) State %d for %d was evicted, sending full state\n",
+        gametic, sync_tic, N_PeerGetPlayernum(iter.np)
+      );
+      N_PeerSyncSetNeedsGameState(iter.np);
+    }
+
     if (N_PeerSyncNeedsGameInfo(iter.np) &&
         N_PeerSyncNeedsGameState(iter.np)) {
       N_PackSetup(iter.np);
@@ -613,13 +696,45 @@ void N_UpdateSync(void) {
       N_PeerSyncSetHasGameState(iter.np);
       N_PeerUpdateLastSetupRequestTime(iter.np);
     }
-    else if (N_PeerSyncOutdated(iter.np) && N_PeerGetSyncTIC(iter.np) != 0) {
+    else if (N_PeerSyncOutdated(iter.np) && sync_tic != 0) {
       N_PeerClearChannel(iter.np, network_message_info[NM_SYNC].channel);
-      N_PeerBuildNewSyncStateDelta(iter.np);
-      N_PackSync(iter.np);
-      N_PeerSyncSetNotOutdated(iter.np);
+      g_ptr_array_add(sync_peers, iter.np);
     }
   }
+
+  /* Oldest first, so each retained state rebuilds from the one before */
+  g_ptr_array_sort(sync_peers, compare_sync_tics);
+
+  delta_start_time = g_get_monotonic_time();
+
+  for (unsigned int i = 0; i < sync_peers->len; i++) {
+    netpeer_t *np = g_ptr_array_index(sync_peers, i);
+
+    if (!SV_AOIFiltersPeer(np)) {
+      N_PeerPrepareSyncStateDelta(np);
+    }
+    else if (!SV_AOIBuildStateDelta(np)) {
+      N_PackFullState(np);
+      N_PeerSyncSetHasGameState(np);
+      N_PeerUpdateLastSetupRequestTime(np);
+      g_ptr_array_remove_index(sync_peers, i);
+      i--;
+    }
+  }
+
+  pack_start_time = g_get_monotonic_time();
+
+  N_WorkRun(sync_peers, build_sync);
+
+  N_BenchRecordSync(
+    pack_start_time - delta_start_time,
+    g_get_monotonic_time() - pack_start_time,
+    sync_peers
+  );
+
+  for (unsigned int i = 0; i < sync_peers->len; i++) {
+    N_PeerSyncSetNotOutdated(g_ptr_array_index(sync_peers, i));
+  }
 }
 
 void SV_SendAuthResponse(unsigned short playernum, auth_level_e auth_level) {
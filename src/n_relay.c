@@ -0,0 +1,232 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "d_main.h"
+#include "g_game.h"
+#include "g_state.h"
+#include "i_system.h"
+#include "n_main.h"
+#include "cl_net.h"
+
+/*
+ * A relay connects to a server like any other client and serves what it
+ * receives to its own (downstream) peers as if it were the server, so the
+ * server only syncs the relay.  Downstream peers all get player 0.
+ *
+ * Run one with -connect <server> -relay [address]; the server needs
+ * allow_relays on.  Upstream, the server gives the relay player 0 as well, so
+ * it never spawns a player of its own.
+ */
+
+static bool relay_enabled = false;
+
+static void build_relay_sync(netpeer_t *np) {
+  N_PeerBuildNewSyncStateDelta(np);
+  N_PackRelaySync(np);
+}
+
+static gint compare_sync_tics(gconstpointer a, gconstpointer b) {
+  netpeer_t *np_a = *(netpeer_t **)a;
+  netpeer_t *np_b = *(netpeer_t **)b;
+
+  return N_PeerGetSyncTIC(np_a) - N_PeerGetSyncTIC(np_b);
+}
+
+void N_RelayInit(const char *address) {
+  char *host = NULL;
+  uint16_t port = DEFAULT_PORT;
+
+  if ((!address) || N_ParseAddressString(address, &host, &port) == 0) {
+    free(host);
+    host = strdup("0.0.0.0");
+  }
+
+  nodrawers   = true;
+  nosfxparm   = true;
+  nomusicparm = true;
+
+  if (!N_Listen(host, port)) {
+    I_Error("N_RelayInit: Error listening on %s:%u\n", host, port);
+  }
+
+  D_Msg(MSG_INFO, "N_RelayInit: Relaying on %s:%u.\n", host, port);
+
+  relay_enabled = true;
+
+  free(host);
+}
+
+bool N_RelayEnabled(void) {
+  return CLIENT && relay_enabled;
+}
+
+bool N_RelayIsDownstream(netpeer_t *np) {
+  return N_RelayEnabled() && np != CL_GetServerPeer();
+}
+
+/* Downstream peers may still be syncing from states before tic */
+int N_RelayGetOldestStateTIC(int tic) {
+  if (!N_RelayEnabled()) {
+    return tic;
+  }
+
+  NETPEER_FOR_EACH(iter) {
+    int sync_tic;
+
+    if (!N_RelayIsDownstream(iter.np)) {
+      continue;
+    }
+
+    if (N_PeerSyncNeedsGameState(iter.np)) {
+      continue;
+    }
+
+    sync_tic = N_PeerGetSyncTIC(iter.np);
+
+    if (sync_tic != 0 && sync_tic < tic) {
+      tic = sync_tic;
+    }
+  }
+
+  return tic;
+}
+
+void N_RelayHandleMessage(netpeer_t *np, net_message_e message_type) {
+  switch (message_type) {
+    case NM_SETUP:
+      if (N_PeerCanRequestSetup(np)) {
+        N_PeerSyncSetNeedsGameInfo(np);
+        N_PeerSyncSetNeedsGameState(np);
+      }
+    break;
+    case NM_SYNC:
+      N_UnpackRelaySync(np);
+    break;
+    case NM_AUTH:
+      N_PackAuthResponse(np, AUTH_LEVEL_SPECTATOR);
+    break;
+    case NM_PING:
+    break;
+    default:
+      if (message_type > NM_NONE && message_type < NM_MAX) {
+        D_Msg(MSG_NET, "N_RelayHandleMessage: Ignoring [%s] message.\n",
+          network_message_info[message_type].name
+        );
+      }
+    break;
+  }
+}
+
+/* The game action resets the game, so downstream peers need a full state */
+void N_RelayGameActionChange(gameaction_t new_gameaction, int new_gametic) {
+  if (!N_RelayEnabled()) {
+    return;
+  }
+
+  NETPEER_FOR_EACH(iter) {
+    if (!N_RelayIsDownstream(iter.np)) {
+      continue;
+    }
+
+    N_PeerResetSync(iter.np);
+    N_PeerSyncSetHasGameInfo(iter.np);
+    N_PackRelayedGameActionChange(iter.np, new_gameaction, new_gametic);
+  }
+}
+
+/* Runs whenever a new state from the server has been loaded */
+void N_RelayUpdateSync(void) {
+  static GPtrArray *sync_peers = NULL;
+  int latest_tic;
+
+  if (!N_RelayEnabled()) {
+    return;
+  }
+
+  if (!CL_ReceivedSetup()) {
+    return;
+  }
+
+  if (!sync_peers) {
+    sync_peers = g_ptr_array_new();
+  }
+
+  g_ptr_array_set_size(sync_peers, 0);
+
+  latest_tic = G_GetLatestState()->tic;
+
+  NETPEER_FOR_EACH(iter) {
+    int sync_tic;
+
+    if (!N_RelayIsDownstream(iter.np)) {
+      continue;
+    }
+
+    sync_tic = N_PeerGetSyncTIC(iter.np);
+
+    if ((sync_tic != 0) &&
+        (sync_tic < latest_tic) &&
+        (!N_PeerSyncNeedsGameState(iter.np)) &&
+        (!G_HaveState(sync_tic))) {
+      D_Msg(MSG_WARN, "(%d) State %d for %s:%u was evicted, sending full "
+                      "state\n",
+        gametic,
+        sync_tic,
+        N_PeerGetIPAddressConstString(iter.np),
+        N_PeerGetPort(iter.np)
+      );
+      N_PeerSyncSetNeedsGameState(iter.np);
+    }
+
+    if (N_PeerSyncNeedsGameInfo(iter.np) &&
+        N_PeerSyncNeedsGameState(iter.np)) {
+      N_PackSetup(iter.np);
+      N_PeerSyncSetHasGameInfo(iter.np);
+      N_PeerSyncSetHasGameState(iter.np);
+      N_PeerUpdateLastSetupRequestTime(iter.np);
+    }
+    else if (N_PeerSyncNeedsGameState(iter.np)) {
+      N_PackFullState(iter.np);
+      N_PeerSyncSetHasGameState(iter.np);
+      N_PeerUpdateLastSetupRequestTime(iter.np);
+    }
+    else if ((sync_tic != 0) && (sync_tic < latest_tic)) {
+      N_PeerClearChannel(iter.np, network_message_info[NM_SYNC].channel);
+      g_ptr_array_add(sync_peers, iter.np);
+    }
+  }
+
+  g_ptr_array_sort(sync_peers, compare_sync_tics);
+
+  for (unsigned int i = 0; i < sync_peers->len; i++) {
+    N_PeerPrepareSyncStateDelta(g_ptr_array_index(sync_peers, i));
+  }
+
+  N_WorkRun(sync_peers, build_relay_sync);
+}
+
+/* vi: set et ts=2 sw=2: */
+
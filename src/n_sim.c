@@ -0,0 +1,289 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "m_argv.h"
+#include "n_main.h"
+#include "n_transport.h"
+
+/*
+ * Simulates a poor link over whichever transport is in use:
+ *   -netlatency <ms>:  added one-way delay
+ *   -netjitter <ms>:   the delay varies by up to this much either way
+ *   -netloss <pct>:    percentage of packets dropped
+ * Reliable packets are never dropped or reordered.
+ */
+
+typedef struct sim_packet_s {
+  void          *peer;
+  net_channel_e  channel;
+  bool           reliable;
+  unsigned char *data;
+  size_t         size;
+  gint64         send_time;
+} sim_packet_t;
+
+static net_transport_t  net_transport_sim;
+static net_transport_t *sim_transport = NULL;
+static GQueue          *sim_packets = NULL;
+static GRand           *sim_rand = NULL;
+static unsigned int     sim_latency = 0;
+static unsigned int     sim_jitter = 0;
+static double           sim_loss = 0.0;
+static unsigned int     sim_dropped = 0;
+
+static void free_packet(sim_packet_t *packet) {
+  free(packet->data);
+  free(packet);
+}
+
+/* Packets due at the same time go out in the order they were sent */
+static void queue_packet(sim_packet_t *packet) {
+  GList *node = sim_packets->tail;
+
+  while (node && ((sim_packet_t *)node->data)->send_time > packet->send_time) {
+    node = node->prev;
+  }
+
+  if (node) {
+    g_queue_insert_after(sim_packets, node, packet);
+  }
+  else {
+    g_queue_push_head(sim_packets, packet);
+  }
+}
+
+static gint64 last_reliable_send_time(void *peer, net_channel_e channel) {
+  for (GList *node = sim_packets->tail; node; node = node->prev) {
+    sim_packet_t *packet = node->data;
+
+    if (packet->reliable && packet->peer == peer &&
+                            packet->channel == channel) {
+      return packet->send_time;
+    }
+  }
+
+  return 0;
+}
+
+static void send_due_packets(void) {
+  gint64 now = g_get_monotonic_time();
+
+  while (!g_queue_is_empty(sim_packets)) {
+    sim_packet_t *packet = g_queue_peek_head(sim_packets);
+
+    if (packet->send_time > now) {
+      break;
+    }
+
+    g_queue_pop_head(sim_packets);
+    sim_transport->send(
+      packet->peer, packet->channel, packet->reliable, packet->data,
+                                                       packet->size
+    );
+    free_packet(packet);
+  }
+}
+
+static void drop_peer_packets(void *peer) {
+  GList *node = sim_packets->head;
+
+  while (node) {
+    GList *next = node->next;
+    sim_packet_t *packet = node->data;
+
+    if (packet->peer == peer) {
+      g_queue_delete_link(sim_packets, node);
+      free_packet(packet);
+    }
+
+    node = next;
+  }
+}
+
+static void drop_all_packets(void) {
+  while (!g_queue_is_empty(sim_packets)) {
+    free_packet(g_queue_pop_head(sim_packets));
+  }
+}
+
+static void sim_send(void *peer, net_channel_e channel, bool reliable,
+                                                        unsigned char *data,
+                                                        size_t size) {
+  sim_packet_t *packet;
+  gint64 delay;
+  gint64 now;
+  gint64 send_time;
+
+  if ((sim_loss > 0.0) &&
+      (!(reliable && sim_transport->reliable)) &&
+      (g_rand_double(sim_rand) * 100.0 < sim_loss)) {
+    sim_dropped++;
+    return;
+  }
+
+  delay = sim_latency;
+
+  if (sim_jitter) {
+    delay += g_rand_int_range(sim_rand, -((gint32)sim_jitter),
+                                        ((gint32)sim_jitter) + 1);
+  }
+
+  now = g_get_monotonic_time();
+  send_time = now + (delay * 1000);
+
+  if (reliable) {
+    send_time = MAX(send_time, last_reliable_send_time(peer, channel));
+  }
+
+  if (send_time <= now) {
+    sim_transport->send(peer, channel, reliable, data, size);
+    return;
+  }
+
+  packet = malloc(sizeof(sim_packet_t));
+
+  if (!packet) {
+    I_Error("sim_send: Error allocating packet");
+  }
+
+  packet->data = malloc(size);
+
+  if (!packet->data) {
+    I_Error("sim_send: Error allocating packet data");
+  }
+
+  memcpy(packet->data, data, size);
+  packet->peer = peer;
+  packet->channel = channel;
+  packet->reliable = reliable;
+  packet->size = size;
+  packet->send_time = send_time;
+
+  queue_packet(packet);
+}
+
+static int sim_service(net_event_t *event, int timeout_ms) {
+  int res;
+
+  send_due_packets();
+
+  if (!g_queue_is_empty(sim_packets)) {
+    sim_packet_t *packet = g_queue_peek_head(sim_packets);
+    gint64 wait_ms = (packet->send_time - g_get_monotonic_time()) / 1000;
+
+    if (timeout_ms < 0 || wait_ms < timeout_ms) {
+      timeout_ms = MAX(wait_ms, 0);
+    }
+  }
+
+  res = sim_transport->service(event, timeout_ms);
+
+  if (res > 0 && event->type == NET_EVENT_DISCONNECT) {
+    drop_peer_packets(event->peer);
+  }
+
+  return res;
+}
+
+static void sim_disconnect(void *peer, uint32_t reason) {
+  drop_peer_packets(peer);
+  sim_transport->disconnect(peer, reason);
+}
+
+static void sim_reset(void *peer) {
+  drop_peer_packets(peer);
+  sim_transport->reset(peer);
+}
+
+static void sim_destroy(void) {
+  drop_all_packets();
+  sim_transport->destroy();
+}
+
+static void sim_shutdown(void) {
+  drop_all_packets();
+  sim_transport->shutdown();
+}
+
+net_transport_t* N_SimWrapTransport(net_transport_t *transport) {
+  int p;
+
+  if (transport == &net_transport_sim) {
+    return transport;
+  }
+
+  if ((p = M_CheckParm("-netlatency")) && p < myargc - 1) {
+    sim_latency = MAX(atoi(myargv[p + 1]), 0);
+  }
+
+  if ((p = M_CheckParm("-netjitter")) && p < myargc - 1) {
+    sim_jitter = MAX(atoi(myargv[p + 1]), 0);
+  }
+
+  if ((p = M_CheckParm("-netloss")) && p < myargc - 1) {
+    sim_loss = CLAMP(atof(myargv[p + 1]), 0.0, 100.0);
+  }
+
+  if (!sim_latency && !sim_jitter && sim_loss == 0.0) {
+    return transport;
+  }
+
+  D_Msg(MSG_INFO,
+    "N_SimWrapTransport: Simulating %ums latency, %ums jitter, %.1f%% loss\n",
+    sim_latency, sim_jitter, sim_loss
+  );
+
+  sim_transport = transport;
+  sim_packets = g_queue_new();
+  sim_rand = g_rand_new();
+
+  net_transport_sim = *transport;
+  net_transport_sim.send = sim_send;
+  net_transport_sim.service = sim_service;
+  net_transport_sim.disconnect = sim_disconnect;
+  net_transport_sim.reset = sim_reset;
+  net_transport_sim.destroy = sim_destroy;
+  net_transport_sim.shutdown = sim_shutdown;
+
+  return &net_transport_sim;
+}
+
+bool N_SimActive(void) {
+  return sim_transport != NULL;
+}
+
+void N_SimGetConditions(unsigned int *latency, unsigned int *jitter,
+                                               double *loss) {
+  *latency = sim_latency;
+  *jitter = sim_jitter;
+  *loss = sim_loss;
+}
+
+unsigned int N_SimGetDroppedPackets(void) {
+  return sim_dropped;
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -29,6 +29,7 @@
 #include "n_main.h"
 #include "n_sync.h"
 #include "p_user.h"
+#include "sv_aoi.h"
 
 #define SERVER_MAX_PEER_LAG (TICRATE * 4)
 
@@ -38,6 +39,7 @@ void N_SyncInit(netsync_t *ns) {
   ns->command_index = 0;
   memset(ns->command_indices, 0, MAXPLAYERS * sizeof(unsigned int));
   G_DeltaInit(&ns->delta);
+  ns->aoi_views = NULL;
 }
 
 void N_SyncReset(netsync_t *ns) {
@@ -46,6 +48,7 @@ void N_SyncReset(netsync_t *ns) {
   ns->command_index = 0;
   memset(ns->command_indices, 0, MAXPLAYERS * sizeof(unsigned int));
   G_DeltaClear(&ns->delta);
+  N_SyncSetAOIViews(ns, NULL);
 }
 
 void N_SyncFree(netsync_t *ns) {
@@ -54,6 +57,7 @@ void N_SyncFree(netsync_t *ns) {
   ns->command_index = 0;
   memset(ns->command_indices, 0, MAXPLAYERS * sizeof(unsigned int));
   G_DeltaFree(&ns->delta);
+  N_SyncSetAOIViews(ns, NULL);
 }
 
 bool N_SyncNeedsGameInfo(netsync_t *ns) {
@@ -140,14 +144,21 @@ void N_SyncUpdateCommandIndex(netsync_t *ns, unsigned int command_index) {
   ns->command_index = command_index;
 }
 
+/*
+ * Applied straight out of the message.  A delta that can't be applied is
+ * dropped, and the server keeps sending deltas from a state we have.
+ */
 bool N_SyncUpdateStateDelta(netsync_t *ns, int from_tic, int to_tic,
+                                                         state_hash_t *hash,
                                                          pbuf_t *delta_data) {
+  const char *data = NULL;
+  size_t size = 0;
+
   if (to_tic <= ns->tic) {
     return true;
   }
 
-  M_BufferClear(&ns->delta.data);
-  if (!M_PBufReadBytes(delta_data, &ns->delta.data)) {
+  if (!M_PBufReadBytesSlice(delta_data, &data, &size)) {
     P_Printf(consoleplayer,
       "N_SyncUpdateStateDelta: Error reading delta data: %s.\n",
       M_PBufGetError(delta_data)
@@ -155,15 +166,32 @@ bool N_SyncUpdateStateDelta(netsync_t *ns, int from_tic, int to_tic,
     return false;
   }
 
+  if (!G_ApplyStateDelta(from_tic, to_tic, hash, data, size)) {
+    D_Msg(MSG_WARN, "N_SyncUpdateStateDelta: Error applying delta %d => %d\n",
+      from_tic, to_tic
+    );
+    return true;
+  }
+
   ns->tic = to_tic;
   ns->delta.from_tic = from_tic;
   ns->delta.to_tic = to_tic;
+  ns->delta.hash = *hash;
 
   N_SyncSetUpdated(ns);
 
   return true;
 }
 
+/* Shared deltas have to be built on the main thread */
+void N_SyncPrepareStateDelta(netsync_t *ns) {
+  if (ns->tic >= G_GetLatestState()->tic) {
+    return;
+  }
+
+  G_GetStateDelta(ns->tic);
+}
+
 void N_SyncBuildNewStateDelta(netsync_t *ns) {
   if (ns->tic >= G_GetLatestState()->tic) {
     return;
@@ -204,4 +232,17 @@ game_state_delta_t* N_SyncGetStateDelta(netsync_t *ns) {
   return &ns->delta;
 }
 
+struct aoi_views_s* N_SyncGetAOIViews(netsync_t *ns) {
+  return ns->aoi_views;
+}
+
+/* Frees the views being replaced */
+void N_SyncSetAOIViews(netsync_t *ns, struct aoi_views_s *aoi_views) {
+  if (ns->aoi_views && ns->aoi_views != aoi_views) {
+    SV_AOIFreeViews(ns->aoi_views);
+  }
+
+  ns->aoi_views = aoi_views;
+}
+
 /* vi: set et ts=2 sw=2: */
@@ -38,6 +38,7 @@ typedef struct netsync_s {
   unsigned int command_index;
   unsigned int command_indices[MAXPLAYERS];
   game_state_delta_t delta;
+  struct aoi_views_s *aoi_views;
 } netsync_t;
 
 void N_SyncInit(netsync_t *ns);
@@ -74,12 +75,18 @@ void         N_SyncUpdateCommandIndex(netsync_t *ns,
 game_state_delta_t* N_SyncGetStateDelta(netsync_t *ns);
 bool                N_SyncUpdateStateDelta(netsync_t *ns, int from_tic,
                                                           int to_tic,
+                                                          state_hash_t *hash,
                                                           pbuf_t *delta_data);
+void                N_SyncPrepareStateDelta(netsync_t *ns);
 void                N_SyncBuildNewStateDelta(netsync_t *ns);
 void                N_SyncResetStateDelta(netsync_t *ns, int sync_tic,
                                                          int from_tic,
                                                          int to_tic);
 
+struct aoi_views_s* N_SyncGetAOIViews(netsync_t *ns);
+void                N_SyncSetAOIViews(netsync_t *ns,
+                                      struct aoi_views_s *aoi_views);
+
 unsigned int N_SyncGetCommandIndexForPlayer(netsync_t *ns,
                                             unsigned int playernum);
 void         N_SyncSetCommandIndexForPlayer(netsync_t *ns,
@@ -0,0 +1,87 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+
+#ifndef N_TRANSPORT_H__
+#define N_TRANSPORT_H__
+
+typedef enum {
+  NET_EVENT_NONE,
+  NET_EVENT_CONNECT,
+  NET_EVENT_DISCONNECT,
+  NET_EVENT_RECEIVE,
+} net_event_type_e;
+
+typedef struct net_event_s {
+  net_event_type_e  type;
+  void             *peer;
+  uint32_t          data;
+  unsigned char    *packet_data;
+  size_t            packet_size;
+  void             *packet;
+} net_event_t;
+
+/*
+ * Peers are opaque handles that stay valid until their disconnection event
+ * has been serviced.  Unreliable transports leave sequencing and
+ * retransmission to the channels in n_chan.c.
+ */
+typedef struct net_transport_s {
+  const char *name;
+  bool        reliable;
+  size_t      max_packet_size;
+  bool      (*init)(void);
+  void      (*shutdown)(void);
+  bool      (*listen)(const char *host, uint16_t port, size_t max_peers);
+  void*     (*connect)(const char *host, uint16_t port);
+  void      (*destroy)(void);
+  int       (*service)(net_event_t *event, int timeout_ms);
+  void      (*free_event)(net_event_t *event);
+  void      (*send)(void *peer, net_channel_e channel, bool reliable,
+                                                       unsigned char *data,
+                                                       size_t size);
+  void      (*disconnect)(void *peer, uint32_t reason);
+  void      (*reset)(void *peer);
+  uint32_t  (*get_peer_id)(void *peer);
+  uint32_t  (*get_address)(void *peer);
+  uint16_t  (*get_port)(void *peer);
+  void      (*get_stats)(void *peer, net_peer_stats_t *stats);
+} net_transport_t;
+
+extern net_transport_t net_transport_enet;
+#ifdef __linux__
+extern net_transport_t net_transport_udp;
+#endif
+
+net_transport_t* N_GetTransport(void);
+
+net_transport_t* N_SimWrapTransport(net_transport_t *transport);
+bool             N_SimActive(void);
+void             N_SimGetConditions(unsigned int *latency,
+                                    unsigned int *jitter,
+                                    double *loss);
+unsigned int     N_SimGetDroppedPackets(void);
+
+#endif
+
+/* vi: set et ts=2 sw=2: */
@@ -0,0 +1,944 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+
+#include "doomdef.h"
+#include "i_system.h"
+#include "n_main.h"
+#include "n_transport.h"
+
+#define UDP_PROTOCOL_ID 0x44324B31 /* D2K1 */
+
+#define UDP_HEADER_SIZE 5
+#define UDP_DATA_HEADER_SIZE (UDP_HEADER_SIZE + 1)
+#define UDP_MAX_DATAGRAM_SIZE 1400
+#define UDP_MAX_PACKET_SIZE (UDP_MAX_DATAGRAM_SIZE - UDP_DATA_HEADER_SIZE)
+#define UDP_BATCH_SIZE 64
+#define UDP_SOCKET_BUFFER_SIZE (4 * 1024 * 1024)
+
+#define UDP_MAINTENANCE_INTERVAL 50
+#define UDP_CONNECT_INTERVAL 500
+#define UDP_CONNECT_ATTEMPTS 10
+#define UDP_PING_INTERVAL 1000
+#define UDP_PACKET_LOSS_INTERVAL 10000
+#define UDP_PEER_TIMEOUT (NET_PEER_MAXIMUM_TIMEOUT * 1000)
+#define UDP_ZOMBIE_LIFETIME 5000
+
+typedef enum {
+  UDP_MESSAGE_CONNECT = 1,
+  UDP_MESSAGE_ACCEPT,
+  UDP_MESSAGE_DISCONNECT,
+  UDP_MESSAGE_DATA,
+  UDP_MESSAGE_PING,
+  UDP_MESSAGE_PONG,
+} udp_message_e;
+
+typedef enum {
+  UDP_PEER_CONNECTING,
+  UDP_PEER_CONNECTED,
+  UDP_PEER_ZOMBIE,
+} udp_peer_state_e;
+
+typedef struct udp_peer_s {
+  struct sockaddr_in address;
+  gint64             key;
+  uint32_t           id;
+  uint32_t           connect_id;
+  udp_peer_state_e   state;
+  unsigned int       connect_attempts;
+  uint32_t           last_connect_time;
+  uint32_t           last_receive_time;
+  uint32_t           last_ping_time;
+  uint32_t           zombie_time;
+  uint32_t           packet_loss_epoch;
+  uint32_t           pings_sent;
+  uint32_t           pongs_received;
+  net_peer_stats_t   stats;
+} udp_peer_t;
+
+/*
+ * Datagrams carry the connection ID the client picked, so stale ones from a
+ * previous connection on the same address are ignored.
+ */
+static int          udp_socket = -1;
+static int          udp_epoll = -1;
+static bool         udp_listening = false;
+static size_t       udp_max_peers = 0;
+static GHashTable  *udp_peers = NULL;
+static GPtrArray   *udp_zombies = NULL;
+static GQueue      *udp_events = NULL;
+static uint32_t     udp_next_peer_id = 0;
+static uint32_t     udp_last_maintenance_time = 0;
+
+typedef unsigned char udp_datagram_t[UDP_MAX_DATAGRAM_SIZE];
+
+static struct mmsghdr     udp_send_messages[UDP_BATCH_SIZE];
+static struct iovec       udp_send_iovecs[UDP_BATCH_SIZE];
+static struct sockaddr_in udp_send_addresses[UDP_BATCH_SIZE];
+static udp_datagram_t     udp_send_buffers[UDP_BATCH_SIZE];
+static unsigned int       udp_send_count = 0;
+
+static struct mmsghdr     udp_receive_messages[UDP_BATCH_SIZE];
+static struct iovec       udp_receive_iovecs[UDP_BATCH_SIZE];
+static struct sockaddr_in udp_receive_addresses[UDP_BATCH_SIZE];
+static udp_datagram_t     udp_receive_buffers[UDP_BATCH_SIZE];
+
+static gint64 address_key(const struct sockaddr_in *address) {
+  return (((gint64)ntohl(address->sin_addr.s_addr)) << 16) |
+         ntohs(address->sin_port);
+}
+
+static void write_uint32(unsigned char *data, uint32_t value) {
+  data[0] = (value >> 24) & 0xFF;
+  data[1] = (value >> 16) & 0xFF;
+  data[2] = (value >> 8) & 0xFF;
+  data[3] = value & 0xFF;
+}
+
+static uint32_t read_uint32(const unsigned char *data) {
+  return (((uint32_t)data[0]) << 24) |
+         (((uint32_t)data[1]) << 16) |
+         (((uint32_t)data[2]) << 8) |
+         ((uint32_t)data[3]);
+}
+
+static bool resolve_address(const char *host, uint16_t port,
+                                              struct sockaddr_in *address) {
+  struct addrinfo hints;
+  struct addrinfo *results = NULL;
+  int status;
+
+  memset(address, 0, sizeof(struct sockaddr_in));
+  address->sin_family = AF_INET;
+  address->sin_port = htons(port);
+
+  if (!host) {
+    address->sin_addr.s_addr = htonl(INADDR_ANY);
+    return true;
+  }
+
+  memset(&hints, 0, sizeof(struct addrinfo));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  status = getaddrinfo(host, NULL, &hints, &results);
+
+  if (status != 0) {
+    D_Msg(MSG_ERROR, "N_Transport: Error resolving %s: %s\n",
+      host, gai_strerror(status)
+    );
+    return false;
+  }
+
+  address->sin_addr = ((struct sockaddr_in *)results->ai_addr)->sin_addr;
+  freeaddrinfo(results);
+
+  return true;
+}
+
+static void flush_sends(void) {
+  unsigned int sent = 0;
+
+  while (sent < udp_send_count) {
+    int res = sendmmsg(
+      udp_socket, udp_send_messages + sent, udp_send_count - sent, 0
+    );
+
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      /* Buffer full or unreachable; the channels resend what matters */
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        D_Msg(MSG_WARN, "N_Transport: Error sending datagrams: %s\n",
+          strerror(errno)
+        );
+      }
+
+      break;
+    }
+
+    sent += res;
+  }
+
+  udp_send_count = 0;
+}
+
+static void send_datagram(udp_peer_t *peer, udp_message_e type,
+                                            const unsigned char *data,
+                                            size_t size) {
+  unsigned char *datagram;
+
+  if (udp_send_count == UDP_BATCH_SIZE) {
+    flush_sends();
+  }
+
+  datagram = udp_send_buffers[udp_send_count];
+  datagram[0] = type;
+  write_uint32(datagram + 1, peer->connect_id);
+
+  if (size > 0) {
+    memcpy(datagram + UDP_HEADER_SIZE, data, size);
+  }
+
+  udp_send_addresses[udp_send_count] = peer->address;
+  udp_send_iovecs[udp_send_count].iov_len = UDP_HEADER_SIZE + size;
+  udp_send_count++;
+
+  peer->stats.packets_sent++;
+}
+
+static void send_uint32(udp_peer_t *peer, udp_message_e type, uint32_t value) {
+  unsigned char data[4];
+
+  write_uint32(data, value);
+  send_datagram(peer, type, data, sizeof(data));
+}
+
+static void queue_event(net_event_type_e type, udp_peer_t *peer,
+                                               uint32_t data,
+                                               const unsigned char *packet,
+                                               size_t packet_size) {
+  net_event_t *event = calloc(1, sizeof(net_event_t));
+
+  if (!event) {
+    I_Error("queue_event: Error allocating event");
+  }
+
+  event->type = type;
+  event->peer = peer;
+  event->data = data;
+
+  if (packet_size > 0) {
+    event->packet = malloc(packet_size);
+
+    if (!event->packet) {
+      I_Error("queue_event: Error allocating packet");
+    }
+
+    memcpy(event->packet, packet, packet_size);
+    event->packet_data = event->packet;
+    event->packet_size = packet_size;
+  }
+
+  g_queue_push_tail(udp_events, event);
+}
+
+static udp_peer_t* add_peer(const struct sockaddr_in *address,
+                            uint32_t connect_id,
+                            udp_peer_state_e state) {
+  udp_peer_t *peer = calloc(1, sizeof(udp_peer_t));
+  uint32_t now = I_GetTicks();
+
+  if (!peer) {
+    I_Error("add_peer: Error allocating peer");
+  }
+
+  peer->address = *address;
+  peer->key = address_key(address);
+  peer->id = ++udp_next_peer_id;
+  peer->connect_id = connect_id;
+  peer->state = state;
+  peer->last_connect_time = now;
+  peer->last_receive_time = now;
+  peer->last_ping_time = now;
+  peer->packet_loss_epoch = now;
+
+  g_hash_table_insert(udp_peers, &peer->key, peer);
+
+  return peer;
+}
+
+/* Peers linger so handles in queued events stay valid */
+static void retire_peer(udp_peer_t *peer) {
+  if (peer->state == UDP_PEER_ZOMBIE) {
+    return;
+  }
+
+  g_hash_table_remove(udp_peers, &peer->key);
+  peer->state = UDP_PEER_ZOMBIE;
+  peer->zombie_time = I_GetTicks();
+  g_ptr_array_add(udp_zombies, peer);
+}
+
+static void update_round_trip_time(udp_peer_t *peer, uint32_t sample) {
+  net_peer_stats_t *stats = &peer->stats;
+  uint32_t difference;
+
+  stats->last_round_trip_time = sample;
+
+  if (stats->lowest_round_trip_time == 0 ||
+      sample < stats->lowest_round_trip_time) {
+    stats->lowest_round_trip_time = sample;
+  }
+
+  if (stats->round_trip_time == 0) {
+    stats->round_trip_time = sample;
+    stats->round_trip_time_variance = sample / 2;
+    return;
+  }
+
+  if (sample > stats->round_trip_time) {
+    difference = sample - stats->round_trip_time;
+  }
+  else {
+    difference = stats->round_trip_time - sample;
+  }
+
+  stats->last_round_trip_time_variance = difference;
+  stats->highest_round_trip_time_variance = MAX(
+    stats->highest_round_trip_time_variance, difference
+  );
+  stats->round_trip_time_variance =
+    ((3 * stats->round_trip_time_variance) + difference) / 4;
+  stats->round_trip_time = ((7 * stats->round_trip_time) + sample) / 8;
+}
+
+static void update_packet_loss(udp_peer_t *peer, uint32_t now) {
+  net_peer_stats_t *stats = &peer->stats;
+  float packet_loss;
+  float difference;
+
+  if ((now - peer->packet_loss_epoch) < UDP_PACKET_LOSS_INTERVAL) {
+    return;
+  }
+
+  if (peer->pings_sent > 0) {
+    uint32_t pongs = MIN(peer->pongs_received, peer->pings_sent);
+
+    packet_loss = (peer->pings_sent - pongs) / (float)peer->pings_sent;
+    difference = fabsf(packet_loss - stats->packet_loss);
+
+    stats->packets_lost += peer->pings_sent - pongs;
+    stats->packet_loss_variance =
+      ((3.0f * stats->packet_loss_variance) + difference) / 4.0f;
+    stats->packet_loss = ((7.0f * stats->packet_loss) + packet_loss) / 8.0f;
+  }
+
+  peer->pings_sent = 0;
+  peer->pongs_received = 0;
+  peer->packet_loss_epoch = now;
+}
+
+static void handle_connect(const struct sockaddr_in *address,
+                           udp_peer_t *peer,
+                           uint32_t connect_id,
+                           const unsigned char *data,
+                           size_t size) {
+  if (!udp_listening) {
+    return;
+  }
+
+  if (size < 4 || read_uint32(data) != UDP_PROTOCOL_ID) {
+    return;
+  }
+
+  if (peer) {
+    /* Our accept was lost */
+    if (peer->connect_id == connect_id) {
+      send_datagram(peer, UDP_MESSAGE_ACCEPT, NULL, 0);
+      return;
+    }
+
+    /* The client reconnected before its previous connection timed out */
+    queue_event(NET_EVENT_DISCONNECT, peer,
+      DISCONNECT_REASON_LOST_PEER_CONNECTION, NULL, 0
+    );
+    retire_peer(peer);
+  }
+
+  if (g_hash_table_size(udp_peers) >= udp_max_peers) {
+    udp_peer_t rejected;
+
+    memset(&rejected, 0, sizeof(udp_peer_t));
+    rejected.address = *address;
+    rejected.connect_id = connect_id;
+    send_uint32(
+      &rejected, UDP_MESSAGE_DISCONNECT, DISCONNECT_REASON_SERVER_FULL
+    );
+    return;
+  }
+
+  peer = add_peer(address, connect_id, UDP_PEER_CONNECTED);
+  send_datagram(peer, UDP_MESSAGE_ACCEPT, NULL, 0);
+  queue_event(NET_EVENT_CONNECT, peer, 0, NULL, 0);
+}
+
+static void handle_datagram(const struct sockaddr_in *address,
+                            const unsigned char *data,
+                            size_t size,
+                            uint32_t now) {
+  gint64 key = address_key(address);
+  udp_peer_t *peer = g_hash_table_lookup(udp_peers, &key);
+  udp_message_e type;
+  uint32_t connect_id;
+
+  if (size < UDP_HEADER_SIZE) {
+    return;
+  }
+
+  type = data[0];
+  connect_id = read_uint32(data + 1);
+  data += UDP_HEADER_SIZE;
+  size -= UDP_HEADER_SIZE;
+
+  if (type == UDP_MESSAGE_CONNECT) {
+    handle_connect(address, peer, connect_id, data, size);
+    return;
+  }
+
+  if (!peer || peer->connect_id != connect_id) {
+    return;
+  }
+
+  if (type == UDP_MESSAGE_ACCEPT) {
+    if (peer->state == UDP_PEER_CONNECTING) {
+      peer->state = UDP_PEER_CONNECTED;
+      peer->last_ping_time = now;
+      queue_event(NET_EVENT_CONNECT, peer, 0, NULL, 0);
+    }
+
+    peer->last_receive_time = now;
+    return;
+  }
+
+  if (peer->state != UDP_PEER_CONNECTED) {
+    return;
+  }
+
+  peer->last_receive_time = now;
+
+  switch (type) {
+    case UDP_MESSAGE_DISCONNECT:
+      queue_event(NET_EVENT_DISCONNECT, peer,
+        size >= 4 ? read_uint32(data) : 0, NULL, 0
+      );
+      retire_peer(peer);
+    break;
+    case UDP_MESSAGE_DATA:
+      if (size > 1 && data[0] < NET_CHANNEL_MAX) {
+        queue_event(NET_EVENT_RECEIVE, peer, data[0], data + 1, size - 1);
+      }
+    break;
+    case UDP_MESSAGE_PING:
+      send_datagram(peer, UDP_MESSAGE_PONG, data, MIN(size, 4));
+    break;
+    case UDP_MESSAGE_PONG:
+      if (size >= 4) {
+        peer->pongs_received++;
+        update_round_trip_time(peer, now - read_uint32(data));
+      }
+    break;
+    default:
+    break;
+  }
+}
+
+static int receive_datagrams(void) {
+  uint32_t now = I_GetTicks();
+  int received = 0;
+
+  while (true) {
+    int res = recvmmsg(
+      udp_socket, udp_receive_messages, UDP_BATCH_SIZE, MSG_DONTWAIT, NULL
+    );
+
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+
+      /* ICMP errors from peers that went away show up here */
+      if (errno == ECONNREFUSED) {
+        continue;
+      }
+
+      D_Msg(MSG_WARN, "N_Transport: Error receiving datagrams: %s\n",
+        strerror(errno)
+      );
+      return -1;
+    }
+
+    for (int i = 0; i < res; i++) {
+      handle_datagram(
+        &udp_receive_addresses[i],
+        udp_receive_buffers[i],
+        udp_receive_messages[i].msg_len,
+        now
+      );
+      udp_receive_messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+
+    received += res;
+
+    if (res < UDP_BATCH_SIZE) {
+      break;
+    }
+  }
+
+  return received;
+}
+
+static void maintain_peers(void) {
+  uint32_t now = I_GetTicks();
+  GPtrArray *expired = NULL;
+  GHashTableIter it;
+  gpointer key, value;
+
+  if ((now - udp_last_maintenance_time) < UDP_MAINTENANCE_INTERVAL) {
+    return;
+  }
+
+  udp_last_maintenance_time = now;
+
+  for (unsigned int i = 0; i < udp_zombies->len; i++) {
+    udp_peer_t *peer = g_ptr_array_index(udp_zombies, i);
+
+    if ((now - peer->zombie_time) >= UDP_ZOMBIE_LIFETIME) {
+      g_ptr_array_remove_index_fast(udp_zombies, i);
+      free(peer);
+      i--;
+    }
+  }
+
+  g_hash_table_iter_init(&it, udp_peers);
+
+  while (g_hash_table_iter_next(&it, &key, &value)) {
+    udp_peer_t *peer = (udp_peer_t *)value;
+    bool timed_out = false;
+
+    if (peer->state == UDP_PEER_CONNECTING) {
+      if ((now - peer->last_connect_time) < UDP_CONNECT_INTERVAL) {
+        continue;
+      }
+
+      if (peer->connect_attempts >= UDP_CONNECT_ATTEMPTS) {
+        timed_out = true;
+      }
+      else {
+        send_uint32(peer, UDP_MESSAGE_CONNECT, UDP_PROTOCOL_ID);
+        peer->connect_attempts++;
+        peer->last_connect_time = now;
+      }
+    }
+    else if ((now - peer->last_receive_time) >= UDP_PEER_TIMEOUT) {
+      timed_out = true;
+    }
+    else {
+      if ((now - peer->last_ping_time) >= UDP_PING_INTERVAL) {
+        send_uint32(peer, UDP_MESSAGE_PING, now);
+        peer->pings_sent++;
+        peer->last_ping_time = now;
+      }
+
+      update_packet_loss(peer, now);
+    }
+
+    if (timed_out) {
+      if (!expired) {
+        expired = g_ptr_array_new();
+      }
+
+      g_ptr_array_add(expired, peer);
+    }
+  }
+
+  if (!expired) {
+    return;
+  }
+
+  for (unsigned int i = 0; i < expired->len; i++) {
+    udp_peer_t *peer = g_ptr_array_index(expired, i);
+
+    queue_event(NET_EVENT_DISCONNECT, peer,
+      DISCONNECT_REASON_LOST_PEER_CONNECTION, NULL, 0
+    );
+    retire_peer(peer);
+  }
+
+  g_ptr_array_free(expired, true);
+}
+
+static bool open_socket(const struct sockaddr_in *address) {
+  struct epoll_event event;
+  int buffer_size = UDP_SOCKET_BUFFER_SIZE;
+  int reuse = 1;
+
+  udp_socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+  if (udp_socket < 0) {
+    D_Msg(MSG_ERROR, "N_Transport: Error creating socket: %s\n",
+      strerror(errno)
+    );
+    return false;
+  }
+
+  setsockopt(udp_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  setsockopt(
+    udp_socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size)
+  );
+  setsockopt(
+    udp_socket, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size)
+  );
+
+  if (bind(udp_socket, (const struct sockaddr *)address,
+                       sizeof(struct sockaddr_in)) < 0) {
+    D_Msg(MSG_ERROR, "N_Transport: Error binding socket: %s\n",
+      strerror(errno)
+    );
+    close(udp_socket);
+    udp_socket = -1;
+    return false;
+  }
+
+  udp_epoll = epoll_create1(EPOLL_CLOEXEC);
+
+  if (udp_epoll < 0) {
+    D_Msg(MSG_ERROR, "N_Transport: Error creating epoll instance: %s\n",
+      strerror(errno)
+    );
+    close(udp_socket);
+    udp_socket = -1;
+    return false;
+  }
+
+  memset(&event, 0, sizeof(struct epoll_event));
+  event.events = EPOLLIN;
+  event.data.fd = udp_socket;
+
+  if (epoll_ctl(udp_epoll, EPOLL_CTL_ADD, udp_socket, &event) < 0) {
+    D_Msg(MSG_ERROR, "N_Transport: Error watching socket: %s\n",
+      strerror(errno)
+    );
+    close(udp_epoll);
+    close(udp_socket);
+    udp_epoll = -1;
+    udp_socket = -1;
+    return false;
+  }
+
+  udp_send_count = 0;
+  udp_last_maintenance_time = I_GetTicks();
+
+  return true;
+}
+
+static bool transport_udp_init(void) {
+  for (int i = 0; i < UDP_BATCH_SIZE; i++) {
+    udp_send_iovecs[i].iov_base = udp_send_buffers[i];
+    udp_send_messages[i].msg_hdr.msg_name = &udp_send_addresses[i];
+    udp_send_messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    udp_send_messages[i].msg_hdr.msg_iov = &udp_send_iovecs[i];
+    udp_send_messages[i].msg_hdr.msg_iovlen = 1;
+
+    udp_receive_iovecs[i].iov_base = udp_receive_buffers[i];
+    udp_receive_iovecs[i].iov_len = UDP_MAX_DATAGRAM_SIZE;
+    udp_receive_messages[i].msg_hdr.msg_name = &udp_receive_addresses[i];
+    udp_receive_messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    udp_receive_messages[i].msg_hdr.msg_iov = &udp_receive_iovecs[i];
+    udp_receive_messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  udp_peers = g_hash_table_new(g_int64_hash, g_int64_equal);
+  udp_zombies = g_ptr_array_new();
+  udp_events = g_queue_new();
+
+  return true;
+}
+
+static void transport_udp_free_event(net_event_t *event) {
+  free(event->packet);
+  event->packet = NULL;
+  event->packet_data = NULL;
+  event->packet_size = 0;
+}
+
+static void transport_udp_destroy(void) {
+  GHashTableIter it;
+  gpointer key, value;
+  net_event_t *event;
+
+  if (udp_socket < 0) {
+    return;
+  }
+
+  flush_sends();
+
+  while ((event = g_queue_pop_head(udp_events))) {
+    transport_udp_free_event(event);
+    free(event);
+  }
+
+  g_hash_table_iter_init(&it, udp_peers);
+
+  while (g_hash_table_iter_next(&it, &key, &value)) {
+    g_hash_table_iter_remove(&it);
+    free(value);
+  }
+
+  for (unsigned int i = 0; i < udp_zombies->len; i++) {
+    free(g_ptr_array_index(udp_zombies, i));
+  }
+
+  g_ptr_array_set_size(udp_zombies, 0);
+
+  close(udp_epoll);
+  close(udp_socket);
+  udp_epoll = -1;
+  udp_socket = -1;
+  udp_listening = false;
+  udp_max_peers = 0;
+}
+
+static void transport_udp_shutdown(void) {
+  transport_udp_destroy();
+
+  g_hash_table_destroy(udp_peers);
+  g_ptr_array_free(udp_zombies, true);
+  g_queue_free(udp_events);
+  udp_peers = NULL;
+  udp_zombies = NULL;
+  udp_events = NULL;
+}
+
+static bool transport_udp_listen(const char *host, uint16_t port,
+                                                   size_t max_peers) {
+  struct sockaddr_in address;
+
+  if (!resolve_address(host, port, &address)) {
+    return false;
+  }
+
+  if (!open_socket(&address)) {
+    return false;
+  }
+
+  udp_listening = true;
+  udp_max_peers = max_peers;
+
+  return true;
+}
+
+static void* transport_udp_connect(const char *host, uint16_t port) {
+  struct sockaddr_in local_address;
+  struct sockaddr_in address;
+  udp_peer_t *peer;
+
+  if (!resolve_address(host, port, &address)) {
+    return NULL;
+  }
+
+  /* Relays connect upstream from the socket they're listening on */
+  if (!udp_listening) {
+    if (!resolve_address(NULL, 0, &local_address)) {
+      return NULL;
+    }
+
+    if (!open_socket(&local_address)) {
+      return NULL;
+    }
+
+    udp_max_peers = 1;
+  }
+
+  peer = add_peer(&address, g_random_int(), UDP_PEER_CONNECTING);
+  send_uint32(peer, UDP_MESSAGE_CONNECT, UDP_PROTOCOL_ID);
+  peer->connect_attempts++;
+  flush_sends();
+
+  return peer;
+}
+
+static bool pop_event(net_event_t *event) {
+  net_event_t *queued = g_queue_pop_head(udp_events);
+
+  if (!queued) {
+    return false;
+  }
+
+  *event = *queued;
+  free(queued);
+
+  return true;
+}
+
+static int transport_udp_service(net_event_t *event, int timeout_ms) {
+  uint32_t start = I_GetTicks();
+
+  memset(event, 0, sizeof(net_event_t));
+
+  if (udp_socket < 0) {
+    return 0;
+  }
+
+  flush_sends();
+
+  if (pop_event(event)) {
+    return 1;
+  }
+
+  while (true) {
+    struct epoll_event epoll_event;
+    int remaining;
+    int res;
+
+    if (receive_datagrams() < 0) {
+      return -1;
+    }
+
+    maintain_peers();
+    flush_sends();
+
+    if (pop_event(event)) {
+      return 1;
+    }
+
+    remaining = timeout_ms - (int)(I_GetTicks() - start);
+
+    if (remaining <= 0) {
+      return 0;
+    }
+
+    res = epoll_wait(
+      udp_epoll, &epoll_event, 1, MIN(remaining, UDP_MAINTENANCE_INTERVAL)
+    );
+
+    if (res < 0 && errno != EINTR) {
+      D_Msg(MSG_WARN, "N_Transport: Error waiting for datagrams: %s\n",
+        strerror(errno)
+      );
+      return -1;
+    }
+  }
+}
+
+static void transport_udp_send(void *peer, net_channel_e channel,
+                                           bool reliable,
+                                           unsigned char *data,
+                                           size_t size) {
+  udp_peer_t *upeer = (udp_peer_t *)peer;
+  unsigned char *datagram;
+
+  if (upeer->state != UDP_PEER_CONNECTED) {
+    return;
+  }
+
+  if (size > UDP_MAX_PACKET_SIZE) {
+    D_Msg(MSG_WARN, "N_Transport: Dropping oversized packet (%zu > %d)\n",
+      size, UDP_MAX_PACKET_SIZE
+    );
+    return;
+  }
+
+  if (udp_send_count == UDP_BATCH_SIZE) {
+    flush_sends();
+  }
+
+  /* Build the datagram in place to save copying the payload twice */
+  datagram = udp_send_buffers[udp_send_count];
+  datagram[0] = UDP_MESSAGE_DATA;
+  write_uint32(datagram + 1, upeer->connect_id);
+  datagram[UDP_HEADER_SIZE] = channel;
+  memcpy(datagram + UDP_DATA_HEADER_SIZE, data, size);
+
+  udp_send_addresses[udp_send_count] = upeer->address;
+  udp_send_iovecs[udp_send_count].iov_len = UDP_DATA_HEADER_SIZE + size;
+  udp_send_count++;
+
+  upeer->stats.packets_sent++;
+}
+
+static void transport_udp_disconnect(void *peer, uint32_t reason) {
+  udp_peer_t *upeer = (udp_peer_t *)peer;
+
+  if (upeer->state == UDP_PEER_ZOMBIE) {
+    return;
+  }
+
+  if (upeer->state == UDP_PEER_CONNECTED) {
+    send_uint32(upeer, UDP_MESSAGE_DISCONNECT, reason);
+  }
+
+  queue_event(NET_EVENT_DISCONNECT, upeer, reason, NULL, 0);
+  retire_peer(upeer);
+}
+
+static void transport_udp_reset(void *peer) {
+  retire_peer((udp_peer_t *)peer);
+}
+
+static uint32_t transport_udp_get_peer_id(void *peer) {
+  return ((udp_peer_t *)peer)->id;
+}
+
+static uint32_t transport_udp_get_address(void *peer) {
+  return ntohl(((udp_peer_t *)peer)->address.sin_addr.s_addr);
+}
+
+static uint16_t transport_udp_get_port(void *peer) {
+  return ntohs(((udp_peer_t *)peer)->address.sin_port);
+}
+
+static void transport_udp_get_stats(void *peer, net_peer_stats_t *stats) {
+  *stats = ((udp_peer_t *)peer)->stats;
+}
+
+net_transport_t net_transport_udp = {
+  "udp",
+  false,
+  UDP_MAX_PACKET_SIZE,
+  transport_udp_init,
+  transport_udp_shutdown,
+  transport_udp_listen,
+  transport_udp_connect,
+  transport_udp_destroy,
+  transport_udp_service,
+  transport_udp_free_event,
+  transport_udp_send,
+  transport_udp_disconnect,
+  transport_udp_reset,
+  transport_udp_get_peer_id,
+  transport_udp_get_address,
+  transport_udp_get_port,
+  transport_udp_get_stats,
+};
+
+#endif
+
+/* vi: set et ts=2 sw=2: */
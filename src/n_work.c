@@ -0,0 +1,165 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "m_argv.h"
+#include "n_main.h"
+
+/* Below this many peers per worker, handing work off isn't worth it */
+#define MIN_PEERS_PER_WORKER 4
+
+typedef struct net_work_s {
+  GPtrArray  *peers;
+  net_work_f  func;
+  gint        next_peer;
+  guint       workers_running;
+} net_work_t;
+
+static GThreadPool *net_workers = NULL;
+static unsigned int net_worker_count = 0;
+static bool         net_workers_initialized = false;
+static GMutex       net_work_mutex;
+static GCond        net_work_done;
+
+static void run_work(net_work_t *work) {
+  while (true) {
+    guint i = (guint)g_atomic_int_add(&work->next_peer, 1);
+
+    if (i >= work->peers->len) {
+      break;
+    }
+
+    work->func(g_ptr_array_index(work->peers, i));
+  }
+}
+
+static void run_worker(gpointer data, gpointer user_data) {
+  net_work_t *work = (net_work_t *)data;
+
+  run_work(work);
+
+  g_mutex_lock(&net_work_mutex);
+  work->workers_running--;
+
+  if (work->workers_running == 0) {
+    g_cond_signal(&net_work_done);
+  }
+
+  g_mutex_unlock(&net_work_mutex);
+}
+
+/* -networkers overrides this; 0 does everything on the main thread */
+static void init_workers(void) {
+  GError *error = NULL;
+  int worker_count = g_get_num_processors() - 1;
+  int p;
+
+  net_workers_initialized = true;
+
+  if ((p = M_CheckParm("-networkers")) && p < myargc - 1) {
+    worker_count = atoi(myargv[p + 1]);
+  }
+
+  if (worker_count <= 0) {
+    return;
+  }
+
+  net_workers = g_thread_pool_new(
+    run_worker, NULL, worker_count, TRUE, &error
+  );
+
+  if (!net_workers) {
+    D_Msg(MSG_WARN, "init_workers: Error starting network workers (%s)\n",
+      error->message
+    );
+    g_error_free(error);
+    return;
+  }
+
+  net_worker_count = worker_count;
+
+  D_Msg(MSG_INFO, "Started %u network workers\n", net_worker_count);
+}
+
+unsigned int N_GetWorkerCount(void) {
+  return net_worker_count;
+}
+
+void N_ShutdownWorkers(void) {
+  if (net_workers) {
+    g_thread_pool_free(net_workers, TRUE, TRUE);
+    net_workers = NULL;
+  }
+
+  net_worker_count = 0;
+  net_workers_initialized = false;
+}
+
+/*
+ * func may only write to the peer it's given; everything else is read-only.
+ * Sync logging keeps everything on the main thread.
+ */
+void N_WorkRun(GPtrArray *peers, net_work_f func) {
+  net_work_t work;
+  guint worker_count;
+
+  if (!net_workers_initialized) {
+    init_workers();
+  }
+
+  work.peers = peers;
+  work.func = func;
+  work.next_peer = 0;
+  work.workers_running = 0;
+
+  worker_count = MIN(net_worker_count, peers->len / MIN_PEERS_PER_WORKER);
+
+  if (worker_count == 0 || D_MsgActive(MSG_SYNC)) {
+    run_work(&work);
+    return;
+  }
+
+  work.workers_running = worker_count;
+
+  Z_SetLocking(true);
+
+  for (guint i = 0; i < worker_count; i++) {
+    g_thread_pool_push(net_workers, &work, NULL);
+  }
+
+  run_work(&work);
+
+  g_mutex_lock(&net_work_mutex);
+
+  while (work.workers_running > 0) {
+    g_cond_wait(&net_work_done, &net_work_mutex);
+  }
+
+  g_mutex_unlock(&net_work_mutex);
+
+  Z_SetLocking(false);
+}
+
+/* vi: set et ts=2 sw=2: */
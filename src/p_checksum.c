@@ -29,6 +29,7 @@
 #include "p_checksum.h"
 #include "p_user.h"
 #include "g_game.h"
+#include "g_state.h"
 #include "md5.h"
 
 /* forward decls */
@@ -93,26 +94,18 @@ static void p_checksum_cleanup(void) {
  */
 void checksum_gamestate(int tic) {
     int i;
-    struct MD5Context md5ctx;
-    unsigned char digest[16];
-    char buffer[2048];
+    state_hash_t hash;
+    char buffer[32];
 
-    fprintf(outfile,"%6d, ", tic);
+    fprintf(outfile,"%6d,", tic);
 
-    /* based on "ArchivePlayers" */
-    MD5Init(&md5ctx);
-    for (i=0 ; i<MAXPLAYERS ; i++) {
-        if (!playeringame[i]) continue;
+    G_HashCurrentState(&hash);
 
-        snprintf(buffer, sizeof(buffer), "%d", players[i].health);
-        buffer[sizeof(buffer)-1] = 0;
+    for (i=0; i<STATE_SECTION_MAX; i++) {
+        snprintf(buffer, sizeof(buffer), " %016" PRIx64, hash.sections[i]);
 
-        MD5Update(&md5ctx, (unsigned char const *)&buffer, strlen(buffer));
-    }
-    MD5Final(digest, &md5ctx);
-    for (i=0; i<16; i++) {
-        MD5Update(&md5global, (unsigned char const *)&digest[i], sizeof(digest[i]));
-        fprintf(outfile,"%x", digest[i]);
+        MD5Update(&md5global, (unsigned char const *)buffer, strlen(buffer));
+        fputs(buffer, outfile);
     }
 
     fprintf(outfile,"\n");
@@ -31,6 +31,7 @@
 #include "e6y.h"
 #include "g_game.h"
 #include "i_video.h"
+#include "m_bitmap.h"
 #include "n_main.h"
 #include "p_user.h"
 #include "r_defs.h"
@@ -51,9 +52,9 @@
 #define LOG_COMMANDS 0
 #define PRINT_COMMANDS 1
 
-void G_BuildTiccmd(ticcmd_t *cmd);
+#define command_slot(index) ((index) & (COMMAND_QUEUE_CAPACITY - 1))
 
-static GQueue *blank_command_queue;
+void G_BuildTiccmd(ticcmd_t *cmd);
 
 #if LOG_COMMANDS
 static void log_command(gpointer data, gpointer user_data) {
@@ -340,6 +341,7 @@ static bool extrapolate_player_position(int playernum) {
 static void run_queued_player_commands(int playernum) {
   int saved_leveltime = leveltime;
   player_t *player = &players[playernum];
+  unsigned int start = 0;
 
   if (SERVER && playernum == consoleplayer) {
     return;
@@ -361,15 +363,25 @@ static void run_queued_player_commands(int playernum) {
 
   player->cmdq.commands_run_this_tic = 0;
 
-  if (CLIENT && player->cmdq.commands->len >= 100) {
+  if (CLIENT && player->cmdq.count >= 100) {
     I_Error("%d commands for %d (%d), exiting\n",
-      player->cmdq.commands->len, playernum, consoleplayer
+      player->cmdq.count, playernum, consoleplayer
     );
   }
 
+  /* Skip straight past commands that have already been run */
+  if (player->cmdq.latest_command_run_index >= player->cmdq.first_index) {
+    start = (player->cmdq.latest_command_run_index + 1) -
+            player->cmdq.first_index;
+  }
+
   if (CLIENT && CL_Synchronizing()) {
-    for (unsigned int i = 0; i < player->cmdq.commands->len; i++) {
-      netticcmd_t *ncmd = g_ptr_array_index(player->cmdq.commands, i);
+    for (unsigned int i = start; i < player->cmdq.span; i++) {
+      netticcmd_t *ncmd = P_GetCommand(playernum, i);
+
+      if (!ncmd) {
+        continue;
+      }
 
       if ((ncmd->index > player->cmdq.latest_command_run_index) &&
           (ncmd->server_tic == gametic)) {
@@ -378,8 +390,12 @@ static void run_queued_player_commands(int playernum) {
     }
   }
   else {
-    for (unsigned int i = 0; i < player->cmdq.commands->len; i++) {
-      netticcmd_t *ncmd = g_ptr_array_index(player->cmdq.commands, i);
+    for (unsigned int i = start; i < player->cmdq.span; i++) {
+      netticcmd_t *ncmd = P_GetCommand(playernum, i);
+
+      if (!ncmd) {
+        continue;
+      }
 
       if (ncmd->index > player->cmdq.latest_command_run_index) {
         run_queued_command(playernum, ncmd);
@@ -391,82 +407,111 @@ static void run_queued_player_commands(int playernum) {
   leveltime = saved_leveltime;
 }
 
-static gint compare_commands(gconstpointer a, gconstpointer b) {
-  netticcmd_t *ncmd_one = *(netticcmd_t **)a;
-  netticcmd_t *ncmd_two = *(netticcmd_t **)b;
-
-  if (ncmd_one->index < ncmd_two->index) {
-    return -1;
-  }
-
-  if (ncmd_one->index > ncmd_two->index) {
-    return 1;
-  }
+static command_queue_t* get_command_queue(int playernum) {
+  command_queue_t *cmdq = &players[playernum].cmdq;
 
-  if (ncmd_one->tic < ncmd_two->index) {
-    return -1;
-  }
+  if (!cmdq->commands) {
+    cmdq->commands = calloc(COMMAND_QUEUE_CAPACITY, sizeof(netticcmd_t));
 
-  if (ncmd_one->tic > ncmd_two->index) {
-    return 1;
+    if (!cmdq->commands) {
+      I_Error("get_command_queue: Error allocating command queue");
+    }
   }
 
-  if (ncmd_one->server_tic != 0 && ncmd_two->server_tic == 0) {
-    return -1;
-  }
+  return cmdq;
+}
 
-  if (ncmd_one->server_tic == 0 && ncmd_two->server_tic != 0) {
-    return 1;
+static bool command_queue_has(command_queue_t *cmdq, uint32_t command_index) {
+  if (cmdq->count == 0) {
+    return false;
   }
 
-  if (ncmd_one->server_tic == 0 && ncmd_two->server_tic != 0) {
-    return 1;
+  if ((command_index - cmdq->first_index) >= cmdq->span) {
+    return false;
   }
 
-  if (ncmd_one->server_tic < ncmd_two->server_tic) {
-    return -1;
-  }
+  return bitmap_get_bit(cmdq->occupied, command_slot(command_index));
+}
 
-  if (ncmd_one->server_tic > ncmd_two->server_tic) {
-    return 1;
-  }
+/* Skips any holes so the first command in the span is present */
+static void command_queue_pop(command_queue_t *cmdq) {
+  bitmap_clear_bit(cmdq->occupied, command_slot(cmdq->first_index));
+  cmdq->count--;
 
-  return 0;
+  do {
+    cmdq->first_index++;
+    cmdq->span--;
+  } while (cmdq->span > 0 &&
+           !bitmap_get_bit(cmdq->occupied, command_slot(cmdq->first_index)));
 }
 
-static void recycle_command(gpointer data) {
-  netticcmd_t *ncmd = (netticcmd_t *)data;
+static void command_queue_insert(int playernum, command_queue_t *cmdq,
+                                                netticcmd_t *ncmd) {
+  uint32_t command_index = ncmd->index;
+  netticcmd_t *stored_ncmd = &cmdq->commands[command_slot(command_index)];
 
-  memset(ncmd, 0, sizeof(netticcmd_t));
+  /* Late duplicates of trimmed commands would never become trimmable */
+  if ((command_index <= cmdq->latest_command_run_index) &&
+      ((cmdq->count == 0) || (command_index < cmdq->first_index))) {
+    D_Msg(MSG_SYNC, "(%d) (%d) Ignoring already-run command %u\n",
+      gametic, playernum, command_index
+    );
+    return;
+  }
 
-  g_queue_push_tail(blank_command_queue, ncmd);
-}
+  if (cmdq->count == 0) {
+    cmdq->first_index = command_index;
+    cmdq->span = 1;
+  }
+  else if (command_index < cmdq->first_index) {
+    uint32_t new_span = (cmdq->first_index - command_index) + cmdq->span;
 
-static netticcmd_t* get_new_blank_command(void) {
-  netticcmd_t *ncmd = g_queue_pop_head(blank_command_queue);
+    if (new_span > COMMAND_QUEUE_CAPACITY) {
+      D_Msg(MSG_WARN, "(%d) (%d) Dropping stale command %u (oldest: %u)\n",
+        gametic, playernum, command_index, cmdq->first_index
+      );
+      return;
+    }
 
-  if (!ncmd) {
-    ncmd = calloc(1, sizeof(netticcmd_t));
+    cmdq->first_index = command_index;
+    cmdq->span = new_span;
   }
+  else if ((command_index - cmdq->first_index) >= cmdq->span) {
+    while (cmdq->count > 0 &&
+           (command_index - cmdq->first_index) >= COMMAND_QUEUE_CAPACITY) {
+      D_Msg(MSG_WARN, "(%d) (%d) Command queue full, dropping command %u\n",
+        gametic, playernum, cmdq->first_index
+      );
+      command_queue_pop(cmdq);
+    }
 
-  if (!ncmd) {
-    I_Error("get_new_blank_command: Error allocating new netticcmd");
+    if (cmdq->count == 0) {
+      cmdq->first_index = command_index;
+    }
+
+    cmdq->span = (command_index - cmdq->first_index) + 1;
   }
 
-  return ncmd;
-}
+  memcpy(stored_ncmd, ncmd, sizeof(netticcmd_t));
 
-void P_InitCommandQueues(void) {
-  if (!blank_command_queue) {
-    blank_command_queue = g_queue_new();
+  if (!bitmap_get_bit(cmdq->occupied, command_slot(command_index))) {
+    bitmap_set_bit(cmdq->occupied, command_slot(command_index));
+    cmdq->count++;
   }
+}
 
+void P_InitCommandQueues(void) {
   for (int i = 0; i < MAXPLAYERS; i++) {
-    players[i].cmdq.commands = g_ptr_array_new_with_free_func(recycle_command);
-    players[i].cmdq.commands_missed = 0;
-    players[i].cmdq.command_limit = 0;
-    players[i].cmdq.commands_run_this_tic = 0;
-    players[i].cmdq.latest_command_run_index = 0;
+    command_queue_t *cmdq = &players[i].cmdq;
+
+    cmdq->first_index = 0;
+    cmdq->span = 0;
+    cmdq->count = 0;
+    cmdq->commands_missed = 0;
+    cmdq->command_limit = 0;
+    cmdq->commands_run_this_tic = 0;
+    cmdq->latest_command_run_index = 0;
+    memset(cmdq->occupied, 0, sizeof(cmdq->occupied));
   }
 }
 
@@ -483,78 +528,99 @@ unsigned int P_GetCommandCount(int playernum) {
     return 0;
   }
 
-  return players[playernum].cmdq.commands->len;
+  return players[playernum].cmdq.count;
 }
 
-netticcmd_t* P_GetCommand(int playernum, unsigned int index) {
+/* The span includes holes for commands that haven't arrived yet */
+unsigned int P_GetCommandSpan(int playernum) {
+  if (!playeringame[playernum]) {
+    return 0;
+  }
+
+  return players[playernum].cmdq.span;
+}
+
+/* Returns NULL for holes */
+netticcmd_t* P_GetCommand(int playernum, unsigned int position) {
+  command_queue_t *cmdq = &players[playernum].cmdq;
+  uint32_t command_index;
+
   if (!playeringame[playernum]) {
     return NULL;
   }
 
-  if (index >= P_GetCommandCount(playernum)) {
+  if (position >= cmdq->span) {
     return NULL;
   }
 
-  return g_ptr_array_index(players[playernum].cmdq.commands, index);
+  command_index = cmdq->first_index + position;
+
+  if (!bitmap_get_bit(cmdq->occupied, command_slot(command_index))) {
+    return NULL;
+  }
+
+  return &cmdq->commands[command_slot(command_index)];
 }
 
-void P_InsertCommandSorted(int playernum, netticcmd_t *tmp_ncmd) {
-  unsigned int current_command_count;
-  bool found_command = false;
+netticcmd_t* P_GetCommandByIndex(int playernum, uint32_t command_index) {
+  command_queue_t *cmdq = &players[playernum].cmdq;
 
   if (!playeringame[playernum]) {
-    return;
+    return NULL;
   }
 
-  current_command_count = P_GetCommandCount(playernum);
-
-  for (unsigned int j = 0; j < current_command_count; j++) {
-    netticcmd_t *ncmd = P_GetCommand(playernum, j);
+  if (!command_queue_has(cmdq, command_index)) {
+    return NULL;
+  }
 
-    if (ncmd->index != tmp_ncmd->index) {
-      continue;
-    }
+  return &cmdq->commands[command_slot(command_index)];
+}
 
-    found_command = true;
-
-    if (ncmd->tic     != tmp_ncmd->tic     ||
-        ncmd->forward != tmp_ncmd->forward ||
-        ncmd->side    != tmp_ncmd->side    ||
-        ncmd->angle   != tmp_ncmd->angle   ||
-        ncmd->buttons != tmp_ncmd->buttons) {
-      D_Msg(MSG_SYNC,
-        "P_UnArchivePlayer(%d): command mismatch: "
-        "{%d, %d, %d, %d, %d, %d, %u} != {%d, %d, %d, %d, %d, %d, %u}\n",
-        playernum,
-        ncmd->index,
-        ncmd->tic,
-        ncmd->server_tic,
-        ncmd->forward,
-        ncmd->side,
-        ncmd->angle,
-        ncmd->buttons,
-        tmp_ncmd->index,
-        tmp_ncmd->tic,
-        tmp_ncmd->server_tic,
-        tmp_ncmd->forward,
-        tmp_ncmd->side,
-        tmp_ncmd->angle,
-        tmp_ncmd->buttons
-      );
-    }
+void P_InsertCommandSorted(int playernum, netticcmd_t *tmp_ncmd) {
+  netticcmd_t *ncmd;
 
-    ncmd->server_tic = tmp_ncmd->server_tic;
+  if (!playeringame[playernum]) {
+    return;
   }
 
-  if (!found_command) {
+  ncmd = P_GetCommandByIndex(playernum, tmp_ncmd->index);
+
+  if (!ncmd) {
     P_AppendNewCommand(playernum, tmp_ncmd);
-    g_ptr_array_sort(players[playernum].cmdq.commands, compare_commands);
+    return;
   }
+
+  if (ncmd->tic     != tmp_ncmd->tic     ||
+      ncmd->forward != tmp_ncmd->forward ||
+      ncmd->side    != tmp_ncmd->side    ||
+      ncmd->angle   != tmp_ncmd->angle   ||
+      ncmd->buttons != tmp_ncmd->buttons) {
+    D_Msg(MSG_SYNC,
+      "P_UnArchivePlayer(%d): command mismatch: "
+      "{%d, %d, %d, %d, %d, %d, %u} != {%d, %d, %d, %d, %d, %d, %u}\n",
+      playernum,
+      ncmd->index,
+      ncmd->tic,
+      ncmd->server_tic,
+      ncmd->forward,
+      ncmd->side,
+      ncmd->angle,
+      ncmd->buttons,
+      tmp_ncmd->index,
+      tmp_ncmd->tic,
+      tmp_ncmd->server_tic,
+      tmp_ncmd->forward,
+      tmp_ncmd->side,
+      tmp_ncmd->angle,
+      tmp_ncmd->buttons
+    );
+  }
+
+  ncmd->server_tic = tmp_ncmd->server_tic;
 }
 
 void P_QueuePlayerCommand(int playernum, netticcmd_t *ncmd) {
-  GPtrArray *commands = players[playernum].cmdq.commands;
-  netticcmd_t *new_ncmd = get_new_blank_command();
+  netticcmd_t *stored_ncmd;
 
   D_Msg(MSG_SYNC, "(%d) (%d) Queueing %d/%d/%d\n",
     gametic,
@@ -564,39 +630,24 @@ void P_QueuePlayerCommand(int playernum, netticcmd_t *ncmd) {
     ncmd->server_tic
   );
 
-  memcpy(new_ncmd, ncmd, sizeof(netticcmd_t));
+  stored_ncmd = P_GetCommandByIndex(playernum, ncmd->index);
 
-  for (size_t i = 0; i < commands->len; i++) {
-    netticcmd_t *stored_ncmd = (netticcmd_t *)g_ptr_array_index(commands, i);
-
-    if (stored_ncmd->index == ncmd->index) {
-      if ((stored_ncmd->server_tic == 0) && (ncmd->server_tic != 0)) {
-        stored_ncmd->server_tic = ncmd->server_tic;
-      }
-      return;
-    }
-
-    if (stored_ncmd->index > ncmd->index) {
-      g_ptr_array_insert(commands, i, new_ncmd);
-      return;
+  if (stored_ncmd) {
+    if ((stored_ncmd->server_tic == 0) && (ncmd->server_tic != 0)) {
+      stored_ncmd->server_tic = ncmd->server_tic;
     }
+    return;
   }
 
-  g_ptr_array_add(commands, new_ncmd);
+  P_AppendNewCommand(playernum, ncmd);
 }
 
 void P_AppendNewCommand(int playernum, netticcmd_t *tmp_ncmd) {
-  netticcmd_t *ncmd;
-
   if (!playeringame[playernum]) {
     return;
   }
 
-  ncmd = get_new_blank_command();
-
-  memcpy(ncmd, tmp_ncmd, sizeof(netticcmd_t));
-
-  g_ptr_array_add(players[playernum].cmdq.commands, ncmd);
+  command_queue_insert(playernum, get_command_queue(playernum), tmp_ncmd);
 }
 
 netticcmd_t* P_GetEarliestCommand(int playernum) {
@@ -612,7 +663,7 @@ netticcmd_t* P_GetLatestCommand(int playernum) {
     return NULL;
   }
 
-  return P_GetCommand(playernum, P_GetCommandCount(playernum) - 1);
+  return P_GetCommand(playernum, P_GetCommandSpan(playernum) - 1);
 }
 
 int P_GetEarliestCommandIndex(int playernum) {
@@ -636,13 +687,12 @@ unsigned int P_GetLatestCommandIndex(int playernum) {
 }
 
 unsigned int P_GetLatestServerRunCommandIndex(int playernum) {
-  GPtrArray *commands = players[playernum].cmdq.commands;
+  unsigned int span = P_GetCommandSpan(playernum);
 
-  for (unsigned int i = 0; i < commands->len; i++) {
-    netticcmd_t *ncmd =
-      (netticcmd_t *)g_ptr_array_index(commands, commands->len - (1 + i));
+  for (unsigned int i = 0; i < span; i++) {
+    netticcmd_t *ncmd = P_GetCommand(playernum, span - (1 + i));
 
-    if (ncmd->server_tic) {
+    if (ncmd && ncmd->server_tic) {
       return ncmd->index;
     }
   }
@@ -652,29 +702,30 @@ unsigned int P_GetLatestServerRunCommandIndex(int playernum) {
 
 void P_UpdateCommandServerTic(int playernum, uint32_t command_index,
                                              uint32_t server_tic) {
-  GPtrArray *commands = players[playernum].cmdq.commands;
+  netticcmd_t *ncmd = P_GetCommandByIndex(playernum, command_index);
 
-  for (unsigned int i = 0; i < commands->len; i++) {
-    netticcmd_t *ncmd = (netticcmd_t *)g_ptr_array_index(commands, i);
-
-    if (ncmd->index == command_index) {
-      ncmd->server_tic = server_tic;
-      D_Msg(MSG_SYNC, "(%5d) Server ran %u at %u\n",
-        gametic, ncmd->index, ncmd->server_tic
-      );
-      break;
-    }
+  if (ncmd) {
+    ncmd->server_tic = server_tic;
+    D_Msg(MSG_SYNC, "(%5d) Server ran %u at %u\n",
+      gametic, ncmd->index, ncmd->server_tic
+    );
   }
 }
 
 void P_ForEachCommand(int playernum, GFunc func, gpointer user_data) {
-  if (playeringame[playernum]) {
-    g_ptr_array_foreach(players[playernum].cmdq.commands, func, user_data);
+  unsigned int span = P_GetCommandSpan(playernum);
+
+  for (unsigned int i = 0; i < span; i++) {
+    netticcmd_t *ncmd = P_GetCommand(playernum, i);
+
+    if (ncmd) {
+      func(ncmd, user_data);
+    }
   }
 }
 
 void P_ClearPlayerCommands(int playernum) {
-  unsigned int command_count;
+  command_queue_t *cmdq = &players[playernum].cmdq;
 
   if (!playeringame[playernum]) {
     return;
@@ -684,13 +735,10 @@ void P_ClearPlayerCommands(int playernum) {
     "P_ClearPlayerCommands: Clearing commands for %d\n", playernum
   );
 
-  command_count = P_GetCommandCount(playernum);
-
-  if (command_count > 0) {
-    g_ptr_array_remove_range(
-      players[playernum].cmdq.commands, 0, command_count
-    );
-  }
+  cmdq->first_index = 0;
+  cmdq->span = 0;
+  cmdq->count = 0;
+  memset(cmdq->occupied, 0, sizeof(cmdq->occupied));
 }
 
 void P_ResetPlayerCommands(int playernum) {
@@ -718,31 +766,26 @@ void P_IgnorePlayerCommands(int playernum) {
   P_ForEachCommand(playernum, ignore_command, NULL);
 }
 
+/* Commands run in index order, so stop at the first one to keep */
 void P_TrimCommands(int playernum, TrimFunc should_trim, gpointer user_data) {
-  GPtrArray *commands;
-  uint32_t command_count = 0;
-  uint32_t i = 0;
+  command_queue_t *cmdq = &players[playernum].cmdq;
 
   if (!playeringame[playernum]) {
     return;
   }
 
-  commands = players[playernum].cmdq.commands;
-  command_count = commands->len;
+  while (cmdq->count > 0) {
+    netticcmd_t *ncmd = &cmdq->commands[command_slot(cmdq->first_index)];
 
-  while (i < commands->len) {
-    netticcmd_t *ncmd = g_ptr_array_index(commands, i);
+    if (!should_trim(ncmd, user_data)) {
+      break;
+    }
 
-    if (should_trim(ncmd, user_data)) {
-      D_Msg(MSG_SYNC, "(%d) Removing command %d/%d/%d\n",
-        gametic, ncmd->index, ncmd->tic, ncmd->server_tic
-      );
+    D_Msg(MSG_SYNC, "(%d) Removing command %d/%d/%d\n",
+      gametic, ncmd->index, ncmd->tic, ncmd->server_tic
+    );
 
-      g_ptr_array_remove_index(commands, i);
-    }
-    else {
-      i++;
-    }
+    command_queue_pop(cmdq);
   }
 }
 
@@ -754,16 +797,22 @@ void P_BuildCommand(void) {
     return;
   }
 
-  memset(&cmd, 0, sizeof(ticcmd_t));
-  G_BuildTiccmd(&cmd);
-
   ncmd.index      = CL_GetNextCommandIndex();
   ncmd.tic        = gametic;
   ncmd.server_tic = 0;
-  ncmd.forward    = cmd.forwardmove;
-  ncmd.side       = cmd.sidemove;
-  ncmd.angle      = cmd.angleturn;
-  ncmd.buttons    = cmd.buttons;
+
+  if (N_BenchClient()) {
+    N_BenchBuildCommand(&ncmd);
+  }
+  else {
+    memset(&cmd, 0, sizeof(ticcmd_t));
+    G_BuildTiccmd(&cmd);
+
+    ncmd.forward    = cmd.forwardmove;
+    ncmd.side       = cmd.sidemove;
+    ncmd.angle      = cmd.angleturn;
+    ncmd.buttons    = cmd.buttons;
+  }
 
   P_AppendNewCommand(consoleplayer, &ncmd);
 
@@ -795,14 +844,6 @@ bool P_RunPlayerCommands(int playernum) {
 #endif
   }
 
-  if (CLIENT) {
-    for (unsigned int i = 0; i < MAXPLAYERS; i++) {
-      if (!playeringame[i]) {
-        continue;
-      }
-    }
-  }
-
   run_queued_player_commands(playernum);
 
   return player->playerstate != PST_DEAD;
@@ -820,7 +861,7 @@ void P_PrintCommands(int playernum) {
     gametic,
     playernum,
     server->command_indices[playernum],
-    players[playernum].cmdq.commands->len
+    players[playernum].cmdq.count
   );
   P_ForEachCommand(playernum, log_command, NULL);
   D_Msg(MSG_CMD, " }\n");
@@ -33,6 +33,7 @@
 #include "r_defs.h"
 #include "r_main.h"
 #include "r_state.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "g_game.h"
 #include "d_net.h"
@@ -670,6 +671,7 @@ void P_SpawnDoorCloseIn30(sector_t *sec) {
 
   sec->ceilingdata = door; //jff 2/22/98
   sec->special = 0;
+  P_MarkChanged(sec);
 
   door->thinker.function = T_VerticalDoor;
   door->sector = sec;
@@ -699,6 +701,7 @@ void P_SpawnDoorRaiseIn5Mins(sector_t *sec, int secnum) {
 
   sec->ceilingdata = door; //jff 2/22/98
   sec->special = 0;
+  P_MarkChanged(sec);
 
   door->thinker.function = T_VerticalDoor;
   door->sector = sec;
@@ -29,6 +29,7 @@
 #include "r_main.h"
 #include "r_state.h"
 #include "p_map.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "p_spec.h"
 #include "p_tick.h"
@@ -81,6 +82,8 @@ result_e T_MovePlane(sector_t *sector, fixed_t speed, fixed_t dest, int crush,
   }
 #endif
 
+  P_MarkChanged(sector);
+
   switch(floorOrCeiling) {
     case 0:
       // Moving a floor
@@ -580,6 +583,7 @@ manual_floor://e6y
         sec->special = line->frontsector->special;
         //jff 3/14/98 transfer both old and new special
         sec->oldspecial = line->frontsector->oldspecial;
+        P_MarkChanged(sec);
         break;
 
       case raiseToTexture:
@@ -691,6 +695,7 @@ int EV_DoChange
         sec->floorpic = line->frontsector->floorpic;
         sec->special = line->frontsector->special;
         sec->oldspecial = line->frontsector->oldspecial;
+        P_MarkChanged(sec);
         break;
       case numChangeOnly:
         secm = P_FindModelFloorSector(sec->floorheight,secnum);
@@ -699,6 +704,7 @@ int EV_DoChange
           sec->floorpic = secm->floorpic;
           sec->special = secm->special;
           sec->oldspecial = secm->oldspecial;
+          P_MarkChanged(sec);
         }
         break;
       default:
@@ -35,6 +35,7 @@
 #include "n_main.h"
 #include "p_enemy.h"
 #include "p_inter.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "p_mobj.h"
 #include "p_tick.h"
@@ -833,6 +834,8 @@ void P_DamageMobj(mobj_t *target,mobj_t *inflictor, mobj_t *source, int damage)
   if (target->health <= 0)
     return;
 
+  P_MarkChanged(target);
+
   if (target->flags & MF_SKULLFLY)
     target->momx = target->momy = target->momz = 0;
 
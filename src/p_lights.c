@@ -27,6 +27,7 @@
 #include "doomstat.h" //jff 5/18/98
 #include "m_random.h"
 #include "r_main.h"
+#include "p_saveg.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "r_defs.h"
@@ -61,6 +62,8 @@ void T_FireFlicker (fireflicker_t* flick)
   else
     flick->sector->lightlevel = flick->maxlight - amount;
 
+  P_MarkChanged(flick->sector);
+
   flick->count = 4;
 }
 
@@ -88,6 +91,8 @@ void T_LightFlash (lightflash_t* flash)
     flash->count = (P_Random(pr_lights)&flash->maxtime)+1;
   }
 
+  P_MarkChanged(flash->sector);
+
 }
 
 //
@@ -113,6 +118,8 @@ void T_StrobeFlash (strobe_t*   flash)
     flash-> sector->lightlevel = flash->minlight;
     flash->count =flash->darktime;
   }
+
+  P_MarkChanged(flash->sector);
 }
 
 //
@@ -126,6 +133,8 @@ void T_StrobeFlash (strobe_t*   flash)
 
 void T_Glow(glow_t* g)
 {
+  P_MarkChanged(g->sector);
+
   switch(g->direction)
   {
     case -1:
@@ -174,6 +183,7 @@ void P_SpawnFireFlicker (sector_t*  sector)
   // Note that we are resetting sector attributes.
   // Nothing special about it during gameplay.
   sector->special &= ~31; //jff 3/14/98 clear non-generalized sector type
+  P_MarkChanged(sector);
 
   flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
 
@@ -201,6 +211,7 @@ void P_SpawnLightFlash (sector_t* sector)
 
   // nothing special about it during gameplay
   sector->special &= ~31; //jff 3/14/98 clear non-generalized sector type
+  P_MarkChanged(sector);
 
   flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
 
@@ -251,6 +262,7 @@ void P_SpawnStrobeFlash
 
   // nothing special about it during gameplay
   sector->special &= ~31; //jff 3/14/98 clear non-generalized sector type
+  P_MarkChanged(sector);
 
   if (!inSync)
     flash->count = (P_Random(pr_lights)&7)+1;
@@ -282,6 +294,7 @@ void P_SpawnGlowingLight(sector_t*  sector)
   g->direction = -1;
 
   sector->special &= ~31; //jff 3/14/98 clear non-generalized sector type
+  P_MarkChanged(sector);
 }
 
 //////////////////////////////////////////////////////////
@@ -346,6 +359,7 @@ int EV_TurnTagLightsOff(line_t* line)
       tsec->lightlevel < min)
     min = tsec->lightlevel;
       sector->lightlevel = min;
+      P_MarkChanged(sector);
     }
   return 1;
 }
@@ -382,6 +396,7 @@ int EV_LightTurnOn(line_t *line, int bright)
       tbright = temp->lightlevel;
 
       sector->lightlevel = tbright;
+      P_MarkChanged(sector);
 
       //jff 5/17/98 unless compatibility optioned
       //then maximum near ANY tagged sector
@@ -430,6 +445,7 @@ int EV_LightTurnOnPartway(line_t *line, fixed_t level)
 
       sector->lightlevel =   // Set level in-between extremes
   (level * bright + (FRACUNIT-level) * min) >> FRACBITS;
+      P_MarkChanged(sector);
     }
   return 1;
 }
@@ -32,6 +32,7 @@
 #include "m_argv.h"
 #include "m_bbox.h"
 #include "m_random.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "p_mobj.h"
 #include "p_inter.h"
@@ -1175,6 +1176,8 @@ bool P_ThingHeightClip (mobj_t* thing)
 
   onfloor = (thing->z == thing->floorz);
 
+  P_MarkChanged(thing);
+
   P_CheckPosition (thing, thing->x, thing->y);
 
   /* what about stranding a monster partially off an edge?
@@ -32,6 +32,7 @@
 #include "m_bbox.h"
 #include "r_defs.h"
 #include "p_maputl.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "p_mobj.h"
 #include "r_main.h"
@@ -278,6 +279,8 @@ void P_UnsetThingPosition(mobj_t *thing) {
 void P_SetThingPosition(mobj_t *thing) { // link into subsector
   subsector_t *ss = thing->subsector = R_PointInSubsector(thing->x, thing->y);
 
+  P_MarkChanged(thing);
+
   // invisible things don't go into the sector links
 
   // killough 8/11/98: simpler scheme using pointer-to-pointer prev pointers,
@@ -40,6 +40,7 @@
 #include "p_inter.h"
 #include "p_map.h"
 #include "p_maputl.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "p_mobj.h"
 #include "p_tick.h"
@@ -86,6 +87,8 @@ bool P_SetMobjState(mobj_t *mobj, statenum_t state) {
   if (recursion++)                            // if recursion detected,
     memset(seenstate = tempstate, 0, sizeof(tempstate)); // clear state table
 
+  P_MarkChanged(mobj);
+
   do {
     if (state == S_NULL) {
       mobj->state = (state_t *)S_NULL;
@@ -798,6 +801,11 @@ void P_MobjThinker(mobj_t* mobj) {
   }
   else if (!(mobj->momx | mobj->momy) && !sentient(mobj)) {
     // non-sentient objects at rest
+    if (!(mobj->intflags & MIF_ARMED) || mobj->gear ||
+        (mobj->intflags & MIF_FALLING)) {
+      P_MarkChanged(mobj);
+    }
+
     mobj->intflags |= MIF_ARMED;     // arm a mine which has come to rest
 
     // killough 9/12/98: objects fall off ledges if they are hanging off
@@ -808,6 +816,7 @@ void P_MobjThinker(mobj_t* mobj) {
     if (mobj->z > mobj->dropoffz &&
         !(mobj->flags & MF_NOGRAVITY) &&
         !comp[comp_falloff]) {
+      P_MarkChanged(mobj);
       P_ApplyTorque(mobj);
     }
     else { // Reset torque
@@ -346,6 +346,12 @@ typedef struct mobj_s {
 
     int iden_nums;		// hi word stores thing num, low word identifier num
 
+    // Archive generation this actor last changed in (see P_MarkChanged)
+    unsigned int        changed_gen;
+
+    // Set when the actor is relevant to the state being archived
+    unsigned int        relevance_mark;
+
     fixed_t             pad; // cph - needed so I can get the size unambiguously on amd64
 
     // SEE WARNING ABOVE ABOUT POINTER FIELDS!!!
@@ -27,6 +27,7 @@
 #include "doomstat.h"
 #include "m_random.h"
 #include "r_main.h"
+#include "p_saveg.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "r_defs.h"
@@ -237,6 +238,7 @@ manual_plat://e6y
       case raiseToNearestAndChange:
         plat->speed = PLATSPEED/2;
         sec->floorpic = sides[line->sidenum[0]].sector->floorpic;
+        P_MarkChanged(sec);
         plat->high = P_FindNextHighestFloor(sec,sec->floorheight);
         plat->wait = 0;
         plat->status = up;
@@ -250,6 +252,7 @@ manual_plat://e6y
       case raiseAndChange:
         plat->speed = PLATSPEED/2;
         sec->floorpic = sides[line->sidenum[0]].sector->floorpic;
+        P_MarkChanged(sec);
         plat->high = sec->floorheight + amount*FRACUNIT;
         plat->wait = 0;
         plat->status = up;
@@ -292,7 +292,7 @@ static void P_FireWeapon(player_t *player) {
     return;
 
   if (SERVER) {
-    unlagged_activated = SV_UnlagStart();
+    unlagged_activated = SV_UnlagStart(player - players);
   }
 
   P_SetMobjState(player->mo, S_PLAY_ATK1);
@@ -0,0 +1,798 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "d_main.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_file.h"
+#include "m_hash.h"
+#include "md5.h"
+#include "p_setup.h"
+#include "p_reject.h"
+#include "r_defs.h"
+#include "r_state.h"
+#include "w_wad.h"
+
+/*
+ * Builds a REJECT table for maps that ship an empty one.  Sectors see each
+ * other through the two-sided lines joining them (portals), like Quake's vis,
+ * and everything errs towards "visible": heights and walls inside sectors
+ * are ignored, portals are widened slightly, and portals that take too long
+ * see everything they might.  Demos keep the map's own table; netgame clients
+ * build one when the server does, and check theirs against its hash.
+ */
+
+#define REJECT_CACHE_VERSION 1
+#define REJECT_CACHE_FOLDER "reject_cache"
+
+#define REJECT_EPSILON     (1.0 / 16.0)
+#define REJECT_PORTAL_SLOP 1.0
+#define REJECT_MAX_DEPTH   256
+#define REJECT_MAX_STEPS   (1 << 16)
+
+/* Past this, portals aren't pre-flooded and only the step limit applies */
+#define REJECT_MAX_MIGHTSEE_SIZE (256 * 1024 * 1024)
+
+static bool     reject_build_set = false;
+static bool     reject_build = false;
+static uint64_t reject_hash = 0;
+static bool     reject_hash_expected = false;
+static uint64_t expected_reject_hash = 0;
+
+typedef struct reject_seg_s {
+  double x1, y1, x2, y2;
+} reject_seg_t;
+
+typedef struct reject_plane_s {
+  double nx, ny, d;
+} reject_plane_t;
+
+typedef struct reject_portal_s {
+  reject_seg_t   seg;
+  reject_plane_t plane;
+  int            line;
+  int            to;
+} reject_portal_t;
+
+/* The widest part of a portal explored from the current source portal */
+typedef struct reject_window_s {
+  unsigned int generation;
+  double       t1;
+  double       t2;
+} reject_window_t;
+
+struct reject_worker_s;
+
+typedef void (*reject_job_f)(struct reject_worker_s *worker, int index);
+
+typedef struct reject_build_s {
+  reject_portal_t *portals;
+  int              portal_count;
+  int             *sector_portals;
+  int             *components;
+  size_t           row_size;
+  unsigned char   *mightsee;
+  unsigned char   *visible;
+  reject_job_f     job;
+  gint             next_job;
+  int              job_count;
+} reject_build_t;
+
+typedef struct reject_worker_s {
+  reject_build_t  *build;
+  unsigned char   *row;
+  unsigned char   *portals_seen;
+  int             *portal_stack;
+  reject_window_t *windows;
+  unsigned int     generation;
+  unsigned int     steps;
+  bool             overflowed;
+} reject_worker_t;
+
+static inline void row_set(unsigned char *row, int sector) {
+  row[sector >> 3] |= 1 << (sector & 7);
+}
+
+static inline bool row_get(const unsigned char *row, int sector) {
+  return (row[sector >> 3] & (1 << (sector & 7))) != 0;
+}
+
+static inline double plane_side(const reject_plane_t *plane, double x,
+                                                             double y) {
+  return (plane->nx * x) + (plane->ny * y) - plane->d;
+}
+
+/* Keeps the part of seg on plane's front side; false if nothing's left */
+static bool clip_seg(reject_seg_t *seg, const reject_plane_t *plane) {
+  double s1 = plane_side(plane, seg->x1, seg->y1);
+  double s2 = plane_side(plane, seg->x2, seg->y2);
+  double frac;
+
+  if (s1 >= -REJECT_EPSILON && s2 >= -REJECT_EPSILON)
+    return true;
+
+  if (s1 < -REJECT_EPSILON && s2 < -REJECT_EPSILON)
+    return false;
+
+  frac = s1 / (s1 - s2);
+
+  if (s1 < 0) {
+    seg->x1 += (seg->x2 - seg->x1) * frac;
+    seg->y1 += (seg->y2 - seg->y1) * frac;
+  }
+  else {
+    seg->x2 = seg->x1 + (seg->x2 - seg->x1) * frac;
+    seg->y2 = seg->y1 + (seg->y2 - seg->y1) * frac;
+  }
+
+  return true;
+}
+
+/*
+ * A line through an endpoint of source and an endpoint of pass that has
+ * the rest of source on one side and the rest of pass on the other bounds
+ * everything visible through both; the visible side is pass's side.
+ */
+static bool clip_to_separators(reject_seg_t *target,
+                               const reject_seg_t *source,
+                               const reject_seg_t *pass) {
+  const double sx[2] = { source->x1, source->x2 };
+  const double sy[2] = { source->y1, source->y2 };
+  const double px[2] = { pass->x1, pass->x2 };
+  const double py[2] = { pass->y1, pass->y2 };
+
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++) {
+      reject_plane_t separator;
+      double length;
+      double source_side;
+      double pass_side;
+
+      separator.nx = -(py[j] - sy[i]);
+      separator.ny = px[j] - sx[i];
+      length = sqrt(
+        (separator.nx * separator.nx) + (separator.ny * separator.ny)
+      );
+
+      if (length < REJECT_EPSILON)
+        continue;
+
+      separator.nx /= length;
+      separator.ny /= length;
+      separator.d = (separator.nx * sx[i]) + (separator.ny * sy[i]);
+
+      source_side = plane_side(&separator, sx[!i], sy[!i]);
+      pass_side = plane_side(&separator, px[!j], py[!j]);
+
+      if (source_side > REJECT_EPSILON && pass_side < -REJECT_EPSILON) {
+        separator.nx = -separator.nx;
+        separator.ny = -separator.ny;
+        separator.d = -separator.d;
+      }
+      else if (!(source_side < -REJECT_EPSILON &&
+                 pass_side > REJECT_EPSILON)) {
+        continue;
+      }
+
+      if (!clip_seg(target, &separator))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+static void add_portal(reject_build_t *build, line_t *line, sector_t *from,
+                                                            sector_t *to) {
+  reject_portal_t *portal = &build->portals[build->portal_count++];
+  double x1 = line->v1->x / (double)FRACUNIT;
+  double y1 = line->v1->y / (double)FRACUNIT;
+  double x2 = line->v2->x / (double)FRACUNIT;
+  double y2 = line->v2->y / (double)FRACUNIT;
+  double dx = x2 - x1;
+  double dy = y2 - y1;
+  double length = sqrt((dx * dx) + (dy * dy));
+
+  dx /= length;
+  dy /= length;
+
+  portal->seg.x1 = x1 - (dx * REJECT_PORTAL_SLOP);
+  portal->seg.y1 = y1 - (dy * REJECT_PORTAL_SLOP);
+  portal->seg.x2 = x2 + (dx * REJECT_PORTAL_SLOP);
+  portal->seg.y2 = y2 + (dy * REJECT_PORTAL_SLOP);
+
+  /* A line's front side is on its right, so its back is on the left */
+  if (from == line->frontsector) {
+    portal->plane.nx = -dy;
+    portal->plane.ny = dx;
+  }
+  else {
+    portal->plane.nx = dy;
+    portal->plane.ny = -dx;
+  }
+
+  portal->plane.d = (portal->plane.nx * x1) + (portal->plane.ny * y1);
+  portal->line = line - lines;
+  portal->to = to - sectors;
+}
+
+static int find_component(int *components, int sector) {
+  while (components[sector] != sector) {
+    components[sector] = components[components[sector]];
+    sector = components[sector];
+  }
+
+  return sector;
+}
+
+static bool is_portal(const line_t *line) {
+  return (line->flags & ML_TWOSIDED) &&
+         line->frontsector &&
+         line->backsector &&
+         (line->dx || line->dy);
+}
+
+/* sector_portals[s] .. sector_portals[s + 1] are sector s's portals */
+static void build_portals(reject_build_t *build) {
+  int *counts = calloc(numsectors + 1, sizeof(int));
+
+  build->portals = malloc(numlines * 2 * sizeof(reject_portal_t));
+  build->sector_portals = malloc((numsectors + 1) * sizeof(int));
+  build->components = malloc(numsectors * sizeof(int));
+
+  if ((!counts) ||
+      (!build->portals) ||
+      (!build->sector_portals) ||
+      (!build->components)) {
+    I_Error("build_portals: Error allocating portals");
+  }
+
+  build->portal_count = 0;
+
+  for (int i = 0; i < numsectors; i++)
+    build->components[i] = i;
+
+  for (int i = 0; i < numlines; i++) {
+    line_t *line = &lines[i];
+
+    if (!is_portal(line))
+      continue;
+
+    counts[line->frontsector - sectors]++;
+    counts[line->backsector - sectors]++;
+
+    build->components[find_component(
+      build->components, line->frontsector - sectors
+    )] = find_component(build->components, line->backsector - sectors);
+  }
+
+  build->sector_portals[0] = 0;
+
+  for (int i = 0; i < numsectors; i++) {
+    build->sector_portals[i + 1] = build->sector_portals[i] + counts[i];
+    counts[i] = build->sector_portals[i];
+  }
+
+  for (int i = 0; i < numlines; i++) {
+    line_t *line = &lines[i];
+
+    if (!is_portal(line))
+      continue;
+
+    build->portal_count = counts[line->frontsector - sectors]++;
+    add_portal(build, line, line->frontsector, line->backsector);
+
+    build->portal_count = counts[line->backsector - sectors]++;
+    add_portal(build, line, line->backsector, line->frontsector);
+  }
+
+  build->portal_count = build->sector_portals[numsectors];
+
+  for (int i = 0; i < numsectors; i++)
+    build->components[i] = find_component(build->components, i);
+
+  free(counts);
+}
+
+/* Everything a portal could possibly lead to, to cut chains short */
+static void flood_mightsee(reject_worker_t *worker, int index) {
+  reject_build_t *build = worker->build;
+  const reject_portal_t *portal = &build->portals[index];
+  unsigned char *row = build->mightsee + (index * build->row_size);
+  int stack_size = 0;
+
+  row_set(row, portal->to);
+
+  worker->portal_stack[stack_size++] = index;
+  worker->portals_seen[index] = 1;
+
+  while (stack_size > 0) {
+    int sector = build->portals[worker->portal_stack[--stack_size]].to;
+
+    for (int i = build->sector_portals[sector];
+             i < build->sector_portals[sector + 1];
+             i++) {
+      const reject_portal_t *next = &build->portals[i];
+      reject_seg_t seg = next->seg;
+      reject_seg_t back = portal->seg;
+      reject_plane_t behind_next = {
+        -next->plane.nx, -next->plane.ny, -next->plane.d
+      };
+
+      if (worker->portals_seen[i])
+        continue;
+
+      if (next->line == portal->line)
+        continue;
+
+      if (!clip_seg(&seg, &portal->plane))
+        continue;
+
+      if (!clip_seg(&back, &behind_next))
+        continue;
+
+      worker->portals_seen[i] = 1;
+      worker->portal_stack[stack_size++] = i;
+      row_set(row, next->to);
+    }
+  }
+
+  memset(worker->portals_seen, 0, build->portal_count);
+}
+
+static bool adds_visibility(reject_worker_t *worker, int portal) {
+  reject_build_t *build = worker->build;
+  const unsigned char *mightsee;
+
+  if (!build->mightsee)
+    return true;
+
+  mightsee = build->mightsee + (portal * build->row_size);
+
+  for (size_t i = 0; i < build->row_size; i++) {
+    if (mightsee[i] & ~worker->row[i])
+      return true;
+  }
+
+  return false;
+}
+
+/* No need to go through a portal again unless more of it's visible */
+static bool explored(reject_worker_t *worker, int portal,
+                                              const reject_seg_t *seg) {
+  const reject_seg_t *full = &worker->build->portals[portal].seg;
+  reject_window_t *window = &worker->windows[portal];
+  double dx = full->x2 - full->x1;
+  double dy = full->y2 - full->y1;
+  double length = (dx * dx) + (dy * dy);
+  double t1 = (((seg->x1 - full->x1) * dx) + ((seg->y1 - full->y1) * dy)) /
+              length;
+  double t2 = (((seg->x2 - full->x1) * dx) + ((seg->y2 - full->y1) * dy)) /
+              length;
+
+  if (window->generation == worker->generation) {
+    if (t1 >= window->t1 && t2 <= window->t2)
+      return true;
+
+    if ((t2 - t1) <= (window->t2 - window->t1))
+      return false;
+  }
+
+  window->generation = worker->generation;
+  window->t1 = t1;
+  window->t2 = t2;
+
+  return false;
+}
+
+static void flow(reject_worker_t *worker, const reject_portal_t *source,
+                                          const reject_portal_t *pass,
+                                          const reject_seg_t *pass_seg,
+                                          int depth) {
+  reject_build_t *build = worker->build;
+
+  for (int i = build->sector_portals[pass->to];
+           i < build->sector_portals[pass->to + 1];
+           i++) {
+    const reject_portal_t *portal = &build->portals[i];
+    reject_seg_t seg = portal->seg;
+
+    if (worker->overflowed)
+      return;
+
+    if (portal->line == pass->line || portal->line == source->line)
+      continue;
+
+    if (++worker->steps > REJECT_MAX_STEPS || depth >= REJECT_MAX_DEPTH) {
+      worker->overflowed = true;
+      return;
+    }
+
+    if (!clip_seg(&seg, &source->plane))
+      continue;
+
+    if (!clip_seg(&seg, &pass->plane))
+      continue;
+
+    if (!clip_to_separators(&seg, &source->seg, pass_seg))
+      continue;
+
+    row_set(worker->row, portal->to);
+
+    if (!adds_visibility(worker, i))
+      continue;
+
+    if (explored(worker, i, &seg))
+      continue;
+
+    flow(worker, source, portal, &seg, depth + 1);
+  }
+}
+
+/* Portals that take too long see everything they might */
+static void flow_sector(reject_worker_t *worker, int sector) {
+  reject_build_t *build = worker->build;
+
+  worker->row = build->visible + (sector * build->row_size);
+
+  row_set(worker->row, sector);
+
+  for (int i = build->sector_portals[sector];
+           i < build->sector_portals[sector + 1];
+           i++) {
+    const reject_portal_t *portal = &build->portals[i];
+    const unsigned char *might = NULL;
+
+    worker->steps = 0;
+    worker->overflowed = false;
+    worker->generation++;
+
+    row_set(worker->row, portal->to);
+
+    if (build->mightsee)
+      might = build->mightsee + (i * build->row_size);
+
+    flow(worker, portal, portal, &portal->seg, 1);
+
+    if (!worker->overflowed)
+      continue;
+
+    if (might) {
+      for (size_t j = 0; j < build->row_size; j++)
+        worker->row[j] |= might[j];
+
+      continue;
+    }
+
+    for (int j = 0; j < numsectors; j++) {
+      if (build->components[j] == build->components[sector])
+        row_set(worker->row, j);
+    }
+
+    break;
+  }
+}
+
+static void run_jobs(reject_worker_t *worker) {
+  reject_build_t *build = worker->build;
+
+  while (true) {
+    int i = g_atomic_int_add(&build->next_job, 1);
+
+    if (i >= build->job_count)
+      break;
+
+    build->job(worker, i);
+  }
+}
+
+static gpointer run_worker(gpointer data) {
+  run_jobs((reject_worker_t *)data);
+
+  return NULL;
+}
+
+/* Everything is allocated up front, so workers never touch the zone */
+static void run_parallel(reject_build_t *build, reject_worker_t *workers,
+                                                unsigned int worker_count,
+                                                reject_job_f job,
+                                                int job_count) {
+  GThread **threads = calloc(worker_count, sizeof(GThread *));
+
+  if (!threads)
+    I_Error("run_parallel: Error allocating threads");
+
+  build->job = job;
+  build->job_count = job_count;
+  build->next_job = 0;
+
+  for (unsigned int i = 1; i < worker_count; i++)
+    threads[i] = g_thread_new("reject", run_worker, &workers[i]);
+
+  run_jobs(&workers[0]);
+
+  for (unsigned int i = 1; i < worker_count; i++)
+    g_thread_join(threads[i]);
+
+  free(threads);
+}
+
+static void build_reject(unsigned char *reject) {
+  reject_build_t build;
+  reject_worker_t *workers;
+  unsigned int worker_count = MAX(g_get_num_processors(), 1);
+  size_t mightsee_size;
+
+  memset(&build, 0, sizeof(reject_build_t));
+
+  build_portals(&build);
+
+  build.row_size = (numsectors + 7) / 8;
+  build.visible = calloc(numsectors, build.row_size);
+
+  if (!build.visible)
+    I_Error("build_reject: Error allocating visibility rows");
+
+  mightsee_size = build.portal_count * build.row_size;
+
+  if (mightsee_size <= REJECT_MAX_MIGHTSEE_SIZE)
+    build.mightsee = calloc(MAX(mightsee_size, 1), 1);
+
+  workers = calloc(worker_count, sizeof(reject_worker_t));
+
+  if (!workers)
+    I_Error("build_reject: Error allocating workers");
+
+  for (unsigned int i = 0; i < worker_count; i++) {
+    workers[i].build = &build;
+    workers[i].portals_seen = calloc(MAX(build.portal_count, 1), 1);
+    workers[i].portal_stack = malloc(
+      MAX(build.portal_count, 1) * sizeof(int)
+    );
+    workers[i].windows = calloc(
+      MAX(build.portal_count, 1), sizeof(reject_window_t)
+    );
+
+    if ((!workers[i].portals_seen) ||
+        (!workers[i].portal_stack) ||
+        (!workers[i].windows)) {
+      I_Error("build_reject: Error allocating worker scratch space");
+    }
+  }
+
+  if (build.mightsee) {
+    run_parallel(
+      &build, workers, worker_count, flood_mightsee, build.portal_count
+    );
+  }
+
+  run_parallel(&build, workers, worker_count, flow_sector, numsectors);
+
+  /* Sight is symmetric, so either direction seeing the other counts */
+  memset(reject, 0, (((size_t)numsectors * numsectors) + 7) / 8);
+
+  for (int i = 0; i < numsectors; i++) {
+    const unsigned char *row = build.visible + (i * build.row_size);
+
+    for (int j = 0; j < numsectors; j++) {
+      const unsigned char *column = build.visible + (j * build.row_size);
+      size_t pnum = ((size_t)i * numsectors) + j;
+
+      if (!row_get(row, j) && !row_get(column, i))
+        reject[pnum >> 3] |= 1 << (pnum & 7);
+    }
+  }
+
+  for (unsigned int i = 0; i < worker_count; i++) {
+    free(workers[i].portals_seen);
+    free(workers[i].portal_stack);
+    free(workers[i].windows);
+  }
+
+  free(workers);
+  free(build.mightsee);
+  free(build.visible);
+  free(build.components);
+  free(build.sector_portals);
+  free(build.portals);
+}
+
+static bool reject_is_empty(int rejectlump, size_t required) {
+  const unsigned char *reject;
+  size_t length = W_LumpLength(rejectlump);
+  bool empty = true;
+
+  if (length < required)
+    return true;
+
+  reject = W_CacheLumpNum(rejectlump);
+
+  for (size_t i = 0; i < required; i++) {
+    if (reject[i]) {
+      empty = false;
+      break;
+    }
+  }
+
+  W_UnlockLumpNum(rejectlump);
+
+  return empty;
+}
+
+static char* get_cache_path(int lumpnum) {
+  static const int map_lumps[] = {
+    ML_LINEDEFS, ML_SIDEDEFS, ML_VERTEXES, ML_SECTORS
+  };
+  struct MD5Context md5;
+  unsigned char version = REJECT_CACHE_VERSION;
+  unsigned char digest[16];
+  char name[sizeof(digest) * 2 + sizeof(".rej")];
+  char *folder;
+  char *path;
+
+  MD5Init(&md5);
+  MD5Update(&md5, &version, sizeof(version));
+
+  for (size_t i = 0; i < sizeof(map_lumps) / sizeof(*map_lumps); i++) {
+    int lump = lumpnum + map_lumps[i];
+
+    MD5Update(&md5, W_CacheLumpNum(lump), W_LumpLength(lump));
+    W_UnlockLumpNum(lump);
+  }
+
+  MD5Final(digest, &md5);
+
+  for (size_t i = 0; i < sizeof(digest); i++)
+    sprintf(name + (i * 2), "%02x", digest[i]);
+
+  strcat(name, ".rej");
+
+  folder = M_PathJoin(basesavegame, REJECT_CACHE_FOLDER);
+
+  if (!M_IsFolder(folder) && !M_CreateFolder(folder, 0755)) {
+    D_Msg(MSG_WARN, "P_BuildReject: Error creating %s: %s\n",
+      folder, M_GetFileError()
+    );
+    free(folder);
+    return NULL;
+  }
+
+  path = M_PathJoin(folder, name);
+
+  free(folder);
+
+  return path;
+}
+
+/*
+ * P_BuildReject
+ *
+ * Returns a built (or previously built and cached) REJECT table for the
+ * map at lumpnum, or NULL if -buildreject isn't given, the map's own REJECT
+ * isn't empty, or a demo or netgame needs the original.  The table is
+ * PU_LEVEL.
+ */
+static unsigned char* load_reject(int lumpnum, size_t required) {
+  unsigned char *reject;
+  char *cache_path;
+  char *cached = NULL;
+  size_t cached_size = 0;
+  gint64 start;
+
+  if (!P_RejectBuildEnabled())
+    return NULL;
+
+  if (demo_compatibility || demoplayback || demorecording)
+    return NULL;
+
+  if (!reject_is_empty(lumpnum + ML_REJECT, required))
+    return NULL;
+
+  reject = Z_Malloc(MAX(required, 1), PU_LEVEL, NULL);
+  cache_path = get_cache_path(lumpnum);
+
+  if (cache_path && M_ReadFile(cache_path, &cached, &cached_size)) {
+    if (cached_size == required) {
+      memcpy(reject, cached, required);
+      g_free(cached);
+      free(cache_path);
+      D_Msg(MSG_INFO, "P_BuildReject: Loaded cached REJECT\n");
+      return reject;
+    }
+
+    g_free(cached);
+  }
+
+  start = g_get_monotonic_time();
+
+  build_reject(reject);
+
+  D_Msg(MSG_INFO, "P_BuildReject: Built REJECT for %d sectors in %.1f ms\n",
+    numsectors, (g_get_monotonic_time() - start) / 1000.0
+  );
+
+  if (cache_path) {
+    if (!M_WriteFile(cache_path, (const char *)reject, required)) {
+      D_Msg(MSG_WARN, "P_BuildReject: Error writing %s: %s\n",
+        cache_path, M_GetFileError()
+      );
+    }
+
+    free(cache_path);
+  }
+
+  return reject;
+}
+
+bool P_RejectBuildEnabled(void) {
+  if (!reject_build_set) {
+    reject_build = M_CheckParm("-buildreject") != 0;
+    reject_build_set = true;
+  }
+
+  return reject_build;
+}
+
+/* Clients follow the server, so they use the same tables it does */
+void P_SetRejectBuildEnabled(bool enabled) {
+  reject_build = enabled;
+  reject_build_set = true;
+}
+
+/* 0 when the current map uses its own table */
+uint64_t P_GetRejectHash(void) {
+  return reject_hash;
+}
+
+/* The next table P_BuildReject returns is checked against hash */
+void P_ExpectRejectHash(uint64_t hash) {
+  expected_reject_hash = hash;
+  reject_hash_expected = true;
+}
+
+const unsigned char* P_BuildReject(int lumpnum) {
+  size_t required = (((size_t)numsectors * numsectors) + 7) / 8;
+  unsigned char *reject = load_reject(lumpnum, required);
+
+  reject_hash = reject ? M_HashBytes(reject, required, 0) : 0;
+
+  if (reject_hash_expected) {
+    reject_hash_expected = false;
+
+    if (reject_hash != expected_reject_hash) {
+      D_Msg(MSG_WARN,
+        "P_BuildReject: REJECT doesn't match the server's, sight checks "
+        "may desync\n"
+      );
+    }
+  }
+
+  return reject;
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -29,6 +29,7 @@
 #include "doomstat.h"
 #include "am_map.h"
 #include "g_game.h"
+#include "m_delta.h"
 #include "m_random.h"
 #include "n_main.h"
 #include "g_state.h"
@@ -68,10 +69,20 @@ extern int numspechit;
 #define MAX_PLAYER_MESSAGE_SIZE 256
 #define MAX_COMMAND_COUNT 10000
 
+/* Fields written per record, see M_PBufBeginRecord */
+#define ACTOR_FIELD_COUNT 36
+#define SECTOR_FIELD_COUNT 11
+#define LINE_FIELD_COUNT 21
+
 static uint32_t current_thinker_count = 0;
 
 static GHashTable *delta_compressed_actors = NULL;
 
+unsigned int archive_generation = 1;
+
+/* When set, only actors stamped with this mark are archived */
+static unsigned int archive_relevance_mark = 0;
+
 typedef enum {
   tc_end,
   tc_mobj
@@ -326,6 +337,8 @@ static void serialize_actor_pointers(pbuf_t *savebuffer, mobj_t *mobj) {
   uint64_t     state_index = 0;
   unsigned int player_index = 0;
 
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_ACTOR_POINTERS, mobj->id);
+
   // killough 2/14/98: convert pointers into indices.
   // Fixes many savegame problems, by properly saving
   // target and tracer fields. Note: we store NULL if
@@ -465,50 +478,101 @@ static void deserialize_actor_pointers(pbuf_t *savebuffer, mobj_t *mobj) {
   }
 }
 
+static bool actor_is_archived(mobj_t *mobj) {
+  return !archive_relevance_mark ||
+         mobj->relevance_mark == archive_relevance_mark;
+}
+
 static bool should_delta_compress_actor(mobj_t *mobj) {
   return MULTINET && g_hash_table_contains(
     delta_compressed_actors, GINT_TO_POINTER(mobj->type)
   );
 }
 
+/* Settled actors only change through paths that mark them */
+static bool actor_is_settled(mobj_t *mobj) {
+  if (mobj->player || mobj->tics != -1 || mobj->type == MT_MUSICSOURCE)
+    return false;
+
+  if (mobj->momx || mobj->momy || mobj->momz || mobj->z != mobj->floorz)
+    return false;
+
+  if (mobj->flags & MF_SKULLFLY)
+    return false;
+
+  if (respawnmonsters && (mobj->flags & MF_COUNTKILL))
+    return false;
+
+  return true;
+}
+
 static void serialize_actor(pbuf_t *savebuffer, mobj_t *mobj) {
-  M_PBufWriteInt(savebuffer, mobj->type);
-  M_PBufWriteUInt(savebuffer, mobj->id);
-  M_PBufWriteInt(savebuffer, mobj->index);
-  M_PBufWriteInt(savebuffer, mobj->x);
-  M_PBufWriteInt(savebuffer, mobj->y);
-  M_PBufWriteInt(savebuffer, mobj->z);
-  M_PBufWriteUInt(savebuffer, mobj->angle);
-  M_PBufWriteInt(savebuffer, mobj->tics);
-  M_PBufWriteUInt(savebuffer, mobj->pitch);
-  M_PBufWriteULong(savebuffer, mobj->flags);
+  pbuf_record_t record;
 
-  M_PBufWriteInt(savebuffer, mobj->floorz);
-  M_PBufWriteInt(savebuffer, mobj->ceilingz);
-  M_PBufWriteInt(savebuffer, mobj->dropoffz);
-  M_PBufWriteInt(savebuffer, mobj->momx);
-  M_PBufWriteInt(savebuffer, mobj->momy);
-  M_PBufWriteInt(savebuffer, mobj->momz);
-  M_PBufWriteInt(savebuffer, mobj->validcount);
-  M_PBufWriteInt(savebuffer, mobj->intflags);
-  M_PBufWriteInt(savebuffer, mobj->health);
-  M_PBufWriteShort(savebuffer, mobj->movedir);
-  M_PBufWriteShort(savebuffer, mobj->movecount);
-  M_PBufWriteShort(savebuffer, mobj->strafecount);
-  M_PBufWriteShort(savebuffer, mobj->reactiontime);
-  M_PBufWriteShort(savebuffer, mobj->threshold);
-  M_PBufWriteShort(savebuffer, mobj->pursuecount);
-  M_PBufWriteShort(savebuffer, mobj->gear);
-  M_PBufWriteShort(savebuffer, mobj->lastlook);
-  M_PBufWriteShort(savebuffer, mobj->spawnpoint.x);
-  M_PBufWriteShort(savebuffer, mobj->spawnpoint.y);
-  M_PBufWriteShort(savebuffer, mobj->spawnpoint.angle);
-  M_PBufWriteShort(savebuffer, mobj->spawnpoint.type);
-  M_PBufWriteShort(savebuffer, mobj->spawnpoint.options);
-  M_PBufWriteInt(savebuffer, mobj->friction);
-  M_PBufWriteInt(savebuffer, mobj->movefactor);
-  M_PBufWriteShort(savebuffer, mobj->patch_width);
-  M_PBufWriteInt(savebuffer, mobj->iden_nums);
+  if (!actor_is_settled(mobj)) {
+    /* So the first save after they settle still re-serializes them */
+    mobj->changed_gen = archive_generation + 1;
+  }
+  else if (mobj->changed_gen < archive_generation &&
+           M_DeltaCopyRecord(savebuffer, SAVE_RECORD_ACTOR, mobj->id)) {
+    return;
+  }
+
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_ACTOR, mobj->id);
+  M_PBufBeginRecord(savebuffer, &record, ACTOR_FIELD_COUNT);
+  M_PBufRecordWriteInt(&record, mobj->type);
+  M_PBufRecordWriteUInt(&record, mobj->id);
+  M_PBufRecordWriteInt(&record, mobj->index);
+  M_PBufRecordWriteInt(&record, mobj->x);
+  M_PBufRecordWriteInt(&record, mobj->y);
+  M_PBufRecordWriteInt(&record, mobj->z);
+  M_PBufRecordWriteUInt(&record, mobj->angle);
+  M_PBufRecordWriteInt(&record, mobj->tics);
+  M_PBufRecordWriteUInt(&record, mobj->pitch);
+  M_PBufRecordWriteULong(&record, mobj->flags);
+
+  M_PBufRecordWriteInt(&record, mobj->floorz);
+  M_PBufRecordWriteInt(&record, mobj->ceilingz);
+  M_PBufRecordWriteInt(&record, mobj->dropoffz);
+  M_PBufRecordWriteInt(&record, mobj->momx);
+  M_PBufRecordWriteInt(&record, mobj->momy);
+  M_PBufRecordWriteInt(&record, mobj->momz);
+  M_PBufRecordWriteInt(&record, mobj->validcount);
+  M_PBufRecordWriteInt(&record, mobj->intflags);
+  M_PBufRecordWriteInt(&record, mobj->health);
+  M_PBufRecordWriteShort(&record, mobj->movedir);
+  M_PBufRecordWriteShort(&record, mobj->movecount);
+  M_PBufRecordWriteShort(&record, mobj->strafecount);
+  M_PBufRecordWriteShort(&record, mobj->reactiontime);
+  M_PBufRecordWriteShort(&record, mobj->threshold);
+  M_PBufRecordWriteShort(&record, mobj->pursuecount);
+  M_PBufRecordWriteShort(&record, mobj->gear);
+  M_PBufRecordWriteShort(&record, mobj->lastlook);
+  M_PBufRecordWriteShort(&record, mobj->spawnpoint.x);
+  M_PBufRecordWriteShort(&record, mobj->spawnpoint.y);
+  M_PBufRecordWriteShort(&record, mobj->spawnpoint.angle);
+  M_PBufRecordWriteShort(&record, mobj->spawnpoint.type);
+  M_PBufRecordWriteShort(&record, mobj->spawnpoint.options);
+  M_PBufRecordWriteInt(&record, mobj->friction);
+  M_PBufRecordWriteInt(&record, mobj->movefactor);
+  M_PBufRecordWriteShort(&record, mobj->patch_width);
+  M_PBufRecordWriteInt(&record, mobj->iden_nums);
+  M_PBufEndRecord(&record);
+}
+
+static bool line_changed(line_t *li) {
+  if (li->changed_gen >= archive_generation)
+    return true;
+
+  for (int i = 0; i < 2; i++) {
+    if (li->sidenum[i] == NO_INDEX)
+      continue;
+
+    if (sides[li->sidenum[i]].changed_gen >= archive_generation)
+      return true;
+  }
+
+  return false;
 }
 
 static mobj_t* build_actor(mobjtype_t actor_type) {
@@ -561,55 +625,60 @@ static void insert_actor(mobj_t *mobj) {
 
 static void deserialize_actor(pbuf_t *savebuffer) {
   mobj_t *mobj;
-  mobjtype_t actor_type;
+  pbuf_reader_t reader;
+  int actor_type = NUMMOBJTYPES;
 
-  M_PBufReadInt(savebuffer, (int *)(&actor_type));
+  M_PBufBeginReader(savebuffer, &reader);
+  M_PBufReaderReadInt(&reader, &actor_type);
 
   mobj = build_actor(actor_type);
 
-  M_PBufReadUInt(savebuffer, &mobj->id);
-  M_PBufReadInt(savebuffer, &mobj->index);
-  M_PBufReadInt(savebuffer, &mobj->x);
-  M_PBufReadInt(savebuffer, &mobj->y);
-  M_PBufReadInt(savebuffer, &mobj->z);
-  M_PBufReadUInt(savebuffer, &mobj->angle);
-  M_PBufReadInt(savebuffer, &mobj->tics);
-  M_PBufReadUInt(savebuffer, &mobj->pitch);
-  M_PBufReadULong(savebuffer, &mobj->flags);
+  M_PBufReaderReadUInt(&reader, &mobj->id);
+  M_PBufReaderReadInt(&reader, &mobj->index);
+  M_PBufReaderReadInt(&reader, &mobj->x);
+  M_PBufReaderReadInt(&reader, &mobj->y);
+  M_PBufReaderReadInt(&reader, &mobj->z);
+  M_PBufReaderReadUInt(&reader, &mobj->angle);
+  M_PBufReaderReadInt(&reader, &mobj->tics);
+  M_PBufReaderReadUInt(&reader, &mobj->pitch);
+  M_PBufReaderReadULong(&reader, &mobj->flags);
 
   setup_actor(mobj);
 
-  M_PBufReadInt(savebuffer, &mobj->floorz);
-  M_PBufReadInt(savebuffer, &mobj->ceilingz);
-  M_PBufReadInt(savebuffer, &mobj->dropoffz);
-  M_PBufReadInt(savebuffer, &mobj->momx);
-  M_PBufReadInt(savebuffer, &mobj->momy);
-  M_PBufReadInt(savebuffer, &mobj->momz);
-  M_PBufReadInt(savebuffer, &mobj->validcount);
-  M_PBufReadInt(savebuffer, &mobj->intflags);
-  M_PBufReadInt(savebuffer, &mobj->health);
-  M_PBufReadShort(savebuffer, &mobj->movedir);
-  M_PBufReadShort(savebuffer, &mobj->movecount);
-  M_PBufReadShort(savebuffer, &mobj->strafecount);
-  M_PBufReadShort(savebuffer, &mobj->reactiontime);
-  M_PBufReadShort(savebuffer, &mobj->threshold);
-  M_PBufReadShort(savebuffer, &mobj->pursuecount);
-  M_PBufReadShort(savebuffer, &mobj->gear);
-  M_PBufReadShort(savebuffer, &mobj->lastlook);
-  M_PBufReadShort(savebuffer, &mobj->spawnpoint.x);
-  M_PBufReadShort(savebuffer, &mobj->spawnpoint.y);
-  M_PBufReadShort(savebuffer, &mobj->spawnpoint.angle);
-  M_PBufReadShort(savebuffer, &mobj->spawnpoint.type);
-  M_PBufReadShort(savebuffer, &mobj->spawnpoint.options);
-  M_PBufReadInt(savebuffer, &mobj->friction);
-  M_PBufReadInt(savebuffer, &mobj->movefactor);
+  M_PBufReaderReadInt(&reader, &mobj->floorz);
+  M_PBufReaderReadInt(&reader, &mobj->ceilingz);
+  M_PBufReaderReadInt(&reader, &mobj->dropoffz);
+  M_PBufReaderReadInt(&reader, &mobj->momx);
+  M_PBufReaderReadInt(&reader, &mobj->momy);
+  M_PBufReaderReadInt(&reader, &mobj->momz);
+  M_PBufReaderReadInt(&reader, &mobj->validcount);
+  M_PBufReaderReadInt(&reader, &mobj->intflags);
+  M_PBufReaderReadInt(&reader, &mobj->health);
+  M_PBufReaderReadShort(&reader, &mobj->movedir);
+  M_PBufReaderReadShort(&reader, &mobj->movecount);
+  M_PBufReaderReadShort(&reader, &mobj->strafecount);
+  M_PBufReaderReadShort(&reader, &mobj->reactiontime);
+  M_PBufReaderReadShort(&reader, &mobj->threshold);
+  M_PBufReaderReadShort(&reader, &mobj->pursuecount);
+  M_PBufReaderReadShort(&reader, &mobj->gear);
+  M_PBufReaderReadShort(&reader, &mobj->lastlook);
+  M_PBufReaderReadShort(&reader, &mobj->spawnpoint.x);
+  M_PBufReaderReadShort(&reader, &mobj->spawnpoint.y);
+  M_PBufReaderReadShort(&reader, &mobj->spawnpoint.angle);
+  M_PBufReaderReadShort(&reader, &mobj->spawnpoint.type);
+  M_PBufReaderReadShort(&reader, &mobj->spawnpoint.options);
+  M_PBufReaderReadInt(&reader, &mobj->friction);
+  M_PBufReaderReadInt(&reader, &mobj->movefactor);
 
   mobj->PrevX = mobj->x;
   mobj->PrevY = mobj->y;
   mobj->PrevZ = mobj->z;
 
-  M_PBufReadShort(savebuffer, &mobj->patch_width);
-  M_PBufReadInt(savebuffer, &mobj->iden_nums);
+  M_PBufReaderReadShort(&reader, &mobj->patch_width);
+  M_PBufReaderReadInt(&reader, &mobj->iden_nums);
+
+  if (!M_PBufEndReader(&reader))
+    I_Error("deserialize_actor: Invalid actor data");
 
   insert_actor(mobj);
 }
@@ -1129,11 +1198,22 @@ static void deserialize_line_index(pbuf_t *savebuffer, line_t **li, const char *
 //
 // P_ArchivePlayers
 //
+void P_AdvanceArchiveGeneration(void) {
+  archive_generation++;
+}
+
+/*
+ * Restricts P_ArchiveThinkers to actors stamped with mark (0 lifts it).  The
+ * stamped set must include everything those actors point to.
+ */
+void P_SetArchiveRelevanceMark(unsigned int mark) {
+  archive_relevance_mark = mark;
+}
+
 void P_ArchivePlayers(pbuf_t *savebuffer) {
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if (playeringame[i]) {
-      serialize_player(savebuffer, i);
-    }
+  PLAYERS_FOR_EACH(i) {
+    M_DeltaMarkRecord(savebuffer, SAVE_RECORD_PLAYER, i);
+    serialize_player(savebuffer, i);
   }
 }
 
@@ -1141,11 +1221,7 @@ void P_ArchivePlayers(pbuf_t *savebuffer) {
 // P_UnArchivePlayers
 //
 void P_UnArchivePlayers(pbuf_t *savebuffer) {
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if (!playeringame[i]) {
-      continue;
-    }
-
+  PLAYERS_FOR_EACH(i) {
     deserialize_player(savebuffer, i);
 
     // will be set when unarc thinker
@@ -1159,65 +1235,85 @@ void P_UnArchivePlayers(pbuf_t *savebuffer) {
 //
 void P_ArchiveWorld(pbuf_t *savebuffer) {
   uint32_t button_count = 0;
+  pbuf_record_t record;
 
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_WORLD, 0);
   M_PBufWriteInt(savebuffer, numspechit);
   M_PBufWriteUInt(savebuffer, numsectors);
   M_PBufWriteUInt(savebuffer, numlines);
 
   // do sectors
   for (sector_t *sec = sectors; (sec - sectors) < numsectors; sec++) {
+    if (sec->changed_gen < archive_generation &&
+        M_DeltaCopyRecord(savebuffer, SAVE_RECORD_SECTOR, sec - sectors)) {
+      continue;
+    }
+
+    M_DeltaMarkRecord(savebuffer, SAVE_RECORD_SECTOR, sec - sectors);
+    M_PBufBeginRecord(savebuffer, &record, SECTOR_FIELD_COUNT);
+
     // killough 10/98: save full floor & ceiling heights, including fraction
-    M_PBufWriteInt(savebuffer, sec->floorheight);
-    M_PBufWriteInt(savebuffer, sec->ceilingheight);
+    M_PBufRecordWriteInt(&record, sec->floorheight);
+    M_PBufRecordWriteInt(&record, sec->ceilingheight);
 
-    M_PBufWriteShort(savebuffer, sec->floorpic);
-    M_PBufWriteShort(savebuffer, sec->ceilingpic);
-    M_PBufWriteShort(savebuffer, sec->lightlevel);
+    M_PBufRecordWriteShort(&record, sec->floorpic);
+    M_PBufRecordWriteShort(&record, sec->ceilingpic);
+    M_PBufRecordWriteShort(&record, sec->lightlevel);
 
     // needed?   yes -- transfer types
-    M_PBufWriteShort(savebuffer, sec->special);
+    M_PBufRecordWriteShort(&record, sec->special);
 
     // needed?   need them -- killough
-    M_PBufWriteShort(savebuffer, sec->tag);
+    M_PBufRecordWriteShort(&record, sec->tag);
 
-    M_PBufWriteInt(savebuffer, sec->soundorg.x);
-    M_PBufWriteInt(savebuffer, sec->soundorg.y);
-    M_PBufWriteInt(savebuffer, sec->soundorg.z);
-    M_PBufWriteUInt(savebuffer, sec->soundorg.id);
+    M_PBufRecordWriteInt(&record, sec->soundorg.x);
+    M_PBufRecordWriteInt(&record, sec->soundorg.y);
+    M_PBufRecordWriteInt(&record, sec->soundorg.z);
+    M_PBufRecordWriteUInt(&record, sec->soundorg.id);
+    M_PBufEndRecord(&record);
   }
 
   // do lines
   for (line_t *li = lines; (li - lines) < numlines; li++) {
-    M_PBufWriteShort(savebuffer, li->flags);
-    M_PBufWriteShort(savebuffer, li->special);
-    M_PBufWriteShort(savebuffer, li->tag);
+    if (!line_changed(li) &&
+        M_DeltaCopyRecord(savebuffer, SAVE_RECORD_LINE, li - lines)) {
+      continue;
+    }
+
+    M_DeltaMarkRecord(savebuffer, SAVE_RECORD_LINE, li - lines);
+    M_PBufBeginRecord(savebuffer, &record, LINE_FIELD_COUNT);
+    M_PBufRecordWriteShort(&record, li->flags);
+    M_PBufRecordWriteShort(&record, li->special);
+    M_PBufRecordWriteShort(&record, li->tag);
 
     for (int j = 0; j < 2; j++) {
-      M_PBufWriteUChar(savebuffer, j);
+      M_PBufRecordWriteUChar(&record, j);
 
       if (li->sidenum[j] == NO_INDEX) {
-        M_PBufWriteBool(savebuffer, false);
+        M_PBufRecordWriteBool(&record, false);
       }
       else {
         side_t *si = &sides[li->sidenum[j]];
 
-        M_PBufWriteBool(savebuffer, true);
+        M_PBufRecordWriteBool(&record, true);
         // killough 10/98: save full sidedef offsets,
         // preserving fractional scroll offsets
-        M_PBufWriteInt(savebuffer, si->textureoffset);
-        M_PBufWriteInt(savebuffer, si->rowoffset);
-        M_PBufWriteShort(savebuffer, si->toptexture);
-        M_PBufWriteShort(savebuffer, si->bottomtexture);
-        M_PBufWriteShort(savebuffer, si->midtexture);
+        M_PBufRecordWriteInt(&record, si->textureoffset);
+        M_PBufRecordWriteInt(&record, si->rowoffset);
+        M_PBufRecordWriteShort(&record, si->toptexture);
+        M_PBufRecordWriteShort(&record, si->bottomtexture);
+        M_PBufRecordWriteShort(&record, si->midtexture);
       }
     }
 
-    M_PBufWriteInt(savebuffer, li->soundorg.x);
-    M_PBufWriteInt(savebuffer, li->soundorg.y);
-    M_PBufWriteInt(savebuffer, li->soundorg.z);
-    M_PBufWriteUInt(savebuffer, li->soundorg.id);
+    M_PBufRecordWriteInt(&record, li->soundorg.x);
+    M_PBufRecordWriteInt(&record, li->soundorg.y);
+    M_PBufRecordWriteInt(&record, li->soundorg.z);
+    M_PBufRecordWriteUInt(&record, li->soundorg.id);
+    M_PBufEndRecord(&record);
   }
 
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_BUTTONS, 0);
   M_PBufWriteInt(savebuffer, musinfo.current_item);
 
   for (int i = 0; i < MAXBUTTONS; i++) {
@@ -1250,6 +1346,9 @@ void P_UnArchiveWorld(pbuf_t *savebuffer) {
   uint32_t line_count;
   uint32_t button_count;
 
+  /* The world no longer matches the last state saved */
+  P_AdvanceArchiveGeneration();
+
   M_PBufReadInt(savebuffer, &numspechit);
   M_PBufReadUInt(savebuffer, &sector_count);
   M_PBufReadUInt(savebuffer, &line_count);
@@ -1276,19 +1375,27 @@ void P_UnArchiveWorld(pbuf_t *savebuffer) {
   }
   else {
     for (sector_t *sec = sectors; (sec - sectors) < numsectors; sec++) {
+      pbuf_reader_t reader;
+
+      M_PBufBeginReader(savebuffer, &reader);
+
       // killough 10/98: load full floor & ceiling heights, including fractions
-      M_PBufReadInt(savebuffer, &sec->floorheight);
-      M_PBufReadInt(savebuffer, &sec->ceilingheight);
-      M_PBufReadShort(savebuffer, &sec->floorpic);
-      M_PBufReadShort(savebuffer, &sec->ceilingpic);
-      M_PBufReadShort(savebuffer, &sec->lightlevel);
-      M_PBufReadShort(savebuffer, &sec->special);
-      M_PBufReadShort(savebuffer, &sec->tag);
-
-      M_PBufReadInt(savebuffer, &sec->soundorg.x);
-      M_PBufReadInt(savebuffer, &sec->soundorg.y);
-      M_PBufReadInt(savebuffer, &sec->soundorg.z);
-      M_PBufReadUInt(savebuffer, &sec->soundorg.id);
+      M_PBufReaderReadInt(&reader, &sec->floorheight);
+      M_PBufReaderReadInt(&reader, &sec->ceilingheight);
+      M_PBufReaderReadShort(&reader, &sec->floorpic);
+      M_PBufReaderReadShort(&reader, &sec->ceilingpic);
+      M_PBufReaderReadShort(&reader, &sec->lightlevel);
+      M_PBufReaderReadShort(&reader, &sec->special);
+      M_PBufReaderReadShort(&reader, &sec->tag);
+
+      M_PBufReaderReadInt(&reader, &sec->soundorg.x);
+      M_PBufReaderReadInt(&reader, &sec->soundorg.y);
+      M_PBufReaderReadInt(&reader, &sec->soundorg.z);
+      M_PBufReaderReadUInt(&reader, &sec->soundorg.id);
+
+      if (!M_PBufEndReader(&reader))
+        I_Error("P_UnArchiveWorld: Invalid sector data");
+
       P_IdentAssignID(&sec->soundorg, sec->soundorg.id);
 
       sec->ceilingdata = 0; //jff 2/22/98 now three thinker fields, not two
@@ -1338,37 +1445,44 @@ void P_UnArchiveWorld(pbuf_t *savebuffer) {
   }
   else {
     for (line_t *li = lines; (li - lines) < numlines; li++) {
-      M_PBufReadShort(savebuffer, (short *)&li->flags);
-      M_PBufReadShort(savebuffer, &li->special);
-      M_PBufReadShort(savebuffer, &li->tag);
+      pbuf_reader_t reader;
+
+      M_PBufBeginReader(savebuffer, &reader);
+      M_PBufReaderReadShort(&reader, (short *)&li->flags);
+      M_PBufReaderReadShort(&reader, &li->special);
+      M_PBufReaderReadShort(&reader, &li->tag);
 
       for (int j = 0; j < 2; j++) {
-        unsigned char sidenum_index;
-        bool sidenum_index_valid;
+        unsigned char sidenum_index = 0xFF;
+        bool sidenum_index_valid = false;
 
-        M_PBufReadUChar(savebuffer, &sidenum_index);
+        M_PBufReaderReadUChar(&reader, &sidenum_index);
 
         if (sidenum_index != j)
           I_Error("P_UnArchiveWorld: side index %d != %d\n", sidenum_index, j);
 
-        M_PBufReadBool(savebuffer, &sidenum_index_valid);
+        M_PBufReaderReadBool(&reader, &sidenum_index_valid);
 
         if (sidenum_index_valid) {
           side_t *si = &sides[li->sidenum[j]];
 
           // killough 10/98: load full sidedef offsets, including fractions
-          M_PBufReadInt(savebuffer, &si->textureoffset);
-          M_PBufReadInt(savebuffer, &si->rowoffset);
-          M_PBufReadShort(savebuffer, &si->toptexture);
-          M_PBufReadShort(savebuffer, &si->bottomtexture);
-          M_PBufReadShort(savebuffer, &si->midtexture);
+          M_PBufReaderReadInt(&reader, &si->textureoffset);
+          M_PBufReaderReadInt(&reader, &si->rowoffset);
+          M_PBufReaderReadShort(&reader, &si->toptexture);
+          M_PBufReaderReadShort(&reader, &si->bottomtexture);
+          M_PBufReaderReadShort(&reader, &si->midtexture);
         }
       }
 
-      M_PBufReadInt(savebuffer, &li->soundorg.x);
-      M_PBufReadInt(savebuffer, &li->soundorg.y);
-      M_PBufReadInt(savebuffer, &li->soundorg.z);
-      M_PBufReadUInt(savebuffer, &li->soundorg.id);
+      M_PBufReaderReadInt(&reader, &li->soundorg.x);
+      M_PBufReaderReadInt(&reader, &li->soundorg.y);
+      M_PBufReaderReadInt(&reader, &li->soundorg.z);
+      M_PBufReaderReadUInt(&reader, &li->soundorg.id);
+
+      if (!M_PBufEndReader(&reader))
+        I_Error("P_UnArchiveWorld: Invalid line data");
+
       P_IdentAssignID(&li->soundorg, li->soundorg.id);
     }
   }
@@ -1413,6 +1527,7 @@ void P_ArchiveThinkers(pbuf_t *savebuffer) {
     initialize_delta_compressed_actors();
   }
 
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_THINKERS, 0);
   M_PBufWriteUInt(savebuffer, P_IdentGetMaxID());
 
   // killough 3/26/98: Save boss brain state
@@ -1422,7 +1537,9 @@ void P_ArchiveThinkers(pbuf_t *savebuffer) {
   for (thinker_t *th = thinkercap.next; th != &thinkercap; th = th->next) {
     mobj_t *mobj = (mobj_t *)th;
 
-    if (th->function == P_MobjThinker && !should_delta_compress_actor(mobj))
+    if (th->function == P_MobjThinker &&
+        actor_is_archived(mobj) &&
+        !should_delta_compress_actor(mobj))
       thinker_count++;
   }
 
@@ -1436,12 +1553,16 @@ void P_ArchiveThinkers(pbuf_t *savebuffer) {
 
     mobj = (mobj_t *)th;
 
+    if (!actor_is_archived(mobj))
+      continue;
+
     if (should_delta_compress_actor(mobj))
       store_actor_for_delta_compression(mobj);
     else
       serialize_actor(savebuffer, mobj);
   }
 
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_DELTA_ACTORS, 0);
   commit_delta_compressed_actors(savebuffer);
 
   for (thinker_t *th = thinkercap.next; th != &thinkercap; th = th->next) {
@@ -1452,11 +1573,13 @@ void P_ArchiveThinkers(pbuf_t *savebuffer) {
 
     mobj = (mobj_t *)th;
 
-    if (!should_delta_compress_actor(mobj))
+    if (actor_is_archived(mobj) && !should_delta_compress_actor(mobj))
       serialize_actor_pointers(savebuffer, mobj);
   }
 
   // killough 9/14/98: save soundtargets
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_SOUND_TARGETS, 0);
+
   for (int i = 0; i < numsectors; i++) {
     mobj_t *target = sectors[i].soundtarget;
 
@@ -1877,6 +2000,8 @@ void P_UnArchivePusher(pbuf_t *savebuffer, pusher_t *pusher) {
 void P_ArchiveSpecials(pbuf_t *savebuffer) {
   thinker_t *th;
 
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_SPECIALS, 0);
+
   // save off the current thinkers
   for (th = thinkercap.next; th != &thinkercap; th = th->next) {
     if (!th->function) {
@@ -2168,6 +2293,7 @@ void P_UnArchiveSpecials(pbuf_t *savebuffer) {
 
 // killough 2/16/98: save/restore random number generator state information
 void P_ArchiveRNG(pbuf_t *savebuffer) {
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_RNG, 0);
   M_PBufWriteArray(savebuffer, NUMPRCLASS);
 
   for (int i = 0; i < NUMPRCLASS; i++)
@@ -2197,6 +2323,7 @@ void P_UnArchiveRNG(pbuf_t *savebuffer) {
 
 // killough 2/22/98: Save/restore automap state
 void P_ArchiveMap(pbuf_t *savebuffer) {
+  M_DeltaMarkRecord(savebuffer, SAVE_RECORD_MAP, 0);
   M_PBufWriteInt(savebuffer, automapmode);
 
   M_PBufWriteInt(savebuffer, markpointnum);
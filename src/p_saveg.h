@@ -28,6 +28,32 @@
 #pragma interface
 #endif
 
+/* Record types for delta compression; record 0 precedes the first mark */
+typedef enum {
+  SAVE_RECORD_HEADER,
+  SAVE_RECORD_PLAYER,
+  SAVE_RECORD_WORLD,
+  SAVE_RECORD_SECTOR,
+  SAVE_RECORD_LINE,
+  SAVE_RECORD_BUTTONS,
+  SAVE_RECORD_THINKERS,
+  SAVE_RECORD_ACTOR,
+  SAVE_RECORD_DELTA_ACTORS,
+  SAVE_RECORD_ACTOR_POINTERS,
+  SAVE_RECORD_SOUND_TARGETS,
+  SAVE_RECORD_SPECIALS,
+  SAVE_RECORD_RNG,
+  SAVE_RECORD_MAP,
+} save_record_type_e;
+
+/* Records not marked since the baseline are copied forward from it */
+extern unsigned int archive_generation;
+
+#define P_MarkChanged(obj) ((obj)->changed_gen = archive_generation)
+
+void P_AdvanceArchiveGeneration(void);
+void P_SetArchiveRelevanceMark(unsigned int mark);
+
 /* Persistent storage/archiving.
  * These are the load / save game routines. */
 void P_ArchivePlayers(pbuf_t *savebuffer);
@@ -34,8 +34,10 @@
 #include "p_ident.h"
 #include "p_maputl.h"
 #include "p_map.h"
+#include "p_reject.h"
 #include "p_setup.h"
 #include "p_mobj.h"
+#include "p_saveg.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_user.h"
@@ -2050,10 +2052,21 @@ static void P_LoadBlockMap(int lump) {
 //
 
 static void P_LoadReject(int lumpnum, int totallines) {
+  const unsigned char *built_reject;
+
   // dump any old cached reject lump, then cache the new one
   if (rejectlump != -1)
     W_UnlockLumpNum(rejectlump);
 
+  // Maps shipping an empty REJECT can have one built (-buildreject)
+  built_reject = P_BuildReject(lumpnum);
+
+  if (built_reject) {
+    rejectlump = -1;
+    rejectmatrix = built_reject;
+    return;
+  }
+
   rejectlump = lumpnum + ML_REJECT;
   rejectmatrix = W_CacheLumpNum(rejectlump);
 
@@ -2444,6 +2457,9 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill) {
 
   Z_FreeTags(PU_LEVEL, PU_PURGELEVEL-1);
 
+  // Saved states from the previous level can't serve as a baseline
+  P_AdvanceArchiveGeneration();
+
   if (rejectlump != -1) { // cph - unlock the reject table
     W_UnlockLumpNum(rejectlump);
     rejectlump = -1;
@@ -39,6 +39,7 @@
 #include "p_inter.h"
 #include "p_map.h"
 #include "p_maputl.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "p_mobj.h"
 #include "p_spec.h"
@@ -1219,6 +1220,9 @@ void P_CrossSpecialLine(line_t *line, int side, mobj_t *thing)
 {
   int         ok;
 
+  // Activating a line may clear its special
+  P_MarkChanged(line);
+
   //  Things that should never trigger lines
   //
   // e6y: Improved support for Doom v1.2
@@ -2123,6 +2127,8 @@ void P_ShootSpecialLine
 ( mobj_t*       thing,
   line_t*       line )
 {
+  P_MarkChanged(line);
+
   //jff 02/04/98 add check here for generalized linedef
   if (!demo_compatibility)
   {
@@ -2349,6 +2355,7 @@ void P_PlayerInSpecialSector (player_t* player)
         // Tally player in secret sector, clear secret special
         player->secretcount++;
         sector->special = 0;
+        P_MarkChanged(sector);
         //e6y
         if (hudadd_secretarea)
         {
@@ -2406,6 +2413,7 @@ void P_PlayerInSpecialSector (player_t* player)
       sector->special &= ~SECRET_MASK;
       if (sector->special<32) // if all extended bits clear,
         sector->special=0;    // sector is not special anymore
+      P_MarkChanged(sector);
       //e6y
       if (hudadd_secretarea)
       {
@@ -2537,6 +2545,8 @@ void P_UpdateSpecials(void) {
         side->bottomtexture = buttonlist[i].btexture;
       break;
     }
+
+    P_MarkChanged(buttonlist[i].line);
     /*
      * don't take the address of the switch's sound origin, unless in a
      * compatibility mode.
@@ -2639,6 +2649,7 @@ void P_SpawnSpecials (void)
         // strobe fast/death slime
         P_SpawnStrobeFlash(sector,FASTDARK,0);
         sector->special |= 3<<DAMAGE_SHIFT; //jff 3/14/98 put damage bits in
+        P_MarkChanged(sector);
         break;
 
       case 8:
@@ -2807,6 +2818,7 @@ void T_Scroll(scroll_t *s)
         side = sides + s->affectee;
         side->textureoffset += dx;
         side->rowoffset += dy;
+        P_MarkChanged(side);
         break;
 
     case sc_floor:                  // killough 3/7/98: Scroll floor texture
@@ -38,6 +38,7 @@
 #include "s_sound.h"
 #include "sounds.h"
 #include "w_wad.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "p_mobj.h"
 
@@ -180,6 +181,8 @@ void P_ChangeSwitchTexture
   tmid = &sides[line->sidenum[0]].midtexture;
   tbot = &sides[line->sidenum[0]].bottomtexture;
 
+  P_MarkChanged(line);
+
   sound = sfx_swtchn;
   /* use the sound origin of the linedef (its midpoint)
    * unless in a compatibility mode */
@@ -263,6 +266,8 @@ int GetPairForSwitchTexture(side_t *side)
 // Returns true if a thinker was created
 //
 bool P_UseSpecialLine(mobj_t *thing, line_t *line, int side) {
+  P_MarkChanged(line);
+
   // e6y
   // b.m. side test was broken in boom201
   if ((demoplayback ? (demover != 201) : (compatibility_level != boom_201_compatibility)))
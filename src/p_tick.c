@@ -307,10 +307,8 @@ static bool setup_tic(void) {
 
 static void run_regular_tic(void) {
   if (!MULTINET) {
-    for (int i = 0; i < MAXPLAYERS; i++) {
-      if (playeringame[i]) {
-        P_PlayerThink(i);
-      }
+    PLAYERS_FOR_EACH(i) {
+      P_PlayerThink(i);
     }
 
     return;
@@ -320,11 +318,7 @@ static void run_regular_tic(void) {
     P_PlayerThink(consoleplayer);
   }
 
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if (!playeringame[i]) {
-      continue;
-    }
-
+  PLAYERS_FOR_EACH(i) {
     if (i == consoleplayer) {
       continue;
     }
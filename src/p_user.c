@@ -797,14 +797,12 @@ void P_SetPlayerName(int playernum, const char *name) {
 int P_PlayerGetFragCount(int playernum) {
   int frag_count = 0;
 
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if (playeringame[i]) {
-      if (i == playernum) {
-        frag_count -= players[playernum].frags[i];
-      }
-      else {
-        frag_count += players[playernum].frags[i];
-      }
+  PLAYERS_FOR_EACH(i) {
+    if (i == playernum) {
+      frag_count -= players[playernum].frags[i];
+    }
+    else {
+      frag_count += players[playernum].frags[i];
     }
   }
 
@@ -814,10 +812,8 @@ int P_PlayerGetFragCount(int playernum) {
 int P_PlayerGetDeathCount(int playernum) {
   int death_count = 0;
 
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if (playeringame[i]) {
-      death_count += players[i].frags[playernum];
-    }
+  PLAYERS_FOR_EACH(i) {
+    death_count += players[i].frags[playernum];
   }
 
   return death_count;
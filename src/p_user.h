@@ -66,12 +66,22 @@ typedef enum {
 extern int weapon_preferences[2][NUMWEAPONS + 1]; /* killough 5/2/98 */
 int P_WeaponPreferred(int w1, int w2);
 
+/*
+ * A ring of commands indexed by command index, covering [first_index,
+ * first_index + span).  Holes are tracked in occupied.
+ */
+#define COMMAND_QUEUE_CAPACITY 256
+
 typedef struct {
-  GPtrArray *commands;
-  uint32_t   commands_missed;
-  uint32_t   command_limit;
-  uint32_t   commands_run_this_tic;
-  uint32_t   latest_command_run_index;
+  struct netticcmd_s *commands;
+  uint8_t             occupied[COMMAND_QUEUE_CAPACITY / 8];
+  uint32_t            first_index;
+  uint32_t            span;
+  uint32_t            count;
+  uint32_t            commands_missed;
+  uint32_t            command_limit;
+  uint32_t            commands_run_this_tic;
+  uint32_t            latest_command_run_index;
 } command_queue_t;
 
 void A_Light0();
@@ -297,10 +307,6 @@ typedef struct player_s
   int              ping;
   int              connect_tic;
   bool             telefragged_by_spawn;
-  fixed_t          saved_momx;
-  fixed_t          saved_momy;
-  fixed_t          saved_momz;
-  int              saved_damagecount;
 } player_t;
 
 // Bookkeeping on players - state.
@@ -368,7 +374,9 @@ unsigned int P_GetLatestSynchronizedCommandIndex(int playernum);
 void         P_InitCommandQueues(void);
 bool         P_HasCommands(int playernum);
 unsigned int P_GetCommandCount(int playernum);
-netticcmd_t* P_GetCommand(int playernum, unsigned int index);
+unsigned int P_GetCommandSpan(int playernum);
+netticcmd_t* P_GetCommand(int playernum, unsigned int position);
+netticcmd_t* P_GetCommandByIndex(int playernum, uint32_t command_index);
 void         P_InsertCommandSorted(int playernum, netticcmd_t *tmp_ncmd);
 void         P_QueuePlayerCommand(int playernum, netticcmd_t *ncmd);
 void         P_AppendNewCommand(int playernum, netticcmd_t *tmp_ncmd);
@@ -37,6 +37,7 @@
 #include "r_things.h"
 #include "r_bsp.h" // cph - sanity checking
 #include "v_video.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 #include "g_game.h"
 #include "p_user.h"
@@ -418,8 +419,10 @@ static void R_AddLine (seg_t *line)
       maxdrawsegs = newmax;
     }
     
-    if(curline->miniseg == false) // figgi -- skip minisegs
+    if(curline->miniseg == false && !(curline->linedef->flags & ML_MAPPED)) {
       curline->linedef->flags |= ML_MAPPED;
+      P_MarkChanged(curline->linedef);
+    }
     
     // proff 11/99: the rest of the calculations is not needed for OpenGL
     ds_p++->curline = curline;
@@ -550,7 +550,7 @@ void R_InitData(void)
   R_InitFlats();
   D_Msg(MSG_INFO, "Sprites ");
   R_InitSpriteLumps();
-  if (default_translucency)             // killough 3/1/98
+  if (default_translucency && !nodrawers) // killough 3/1/98
     R_InitTranMap(1);                   // killough 2/21/98, 3/6/98
   R_InitColormaps();                    // killough 3/20/98
 }
@@ -670,6 +670,10 @@ void R_PrecacheLevel(void)
   if (timingdemo)
     return;
 
+  /* Nothing will be drawn, so don't pull every level graphic into RAM */
+  if (nodrawers)
+    return;
+
   {
     int size = numflats > numsprites  ? numflats : numsprites;
     hitlist = malloc(numtextures > size ? numtextures : size);
@@ -140,6 +140,9 @@ typedef struct sector_s
   short oldspecial;      //jff 2/16/98 remembers if sector WAS secret (automap)
   short tag;
 
+  // Archive generation this sector last changed in (see P_MarkChanged)
+  unsigned int changed_gen;
+
   //e6y
   int INTERP_SectorFloor;
   int INTERP_SectorCeiling;
@@ -169,6 +172,9 @@ typedef struct side_s
 
   int special;
 
+  // Archive generation this side last changed in (see P_MarkChanged)
+  unsigned int changed_gen;
+
   int INTERP_WallPanning;
 #ifdef GL_DOOM
   int skybox_index;
@@ -216,6 +222,7 @@ typedef struct line_s
     RF_ISOLATED =32,     // Isolated line
   } r_flags;
   degenmobj_t soundorg;  // sound origin for switches/buttons
+  unsigned int changed_gen; // Archive generation last changed in
 } line_t;
 
 // phares 3/14/98
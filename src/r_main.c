@@ -906,6 +906,16 @@ void R_Init(void) {
   R_LoadTrigTables();
   D_Msg(MSG_INFO, "\nR_InitData: ");
   R_InitData();
+
+  /* Game logic only needs R_InitData's lookups, translations and HUD fonts */
+  if (nodrawers) {
+    D_Msg(MSG_INFO, "\nR_Init: R_InitTranslationsTables ");
+    R_InitTranslationTables();
+    D_Msg(MSG_INFO, "R_InitPatches ");
+    R_InitPatches();
+    return;
+  }
+
   R_SetViewSize(screenblocks);
   D_Msg(MSG_INFO, "\nR_Init: R_InitPlanes ");
   R_InitPlanes();
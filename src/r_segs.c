@@ -42,6 +42,7 @@
 #include "v_video.h"
 #include "i_smp.h"
 #include "g_game.h"
+#include "p_saveg.h"
 #include "p_setup.h"
 
 #include "gl_opengl.h"
@@ -546,8 +547,10 @@ void R_StoreWallRange(const int start, const int stop)
       maxdrawsegs = newmax;
     }
 
-  if(curline->miniseg == false) { // figgi -- skip minisegs
+  // figgi -- skip minisegs
+  if(curline->miniseg == false && !(curline->linedef->flags & ML_MAPPED)) {
     curline->linedef->flags |= ML_MAPPED;
+    P_MarkChanged(curline->linedef);
   }
 
 #ifdef GL_DOOM
@@ -571,7 +574,10 @@ void R_StoreWallRange(const int start, const int stop)
   linedef = curline->linedef;
 
   // mark the segment as visible for auto map
-  linedef->flags |= ML_MAPPED;
+  if (!(linedef->flags & ML_MAPPED)) {
+    linedef->flags |= ML_MAPPED;
+    P_MarkChanged(linedef);
+  }
 
   // calculate rw_distance for scale calculation
   rw_normalangle = curline->angle + ANG90;
@@ -0,0 +1,512 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "g_game.h"
+#include "g_state.h"
+#include "m_argv.h"
+#include "m_bbox.h"
+#include "m_delta.h"
+#include "m_hash.h"
+#include "n_main.h"
+#include "p_user.h"
+#include "p_setup.h"
+#include "p_maputl.h"
+#include "p_mobj.h"
+#include "p_tick.h"
+#include "r_defs.h"
+#include "r_state.h"
+#include "sv_aoi.h"
+
+/*
+ * Area of interest.  With -aoi, each peer only receives player actors,
+ * anything targeting its player, actors within -aoiradius (1200) that sound
+ * could reach, actors within -aoidistance (4096) that REJECT allows, and
+ * whatever those point to.  Views are kept for AOI_VIEW_CAPACITY TICs and
+ * shared between peers that see the same actors.
+ */
+
+#define AOI_VIEW_CAPACITY TICRATE
+#define AOI_SOUND_RADIUS 1200
+#define AOI_SIGHT_DISTANCE 4096
+
+typedef struct aoi_views_s {
+  game_state_t views[AOI_VIEW_CAPACITY];
+} aoi_views_t;
+
+typedef struct aoi_shared_view_s {
+  uint64_t      relevance_hash;
+  game_state_t *view;
+} aoi_shared_view_t;
+
+static bool          aoi_initialized = false;
+static bool          aoi_enabled = false;
+static fixed_t       aoi_sound_radius = AOI_SOUND_RADIUS << FRACBITS;
+static fixed_t       aoi_sight_distance = AOI_SIGHT_DISTANCE << FRACBITS;
+static unsigned int  aoi_mark = 0;
+static unsigned int *sector_marks = NULL;
+static int           sector_mark_count = 0;
+static GPtrArray    *marked_actors = NULL;
+static GPtrArray    *connected_sectors = NULL;
+static GArray       *shared_views = NULL;
+static int           shared_views_tic = -1;
+
+static void init_aoi(void) {
+  int p;
+
+  aoi_initialized = true;
+
+  if (!M_CheckParm("-aoi")) {
+    return;
+  }
+
+  if ((p = M_CheckParm("-aoiradius")) && p < myargc - 1) {
+    aoi_sound_radius = MAX(atoi(myargv[p + 1]), 0) << FRACBITS;
+  }
+
+  if ((p = M_CheckParm("-aoidistance")) && p < myargc - 1) {
+    aoi_sight_distance = MAX(atoi(myargv[p + 1]), 0) << FRACBITS;
+  }
+
+  marked_actors = g_ptr_array_new();
+  connected_sectors = g_ptr_array_new();
+  shared_views = g_array_new(false, false, sizeof(aoi_shared_view_t));
+  aoi_enabled = true;
+
+  D_Msg(MSG_INFO, "SV_AOI: Area of interest enabled (radius %d, distance %d)\n",
+    aoi_sound_radius >> FRACBITS, aoi_sight_distance >> FRACBITS
+  );
+}
+
+static void next_mark(void) {
+  aoi_mark++;
+
+  if (aoi_mark != 0) {
+    return;
+  }
+
+  /* Wrapped around, so old marks could be mistaken for new ones */
+  for (thinker_t *th = thinkercap.next; th != &thinkercap; th = th->next) {
+    if (th->function == P_MobjThinker) {
+      ((mobj_t *)th)->relevance_mark = 0;
+    }
+  }
+
+  if (sector_marks) {
+    memset(sector_marks, 0, sector_mark_count * sizeof(unsigned int));
+  }
+
+  aoi_mark = 1;
+}
+
+static void mark_actor(mobj_t *mobj) {
+  if (!mobj || mobj->thinker.function != P_MobjThinker) {
+    return;
+  }
+
+  if (mobj->relevance_mark == aoi_mark) {
+    return;
+  }
+
+  mobj->relevance_mark = aoi_mark;
+  g_ptr_array_add(marked_actors, mobj);
+}
+
+static void mark_corpse(gpointer data, gpointer user_data) {
+  mark_actor((mobj_t *)data);
+}
+
+static void mark_pointed_to_actors(void) {
+  while (marked_actors->len > 0) {
+    mobj_t *mobj = g_ptr_array_remove_index_fast(
+      marked_actors, marked_actors->len - 1
+    );
+
+    mark_actor(mobj->target);
+    mark_actor(mobj->tracer);
+    mark_actor(mobj->lastenemy);
+  }
+}
+
+static fixed_t get_line_distance(line_t *line, fixed_t x, fixed_t y) {
+  fixed_t dx = 0;
+  fixed_t dy = 0;
+
+  if (x < line->bbox[BOXLEFT]) {
+    dx = line->bbox[BOXLEFT] - x;
+  }
+  else if (x > line->bbox[BOXRIGHT]) {
+    dx = x - line->bbox[BOXRIGHT];
+  }
+
+  if (y < line->bbox[BOXBOTTOM]) {
+    dy = line->bbox[BOXBOTTOM] - y;
+  }
+  else if (y > line->bbox[BOXTOP]) {
+    dy = y - line->bbox[BOXTOP];
+  }
+
+  return P_AproxDistance(dx, dy);
+}
+
+static bool sector_is_connected(sector_t *sector) {
+  return sector_marks[sector - sectors] == aoi_mark;
+}
+
+/* Roughly how far sound travels (see P_RecursiveSound) */
+static void mark_connected_sectors(mobj_t *mo) {
+  if (sector_mark_count != numsectors) {
+    sector_marks = realloc(sector_marks, numsectors * sizeof(unsigned int));
+
+    if (!sector_marks) {
+      I_Error("mark_connected_sectors: Error allocating sector marks");
+    }
+
+    memset(sector_marks, 0, numsectors * sizeof(unsigned int));
+    sector_mark_count = numsectors;
+  }
+
+  g_ptr_array_set_size(connected_sectors, 0);
+  sector_marks[mo->subsector->sector - sectors] = aoi_mark;
+  g_ptr_array_add(connected_sectors, mo->subsector->sector);
+
+  while (connected_sectors->len > 0) {
+    sector_t *sector = g_ptr_array_remove_index_fast(
+      connected_sectors, connected_sectors->len - 1
+    );
+
+    for (int i = 0; i < sector->linecount; i++) {
+      line_t *line = sector->lines[i];
+      sector_t *other;
+
+      if (!line->frontsector || !line->backsector) {
+        continue;
+      }
+
+      other = line->frontsector == sector ? line->backsector :
+                                            line->frontsector;
+
+      if (sector_is_connected(other)) {
+        continue;
+      }
+
+      if (MIN(line->frontsector->ceilingheight,
+              line->backsector->ceilingheight) <=
+          MAX(line->frontsector->floorheight,
+              line->backsector->floorheight)) {
+        continue;
+      }
+
+      if (get_line_distance(line, mo->x, mo->y) > aoi_sound_radius) {
+        continue;
+      }
+
+      sector_marks[other - sectors] = aoi_mark;
+      g_ptr_array_add(connected_sectors, other);
+    }
+  }
+}
+
+static bool sector_is_rejected(sector_t *s1, sector_t *s2) {
+  size_t pnum = ((size_t)(s1 - sectors) * numsectors) + (s2 - sectors);
+
+  return (rejectmatrix[pnum >> 3] & (1 << (pnum & 7))) != 0;
+}
+
+static bool actor_is_relevant(mobj_t *mobj, mobj_t *pmo) {
+  fixed_t distance;
+
+  if (mobj->player || mobj->target == pmo || mobj->tracer == pmo) {
+    return true;
+  }
+
+  distance = P_AproxDistance(mobj->x - pmo->x, mobj->y - pmo->y);
+
+  if (distance <= aoi_sound_radius &&
+      sector_is_connected(mobj->subsector->sector)) {
+    return true;
+  }
+
+  if (distance <= aoi_sight_distance &&
+      !sector_is_rejected(pmo->subsector->sector, mobj->subsector->sector)) {
+    return true;
+  }
+
+  return false;
+}
+
+/* Stamps every actor relevant to playernum with a new mark */
+static void mark_relevant_actors(unsigned int playernum) {
+  mobj_t *pmo = players[playernum].mo;
+
+  next_mark();
+
+  if (pmo && pmo->subsector) {
+    mark_connected_sectors(pmo);
+  }
+
+  for (thinker_t *th = thinkercap.next; th != &thinkercap; th = th->next) {
+    mobj_t *mobj;
+
+    if (th->function != P_MobjThinker) {
+      continue;
+    }
+
+    mobj = (mobj_t *)th;
+
+    /* Without an actor there's nowhere to measure from */
+    if (!pmo || !pmo->subsector || actor_is_relevant(mobj, pmo)) {
+      mark_actor(mobj);
+    }
+  }
+
+  for (int i = 0; i < numsectors; i++) {
+    mark_actor(sectors[i].soundtarget);
+  }
+
+  if (corpse_queue) {
+    g_queue_foreach(corpse_queue, mark_corpse, NULL);
+  }
+
+  mark_pointed_to_actors();
+}
+
+static aoi_views_t* get_views(netpeer_t *np) {
+  aoi_views_t *aoi_views = N_PeerGetAOIViews(np);
+
+  if (aoi_views) {
+    return aoi_views;
+  }
+
+  aoi_views = calloc(1, sizeof(aoi_views_t));
+
+  if (!aoi_views) {
+    I_Error("get_views: Error allocating views");
+  }
+
+  for (int i = 0; i < AOI_VIEW_CAPACITY; i++) {
+    aoi_views->views[i].tic = -1;
+  }
+
+  N_PeerSetAOIViews(np, aoi_views);
+
+  return aoi_views;
+}
+
+/* The view AOI_VIEW_CAPACITY TICs back is about to be replaced */
+static game_state_t* find_view(aoi_views_t *aoi_views, int tic) {
+  game_state_t *gs = &aoi_views->views[tic % AOI_VIEW_CAPACITY];
+
+  if (tic <= G_GetLatestState()->tic - AOI_VIEW_CAPACITY) {
+    return NULL;
+  }
+
+  if (gs->tic != tic || !gs->data) {
+    return NULL;
+  }
+
+  return gs;
+}
+
+/* Identifies the set of actors stamped with the current mark */
+static uint64_t hash_marked_actors(void) {
+  uint64_t hash = 0;
+
+  for (thinker_t *th = thinkercap.next; th != &thinkercap; th = th->next) {
+    mobj_t *mobj;
+
+    if (th->function != P_MobjThinker) {
+      continue;
+    }
+
+    mobj = (mobj_t *)th;
+
+    if (mobj->relevance_mark == aoi_mark) {
+      hash = M_HashValue(hash, mobj->id);
+    }
+  }
+
+  return hash;
+}
+
+static game_state_t* find_shared_view(uint64_t relevance_hash, int tic) {
+  if (shared_views_tic != tic) {
+    g_array_set_size(shared_views, 0);
+    shared_views_tic = tic;
+    return NULL;
+  }
+
+  for (unsigned int i = 0; i < shared_views->len; i++) {
+    aoi_shared_view_t *shared = &g_array_index(
+      shared_views, aoi_shared_view_t, i
+    );
+
+    if (shared->relevance_hash == relevance_hash && shared->view->tic == tic) {
+      return shared->view;
+    }
+  }
+
+  return NULL;
+}
+
+static void add_shared_view(uint64_t relevance_hash, game_state_t *view) {
+  aoi_shared_view_t shared = { relevance_hash, view };
+
+  g_array_append_val(shared_views, shared);
+}
+
+static void copy_view(game_state_t *dst, game_state_t *src) {
+  M_PBufCopy(dst->data, src->data);
+  g_array_set_size(dst->records, src->records->len);
+  memcpy(
+    dst->records->data,
+    src->records->data,
+    src->records->len * sizeof(delta_record_t)
+  );
+  dst->hash = src->hash;
+  dst->tic = src->tic;
+}
+
+static game_state_t* get_latest_view(netpeer_t *np) {
+  aoi_views_t *aoi_views = get_views(np);
+  int tic = G_GetLatestState()->tic;
+  game_state_t *gs = find_view(aoi_views, tic);
+  game_state_t *shared;
+  uint64_t relevance_hash;
+
+  if (gs) {
+    return gs;
+  }
+
+  gs = &aoi_views->views[tic % AOI_VIEW_CAPACITY];
+
+  if (!gs->data) {
+    gs->data = M_PBufNew();
+    gs->records = g_array_new(false, false, sizeof(delta_record_t));
+  }
+
+  mark_relevant_actors(N_PeerGetPlayernum(np));
+  relevance_hash = hash_marked_actors();
+  shared = find_shared_view(relevance_hash, tic);
+
+  if (shared && shared != gs) {
+    copy_view(gs, shared);
+    return gs;
+  }
+
+  G_BuildRelevantState(gs, aoi_mark);
+  add_shared_view(relevance_hash, gs);
+
+  return gs;
+}
+
+bool SV_AOIEnabled(void) {
+  if (!aoi_initialized) {
+    init_aoi();
+  }
+
+  return SERVER && aoi_enabled;
+}
+
+/* Relays pass the state on to others, so they always get all of it */
+bool SV_AOIFiltersPeer(netpeer_t *np) {
+  return SV_AOIEnabled() && !N_PeerIsRelay(np);
+}
+
+bool SV_AOIHaveView(netpeer_t *np, int tic) {
+  aoi_views_t *aoi_views = N_PeerGetAOIViews(np);
+
+  return aoi_views && find_view(aoi_views, tic);
+}
+
+/* Every view before the one just sent is useless */
+game_state_t* SV_AOIGetFullState(netpeer_t *np) {
+  aoi_views_t *aoi_views = get_views(np);
+
+  for (int i = 0; i < AOI_VIEW_CAPACITY; i++) {
+    aoi_views->views[i].tic = -1;
+  }
+
+  return get_latest_view(np);
+}
+
+/*
+ * Runs on the main thread, since it serializes actors.  Returns false if the
+ * view at the sync TIC is gone.
+ */
+bool SV_AOIBuildStateDelta(netpeer_t *np) {
+  int sync_tic = N_PeerGetSyncTIC(np);
+  game_state_delta_t *delta = N_PeerGetSyncStateDelta(np);
+  game_state_t *from;
+  game_state_t *to;
+
+  if (sync_tic >= G_GetLatestState()->tic) {
+    return true;
+  }
+
+  from = find_view(get_views(np), sync_tic);
+
+  if (!from) {
+    D_Msg(MSG_WARN, "(%d) Missing view %d for %u, sending full state\n",
+      gametic, sync_tic, N_PeerGetPlayernum(np)
+    );
+    return false;
+  }
+
+  to = get_latest_view(np);
+
+  M_BuildDelta(from->data, from->records, to->data, to->records, &delta->data);
+
+  delta->from_tic = from->tic;
+  delta->to_tic = to->tic;
+  delta->hash = to->hash;
+
+  return true;
+}
+
+void SV_AOIFreeViews(struct aoi_views_s *aoi_views) {
+  /* Shared views could point into these */
+  if (shared_views) {
+    g_array_set_size(shared_views, 0);
+  }
+
+  for (int i = 0; i < AOI_VIEW_CAPACITY; i++) {
+    game_state_t *gs = &aoi_views->views[i];
+
+    if (!gs->data) {
+      continue;
+    }
+
+    M_PBufFree(gs->data);
+    free(gs->data);
+    g_array_free(gs->records, true);
+  }
+
+  free(aoi_views);
+}
+
+/* vi: set et ts=2 sw=2: */
+
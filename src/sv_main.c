@@ -27,20 +27,45 @@
 
 #include "doomdef.h"
 #include "doomstat.h"
-#include "g_save.h"
 #include "g_state.h"
 #include "n_main.h"
 #include "p_user.h"
 #include "g_game.h"
 #include "p_setup.h"
+#include "p_map.h"
+#include "p_maputl.h"
 #include "p_mobj.h"
 
 #define MAX_COMMAND_COUNT (TICRATE / 4)
 
-static game_state_t *unlag_game_state = NULL;
-static int           unlag_tic;
+/* As far back as a peer can lag before it's disconnected */
+#define UNLAG_HISTORY_TICS (TICRATE * 4)
+
+/* The actor pointer catches respawns */
+typedef struct unlag_transform_s {
+  int       tic;
+  mobj_t   *mo;
+  fixed_t   x;
+  fixed_t   y;
+  fixed_t   z;
+  fixed_t   floorz;
+  fixed_t   ceilingz;
+  fixed_t   dropoffz;
+  fixed_t   radius;
+  fixed_t   height;
+  uint64_t  flags;
+} unlag_transform_t;
+
+/* Per-player rings of transforms indexed by TIC */
+static unlag_transform_t *unlag_history[MAXPLAYERS];
+static unlag_transform_t  unlag_rewound[MAXPLAYERS];
+static unlag_transform_t  unlag_saved[MAXPLAYERS];
+static int                unlag_players[MAXPLAYERS];
+static int                unlag_player_count = 0;
+static int                unlag_tic;
 
 int sv_limit_player_commands = 0;
+int sv_allow_relays = 0;
 char *sv_spectate_password = NULL;
 char *sv_join_password = NULL;
 char *sv_moderate_password = NULL;
@@ -183,66 +208,137 @@ unsigned int SV_GetPlayerCommandLimit(int playernum) {
   return 1; /* always run at least 1 ticcmd if possible */
 }
 
-void SV_UnlagSetTIC(int tic) {
-  unlag_tic = tic;
+static void save_transform(unlag_transform_t *ut, mobj_t *mo) {
+  ut->tic      = gametic;
+  ut->mo       = mo;
+  ut->x        = mo->x;
+  ut->y        = mo->y;
+  ut->z        = mo->z;
+  ut->floorz   = mo->floorz;
+  ut->ceilingz = mo->ceilingz;
+  ut->dropoffz = mo->dropoffz;
+  ut->radius   = mo->radius;
+  ut->height   = mo->height;
+  ut->flags    = mo->flags;
+}
+
+static void load_transform(mobj_t *mo, unlag_transform_t *ut) {
+  P_UnsetThingPosition(mo);
+
+  mo->x        = ut->x;
+  mo->y        = ut->y;
+  mo->z        = ut->z;
+  mo->floorz   = ut->floorz;
+  mo->ceilingz = ut->ceilingz;
+  mo->dropoffz = ut->dropoffz;
+  mo->radius   = ut->radius;
+  mo->height   = ut->height;
+  mo->flags    = ut->flags;
+
+  P_SetThingPosition(mo);
 }
 
-bool SV_UnlagStart(void) {
-  if (!unlag_game_state) {
-    unlag_game_state = malloc(sizeof(game_state_t));
-    if (!unlag_game_state) {
-      I_Error("Error allocating unlagged game state");
+void SV_UnlagRecordTIC(void) {
+  PLAYERS_FOR_EACH(i) {
+    mobj_t *mo = players[i].mo;
+
+    if (!mo) {
+      continue;
+    }
+
+    if (!unlag_history[i]) {
+      unlag_history[i] = calloc(
+        UNLAG_HISTORY_TICS, sizeof(unlag_transform_t)
+      );
+
+      if (!unlag_history[i]) {
+        I_Error("SV_UnlagRecordTIC: Error allocating unlag history");
+      }
     }
 
-    unlag_game_state->data = M_PBufNewWithCapacity(16384);
+    save_transform(&unlag_history[i][gametic % UNLAG_HISTORY_TICS], mo);
   }
-  else {
-    M_PBufClear(unlag_game_state->data);
+}
+
+void SV_UnlagSetTIC(int tic) {
+  unlag_tic = tic;
+}
+
+/*
+ * Moves other players' actors back to where they were at unlag_tic.
+ * Anything the shot does to them is applied to the real actor and kept.
+ */
+bool SV_UnlagStart(int shooter) {
+  mobj_t *shooter_mo = players[shooter].mo;
+
+  unlag_player_count = 0;
+
+  if (!shooter_mo) {
+    return false;
   }
 
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if (!playeringame[i]) {
+  PLAYERS_FOR_EACH(i) {
+    mobj_t *mo = players[i].mo;
+    unlag_transform_t *ut;
+
+    if (i == shooter || !mo || mo->health <= 0 || !unlag_history[i]) {
       continue;
     }
 
-    players[i].saved_momx        = players[i].mo->momx;
-    players[i].saved_momy        = players[i].mo->momy;
-    players[i].saved_momz        = players[i].mo->momz;
-    players[i].saved_damagecount = players[i].damagecount;
-  }
+    ut = &unlag_history[i][unlag_tic % UNLAG_HISTORY_TICS];
 
-  unlag_game_state->tic = gametic;
-  G_WriteSaveData(unlag_game_state->data);
+    if (ut->tic != unlag_tic || ut->mo != mo) {
+      continue;
+    }
 
-  return G_LoadState(unlag_tic, false);
-}
+    if (ut->x == mo->x && ut->y == mo->y && ut->z == mo->z &&
+        ut->radius == mo->radius && ut->height == mo->height &&
+        ut->flags == mo->flags) {
+      continue;
+    }
 
-void SV_UnlagEnd(void) {
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if (!playeringame[i]) {
+    if (P_AproxDistance(ut->x - shooter_mo->x, ut->y - shooter_mo->y) >
+        MISSILERANGE + ut->radius) {
       continue;
     }
 
-    /* [CG] These now become deltas instead of base values */
-    players[i].saved_momx        -= players[i].mo->momx;
-    players[i].saved_momy        -= players[i].mo->momy;
-    players[i].saved_momz        -= players[i].mo->momz;
-    players[i].saved_damagecount -= players[i].damagecount;
+    save_transform(&unlag_saved[i], mo);
+    unlag_rewound[i] = *ut;
+    load_transform(mo, ut);
+    unlag_players[unlag_player_count++] = i;
   }
 
-  M_PBufSeek(unlag_game_state->data, 0);
-  G_ReadSaveData(unlag_game_state->data, true, false);
+  return unlag_player_count > 0;
+}
+
+/* Only restored if the shot didn't change them, e.g. by killing them */
+void SV_UnlagEnd(void) {
+  for (int i = 0; i < unlag_player_count; i++) {
+    int playernum = unlag_players[i];
+    mobj_t *mo = players[playernum].mo;
+    unlag_transform_t *saved = &unlag_saved[playernum];
+    unlag_transform_t *rewound = &unlag_rewound[playernum];
 
-  for (int i = 0; i < MAXPLAYERS; i++) {
-    if (!playeringame[i]) {
+    if (mo != saved->mo) {
       continue;
     }
 
-    players[i].mo->momx    += players[i].saved_momx;
-    players[i].mo->momy    += players[i].saved_momy;
-    players[i].mo->momz    += players[i].saved_momz;
-    players[i].damagecount += players[i].saved_damagecount;
+    if (mo->radius != rewound->radius) {
+      saved->radius = mo->radius;
+    }
+
+    if (mo->height != rewound->height) {
+      saved->height = mo->height;
+    }
+
+    if (mo->flags != rewound->flags) {
+      saved->flags = mo->flags;
+    }
+
+    load_transform(mo, saved);
   }
+
+  unlag_player_count = 0;
 }
 
 const char* SV_GetServerName(void) {
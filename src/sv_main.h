@@ -25,6 +25,7 @@
 #define SV_MAIN_H__
 
 extern int   sv_limit_player_commands;
+extern int   sv_allow_relays;
 extern char *sv_spectate_password;
 extern char *sv_join_password;
 extern char *sv_moderate_password;
@@ -32,8 +33,9 @@ extern char *sv_administrate_password;
 
 void           SV_CleanupOldCommandsAndStates(void);
 unsigned int   SV_GetPlayerCommandLimit(int playernum);
+void           SV_UnlagRecordTIC(void);
 void           SV_UnlagSetTIC(int tic);
-bool           SV_UnlagStart(void);
+bool           SV_UnlagStart(int shooter);
 void           SV_UnlagEnd(void);
 const char*    SV_GetServerName(void);
 const char*    SV_GetDirSrvGroup(const char *address, unsigned short port);
@@ -0,0 +1,239 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "w_lru.h"
+
+typedef struct lru_entry_s {
+  int    prev;
+  int    next;
+  size_t size;
+  bool   cached;
+  bool   evictable;
+} lru_entry_t;
+
+static lru_entry_t  *entries = NULL;
+static int           entry_count = 0;
+static int           head = -1;
+static int           tail = -1;
+static lump_evictor  evictor = NULL;
+static bool          budget_initialized = false;
+
+static lump_cache_stats_t stats;
+
+static void list_remove(int lump) {
+  lru_entry_t *entry = &entries[lump];
+
+  if (!entry->evictable)
+    return;
+
+  if (entry->prev != -1)
+    entries[entry->prev].next = entry->next;
+  else
+    head = entry->next;
+
+  if (entry->next != -1)
+    entries[entry->next].prev = entry->prev;
+  else
+    tail = entry->prev;
+
+  entry->prev = -1;
+  entry->next = -1;
+  entry->evictable = false;
+}
+
+static void list_push_head(int lump) {
+  lru_entry_t *entry = &entries[lump];
+
+  entry->prev = -1;
+  entry->next = head;
+  entry->evictable = true;
+
+  if (head != -1)
+    entries[head].prev = lump;
+  else
+    tail = lump;
+
+  head = lump;
+}
+
+/* Locked lumps aren't in the list, so they can exceed the budget */
+static void evict_to_budget(void) {
+  if (!stats.budget)
+    return;
+
+  while (stats.bytes_cached > stats.budget && tail != -1) {
+    int lump = tail;
+
+    W_LRURemove(lump);
+    stats.evictions++;
+
+    if (evictor)
+      evictor(lump);
+  }
+}
+
+void W_LRUInit(int lump_count, lump_evictor evict) {
+  int p;
+
+  W_LRUFree();
+
+  entries = calloc(lump_count, sizeof(lru_entry_t));
+
+  if (lump_count && !entries)
+    I_Error("W_LRUInit: Allocating LRU entries failed");
+
+  for (int i = 0; i < lump_count; i++) {
+    entries[i].prev = -1;
+    entries[i].next = -1;
+  }
+
+  entry_count = lump_count;
+  evictor = evict;
+
+  if (budget_initialized)
+    return;
+
+  budget_initialized = true;
+
+  if ((p = M_CheckParm("-lumpcache")) && p < myargc - 1)
+    stats.budget = (size_t)atoi(myargv[p + 1]) * 1024 * 1024;
+
+  if (stats.budget) {
+    D_Msg(MSG_INFO, "W_LRUInit: Lump cache budget is %zu MiB\n",
+      stats.budget / (1024 * 1024)
+    );
+  }
+}
+
+void W_LRUFree(void) {
+  free(entries);
+  entries = NULL;
+  entry_count = 0;
+  head = -1;
+  tail = -1;
+  evictor = NULL;
+  stats.bytes_cached = 0;
+  stats.lumps_cached = 0;
+}
+
+void W_LRUHit(void) {
+  stats.hits++;
+}
+
+/*
+ * W_LRUMiss
+ *
+ * Records a read of a lump the cache doesn't manage, so it counts towards the
+ * stats but not the budget.
+ */
+void W_LRUMiss(size_t size) {
+  stats.misses++;
+  stats.bytes_read += size;
+}
+
+/*
+ * W_LRUAdd
+ *
+ * Records that a lump was just read into the cache.  New lumps start out
+ * locked; call W_LRUUnlock once nothing's using them.
+ */
+void W_LRUAdd(int lump, size_t size) {
+  lru_entry_t *entry;
+
+#ifdef RANGECHECK
+  if (lump < 0 || lump >= entry_count)
+    I_Error("W_LRUAdd: lump %d out of range", lump);
+#endif
+
+  entry = &entries[lump];
+
+  if (entry->cached)
+    W_LRURemove(lump);
+
+  entry->cached = true;
+  entry->size = size;
+
+  W_LRUMiss(size);
+  stats.bytes_cached += size;
+  stats.lumps_cached++;
+
+  evict_to_budget();
+}
+
+void W_LRURemove(int lump) {
+  lru_entry_t *entry = &entries[lump];
+
+  if (!entry->cached)
+    return;
+
+  list_remove(lump);
+
+  stats.bytes_cached -= entry->size;
+  stats.lumps_cached--;
+
+  entry->cached = false;
+  entry->size = 0;
+}
+
+void W_LRULock(int lump) {
+  list_remove(lump);
+}
+
+void W_LRUUnlock(int lump) {
+  if (!entries[lump].cached)
+    return;
+
+  list_remove(lump);
+  list_push_head(lump);
+
+  evict_to_budget();
+}
+
+void W_SetLumpCacheBudget(size_t budget) {
+  budget_initialized = true;
+  stats.budget = budget;
+
+  evict_to_budget();
+}
+
+size_t W_GetLumpCacheBudget(void) {
+  return stats.budget;
+}
+
+void W_GetLumpCacheStats(lump_cache_stats_t *out) {
+  *out = stats;
+}
+
+void W_ResetLumpCacheStats(void) {
+  stats.hits = 0;
+  stats.misses = 0;
+  stats.bytes_read = 0;
+  stats.evictions = 0;
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -0,0 +1,55 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#ifndef W_LRU_H__
+#define W_LRU_H__
+
+typedef struct lump_cache_stats_s {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t bytes_read;
+  uint64_t evictions;
+  size_t   bytes_cached;
+  size_t   lumps_cached;
+  size_t   budget;
+} lump_cache_stats_t;
+
+typedef void (*lump_evictor)(int lump);
+
+void   W_LRUInit(int lump_count, lump_evictor evict);
+void   W_LRUFree(void);
+void   W_LRUHit(void);
+void   W_LRUMiss(size_t size);
+void   W_LRUAdd(int lump, size_t size);
+void   W_LRURemove(int lump);
+void   W_LRULock(int lump);
+void   W_LRUUnlock(int lump);
+
+void   W_SetLumpCacheBudget(size_t budget);
+size_t W_GetLumpCacheBudget(void);
+void   W_GetLumpCacheStats(lump_cache_stats_t *stats);
+void   W_ResetLumpCacheStats(void);
+
+#endif
+
+/* vi: set et ts=2 sw=2: */
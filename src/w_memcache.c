@@ -28,6 +28,7 @@
 #ifdef __GNUG__
 #pragma implementation "w_wad.h"
 #endif
+#include "w_lru.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
@@ -70,6 +71,22 @@ static void W_ReportLocks(void) {
 }
 #endif
 
+static void evict_lump(int lump) {
+  Z_Free(cachelump[lump].cache);
+}
+
+/* z_zone can purge cached lumps on its own, so the LRU has to hear of it */
+static void lump_purged(void **user) {
+  ptrdiff_t offset = (char *)user - (char *)cachelump;
+
+  if (!cachelump || offset < 0 ||
+      (size_t)offset >= numlumps * sizeof(*cachelump)) {
+    return;
+  }
+
+  W_LRURemove(offset / sizeof(*cachelump));
+}
+
 /* W_InitCache
  *
  * cph 2001/07/07 - split from W_Init
@@ -81,6 +98,9 @@ void W_InitCache(void)
   if (!cachelump)
     I_Error ("W_Init: Couldn't allocate lumpcache");
 
+  W_LRUInit(numlumps, evict_lump);
+  Z_SetPurgeNotifier(lump_purged);
+
 #ifdef TIMEDIAG
   atexit(W_ReportLocks);
 #endif
@@ -88,6 +108,8 @@ void W_InitCache(void)
 
 void W_DoneCache(void)
 {
+  Z_SetPurgeNotifier(NULL);
+  W_LRUFree();
 }
 
 /* W_CacheLumpNum
@@ -104,12 +126,18 @@ const void *W_CacheLumpNum(int lump)
     I_Error("W_CacheLumpNum: %i >= numlumps", lump);
 #endif
 
-  if (!cachelump[lump].cache)      // read the lump in
+  if (!cachelump[lump].cache) {    // read the lump in
     W_ReadLump(lump, Z_Malloc(W_LumpLength(lump), PU_CACHE, &cachelump[lump].cache));
+    W_LRUAdd(lump, W_LumpLength(lump));
+  }
+  else {
+    W_LRUHit();
+  }
 
   /* cph - if wasn't locked but now is, tell z_zone to hold it */
   if (!cachelump[lump].locks && locks) {
     Z_ChangeTag(cachelump[lump].cache,PU_STATIC);
+    W_LRULock(lump);
 #ifdef TIMEDIAG
     cachelump[lump].locktic = gametic;
 #endif
@@ -152,8 +180,10 @@ void W_UnlockLumpNum(int lump)
   /* cph - Note: must only tell z_zone to make purgeable if currently locked,
    * else it might already have been purged
    */
-  if (unlocks && !cachelump[lump].locks)
+  if (unlocks && !cachelump[lump].locks) {
     Z_ChangeTag(cachelump[lump].cache, PU_CACHE);
+    W_LRUUnlock(lump);
+  }
 }
 
 /* vi: set et ts=2 sw=2: */
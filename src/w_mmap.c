@@ -25,6 +25,7 @@
 
 #include "doomdef.h"
 #include "doomstat.h"
+#include "w_lru.h"
 #include "w_wad.h"
 #include "z_zone.h"
 #include "i_system.h"
@@ -37,6 +38,7 @@ static struct {
   int locktic;
 #endif
   int locks;
+  bool touched;
 } *cachelump;
 
 #ifdef HEAPDUMP
@@ -72,6 +74,91 @@ static void W_ReportLocks(void) {
 }
 #endif
 
+static const unsigned char* locate_lump(int lump, const unsigned char *map) {
+  lumpinfo_t *l = &lumpinfo[lump];
+
+  if (l->compression != LUMP_COMPRESSION_NONE && !l->located) {
+    wadfile_info_t *wf = g_ptr_array_index(resource_files, l->wadfile);
+
+    W_ZipLocateLump(l, map + l->position, M_FDLength(wf->handle));
+  }
+
+  return map + l->position;
+}
+
+/*
+ * Deflated PK3 members can't be mapped, so they're inflated into the cache and
+ * locked like W_LockLumpNum copies until W_UnlockLumpNum.
+ */
+static const void* cache_inflated_lump(int lump, const unsigned char *map) {
+  lumpinfo_t *l = &lumpinfo[lump];
+
+  if (!cachelump[lump].cache) {
+    Z_Malloc(MAX(l->size, 1), PU_STATIC, &cachelump[lump].cache);
+    W_ZipReadLump(l, locate_lump(lump, map), cachelump[lump].cache);
+    W_LRUAdd(lump, l->size);
+#ifdef TIMEDIAG
+    cachelump[lump].locktic = gametic;
+#endif
+    cachelump[lump].locks = 1;
+
+    return cachelump[lump].cache;
+  }
+
+  W_LRUHit();
+
+  if (cachelump[lump].locks <= 0) {
+    Z_ChangeTag(cachelump[lump].cache, PU_STATIC);
+    W_LRULock(lump);
+#ifdef TIMEDIAG
+    cachelump[lump].locktic = gametic;
+#endif
+    cachelump[lump].locks = 1;
+  }
+  else {
+    cachelump[lump].locks += 1;
+  }
+
+  return cachelump[lump].cache;
+}
+
+static void evict_lump(int lump) {
+  Z_Free(cachelump[lump].cache);
+}
+
+/* z_zone can purge cached lumps on its own, so the LRU has to hear of it */
+static void lump_purged(void **user) {
+  ptrdiff_t offset = (char *)user - (char *)cachelump;
+
+  if (!cachelump || offset < 0 ||
+      (size_t)offset >= numlumps * sizeof(*cachelump)) {
+    return;
+  }
+
+  W_LRURemove(offset / sizeof(*cachelump));
+}
+
+static void init_lump_locks(void) {
+  for (int i = 0; i < numlumps; i++) {
+    if (lumpinfo[i].compression == LUMP_COMPRESSION_ZIP_DEFLATED)
+      cachelump[i].locks = 0;
+    else
+      cachelump[i].locks = -1;
+  }
+}
+
+static void free_cached_lumps(void) {
+  Z_SetPurgeNotifier(NULL);
+
+  if (!cachelump)
+    return;
+
+  for (int i = 0; i < numlumps; i++) {
+    if (cachelump[i].cache)
+      Z_Free(cachelump[i].cache);
+  }
+}
+
 #ifdef _WIN32
 
 #include "wchar.h"
@@ -88,6 +175,9 @@ mmap_info_t *mapped_wad;
 void W_DoneCache(void) {
   size_t wadfile_count = resource_files->len;
 
+  free_cached_lumps();
+  W_LRUFree();
+
   if (cachelump) {
     free(cachelump);
     cachelump = NULL;
@@ -125,6 +215,10 @@ void W_InitCache(void) {
   if (!cachelump)
     I_Error("W_InitCache: Couldn't allocate lumpcache");
 
+  W_LRUInit(numlumps, evict_lump);
+  Z_SetPurgeNotifier(lump_purged);
+  init_lump_locks();
+
 #ifdef TIMEDIAG
   atexit(W_ReportLocks);
 #endif
@@ -135,7 +229,6 @@ void W_InitCache(void) {
   for (int i = 0; i < numlumps; i++) {
     int wad_index = (int)(lumpinfo[i].wadfile);
     wadfile_info_t *wadfile;
-    cachelump[i].locks = -1;
 
     if (lumpinfo[i].wadfile == -1)
       continue;
@@ -207,7 +300,7 @@ void W_InitCache(void) {
   }
 }
 
-const void* W_CacheLumpNum(int lump) {
+static const unsigned char* map_lump(int lump) {
   int wad_index = (int)(lumpinfo[lump].wadfile);
 
 #ifdef RANGECHECK
@@ -223,9 +316,7 @@ const void* W_CacheLumpNum(int lump) {
   if (lumpinfo[lump].wadfile == -1)
     return NULL;
 
-  return (void *)(
-    (unsigned char *)mapped_wad[wad_index].data + lumpinfo[lump].position
-  );
+  return mapped_wad[wad_index].data;
 }
 
 #else
@@ -241,6 +332,10 @@ void W_InitCache(void) {
   if (!cachelump)
     I_Error("W_InitCache: Couldn't allocate lumpcache");
 
+  W_LRUInit(numlumps, evict_lump);
+  Z_SetPurgeNotifier(lump_purged);
+  init_lump_locks();
+
 #ifdef TIMEDIAG
   atexit(W_ReportLocks);
 #endif
@@ -273,8 +368,6 @@ void W_InitCache(void) {
     void *map;
     wadfile_info_t *wf = NULL;
 
-    cachelump[i].locks = -1;
-
     if (lumpinfo[i].wadfile == -1)
       continue;
 
@@ -303,6 +396,9 @@ void W_InitCache(void) {
 }
 
 void W_DoneCache(void) {
+  free_cached_lumps();
+  W_LRUFree();
+
   for (int i = 0; i < numlumps; i++) {
     int fd;
     wadfile_info_t *wf;
@@ -330,7 +426,7 @@ void W_DoneCache(void) {
   mapped_wad = NULL;
 }
 
-const void* W_CacheLumpNum(int lump) {
+static const unsigned char* map_lump(int lump) {
   lumpinfo_t *l;
 
 #ifdef RANGECHECK
@@ -342,31 +438,62 @@ const void* W_CacheLumpNum(int lump) {
   if (l->wadfile == -1)
     return NULL;
 
-  return (const void *)(
-    ((const unsigned char *)(mapped_wad[l->wadfile])) + l->position
-  );
+  return mapped_wad[l->wadfile];
 }
 #endif
 
+/*
+ * Mapped lumps count as a miss the first time they're used, as that's when
+ * they're read in, and as a hit after that.
+ */
+const void* W_CacheLumpNum(int lump) {
+  const unsigned char *map = map_lump(lump);
+
+  if (!map)
+    return NULL;
+
+  if (lumpinfo[lump].compression == LUMP_COMPRESSION_ZIP_DEFLATED)
+    return cache_inflated_lump(lump, map);
+
+  if (cachelump[lump].touched) {
+    W_LRUHit();
+  }
+  else {
+    cachelump[lump].touched = true;
+    W_LRUMiss(lumpinfo[lump].size);
+  }
+
+  return locate_lump(lump, map);
+}
+
 /*
  * W_LockLumpNum
  *
  * This copies the lump into a malloced memory region and returns its address
  * instead of returning a pointer into the memory mapped area
  *
+ * Inflated PK3 lumps already live in the cache, so they're just locked.
+ *
  */
 const void* W_LockLumpNum(int lump) {
   size_t len = W_LumpLength(lump);
-  const void *data = W_CacheLumpNum(lump);
+
+  if (lumpinfo[lump].compression == LUMP_COMPRESSION_ZIP_DEFLATED)
+    return W_CacheLumpNum(lump);
 
   if (!cachelump[lump].cache) { // read the lump in
     Z_Malloc(len, PU_CACHE, &cachelump[lump].cache);
-    memcpy(cachelump[lump].cache, data, len);
+    memcpy(cachelump[lump].cache, locate_lump(lump, map_lump(lump)), len);
+    W_LRUAdd(lump, len);
+  }
+  else {
+    W_LRUHit();
   }
 
   /* cph - if wasn't locked but now is, tell z_zone to hold it */
   if (cachelump[lump].locks <= 0) {
     Z_ChangeTag(cachelump[lump].cache, PU_STATIC);
+    W_LRULock(lump);
 #ifdef TIMEDIAG
     cachelump[lump].locktic = gametic;
 #endif
@@ -403,8 +530,10 @@ void W_UnlockLumpNum(int lump) {
    * cph - Note: must only tell z_zone to make purgeable if currently locked,
    * else it might already have been purged
    */
-  if (cachelump[lump].locks == 0)
+  if (cachelump[lump].locks == 0) {
     Z_ChangeTag(cachelump[lump].cache, PU_CACHE);
+    W_LRUUnlock(lump);
+  }
 }
 
 /* vi: set et ts=2 sw=2: */
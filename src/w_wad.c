@@ -97,6 +97,7 @@ static int W_CoalesceMarkedResource(const char *start_marker,
     if (IsMarker(start_marker, lump->name)) {     // start marker found
       // If this is the first start marker, add start marker to marked lumps
       if (!num_marked) {
+        memset(marked, 0, sizeof(*marked));
         strncpy(marked->name, start_marker, 8);
         marked->size = 0;  // killough 3/20/98: force size to be 0
         marked->li_namespace = ns_global;        // killough 4/17/98
@@ -139,6 +140,7 @@ static int W_CoalesceMarkedResource(const char *start_marker,
   numlumps = num_unmarked + num_marked;           // new total number of lumps
 
   if (mark_end) {                                 // add end marker
+    memset(&lumpinfo[numlumps], 0, sizeof(lumpinfo_t));
     lumpinfo[numlumps].size = 0;  // killough 3/20/98: force size to be 0
     lumpinfo[numlumps].wadfile = -1;
     lumpinfo[numlumps].li_namespace = ns_global;   // killough 4/17/98
@@ -375,6 +377,11 @@ static void load_resource(size_t index) {
     }
   }
 
+  if (W_IsZipResource(wadfile->name)) {
+    W_AddZipLumps(index, flags);
+    return;
+  }
+
   if (strlen(wadfile->name) <=4 ||
 	    (strcasecmp(wadfile->name + strlen(wadfile->name) - 4,".wad") &&
 	     strcasecmp(wadfile->name + strlen(wadfile->name) - 4,".gwa"))) {
@@ -413,6 +420,9 @@ static void load_resource(size_t index) {
     lump_p->wadfile = index; //  killough 4/25/98
     lump_p->position = LittleLong(fileinfo->filepos);
     lump_p->size = LittleLong(fileinfo->size);
+    lump_p->compression = LUMP_COMPRESSION_NONE;
+    lump_p->compressed_size = lump_p->size;
+    lump_p->located = true;
 
     // Modifications to place command-line-added demo lumps
     // into a separate "ns_demos" namespace so that they cannot
@@ -516,6 +526,39 @@ int W_LumpLength (int lump) {
   return lumpinfo[lump].size;
 }
 
+static void read_zip_lump(wadfile_info_t *wadfile, lumpinfo_t *l,
+                                                   void *dest) {
+  unsigned char header[30];
+  unsigned char *data = dest;
+
+  if (!l->located) {
+    if (!M_Seek(wadfile->handle, l->position, SEEK_SET) ||
+        !M_Read(wadfile->handle, header, sizeof(header))) {
+      I_Error("W_ReadLump: read failed: %s\n", M_GetFileError());
+    }
+
+    W_ZipLocateLump(l, header, M_FDLength(wadfile->handle));
+  }
+
+  if (l->compression == LUMP_COMPRESSION_ZIP_DEFLATED) {
+    data = malloc(l->compressed_size);
+
+    if (!data)
+      I_Error("W_ReadLump: Allocating compressed lump buffer failed");
+  }
+
+  if (!M_Seek(wadfile->handle, l->position, SEEK_SET))
+    I_Error("W_ReadLump: seek failed: %s.\n", M_GetFileError());
+
+  if (!M_Read(wadfile->handle, data, l->compressed_size))
+    I_Error("W_ReadLump: read failed: %s\n", M_GetFileError());
+
+  if (data != dest) {
+    W_ZipReadLump(l, data, dest);
+    free(data);
+  }
+}
+
 //
 // W_ReadLump
 // Loads the lump into the given buffer,
@@ -540,6 +583,11 @@ void W_ReadLump(int lump, void *dest) {
   if (wadfile == NULL)
     return;
 
+  if (l->compression != LUMP_COMPRESSION_NONE) {
+    read_zip_lump(wadfile, l, dest);
+    return;
+  }
+
   if (!M_Seek(wadfile->handle, l->position, SEEK_SET))
     I_Error("W_ReadLump: seek failed: %s.\n", M_GetFileError());
 
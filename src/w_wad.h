@@ -96,6 +96,14 @@ typedef enum
   ns_hires //e6y
 } li_namespace_e; // haleyjd 05/21/02: renamed from "namespace"
 
+// How a lump is stored in its resource file.  WAD lumps are always
+// uncompressed; PK3 members are stored or deflated.
+typedef enum {
+  LUMP_COMPRESSION_NONE,
+  LUMP_COMPRESSION_ZIP_STORED,
+  LUMP_COMPRESSION_ZIP_DEFLATED,
+} lump_compression_e;
+
 typedef struct
 {
   // WARNING: order of some fields important (see info.c).
@@ -113,6 +121,12 @@ typedef struct
   int position;
   wad_source_t source;
   int flags; //e6y
+
+  // PK3 members: position is the member's local header offset until the
+  // lump is first read and W_ZipLocateLump() moves it to the data.
+  lump_compression_e compression;
+  int compressed_size;
+  bool located;
 } lumpinfo_t;
 
 // e6y: lump flags
@@ -156,6 +170,13 @@ void    W_UnlockLumpNum(int lump);
 unsigned W_LumpNameHash(const char *s);           // killough 1/31/98
 void W_HashLumps(void);                           // cph 2001/07/07 - made public
 
+// PK3 resources (w_zip.c)
+bool W_IsZipResource(const char *path);
+void W_AddZipLumps(size_t index, int flags);
+void W_ZipLocateLump(lumpinfo_t *l, const unsigned char *header,
+                                    size_t file_size);
+void W_ZipReadLump(lumpinfo_t *l, const unsigned char *data, void *dest);
+
 #endif
 
 /* vi: set et ts=2 sw=2: */
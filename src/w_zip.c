@@ -0,0 +1,399 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include <zlib.h>
+
+#include "doomdef.h"
+#include "i_system.h"
+#include "m_file.h"
+#include "w_wad.h"
+
+#define ZIP_EOCD_SIGNATURE    0x06054b50
+#define ZIP_CENTRAL_SIGNATURE 0x02014b50
+#define ZIP_LOCAL_SIGNATURE   0x04034b50
+
+#define ZIP_EOCD_SIZE          22
+#define ZIP_EOCD_SEARCH_SIZE  (ZIP_EOCD_SIZE + 0xFFFF)
+#define ZIP_CENTRAL_SIZE       46
+#define ZIP_LOCAL_SIZE         30
+
+#define ZIP_FLAG_ENCRYPTED 0x0001
+
+#define ZIP_METHOD_STORED   0
+#define ZIP_METHOD_DEFLATED 8
+
+/* Other top-level directories (e.g. filter/, acs/) are skipped */
+static const struct {
+  const char *folder;
+  li_namespace_e li_namespace;
+} zip_namespaces[] = {
+  { "sprites",   ns_sprites   },
+  { "flats",     ns_flats     },
+  { "colormaps", ns_colormaps },
+  { "hires",     ns_hires     },
+  { "graphics",  ns_global    },
+  { "patches",   ns_global    },
+  { "textures",  ns_global    },
+  { "sounds",    ns_global    },
+  { "music",     ns_global    },
+};
+
+#define ZIP_NAMESPACE_COUNT (sizeof(zip_namespaces) / sizeof(*zip_namespaces))
+
+static uint16_t zip_u16(const unsigned char *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t zip_u32(const unsigned char *p) {
+  return ((uint32_t)p[0]      ) |
+         ((uint32_t)p[1] <<  8) |
+         ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static bool zip_get_namespace(const char *name, size_t length,
+                                                li_namespace_e *li_namespace) {
+  const char *slash = memchr(name, '/', length);
+  size_t folder_length;
+
+  if (!slash) {
+    *li_namespace = ns_global;
+    return true;
+  }
+
+  folder_length = slash - name;
+
+  for (size_t i = 0; i < ZIP_NAMESPACE_COUNT; i++) {
+    if (strlen(zip_namespaces[i].folder) == folder_length &&
+        !strncasecmp(zip_namespaces[i].folder, name, folder_length)) {
+      *li_namespace = zip_namespaces[i].li_namespace;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Same rules as M_ExtractFileBase: uppercase, stop at '.', truncate at 8 */
+static void zip_get_lump_name(const char *name, size_t length, char *dest) {
+  const char *base = name;
+
+  for (size_t i = 0; i < length; i++) {
+    if (name[i] == '/')
+      base = name + i + 1;
+  }
+
+  memset(dest, 0, 9);
+
+  for (int i = 0; i < 8 && base < name + length && *base != '.'; i++)
+    dest[i] = toupper(*base++);
+}
+
+static uint32_t zip_find_eocd(wadfile_info_t *wadfile, unsigned char *eocd) {
+  uint32_t file_size = M_FDLength(wadfile->handle);
+  uint32_t search_size = MIN(file_size, ZIP_EOCD_SEARCH_SIZE);
+  uint32_t search_start = file_size - search_size;
+  unsigned char *tail;
+
+  if (file_size < ZIP_EOCD_SIZE)
+    I_Error("W_AddZipLumps: %s is too small to be a PK3", wadfile->name);
+
+  tail = malloc(search_size);
+
+  if (!tail)
+    I_Error("W_AddZipLumps: Allocating search buffer failed");
+
+  if (!M_Seek(wadfile->handle, search_start, SEEK_SET) ||
+      !M_Read(wadfile->handle, tail, search_size)) {
+    I_Error("W_AddZipLumps: Reading %s failed: %s",
+      wadfile->name, M_GetFileError()
+    );
+  }
+
+  /* The record ends with a variable-length comment, so scan backwards */
+  for (uint32_t i = search_size - ZIP_EOCD_SIZE + 1; i-- > 0;) {
+    if (zip_u32(tail + i) == ZIP_EOCD_SIGNATURE &&
+        i + ZIP_EOCD_SIZE + zip_u16(tail + i + 20) <= search_size) {
+      memcpy(eocd, tail + i, ZIP_EOCD_SIZE);
+      free(tail);
+      return search_start + i;
+    }
+  }
+
+  I_Error("W_AddZipLumps: %s has no ZIP central directory", wadfile->name);
+
+  return 0;
+}
+
+bool W_IsZipResource(const char *path) {
+  size_t length = strlen(path);
+
+  if (length <= 4)
+    return false;
+
+  return !strcasecmp(path + length - 4, ".pk3") ||
+         !strcasecmp(path + length - 4, ".zip");
+}
+
+/*
+ * W_AddZipLumps
+ *
+ * Indexes a PK3 from its central directory; nothing is read or inflated
+ * until a lump is first used.
+ */
+void W_AddZipLumps(size_t index, int flags) {
+  wadfile_info_t *wadfile = g_ptr_array_index(resource_files, index);
+  unsigned char eocd[ZIP_EOCD_SIZE];
+  unsigned char *directory;
+  const unsigned char *entry;
+  uint32_t eocd_position;
+  uint32_t directory_size;
+  uint32_t directory_position;
+  unsigned int entry_count;
+  int startlump = numlumps;
+  int skipped = 0;
+
+  eocd_position = zip_find_eocd(wadfile, eocd);
+
+  if (zip_u16(eocd + 4) != 0 || zip_u16(eocd + 6) != 0)
+    I_Error("W_AddZipLumps: Multi-disk archive %s is unsupported",
+      wadfile->name
+    );
+
+  entry_count = zip_u16(eocd + 10);
+  directory_size = zip_u32(eocd + 12);
+  directory_position = zip_u32(eocd + 16);
+
+  if (entry_count == 0xFFFF || directory_position == 0xFFFFFFFF)
+    I_Error("W_AddZipLumps: ZIP64 archive %s is unsupported", wadfile->name);
+
+  if (directory_position > eocd_position ||
+      directory_size > eocd_position - directory_position) {
+    I_Error("W_AddZipLumps: %s has an invalid central directory",
+      wadfile->name
+    );
+  }
+
+  directory = malloc(directory_size);
+
+  if (!directory)
+    I_Error("W_AddZipLumps: Allocating central directory failed");
+
+  if (!M_Seek(wadfile->handle, directory_position, SEEK_SET) ||
+      !M_Read(wadfile->handle, directory, directory_size)) {
+    I_Error("W_AddZipLumps: Reading %s failed: %s",
+      wadfile->name, M_GetFileError()
+    );
+  }
+
+  lumpinfo = realloc(lumpinfo, (numlumps + entry_count) * sizeof(lumpinfo_t));
+
+  if (!lumpinfo)
+    I_Error("W_AddZipLumps: Allocating lump info failed");
+
+  entry = directory;
+
+  for (unsigned int i = 0; i < entry_count; i++) {
+    const char *name;
+    size_t name_length;
+    size_t entry_size;
+    unsigned int zip_flags;
+    unsigned int method;
+    uint32_t compressed_size;
+    uint32_t size;
+    uint32_t header_position;
+    li_namespace_e li_namespace;
+    lumpinfo_t *lump_p;
+
+    if ((size_t)(entry - directory) + ZIP_CENTRAL_SIZE > directory_size ||
+        zip_u32(entry) != ZIP_CENTRAL_SIGNATURE) {
+      I_Error("W_AddZipLumps: %s has a corrupt central directory",
+        wadfile->name
+      );
+    }
+
+    name = (const char *)entry + ZIP_CENTRAL_SIZE;
+    name_length = zip_u16(entry + 28);
+    entry_size = ZIP_CENTRAL_SIZE +
+                 name_length +
+                 zip_u16(entry + 30) +
+                 zip_u16(entry + 32);
+
+    if ((size_t)(entry - directory) + entry_size > directory_size) {
+      I_Error("W_AddZipLumps: %s has a corrupt central directory",
+        wadfile->name
+      );
+    }
+
+    zip_flags = zip_u16(entry + 8);
+    method = zip_u16(entry + 10);
+    compressed_size = zip_u32(entry + 20);
+    size = zip_u32(entry + 24);
+    header_position = zip_u32(entry + 42);
+
+    entry += entry_size;
+
+    /* Folders */
+    if (name_length == 0 || name[name_length - 1] == '/')
+      continue;
+
+    if (!zip_get_namespace(name, name_length, &li_namespace)) {
+      skipped++;
+      continue;
+    }
+
+    if (zip_flags & ZIP_FLAG_ENCRYPTED) {
+      D_Msg(MSG_WARN, "W_AddZipLumps: Skipping encrypted member %.*s\n",
+        (int)name_length, name
+      );
+      continue;
+    }
+
+    if (method != ZIP_METHOD_STORED && method != ZIP_METHOD_DEFLATED) {
+      D_Msg(MSG_WARN,
+        "W_AddZipLumps: Skipping %.*s (unsupported compression method %u)\n",
+        (int)name_length, name, method
+      );
+      continue;
+    }
+
+    if (name_length > 4 &&
+        !strncasecmp(name + name_length - 4, ".wad", 4)) {
+      D_Msg(MSG_WARN, "W_AddZipLumps: Skipping nested WAD %.*s\n",
+        (int)name_length, name
+      );
+      continue;
+    }
+
+    if (size > INT_MAX || compressed_size > INT_MAX ||
+        header_position > INT_MAX ||
+        (method == ZIP_METHOD_STORED && compressed_size != size)) {
+      I_Error("W_AddZipLumps: %.*s in %s has invalid sizes",
+        (int)name_length, name, wadfile->name
+      );
+    }
+
+    lump_p = &lumpinfo[numlumps++];
+
+    zip_get_lump_name(name, name_length, lump_p->name);
+    lump_p->size = size;
+    lump_p->li_namespace = li_namespace;
+    lump_p->wadfile = index;
+    lump_p->position = header_position;
+    lump_p->source = wadfile->src;
+    lump_p->flags = flags;
+    lump_p->compressed_size = compressed_size;
+    lump_p->located = false;
+
+    if (method == ZIP_METHOD_STORED)
+      lump_p->compression = LUMP_COMPRESSION_ZIP_STORED;
+    else
+      lump_p->compression = LUMP_COMPRESSION_ZIP_DEFLATED;
+  }
+
+  free(directory);
+
+  if (numlumps > 0)
+    lumpinfo = realloc(lumpinfo, numlumps * sizeof(lumpinfo_t));
+
+  if (skipped) {
+    D_Msg(MSG_INFO, "  %d lumps (%d members in unknown folders skipped)\n",
+      numlumps - startlump, skipped
+    );
+  }
+}
+
+/*
+ * W_ZipLocateLump
+ *
+ * Moves a PK3 lump's position from its local header to its data.
+ */
+void W_ZipLocateLump(lumpinfo_t *l, const unsigned char *header,
+                                    size_t file_size) {
+  size_t data_position;
+
+  if (l->located)
+    return;
+
+  if ((size_t)l->position + ZIP_LOCAL_SIZE > file_size ||
+      zip_u32(header) != ZIP_LOCAL_SIGNATURE) {
+    I_Error("W_ZipLocateLump: %.8s has an invalid local header", l->name);
+  }
+
+  data_position = (size_t)l->position +
+                  ZIP_LOCAL_SIZE +
+                  zip_u16(header + 26) +
+                  zip_u16(header + 28);
+
+  if (data_position > file_size ||
+      (size_t)l->compressed_size > file_size - data_position ||
+      data_position > INT_MAX) {
+    I_Error("W_ZipLocateLump: %.8s extends past the end of its file",
+      l->name
+    );
+  }
+
+  l->position = data_position;
+  l->located = true;
+}
+
+/*
+ * W_ZipReadLump
+ *
+ * Copies or inflates a located PK3 lump's data (compressed_size bytes) into
+ * dest, which must hold at least l->size bytes.
+ */
+void W_ZipReadLump(lumpinfo_t *l, const unsigned char *data, void *dest) {
+  z_stream stream;
+  int res;
+
+  if (l->size == 0)
+    return;
+
+  if (l->compression == LUMP_COMPRESSION_ZIP_STORED) {
+    memcpy(dest, data, l->size);
+    return;
+  }
+
+  memset(&stream, 0, sizeof(z_stream));
+
+  /* ZIP members are raw deflate streams without a zlib header */
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    I_Error("W_ZipReadLump: Initializing zlib failed");
+
+  stream.next_in = (Bytef *)data;
+  stream.avail_in = l->compressed_size;
+  stream.next_out = dest;
+  stream.avail_out = l->size;
+
+  res = inflate(&stream, Z_FINISH);
+
+  inflateEnd(&stream);
+
+  if (res != Z_STREAM_END || stream.total_out != (uLong)l->size)
+    I_Error("W_ZipReadLump: Inflating %.8s failed (%d)", l->name, res);
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -993,13 +993,11 @@ void WI_drawNoState(void)
 //
 int WI_fragSum(int playernum)
 {
-  int   i;
   int   frags = 0;
 
-  for (i=0 ; i<MAXPLAYERS ; i++)
+  PLAYERS_FOR_EACH(i)
   {
-    if (playeringame[i]  // is this player playing?
-       && i!=playernum) // and it's not the player we're calculating
+    if (i!=playernum) // it's not the player we're calculating
     {
       frags += plrs[playernum].frags[i];
     }
@@ -1026,8 +1024,6 @@ static short int   *dm_totals;  // totals by player
 //
 void WI_initDeathmatchStats(void)
 {
-  int   i; // looping variables
-
   // CPhipps - allocate data structures needed
   dm_frags  = calloc(MAXPLAYERS, sizeof(*dm_frags));
   dm_totals = calloc(MAXPLAYERS, sizeof(*dm_totals));
@@ -1038,15 +1034,12 @@ void WI_initDeathmatchStats(void)
 
   cnt_pause = TICRATE;
 
-  for (i=0 ; i<MAXPLAYERS ; i++)
+  PLAYERS_FOR_EACH(i)
   {
-    if (playeringame[i])
-    {
-      // CPhipps - allocate frags line
-      dm_frags[i] = calloc(MAXPLAYERS, sizeof(**dm_frags)); // set all counts to zero
+    // CPhipps - allocate frags line
+    dm_frags[i] = calloc(MAXPLAYERS, sizeof(**dm_frags)); // set all counts to zero
 
-      dm_totals[i] = 0;
-    }
+    dm_totals[i] = 0;
   }
   WI_initAnimatedBack();
 }
@@ -1077,9 +1070,6 @@ void WI_endDeathmatchStats(void)
 //
 void WI_updateDeathmatchStats(void)
 {
-  int   i;
-  int   j;
-
   bool stillticking;
 
   WI_updateAnimatedBack();
@@ -1088,16 +1078,12 @@ void WI_updateDeathmatchStats(void)
   {
     acceleratestage = 0;
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    PLAYERS_FOR_EACH(i)
     {
-      if (playeringame[i])
-      {
-        for (j=0 ; j<MAXPLAYERS ; j++)
-          if (playeringame[j])
-            dm_frags[i][j] = plrs[i].frags[j];
+      PLAYERS_FOR_EACH(j)
+        dm_frags[i][j] = plrs[i].frags[j];
 
-        dm_totals[i] = WI_fragSum(i);
-      }
+      dm_totals[i] = WI_fragSum(i);
     }
 
 
@@ -1113,37 +1099,33 @@ void WI_updateDeathmatchStats(void)
 
     stillticking = false;
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    PLAYERS_FOR_EACH(i)
     {
-      if (playeringame[i])
+      PLAYERS_FOR_EACH(j)
       {
-        for (j=0 ; j<MAXPLAYERS ; j++)
+        if (dm_frags[i][j] != plrs[i].frags[j])
         {
-          if (playeringame[j]
-             && dm_frags[i][j] != plrs[i].frags[j])
-          {
-            if (plrs[i].frags[j] < 0)
-              dm_frags[i][j]--;
-            else
-              dm_frags[i][j]++;
+          if (plrs[i].frags[j] < 0)
+            dm_frags[i][j]--;
+          else
+            dm_frags[i][j]++;
 
-            if (dm_frags[i][j] > 999) // Ty 03/17/98 3-digit frag count
-              dm_frags[i][j] = 999;
+          if (dm_frags[i][j] > 999) // Ty 03/17/98 3-digit frag count
+            dm_frags[i][j] = 999;
 
-            if (dm_frags[i][j] < -999)
-              dm_frags[i][j] = -999;
+          if (dm_frags[i][j] < -999)
+            dm_frags[i][j] = -999;
 
-            stillticking = true;
-          }
+          stillticking = true;
         }
-        dm_totals[i] = WI_fragSum(i);
+      }
+      dm_totals[i] = WI_fragSum(i);
 
-        if (dm_totals[i] > 999)
-          dm_totals[i] = 999;
+      if (dm_totals[i] > 999)
+        dm_totals[i] = 999;
 
-        if (dm_totals[i] < -999)
-          dm_totals[i] = -999;  // Ty 03/17/98 end 3-digit frag count
-      }
+      if (dm_totals[i] < -999)
+        dm_totals[i] = -999;  // Ty 03/17/98 end 3-digit frag count
     }
 
     if (!stillticking)
@@ -1310,8 +1292,6 @@ static void WI_endNetgameStats(void)
 //
 void WI_initNetgameStats(void)
 {
-  int i;
-
   state = StatCount;
   acceleratestage = 0;
   ng_state = 1;
@@ -1324,9 +1304,8 @@ void WI_initNetgameStats(void)
   cnt_secret= calloc(MAXPLAYERS, sizeof(*cnt_secret));
   cnt_frags = calloc(MAXPLAYERS, sizeof(*cnt_frags));
 
-  for (i=0 ; i<MAXPLAYERS ; i++)
-    if (playeringame[i])
-      dofrags += WI_fragSum(i);
+  PLAYERS_FOR_EACH(i)
+    dofrags += WI_fragSum(i);
 
   dofrags = !!dofrags; // set to true or false - did we have frags?
 
@@ -1343,7 +1322,6 @@ void WI_initNetgameStats(void)
 //
 void WI_updateNetgameStats(void)
 {
-  int   i;
   int   fsum;
 
   bool stillticking;
@@ -1354,11 +1332,8 @@ void WI_updateNetgameStats(void)
   {
     acceleratestage = 0;
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    PLAYERS_FOR_EACH(i)
     {
-      if (!playeringame[i])
-        continue;
-
       cnt_kills[i] = (plrs[i].skills * 100) / wbs->maxkills;
       cnt_items[i] = (plrs[i].sitems * 100) / wbs->maxitems;
 
@@ -1379,11 +1354,8 @@ void WI_updateNetgameStats(void)
 
     stillticking = false;
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    PLAYERS_FOR_EACH(i)
     {
-      if (!playeringame[i])
-        continue;
-
       cnt_kills[i] += 2;
 
       if (cnt_kills[i] >= (plrs[i].skills * 100) / wbs->maxkills)
@@ -1405,11 +1377,8 @@ void WI_updateNetgameStats(void)
 
     stillticking = false;
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    PLAYERS_FOR_EACH(i)
     {
-      if (!playeringame[i])
-        continue;
-
       cnt_items[i] += 2;
       if (cnt_items[i] >= (plrs[i].sitems * 100) / wbs->maxitems)
         cnt_items[i] = (plrs[i].sitems * 100) / wbs->maxitems;
@@ -1430,11 +1399,8 @@ void WI_updateNetgameStats(void)
 
     stillticking = false;
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    PLAYERS_FOR_EACH(i)
     {
-      if (!playeringame[i])
-        continue;
-
       cnt_secret[i] += 2;
 
       // killough 2/22/98: Make secrets = 100% if maxsecret = 0:
@@ -1458,11 +1424,8 @@ void WI_updateNetgameStats(void)
 
     stillticking = false;
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    PLAYERS_FOR_EACH(i)
     {
-      if (!playeringame[i])
-        continue;
-
       cnt_frags[i] += 1;
 
       if (cnt_frags[i] >= (fsum = WI_fragSum(i)))
@@ -1510,7 +1473,6 @@ void WI_updateNetgameStats(void)
 // CPhipps - patch drawing updated
 void WI_drawNetgameStats(void)
 {
-  int   i;
   int   x;
   int   y;
   int   pwidth = V_NamePatchWidth(percent);
@@ -1540,12 +1502,9 @@ void WI_drawNetgameStats(void)
   // draw stats
   y = NG_STATSY + V_NamePatchHeight(kills);
 
-  for (i=0 ; i<MAXPLAYERS ; i++)
+  PLAYERS_FOR_EACH(i)
   {
     //int trans = playernumtotrans[i];
-    if (!playeringame[i])
-      continue;
-
     x = NG_STATSX;
     V_DrawNamePatch(x-fwidth, y, FB, facebackp,
        i ? CR_LIMIT+i : CR_DEFAULT,
@@ -1798,29 +1757,27 @@ void WI_drawStats(void)
 //
 void WI_checkForAccelerate(void) {
   // check for button presses to skip delays
-  for (int i = 0; i < MAXPLAYERS; i++) {
+  PLAYERS_FOR_EACH(i) {
     player_t *player = &players[i];
 
-    if (playeringame[i]) {
-      if (player->cmd.buttons & BT_ATTACK) {
-        if (!player->attackdown)
-          acceleratestage = 1;
+    if (player->cmd.buttons & BT_ATTACK) {
+      if (!player->attackdown)
+        acceleratestage = 1;
 
-        player->attackdown = true;
-      }
-      else {
-        player->attackdown = false;
-      }
+      player->attackdown = true;
+    }
+    else {
+      player->attackdown = false;
+    }
 
-      if (player->cmd.buttons & BT_USE) {
-        if (!player->usedown)
-          acceleratestage = 1;
+    if (player->cmd.buttons & BT_USE) {
+      if (!player->usedown)
+        acceleratestage = 1;
 
-        player->usedown = true;
-      }
-      else {
-        player->usedown = false;
-      }
+      player->usedown = true;
+    }
+    else {
+      player->usedown = false;
     }
   }
 }
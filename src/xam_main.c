@@ -46,7 +46,12 @@ void XAM_RegisterInterface(void) {
     "handle_event",                  X_FUNCTION, XAM_HandleEvent,
     "map_things_appearance_classic", X_INTEGER,  map_things_appearance_classic,
     "map_things_appearance_scaled",  X_INTEGER,  map_things_appearance_scaled,
+#if defined(HAVE_LIBSDL_IMAGE) && defined(GL_DOOM)
     "map_things_appearance_icon",    X_INTEGER,  map_things_appearance_icon
+#else
+    /* Scripts still refer to icons; fall back to scaled sprites */
+    "map_things_appearance_icon",    X_INTEGER,  map_things_appearance_scaled
+#endif
   );
 }
 
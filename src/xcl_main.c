@@ -23,8 +23,6 @@
 
 #include "z_zone.h"
 
-#include <enet/enet.h>
-
 #include "doomdef.h"
 #include "doomstat.h"
 #include "g_state.h"
@@ -107,9 +105,7 @@ static int XCL_SetBobbing(lua_State *L) {
 
 static int XCL_GetNetstats(lua_State *L) {
   netpeer_t *server = NULL;
-  float packet_loss;
-  float packet_loss_jitter;
-  ENetPeer *epeer = NULL;
+  net_peer_stats_t stats;
 
   if (!CLIENT) {
     return 0;
@@ -121,15 +117,9 @@ static int XCL_GetNetstats(lua_State *L) {
     return 0;
   }
 
-  epeer = N_PeerGetENetPeer(server);
-
-  packet_loss = epeer->packetLoss;
-  packet_loss = packet_loss / (float)ENET_PEER_PACKET_LOSS_SCALE;
-
-  packet_loss_jitter = epeer->packetLossVariance;
-  packet_loss_jitter = packet_loss_jitter / (float)ENET_PEER_PACKET_LOSS_SCALE;
+  N_PeerGetStats(server, &stats);
 
-  lua_createtable(L, 0, 18);
+  lua_createtable(L, 0, 21);
 
   lua_pushinteger(L, N_PeerGetBytesUploaded(server));
   lua_setfield(L, -2, "upload");
@@ -137,23 +127,23 @@ static int XCL_GetNetstats(lua_State *L) {
   lua_pushinteger(L, N_PeerGetBytesDownloaded(server));
   lua_setfield(L, -2, "download");
 
-  lua_pushinteger(L, epeer->lowestRoundTripTime);
+  lua_pushinteger(L, stats.lowest_round_trip_time);
   lua_setfield(L, -2, "ping_low");
 
-  lua_pushinteger(L, epeer->lastRoundTripTime);
+  lua_pushinteger(L, stats.last_round_trip_time);
   lua_setfield(L, -2, "ping_last");
 
-  /* lua_pushinteger(L, epeer->roundTripTime); */
+  /* lua_pushinteger(L, stats.round_trip_time); */
   lua_pushinteger(L, players[consoleplayer].ping);
   lua_setfield(L, -2, "ping_average");
 
-  lua_pushinteger(L, epeer->highestRoundTripTimeVariance);
+  lua_pushinteger(L, stats.highest_round_trip_time_variance);
   lua_setfield(L, -2, "jitter_high");
 
-  lua_pushinteger(L, epeer->lastRoundTripTimeVariance);
+  lua_pushinteger(L, stats.last_round_trip_time_variance);
   lua_setfield(L, -2, "jitter_last");
 
-  lua_pushinteger(L, epeer->roundTripTimeVariance);
+  lua_pushinteger(L, stats.round_trip_time_variance);
   lua_setfield(L, -2, "jitter_average");
 
   if (CLIENT) {
@@ -167,33 +157,53 @@ static int XCL_GetNetstats(lua_State *L) {
   lua_pushinteger(L, P_GetCommandCount(consoleplayer));
   lua_setfield(L, -2, "total_commands");
 
-  lua_pushnumber(L, packet_loss);
+  lua_pushinteger(L, P_GetCommandSpan(consoleplayer));
+  lua_setfield(L, -2, "command_span");
+
+  lua_pushnumber(L, stats.packet_loss);
   lua_setfield(L, -2, "packet_loss");
 
-  lua_pushnumber(L, packet_loss_jitter);
+  lua_pushnumber(L, stats.packet_loss_variance);
   lua_setfield(L, -2, "packet_loss_jitter");
 
-  lua_pushinteger(L, epeer->packetThrottle);
+  lua_pushinteger(L, stats.throttle);
   lua_setfield(L, -2, "throttle");
 
-  lua_pushinteger(L, epeer->packetThrottleAcceleration);
+  lua_pushinteger(L, stats.throttle_acceleration);
   lua_setfield(L, -2, "throttle_acceleration");
 
-  lua_pushinteger(L, epeer->packetThrottleCounter);
+  lua_pushinteger(L, stats.throttle_counter);
   lua_setfield(L, -2, "throttle_counter");
 
-  lua_pushinteger(L, epeer->packetThrottleDeceleration);
+  lua_pushinteger(L, stats.throttle_deceleration);
   lua_setfield(L, -2, "throttle_deceleration");
 
-  lua_pushinteger(L, epeer->packetThrottleInterval);
+  lua_pushinteger(L, stats.throttle_interval);
   lua_setfield(L, -2, "throttle_interval");
 
-  lua_pushinteger(L, epeer->packetThrottleLimit);
+  lua_pushinteger(L, stats.throttle_limit);
   lua_setfield(L, -2, "throttle_limit");
 
   lua_pushinteger(L, N_PeerGetSyncTIC(server));
   lua_setfield(L, -2, "server_tic");
 
+  lua_pushinteger(L, CL_GetPredictionHits());
+  lua_setfield(L, -2, "prediction_hits");
+
+  lua_pushinteger(L, CL_GetPredictionMisses());
+  lua_setfield(L, -2, "prediction_misses");
+
+  if (CL_GetPredictionHits() + CL_GetPredictionMisses()) {
+    lua_pushnumber(L,
+      (double)CL_GetPredictionHits() /
+      (CL_GetPredictionHits() + CL_GetPredictionMisses())
+    );
+  }
+  else {
+    lua_pushnumber(L, 0.0);
+  }
+  lua_setfield(L, -2, "prediction_hit_rate");
+
   return 1;
 }
 
@@ -0,0 +1,101 @@
+/*****************************************************************************/
+/* D2K: A Doom Source Port for the 21st Century                              */
+/*                                                                           */
+/* Copyright (C) 2014: See COPYRIGHT file                                    */
+/*                                                                           */
+/* This file is part of D2K.                                                 */
+/*                                                                           */
+/* D2K is free software: you can redistribute it and/or modify it under the  */
+/* terms of the GNU General Public License as published by the Free Software */
+/* Foundation, either version 2 of the License, or (at your option) any      */
+/* later version.                                                            */
+/*                                                                           */
+/* D2K is distributed in the hope that it will be useful, but WITHOUT ANY    */
+/* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS */
+/* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more    */
+/* details.                                                                  */
+/*                                                                           */
+/* You should have received a copy of the GNU General Public License along   */
+/* with D2K.  If not, see <http://www.gnu.org/licenses/>.                    */
+/*                                                                           */
+/*****************************************************************************/
+
+
+#include "z_zone.h"
+
+#include "w_lru.h"
+#include "x_intern.h"
+#include "x_main.h"
+
+static int XW_GetLumpCacheStats(lua_State *L) {
+  lump_cache_stats_t stats;
+
+  W_GetLumpCacheStats(&stats);
+
+  lua_createtable(L, 0, 8);
+
+  lua_pushinteger(L, stats.hits);
+  lua_setfield(L, -2, "hits");
+
+  lua_pushinteger(L, stats.misses);
+  lua_setfield(L, -2, "misses");
+
+  if (stats.hits + stats.misses) {
+    lua_pushnumber(L, (double)stats.hits / (stats.hits + stats.misses));
+  }
+  else {
+    lua_pushnumber(L, 0.0);
+  }
+  lua_setfield(L, -2, "hit_rate");
+
+  lua_pushinteger(L, stats.bytes_read);
+  lua_setfield(L, -2, "bytes_read");
+
+  lua_pushinteger(L, stats.evictions);
+  lua_setfield(L, -2, "evictions");
+
+  lua_pushinteger(L, stats.bytes_cached);
+  lua_setfield(L, -2, "bytes_cached");
+
+  lua_pushinteger(L, stats.lumps_cached);
+  lua_setfield(L, -2, "lumps_cached");
+
+  lua_pushinteger(L, stats.budget);
+  lua_setfield(L, -2, "budget");
+
+  return 1;
+}
+
+static int XW_ResetLumpCacheStats(lua_State *L) {
+  W_ResetLumpCacheStats();
+
+  return 0;
+}
+
+static int XW_GetLumpCacheBudget(lua_State *L) {
+  lua_pushinteger(L, W_GetLumpCacheBudget());
+
+  return 1;
+}
+
+static int XW_SetLumpCacheBudget(lua_State *L) {
+  lua_Integer budget = luaL_checkinteger(L, 1);
+
+  if (budget < 0)
+    return luaL_error(L, "Lump cache budget must be >= 0");
+
+  W_SetLumpCacheBudget(budget);
+
+  return 0;
+}
+
+void XW_RegisterInterface(void) {
+  X_RegisterObjects("Wad", 4,
+    "get_lump_cache_stats",   X_FUNCTION, XW_GetLumpCacheStats,
+    "reset_lump_cache_stats", X_FUNCTION, XW_ResetLumpCacheStats,
+    "get_lump_cache_budget",  X_FUNCTION, XW_GetLumpCacheBudget,
+    "set_lump_cache_budget",  X_FUNCTION, XW_SetLumpCacheBudget
+  );
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -82,6 +82,19 @@ static memblock_t *blockbytag[PU_MAX];
 static int memory_size = 0;
 static int free_memory = 0;
 
+/*
+ * Only locked while N_WorkRun has other threads running.  Recursive, since
+ * Z_Malloc can purge with Z_Free.
+ */
+static bool      zone_locking = false;
+static GRecMutex zone_lock;
+
+#define lock_zone()   if (zone_locking) g_rec_mutex_lock(&zone_lock)
+#define unlock_zone() if (zone_locking) g_rec_mutex_unlock(&zone_lock)
+
+/* Told about purgable blocks with a user just before they're freed */
+static zone_purge_notifier purge_notifier = NULL;
+
 #ifdef INSTRUMENTED
 
 // statistics for evaluating performance
@@ -247,6 +260,16 @@ void Z_Close(void)
 #endif
 }
 
+void Z_SetLocking(bool locking)
+{
+  zone_locking = locking;
+}
+
+void Z_SetPurgeNotifier(zone_purge_notifier notifier)
+{
+  purge_notifier = notifier;
+}
+
 void Z_Init(void)
 {
 #if 0
@@ -343,6 +366,8 @@ void *(Z_Malloc)(size_t size, int tag, void **user
 
   size = (size+CHUNK_SIZE-1) & ~(CHUNK_SIZE-1);  // round to chunk size
 
+  lock_zone();
+
   if (memory_size > 0 && ((free_memory + memory_size) < (int)(size + HEADER_SIZE)))
   {
     memblock_t *end_block;
@@ -427,6 +452,8 @@ void *(Z_Malloc)(size_t size, int tag, void **user
   memset(block, gametic & 0xff, size);
 #endif
 
+  unlock_zone();
+
   return block;
 }
 
@@ -450,6 +477,7 @@ void (Z_Free)(void *p
   if (!p)
     return;
 
+  lock_zone();
 
 #ifdef ZONEIDCHECK
   if (block->id != ZONEID)
@@ -463,6 +491,9 @@ void (Z_Free)(void *p
   block->id = 0;              // Nullify id so another free fails
 #endif
 
+  if (block->user && block->tag >= PU_PURGELEVEL && purge_notifier)
+    purge_notifier(block->user);
+
   if (block->user)            // Nullify user if one exists
     *block->user = NULL;
 
@@ -493,6 +524,8 @@ void (Z_Free)(void *p
 #ifdef INSTRUMENTED
       Z_DrawStats();           // print memory allocation stats
 #endif
+
+  unlock_zone();
 }
 
 void (Z_FreeTags)(int lowtag, int hightag
@@ -511,6 +544,8 @@ void (Z_FreeTags)(int lowtag, int hightag
   if (hightag > PU_CACHE)
     hightag = PU_CACHE;
 
+  lock_zone();
+
   for (;lowtag <= hightag; lowtag++)
   {
     memblock_t *block, *end_block;
@@ -531,6 +566,8 @@ void (Z_FreeTags)(int lowtag, int hightag
       block = next;               // Advance to next block
     }
   }
+
+  unlock_zone();
 }
 
 void (Z_ChangeTag)(void *ptr, int tag
@@ -576,6 +613,8 @@ void (Z_ChangeTag)(void *ptr, int tag
 
 #endif // ZONEIDCHECK
 
+  lock_zone();
+
   if (block == block->next)
     blockbytag[block->tag] = NULL;
   else if (blockbytag[block->tag] == block)
@@ -612,6 +651,8 @@ void (Z_ChangeTag)(void *ptr, int tag
 #endif
 
   block->tag = tag;
+
+  unlock_zone();
 }
 
 void *(Z_Realloc)(void *ptr, size_t n, int tag, void **user
@@ -140,6 +140,9 @@ void (Z_FreeTags)(int lowtag, int hightag DA(const char *, int));
 void (Z_ChangeTag)(void *ptr, int tag DA(const char *, int));
 void (Z_Init)(void);
 void Z_Close(void);
+void Z_SetLocking(bool locking);
+typedef void (*zone_purge_notifier)(void **user);
+void Z_SetPurgeNotifier(zone_purge_notifier notifier);
 void *(Z_Calloc)(size_t n, size_t n2, int tag, void **user DA(const char *, int));
 void *(Z_Realloc)(void *p, size_t n, int tag, void **user DA(const char *, int));
 char *(Z_Strdup)(const char *s, int tag, void **user DA(const char *, int));
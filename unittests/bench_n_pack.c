@@ -0,0 +1,175 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *  Benchmarks for net message packing
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+#include "z_zone.h"
+
+#include "doomdef.h"
+#include "m_bitmap.h"
+#include "n_main.h"
+
+#define PLAYER_SET_ITERATIONS 2000
+
+typedef enum {
+  PLAYER_LAYOUT_SCATTERED,
+  PLAYER_LAYOUT_PACKED,
+  PLAYER_LAYOUT_CLUSTERED,
+  PLAYER_LAYOUT_MAX
+} player_layout_e;
+
+static const char *player_layout_names[PLAYER_LAYOUT_MAX] = {
+  "scattered", "packed", "clustered"
+};
+
+static const char *player_set_encoding_names[PLAYER_SET_ENCODING_MAX] = {
+  "indices", "runs", "bitmap"
+};
+
+/* Scattered is a long-running server; clustered is runs of 8 adjacent slots */
+static void build_player_set(uint8_t *bitmap, size_t size,
+                                              unsigned int count,
+                                              player_layout_e layout) {
+  unsigned int added = 0;
+  unsigned int base = 0;
+
+  memset(bitmap, 0, size);
+
+  while (added < count) {
+    unsigned int playernum;
+
+    /* Every cluster is taken, so spread the rest out */
+    if (layout == PLAYER_LAYOUT_CLUSTERED &&
+        added >= (MAXPLAYERS / 16) * 8) {
+      layout = PLAYER_LAYOUT_SCATTERED;
+    }
+
+    switch (layout) {
+      case PLAYER_LAYOUT_SCATTERED:
+        playernum = rand() % MAXPLAYERS;
+      break;
+      case PLAYER_LAYOUT_PACKED:
+        playernum = added;
+      break;
+      case PLAYER_LAYOUT_CLUSTERED:
+      default:
+        if ((added % 8) == 0) {
+          base = (rand() % (MAXPLAYERS / 16)) * 16;
+        }
+
+        playernum = base + (added % 8);
+      break;
+    }
+
+    if (bitmap_get_bit(bitmap, playernum)) {
+      continue;
+    }
+
+    bitmap_set_bit(bitmap, playernum);
+    added++;
+  }
+}
+
+static double time_player_set(pbuf_t *pbuf, uint8_t *bitmap,
+                                            player_set_encoding_e encoding) {
+  def_bitmap(out, MAXPLAYERS);
+  gint64 start = g_get_monotonic_time();
+
+  for (int i = 0; i < PLAYER_SET_ITERATIONS; i++) {
+    M_PBufClear(pbuf);
+    N_PackPlayerSetAs(pbuf, bitmap, encoding);
+    M_PBufSeek(pbuf, 0);
+
+    if (!N_UnpackPlayerSet(pbuf, out)) {
+      printf("Error unpacking %s player set\n",
+        player_set_encoding_names[encoding]
+      );
+      break;
+    }
+  }
+
+  return ((g_get_monotonic_time() - start) * 1000.0) / PLAYER_SET_ITERATIONS;
+}
+
+void bench_n_pack_player_sets(void) {
+  static const unsigned int counts[] = {
+    0, 1, 2, 4, 8, 16, 32, 64, 96, 128, 160, 192, 256, 384, 512, 1000, 1500,
+    MAXPLAYERS
+  };
+  def_bitmap(bitmap, MAXPLAYERS);
+  pbuf_t pbuf;
+
+  M_PBufInit(&pbuf);
+  srand(1);
+
+  for (int layout = 0; layout < PLAYER_LAYOUT_MAX; layout++) {
+    int crossover = -1;
+
+    printf("Player set layout: %s\n", player_layout_names[layout]);
+    printf("  %7s %22s %22s %22s %8s\n",
+      "players", "indices B/ns", "runs B/ns", "bitmap B/ns", "chosen"
+    );
+
+    for (size_t i = 0; i < sizeof(counts) / sizeof(*counts); i++) {
+      player_set_encoding_e chosen;
+
+      build_player_set(bitmap, sizeof(bitmap), counts[i], layout);
+      chosen = N_ChoosePlayerSetEncoding(bitmap);
+
+      printf("  %7u", counts[i]);
+
+      for (int e = 0; e < PLAYER_SET_ENCODING_MAX; e++) {
+        printf(" %12zu/%9.1f",
+          N_GetPlayerSetSize(bitmap, e),
+          time_player_set(&pbuf, bitmap, e)
+        );
+      }
+
+      printf(" %8s\n", player_set_encoding_names[chosen]);
+
+      if (crossover == -1 && chosen == PLAYER_SET_BITMAP) {
+        crossover = counts[i];
+      }
+    }
+
+    if (crossover == -1) {
+      printf("  Bitmap never wins\n\n");
+    }
+    else {
+      printf("  Bitmap wins from %d players\n\n", crossover);
+    }
+  }
+
+  M_PBufFree(&pbuf);
+}
+
+/* vi: set et ts=2 sw=2: */
@@ -34,7 +34,82 @@
 
 #include "z_zone.h"
 
+#include "CuTest.h"
+
+CuSuite* M_PBufGetSuite(void);
+CuSuite* N_PackGetSuite(void);
+
+void bench_n_pack_player_sets(void);
+
+/* With arguments, only tests whose names start with one of them run */
+static void select_tests(CuSuite *suite, int argc, char **argv) {
+  int count = 0;
+
+  if (argc < 2) {
+    return;
+  }
+
+  for (int i = 0; i < suite->count; i++) {
+    CuTest *test = suite->list[i];
+    bool selected = false;
+
+    for (int j = 1; j < argc; j++) {
+      if (strncmp(test->name, argv[j], strlen(argv[j])) == 0) {
+        selected = true;
+        break;
+      }
+    }
+
+    suite->list[i] = NULL;
+
+    if (selected) {
+      suite->list[count++] = test;
+    }
+    else {
+      CuTestDelete(test);
+    }
+  }
+
+  suite->count = count;
+}
+
 int main(int argc, char **argv) {
+  CuString *output;
+  CuSuite *suite;
+  int failed;
+
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    bench_n_pack_player_sets();
+    return EXIT_SUCCESS;
+  }
+
+  output = CuStringNew();
+  suite = CuSuiteNew();
+  CuSuiteAddSuite(suite, M_PBufGetSuite());
+  CuSuiteAddSuite(suite, N_PackGetSuite());
+  select_tests(suite, argc, argv);
+
+  if (suite->count == 0) {
+    printf("No tests match\n");
+    CuSuiteDelete(suite);
+    CuStringDelete(output);
+    return EXIT_FAILURE;
+  }
+
+  CuSuiteRun(suite);
+  CuSuiteSummary(suite, output);
+  CuSuiteDetails(suite, output);
+  printf("%s\n", output->buffer);
+
+  failed = suite->failCount;
+
+  CuSuiteDelete(suite);
+  CuStringDelete(output);
+
+  if (failed) {
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
 
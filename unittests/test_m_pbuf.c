@@ -0,0 +1,322 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *  Tests for the pbuf record writer and batch reader
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+
+#include "z_zone.h"
+
+#include "CuTest.h"
+
+static const int64_t signed_values[] = {
+  0, 1, 31, 32, 127, 128, 255, 256, 32767, 32768, 65535, 65536,
+  2147483647, -1, -31, -32, -33, -127, -128, -129, -32767, -32768, -32769,
+  -2147483647 - 1, 4294967295LL, 4294967296LL, -2147483649LL,
+  INT64_MAX, INT64_MIN
+};
+
+static const uint64_t unsigned_values[] = {
+  0, 1, 127, 128, 255, 256, 65535, 65536, 2147483647, 2147483648U,
+  4294967295U, 4294967296ULL, UINT64_MAX
+};
+
+static void assert_pbufs_equal(CuTest *tc, pbuf_t *expected,
+                                           pbuf_t *actual) {
+  CuAssertIntEquals(tc, M_PBufGetSize(expected), M_PBufGetSize(actual));
+  CuAssertIntEquals(tc, M_PBufGetCursor(expected), M_PBufGetCursor(actual));
+  CuAssertTrue(tc, memcmp(
+    M_PBufGetData(expected), M_PBufGetData(actual), M_PBufGetSize(actual)
+  ) == 0);
+}
+
+static void test_record_numbers(CuTest *tc) {
+  size_t signed_count = sizeof(signed_values) / sizeof(*signed_values);
+  size_t unsigned_count = sizeof(unsigned_values) / sizeof(*unsigned_values);
+  pbuf_t expected;
+  pbuf_t actual;
+  pbuf_record_t record;
+
+  M_PBufInit(&expected);
+  M_PBufInit(&actual);
+
+  for (size_t i = 0; i < signed_count; i++) {
+    M_PBufWriteNum(&expected, signed_values[i]);
+  }
+
+  for (size_t i = 0; i < unsigned_count; i++) {
+    M_PBufWriteUNum(&expected, unsigned_values[i]);
+  }
+
+  M_PBufBeginRecord(&actual, &record, signed_count + unsigned_count);
+
+  for (size_t i = 0; i < signed_count; i++) {
+    M_PBufRecordWriteNum(&record, signed_values[i]);
+  }
+
+  for (size_t i = 0; i < unsigned_count; i++) {
+    M_PBufRecordWriteUNum(&record, unsigned_values[i]);
+  }
+
+  M_PBufEndRecord(&record);
+
+  assert_pbufs_equal(tc, &expected, &actual);
+
+  M_PBufFree(&expected);
+  M_PBufFree(&actual);
+}
+
+static void test_record_types(CuTest *tc) {
+  pbuf_t expected;
+  pbuf_t actual;
+  pbuf_record_t record;
+
+  M_PBufInit(&expected);
+  M_PBufInit(&actual);
+
+  /* Records append after whatever's already in the buffer */
+  M_PBufWriteString(&expected, "header", 6);
+  M_PBufWriteString(&actual, "header", 6);
+
+  M_PBufWriteInt(&expected, -2147483647 - 1);
+  M_PBufWriteUInt(&expected, 4294967295U);
+  M_PBufWriteShort(&expected, -32768);
+  M_PBufWriteShort(&expected, 32767);
+  M_PBufWriteUShort(&expected, 65535);
+  M_PBufWriteUChar(&expected, 200);
+  M_PBufWriteULong(&expected, UINT64_MAX);
+  M_PBufWriteBool(&expected, true);
+  M_PBufWriteBool(&expected, false);
+  M_PBufWriteInt(&expected, 12);
+
+  M_PBufBeginRecord(&actual, &record, 10);
+  M_PBufRecordWriteInt(&record, -2147483647 - 1);
+  M_PBufRecordWriteUInt(&record, 4294967295U);
+  M_PBufRecordWriteShort(&record, -32768);
+  M_PBufRecordWriteShort(&record, 32767);
+  M_PBufRecordWriteUShort(&record, 65535);
+  M_PBufRecordWriteUChar(&record, 200);
+  M_PBufRecordWriteULong(&record, UINT64_MAX);
+  M_PBufRecordWriteBool(&record, true);
+  M_PBufRecordWriteBool(&record, false);
+  M_PBufEndRecord(&record);
+
+  /* And the pbuf carries on as normal afterwards */
+  M_PBufWriteInt(&actual, 12);
+
+  assert_pbufs_equal(tc, &expected, &actual);
+
+  M_PBufFree(&expected);
+  M_PBufFree(&actual);
+}
+
+static void test_reader_round_trip(CuTest *tc) {
+  pbuf_t pbuf;
+  pbuf_reader_t reader;
+  int i = 0;
+  unsigned int u = 0;
+  short s = 0;
+  unsigned short us = 0;
+  unsigned char c = 0;
+  uint64_t l = 0;
+  bool b = false;
+
+  M_PBufInit(&pbuf);
+
+  for (size_t j = 0; j < sizeof(signed_values) / sizeof(*signed_values); j++) {
+    int value = (int)signed_values[j];
+
+    M_PBufWriteInt(&pbuf, value);
+    M_PBufWriteShort(&pbuf, (short)value);
+    M_PBufWriteUInt(&pbuf, (unsigned int)value);
+    M_PBufWriteULong(&pbuf, (uint64_t)signed_values[j]);
+  }
+
+  M_PBufWriteUShort(&pbuf, 65535);
+  M_PBufWriteUChar(&pbuf, 255);
+  M_PBufWriteBool(&pbuf, true);
+  M_PBufWriteInt(&pbuf, 99);
+
+  M_PBufSeek(&pbuf, 0);
+  M_PBufBeginReader(&pbuf, &reader);
+
+  for (size_t j = 0; j < sizeof(signed_values) / sizeof(*signed_values); j++) {
+    int value = (int)signed_values[j];
+
+    CuAssertTrue(tc, M_PBufReaderReadInt(&reader, &i));
+    CuAssertIntEquals(tc, value, i);
+    CuAssertTrue(tc, M_PBufReaderReadShort(&reader, &s));
+    CuAssertIntEquals(tc, (short)value, s);
+    CuAssertTrue(tc, M_PBufReaderReadUInt(&reader, &u));
+    CuAssertTrue(tc, u == (unsigned int)value);
+    CuAssertTrue(tc, M_PBufReaderReadULong(&reader, &l));
+    CuAssertTrue(tc, l == (uint64_t)signed_values[j]);
+  }
+
+  CuAssertTrue(tc, M_PBufReaderReadUShort(&reader, &us));
+  CuAssertIntEquals(tc, 65535, us);
+  CuAssertTrue(tc, M_PBufReaderReadUChar(&reader, &c));
+  CuAssertIntEquals(tc, 255, c);
+  CuAssertTrue(tc, M_PBufReaderReadBool(&reader, &b));
+  CuAssertTrue(tc, b);
+  CuAssertTrue(tc, M_PBufEndReader(&reader));
+
+  /* The reader leaves the cursor where it stopped */
+  CuAssertTrue(tc, M_PBufReadInt(&pbuf, &i));
+  CuAssertIntEquals(tc, 99, i);
+  CuAssertTrue(tc, M_PBufAtEOF(&pbuf));
+
+  M_PBufFree(&pbuf);
+}
+
+static void test_reader_errors(CuTest *tc) {
+  pbuf_t pbuf;
+  pbuf_t truncated;
+  pbuf_reader_t reader;
+  int i = 0;
+  short s = 0;
+  unsigned int u = 0;
+  bool b = false;
+
+  M_PBufInit(&pbuf);
+
+  /* Out of range for the type it's read as */
+  M_PBufWriteInt(&pbuf, 40000);
+  M_PBufSeek(&pbuf, 0);
+  M_PBufBeginReader(&pbuf, &reader);
+  CuAssertTrue(tc, !M_PBufReaderReadShort(&reader, &s));
+  CuAssertTrue(tc, !M_PBufEndReader(&reader));
+
+  M_PBufClear(&pbuf);
+  M_PBufWriteInt(&pbuf, -1);
+  M_PBufSeek(&pbuf, 0);
+  M_PBufBeginReader(&pbuf, &reader);
+  CuAssertTrue(tc, !M_PBufReaderReadUInt(&reader, &u));
+  CuAssertTrue(tc, !M_PBufEndReader(&reader));
+
+  /* Wrong type */
+  M_PBufClear(&pbuf);
+  M_PBufWriteInt(&pbuf, 1);
+  M_PBufSeek(&pbuf, 0);
+  M_PBufBeginReader(&pbuf, &reader);
+  CuAssertTrue(tc, !M_PBufReaderReadBool(&reader, &b));
+  CuAssertTrue(tc, !M_PBufEndReader(&reader));
+
+  /* Truncated, and errors stick */
+  M_PBufClear(&pbuf);
+  M_PBufWriteInt(&pbuf, 100000);
+  M_PBufWriteInt(&pbuf, 1);
+  M_PBufInit(&truncated);
+  M_PBufSetData(&truncated, M_PBufGetData(&pbuf), 3);
+  M_PBufSeek(&truncated, 0);
+  M_PBufBeginReader(&truncated, &reader);
+  CuAssertTrue(tc, !M_PBufReaderReadInt(&reader, &i));
+  CuAssertTrue(tc, !M_PBufReaderReadInt(&reader, &i));
+  CuAssertTrue(tc, !M_PBufEndReader(&reader));
+
+  M_PBufFree(&truncated);
+  M_PBufFree(&pbuf);
+}
+
+static void test_read_bytes_slice(CuTest *tc) {
+  static const char blob[] = "borrowed state data";
+  pbuf_t pbuf;
+  pbuf_t truncated;
+  const char *data = NULL;
+  size_t size = 0;
+  int i = 0;
+
+  M_PBufInit(&pbuf);
+  M_PBufWriteBytes(&pbuf, blob, sizeof(blob));
+  M_PBufWriteInt(&pbuf, 7);
+  M_PBufSeek(&pbuf, 0);
+
+  /* The slice points into the pbuf and the cursor moves past it */
+  CuAssertTrue(tc, M_PBufReadBytesSlice(&pbuf, &data, &size));
+  CuAssertIntEquals(tc, sizeof(blob), size);
+  CuAssertTrue(tc, data > M_PBufGetData(&pbuf));
+  CuAssertTrue(tc, data + size <= M_PBufGetData(&pbuf) + M_PBufGetSize(&pbuf));
+  CuAssertTrue(tc, memcmp(data, blob, size) == 0);
+  CuAssertTrue(tc, M_PBufReadInt(&pbuf, &i));
+  CuAssertIntEquals(tc, 7, i);
+
+  /* Binary data running past the end of the buffer is rejected */
+  M_PBufInit(&truncated);
+  M_PBufSetData(&truncated, M_PBufGetData(&pbuf), sizeof(blob));
+  M_PBufSeek(&truncated, 0);
+  CuAssertTrue(tc, !M_PBufReadBytesSlice(&truncated, &data, &size));
+
+  M_PBufFree(&truncated);
+  M_PBufFree(&pbuf);
+}
+
+static void test_read_bytes_slice_view(CuTest *tc) {
+  static const char blob[] = "delta";
+  pbuf_t pbuf;
+  buf_t view;
+  const char *data = NULL;
+  const char *part = NULL;
+  size_t size = 0;
+  char c = 0;
+
+  M_PBufInit(&pbuf);
+  M_PBufWriteBytes(&pbuf, blob, sizeof(blob));
+  M_PBufSeek(&pbuf, 0);
+  CuAssertTrue(tc, M_PBufReadBytesSlice(&pbuf, &data, &size));
+
+  M_BufferInitView(&view, data, size);
+  CuAssertIntEquals(tc, sizeof(blob), M_BufferGetSize(&view));
+  CuAssertTrue(tc, M_BufferReadChar(&view, &c));
+  CuAssertIntEquals(tc, 'd', c);
+  CuAssertTrue(tc, M_BufferReadSlice(&view, 3, &part));
+  CuAssertTrue(tc, part == data + 1);
+  CuAssertTrue(tc, memcmp(part, "elt", 3) == 0);
+  CuAssertTrue(tc, !M_BufferReadSlice(&view, 3, &part));
+  CuAssertTrue(tc, M_BufferReadSlice(&view, 2, &part));
+  CuAssertTrue(tc, !M_BufferReadChar(&view, &c));
+
+  M_PBufFree(&pbuf);
+}
+
+CuSuite* M_PBufGetSuite(void) {
+  CuSuite *suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, test_record_numbers);
+  SUITE_ADD_TEST(suite, test_record_types);
+  SUITE_ADD_TEST(suite, test_reader_round_trip);
+  SUITE_ADD_TEST(suite, test_reader_errors);
+  SUITE_ADD_TEST(suite, test_read_bytes_slice);
+  SUITE_ADD_TEST(suite, test_read_bytes_slice_view);
+
+  return suite;
+}
+
+/* vi: set et ts=2 sw=2: */
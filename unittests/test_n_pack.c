@@ -0,0 +1,267 @@
+/* Emacs style mode select   -*- C++ -*-
+ *-----------------------------------------------------------------------------
+ *
+ *
+ *  PrBoom: a Doom port merged with LxDoom and LSDLDoom
+ *  based on BOOM, a modified and improved DOOM engine
+ *  Copyright (C) 1999 by
+ *  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+ *  Copyright (C) 1999-2000 by
+ *  Jess Haas, Nicolas Kalkhof, Colin Phipps, Florian Schulze
+ *  Copyright 2005, 2006 by
+ *  Florian Schulze, Colin Phipps, Neil Stevens, Andrey Budko
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ *  02111-1307, USA.
+ *
+ * DESCRIPTION:
+ *  Tests for net message packing
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+
+#include "z_zone.h"
+
+#include "CuTest.h"
+
+#include "doomdef.h"
+#include "m_bitmap.h"
+#include "n_main.h"
+#include "p_user.h"
+
+#define COMMAND_COUNT 64
+
+static void set_ncmd(netticcmd_t *ncmd, unsigned int index,
+                                        unsigned int tic,
+                                        unsigned int server_tic,
+                                        char forward,
+                                        char side,
+                                        short angle,
+                                        unsigned char buttons) {
+  ncmd->index      = index;
+  ncmd->tic        = tic;
+  ncmd->server_tic = server_tic;
+  ncmd->forward    = forward;
+  ncmd->side       = side;
+  ncmd->angle      = angle;
+  ncmd->buttons    = buttons;
+}
+
+static void assert_ncmd_equals(CuTest *tc, netticcmd_t *expected,
+                                           netticcmd_t *actual) {
+  CuAssertIntEquals(tc, expected->index,      actual->index);
+  CuAssertIntEquals(tc, expected->tic,        actual->tic);
+  CuAssertIntEquals(tc, expected->server_tic, actual->server_tic);
+  CuAssertIntEquals(tc, expected->forward,    actual->forward);
+  CuAssertIntEquals(tc, expected->side,       actual->side);
+  CuAssertIntEquals(tc, expected->angle,      actual->angle);
+  CuAssertIntEquals(tc, expected->buttons,    actual->buttons);
+}
+
+static void pack_ncmds(pbuf_t *pbuf, netticcmd_t *ncmds, size_t count) {
+  M_PBufClear(pbuf);
+
+  for (size_t i = 0; i < count; i++) {
+    N_PackCommand(pbuf, i > 0 ? &ncmds[i - 1] : NULL, &ncmds[i]);
+  }
+
+  M_PBufSeek(pbuf, 0);
+}
+
+static void assert_ncmds_round_trip(CuTest *tc, pbuf_t *pbuf,
+                                                netticcmd_t *ncmds,
+                                                size_t count) {
+  netticcmd_t ncmd;
+
+  pack_ncmds(pbuf, ncmds, count);
+
+  for (size_t i = 0; i < count; i++) {
+    CuAssertTrue(tc, N_UnpackCommand(pbuf, i > 0 ? &ncmd : NULL, &ncmd));
+    assert_ncmd_equals(tc, &ncmds[i], &ncmd);
+  }
+
+  CuAssertTrue(tc, M_PBufAtEOF(pbuf));
+}
+
+static void test_command_steady_state(CuTest *tc) {
+  netticcmd_t ncmds[COMMAND_COUNT];
+  pbuf_t pbuf;
+
+  M_PBufInit(&pbuf);
+
+  for (int i = 0; i < COMMAND_COUNT; i++) {
+    set_ncmd(&ncmds[i], 4096 + i, 4012 + i, 0, 50, 0, 180 + (i * 3), 1);
+  }
+
+  assert_ncmds_round_trip(tc, &pbuf, ncmds, COMMAND_COUNT);
+
+  /* After the first command, only the flags and the angle delta remain */
+  pack_ncmds(&pbuf, ncmds, 1);
+  size_t first_size = M_PBufGetSize(&pbuf);
+  pack_ncmds(&pbuf, ncmds, COMMAND_COUNT);
+  CuAssertIntEquals(tc,
+    first_size + ((COMMAND_COUNT - 1) * 2), M_PBufGetSize(&pbuf)
+  );
+
+  M_PBufFree(&pbuf);
+}
+
+static void test_command_server_tics(CuTest *tc) {
+  netticcmd_t ncmds[COMMAND_COUNT];
+  pbuf_t pbuf;
+
+  M_PBufInit(&pbuf);
+
+  for (int i = 0; i < COMMAND_COUNT; i++) {
+    set_ncmd(&ncmds[i], 10 + i, 20 + i, i < 8 ? 0 : 30 + (i * 2), 0, 0, 0, 0);
+  }
+
+  assert_ncmds_round_trip(tc, &pbuf, ncmds, COMMAND_COUNT);
+
+  M_PBufFree(&pbuf);
+}
+
+static void test_command_extremes(CuTest *tc) {
+  netticcmd_t ncmds[8];
+  pbuf_t pbuf;
+
+  M_PBufInit(&pbuf);
+
+  set_ncmd(&ncmds[0], 0,        0,        0,        0,    0,    0,     0);
+  set_ncmd(&ncmds[1], UINT_MAX, UINT_MAX, UINT_MAX, 127,  -128, 32767, 255);
+  set_ncmd(&ncmds[2], 0,        0,        0,        -128, 127,  -32768, 0);
+  set_ncmd(&ncmds[3], 1,        1,        1,        127,  -128, 32767, 255);
+  set_ncmd(&ncmds[4], 1,        1,        1,        127,  -128, 32767, 255);
+  set_ncmd(&ncmds[5], 2,        0,        5,        -1,   1,    -1,    128);
+  set_ncmd(&ncmds[6], UINT_MAX, 3,        0,        0,    0,    0,     0);
+  set_ncmd(&ncmds[7], 0,        4,        0,        0,    0,    0,     0);
+
+  assert_ncmds_round_trip(tc, &pbuf, ncmds, 8);
+
+  M_PBufFree(&pbuf);
+}
+
+static void test_command_random(CuTest *tc) {
+  netticcmd_t ncmds[COMMAND_COUNT];
+  pbuf_t pbuf;
+
+  M_PBufInit(&pbuf);
+  srand(1);
+
+  for (int run = 0; run < 100; run++) {
+    for (int i = 0; i < COMMAND_COUNT; i++) {
+      set_ncmd(&ncmds[i],
+        rand() % 2 ? (unsigned int)rand() : 100 + i,
+        rand() % 2 ? (unsigned int)rand() : 200 + i,
+        rand() % 2 ? (unsigned int)rand() : 0,
+        rand() % 256 - 128,
+        rand() % 256 - 128,
+        rand() % 65536 - 32768,
+        rand() % 256
+      );
+    }
+
+    assert_ncmds_round_trip(tc, &pbuf, ncmds, COMMAND_COUNT);
+  }
+
+  M_PBufFree(&pbuf);
+}
+
+static void test_command_malformed(CuTest *tc) {
+  netticcmd_t ncmd;
+  pbuf_t pbuf;
+
+  M_PBufInit(&pbuf);
+
+  /* A delta needs a previous command to apply to */
+  M_PBufWriteUChar(&pbuf, 1);
+  M_PBufWriteUNum(&pbuf, 2);
+  M_PBufSeek(&pbuf, 0);
+  CuAssertTrue(tc, !N_UnpackCommand(&pbuf, NULL, &ncmd));
+
+  /* Deltas that land outside a field's range are rejected */
+  set_ncmd(&ncmd, 1, 1, 1, 127, 0, 0, 0);
+  M_PBufClear(&pbuf);
+  M_PBufWriteUChar(&pbuf, 1 << 3);
+  M_PBufWriteUNum(&pbuf, 2);
+  M_PBufSeek(&pbuf, 0);
+  CuAssertTrue(tc, !N_UnpackCommand(&pbuf, &ncmd, &ncmd));
+
+  /* Unknown flag combinations are rejected */
+  M_PBufClear(&pbuf);
+  M_PBufWriteUChar(&pbuf, 0x81);
+  M_PBufSeek(&pbuf, 0);
+  CuAssertTrue(tc, !N_UnpackCommand(&pbuf, &ncmd, &ncmd));
+
+  M_PBufFree(&pbuf);
+}
+
+static void test_player_sets(CuTest *tc) {
+  def_bitmap(bitmap, MAXPLAYERS);
+  def_bitmap(out, MAXPLAYERS);
+  pbuf_t pbuf;
+
+  M_PBufInit(&pbuf);
+  srand(1);
+
+  for (int run = 0; run < 300; run++) {
+    int count = rand() % MAXPLAYERS;
+
+    memset(bitmap, 0, sizeof(bitmap));
+
+    for (int i = 0; i < count; i++) {
+      int playernum = (run % 2) ? rand() % MAXPLAYERS : i;
+
+      bitmap_set_bit(bitmap, playernum);
+    }
+
+    for (int e = 0; e < PLAYER_SET_ENCODING_MAX; e++) {
+      M_PBufClear(&pbuf);
+      N_PackPlayerSetAs(&pbuf, bitmap, e);
+      CuAssertIntEquals(tc,
+        N_GetPlayerSetSize(bitmap, e), M_PBufGetSize(&pbuf)
+      );
+      M_PBufSeek(&pbuf, 0);
+      CuAssertTrue(tc, N_UnpackPlayerSet(&pbuf, out));
+      CuAssertTrue(tc, memcmp(bitmap, out, sizeof(bitmap)) == 0);
+    }
+  }
+
+  /* Player numbers past MAXPLAYERS are rejected */
+  M_PBufClear(&pbuf);
+  M_PBufWriteUChar(&pbuf, PLAYER_SET_INDICES);
+  M_PBufWriteArray(&pbuf, 1);
+  M_PBufWriteUNum(&pbuf, MAXPLAYERS);
+  M_PBufSeek(&pbuf, 0);
+  CuAssertTrue(tc, !N_UnpackPlayerSet(&pbuf, out));
+
+  M_PBufFree(&pbuf);
+}
+
+CuSuite* N_PackGetSuite(void) {
+  CuSuite *suite = CuSuiteNew();
+
+  SUITE_ADD_TEST(suite, test_command_steady_state);
+  SUITE_ADD_TEST(suite, test_command_server_tics);
+  SUITE_ADD_TEST(suite, test_command_extremes);
+  SUITE_ADD_TEST(suite, test_command_random);
+  SUITE_ADD_TEST(suite, test_command_malformed);
+  SUITE_ADD_TEST(suite, test_player_sets);
+
+  return suite;
+}
+
+/* vi: set et ts=2 sw=2: */